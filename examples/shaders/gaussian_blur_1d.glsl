@@ -8,6 +8,7 @@ uniform sampler2D tex;
 uniform ivec2 iresolution;
 
 uniform int kernel_size;
+uniform float weights[151]; // weights[i] is the weight at distance i from the center
 uniform float kernel_scale;
 uniform bool vertical;
 
@@ -22,13 +23,12 @@ void main()
         s = kernel_scale * vec2(1.0, 0.0) / float(tex_resolution.x);
     }
    
-    int h = kernel_size / 2;
-    float sigma = (kernel_size - 1) / 6.0;
+    int h = min(kernel_size / 2, 150);
     vec3 sum = vec3(0.0);
     float wsum = 0;
     for (int i = -h; i < h + 1; i++) {
         vec2 p = uv + i*s;
-        float w = (1.0 / (exp((i*i)/(2.0*sigma*sigma))));
+        float w = weights[abs(i)];
         sum += w * texture(tex, p).rgb;
         wsum += w;
     }
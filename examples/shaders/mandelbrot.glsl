@@ -4,6 +4,7 @@ precision highp float;
 out vec4 frag_color;
 
 uniform ivec2 iresolution;
+uniform ivec2 itile_offset;
 uniform float zoom;
 uniform int max_iterations;
 uniform vec2 position;
@@ -22,7 +23,7 @@ void main()
     vec2 uv, c, z; 
     int i;
 
-    uv = (2.0*gl_FragCoord.xy-iresolution.xy) / iresolution.y;
+    uv = (2.0*(gl_FragCoord.xy + itile_offset)-iresolution.xy) / iresolution.y;
 
     if (animate) {
         c = position + uv * (1.0 / animate_zoom);
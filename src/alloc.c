@@ -12,12 +12,14 @@
 
 static HglAllocator temp_allocator_internal_   = {0};
 static HglAllocator frame_arena_internal_      = {0};
+static HglAllocator sel_arena_internal_        = {0};
 static HglAllocator r2r_arena_internal_        = {0};
 static HglAllocator r2r_fs_allocator_internal_ = {0};
 static HglAllocator image_allocator_internal_  = {0};
 
 HglAllocator *g_temp_allocator   = NULL;
 HglAllocator *g_frame_arena      = NULL;
+HglAllocator *g_sel_arena        = NULL;
 HglAllocator *g_r2r_arena        = NULL;
 HglAllocator *g_r2r_fs_allocator = NULL;
 HglAllocator *g_image_allocator  = NULL;
@@ -28,6 +30,8 @@ void alloc_init()
                                                     .size = 4096);         //   4 KiB
     frame_arena_internal_          = hgl_alloc_make(.kind = HGL_ARENA_ALLOCATOR, 
                                                     .size = 1024*1024);    //   1 MiB
+    sel_arena_internal_            = hgl_alloc_make(.kind = HGL_STACK_ALLOCATOR, 
+                                                    .size = 16*1024*1024); //  16 MiB
     r2r_arena_internal_            = hgl_alloc_make(.kind = HGL_STACK_ALLOCATOR, 
                                                     .size = 16*1024*1024); //  16 MiB
 #if SHAQ_HUGEPAGES
@@ -53,6 +57,7 @@ void alloc_init()
 
     g_temp_allocator       = &temp_allocator_internal_;
     g_frame_arena          = &frame_arena_internal_;
+    g_sel_arena            = &sel_arena_internal_;
     g_r2r_arena        = &r2r_arena_internal_;
     g_r2r_fs_allocator = &r2r_fs_allocator_internal_;
     g_image_allocator      = &image_allocator_internal_;
@@ -61,11 +66,13 @@ void alloc_init()
 void alloc_final()
 {
     hgl_free_all(g_frame_arena);
+    hgl_free_all(g_sel_arena);
     hgl_free_all(g_r2r_arena);
     hgl_free_all(g_r2r_fs_allocator);
     hgl_free_all(g_image_allocator);
     hgl_alloc_destroy(g_temp_allocator);
     hgl_alloc_destroy(g_frame_arena);
+    hgl_alloc_destroy(g_sel_arena);
     hgl_alloc_destroy(g_r2r_arena);
     hgl_alloc_destroy(g_r2r_fs_allocator);
     hgl_alloc_destroy(g_image_allocator);
@@ -8,6 +8,7 @@
 
 extern Allocator *g_temp_allocator;   // for temporary allocations
 extern Allocator *g_frame_arena;      // for allocations that can be freed at the end of the frame
+extern Allocator *g_sel_arena;        // for SEL expression trees (freed by `sel_compile()` and `sel_end_session()`)
 extern Allocator *g_r2r_arena;        // for allocations that can be freed at the next reload
 extern Allocator *g_r2r_fs_allocator; // for allocations that can be freed at the next reload
 extern Allocator *g_image_allocator;  // for image allocations (freed opon opening a new project file)
@@ -0,0 +1,510 @@
+
+/*--- Include files ---------------------------------------------------------------------*/
+
+#include "fusion.h"
+#include "alloc.h"
+#include "log.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+/*--- Private macros --------------------------------------------------------------------*/
+
+#define FUSION_MAX_N_GLOBALS    256
+#define FUSION_MAX_N_EXTENSIONS 16
+#define FUSED_OUTPUT_NAME       "shaq_fused_color"
+
+/*--- Private type definitions ----------------------------------------------------------*/
+
+typedef enum {
+    TOK_SPACE, /* whitespace & comments */
+    TOK_IDENT,
+    TOK_NUMBER,
+    TOK_PUNCT,
+} TokenKind;
+
+typedef struct {
+    StringView text;
+    TokenKind kind;
+    u32 directive; /* 1-based index of the preprocessor directive the token belongs to, or 0 */
+    b8 drop;       /* token is omitted from the fused source */
+} Token;
+
+/*
+ * The result of scanning the source of a single pass. `globals` are all identifiers
+ * declared at global scope (including `main`, functions, uniforms, and macros). These
+ * are renamed in the fused source. `out_name` and `out_type` describe the single
+ * `out` variable of the pass, which becomes a plain global variable.
+ */
+typedef struct {
+    Token *tokens;
+    u32 n_tokens;
+    StringView globals[FUSION_MAX_N_GLOBALS];
+    u32 n_globals;
+    StringView out_name;
+    StringView out_type;
+    u32 n_outs;
+    i32 version;
+} ScannedPass;
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t capacity;
+} Emitter;
+
+/*--- Private function prototypes -------------------------------------------------------*/
+
+static u32 tokenize(StringView src, Token *tokens);
+static i32 scan_pass(ScannedPass *p, StringView *extensions, u32 *n_extensions);
+static i32 emit_pass(Emitter *e, const ScannedPass *p, const FusionPass *fp,
+                     const ScannedPass *prev, const FusionPass *prev_fp);
+static b8 is_global(const ScannedPass *p, StringView name);
+static i32 declare_global(ScannedPass *p, StringView name);
+static void drop_out_qualifiers(ScannedPass *p, u32 begin, u32 end);
+static u32 next_significant(const ScannedPass *p, u32 i);
+static u32 matching_paren(const ScannedPass *p, u32 i);
+static b8 token_is(const Token *t, const char *cstr);
+static void emit(Emitter *e, StringView sv);
+static void emit_cstr(Emitter *e, const char *cstr);
+
+/*--- Public variables ------------------------------------------------------------------*/
+
+/*--- Private variables -----------------------------------------------------------------*/
+
+/* Sampling functions that may read the input of a point-wise pass */
+static const char *const SAMPLING_FUNCTIONS[] = {"texture", "textureLod", "texelFetch"};
+
+/*--- Public functions ------------------------------------------------------------------*/
+
+/*
+ * Generates a single fragment shader from a chain of point-wise passes. Each pass
+ * keeps its own source, but every global identifier is renamed with the prefix of
+ * the pass, its `main` becomes an ordinary function, and its `out` variable becomes
+ * an ordinary global. Wherever a pass samples its input, the sample is replaced with
+ * the output variable of the previous pass. The generated `main` calls the passes
+ * in order and writes the output of the last one.
+ *
+ * Returns NULL if any pass uses a construct that can't be fused. The returned string
+ * is allocated with `r2r_fs_alloc`.
+ */
+char *fusion_make_source(const FusionPass *passes, u32 n_passes)
+{
+    char *ret = NULL;
+    StringView extensions[FUSION_MAX_N_EXTENSIONS];
+    u32 n_extensions = 0;
+    i32 version = 330;
+    size_t capacity = 1024;
+
+    ScannedPass *scanned = r2r_fs_alloc(n_passes * sizeof(*scanned));
+    if (scanned == NULL) {
+        log_error("Pass fusion: out of memory.");
+        return NULL;
+    }
+    memset(scanned, 0, n_passes * sizeof(*scanned));
+
+    /* tokenize and scan all passes */
+    for (u32 i = 0; i < n_passes; i++) {
+        ScannedPass *p = &scanned[i];
+        p->tokens = r2r_fs_alloc((passes[i].source.length + 1) * sizeof(Token));
+        if (p->tokens == NULL) {
+            log_error("Pass fusion: out of memory.");
+            goto out;
+        }
+        p->n_tokens = tokenize(passes[i].source, p->tokens);
+        if (scan_pass(p, extensions, &n_extensions) != 0) {
+            goto out;
+        }
+        if (p->n_outs != 1) {
+            log_info("Pass fusion: pass %u must declare exactly one `out` variable.", i);
+            goto out;
+        }
+        version = (p->version > version) ? p->version : version;
+
+        /* every identifier may grow by the length of the prefix, or be replaced by the previous output */
+        size_t growth = passes[i].prefix.length + 2;
+        if (i > 0) {
+            growth += passes[i - 1].prefix.length + scanned[i - 1].out_name.length;
+        }
+        capacity += passes[i].source.length + p->n_tokens * growth + passes[i].prefix.length + 64;
+    }
+
+    /* generate the fused source */
+    Emitter e = {
+        .buf = r2r_fs_alloc(capacity),
+        .size = 0,
+        .capacity = capacity,
+    };
+    if (e.buf == NULL) {
+        log_error("Pass fusion: out of memory.");
+        goto out;
+    }
+
+    char line[128];
+    snprintf(line, sizeof(line), "#version %d\n", version);
+    emit_cstr(&e, line);
+    for (u32 i = 0; i < n_extensions; i++) {
+        emit(&e, extensions[i]);
+        emit_cstr(&e, "\n");
+    }
+    emit_cstr(&e, "out ");
+    emit(&e, scanned[n_passes - 1].out_type);
+    emit_cstr(&e, " " FUSED_OUTPUT_NAME ";\n");
+
+    for (u32 i = 0; i < n_passes; i++) {
+        snprintf(line, sizeof(line), "#line 1 %u\n", i);
+        emit_cstr(&e, line);
+        i32 err = emit_pass(&e, &scanned[i], &passes[i],
+                            (i > 0) ? &scanned[i - 1] : NULL,
+                            (i > 0) ? &passes[i - 1] : NULL);
+        if (err != 0) {
+            r2r_fs_free(e.buf);
+            goto out;
+        }
+        emit_cstr(&e, "\n");
+    }
+
+    emit_cstr(&e, "void main()\n{\n");
+    for (u32 i = 0; i < n_passes; i++) {
+        emit_cstr(&e, "    ");
+        emit(&e, passes[i].prefix);
+        emit_cstr(&e, "main();\n");
+    }
+    emit_cstr(&e, "    " FUSED_OUTPUT_NAME " = ");
+    emit(&e, passes[n_passes - 1].prefix);
+    emit(&e, scanned[n_passes - 1].out_name);
+    emit_cstr(&e, ";\n}\n");
+    e.buf[e.size] = '\0';
+    ret = e.buf;
+
+out:
+    for (u32 i = n_passes; i > 0; i--) {
+        if (scanned[i - 1].tokens != NULL) {
+            r2r_fs_free(scanned[i - 1].tokens);
+        }
+    }
+    r2r_fs_free(scanned);
+    return ret;
+}
+
+/*--- Private functions -----------------------------------------------------------------*/
+
+static u32 tokenize(StringView src, Token *tokens)
+{
+    u32 n = 0;
+    u32 n_directives = 0;
+    u32 directive = 0;
+    b8 line_start = true;
+    size_t i = 0;
+
+    while (i < src.length) {
+        const char *s = &src.start[i];
+        size_t rem = src.length - i;
+        size_t len = 1;
+        TokenKind kind = TOK_PUNCT;
+
+        if (rem >= 2 && s[0] == '/' && s[1] == '/') {
+            kind = TOK_SPACE;
+            while (len < rem && s[len] != '\n') len++;
+        } else if (rem >= 2 && s[0] == '/' && s[1] == '*') {
+            kind = TOK_SPACE;
+            len = 2;
+            while (len < rem && !(s[len - 1] == '*' && s[len] == '/' && len > 2)) len++;
+            len = (len < rem) ? len + 1 : rem;
+        } else if (isspace((unsigned char)s[0])) {
+            kind = TOK_SPACE;
+            len = 0;
+            while (len < rem && isspace((unsigned char)s[len])) {
+                /* an unescaped newline ends a preprocessor directive */
+                if (s[len] == '\n' && !(i + len > 0 && src.start[i + len - 1] == '\\')) {
+                    directive = 0;
+                    line_start = true;
+                }
+                len++;
+            }
+        } else if (isalpha((unsigned char)s[0]) || s[0] == '_') {
+            kind = TOK_IDENT;
+            while (len < rem && (isalnum((unsigned char)s[len]) || s[len] == '_')) len++;
+        } else if (isdigit((unsigned char)s[0]) ||
+                   (s[0] == '.' && rem >= 2 && isdigit((unsigned char)s[1]))) {
+            kind = TOK_NUMBER;
+            while (len < rem && (isalnum((unsigned char)s[len]) || s[len] == '.' || s[len] == '_')) len++;
+        } else if (s[0] == '#' && line_start) {
+            directive = ++n_directives;
+        }
+
+        if (kind != TOK_SPACE) {
+            line_start = false;
+        }
+
+        tokens[n++] = (Token){
+            .text = sv_from(s, len),
+            .kind = kind,
+            .directive = directive,
+            .drop = false,
+        };
+        i += len;
+    }
+
+    return n;
+}
+
+static i32 scan_pass(ScannedPass *p, StringView *extensions, u32 *n_extensions)
+{
+    i32 brace_depth = 0;
+    i32 paren_depth = 0;
+    b8 in_initializer = false;
+    b8 is_out = false;
+    b8 is_precision = false;
+    u32 stmt_begin = 0;
+    StringView prev_ident = {0};
+
+    for (u32 i = 0; i < p->n_tokens; i++) {
+        Token *t = &p->tokens[i];
+        if (t->kind == TOK_SPACE) {
+            continue;
+        }
+
+        /* preprocessor directive */
+        if (t->directive != 0) {
+            u32 end = i;
+            while (end < p->n_tokens && p->tokens[end].directive == t->directive) end++;
+            u32 name = next_significant(p, i);
+            u32 arg = (name < end) ? next_significant(p, name) : end;
+            if (name < end && token_is(&p->tokens[name], "version")) {
+                p->version = (arg < end) ? (i32)sv_to_i64(p->tokens[arg].text) : 0;
+                for (u32 j = i; j < end; j++) p->tokens[j].drop = true;
+            } else if (name < end && token_is(&p->tokens[name], "extension")) {
+                if (*n_extensions >= FUSION_MAX_N_EXTENSIONS) {
+                    log_info("Pass fusion: too many `#extension` directives.");
+                    return -1;
+                }
+                const Token *last = &p->tokens[end - 1];
+                while (last->kind == TOK_SPACE) last--;
+                extensions[(*n_extensions)++] = sv_from(t->text.start,
+                                                        (size_t)(last->text.start + last->text.length - t->text.start));
+                for (u32 j = i; j < end; j++) p->tokens[j].drop = true;
+            } else if (name < end && token_is(&p->tokens[name], "define") &&
+                       arg < end && p->tokens[arg].kind == TOK_IDENT) {
+                if (declare_global(p, p->tokens[arg].text) != 0) {
+                    return -1;
+                }
+            }
+            i = end - 1;
+            continue;
+        }
+
+        /* only declarations at global scope are of interest */
+        if (token_is(t, "{")) {
+            brace_depth++;
+            continue;
+        } else if (token_is(t, "}")) {
+            brace_depth--;
+            if (brace_depth == 0) {
+                stmt_begin = i + 1;
+                in_initializer = false;
+            }
+            continue;
+        } else if (brace_depth > 0) {
+            continue;
+        }
+
+        if (token_is(t, "(")) {
+            paren_depth++;
+            continue;
+        } else if (token_is(t, ")")) {
+            paren_depth--;
+            continue;
+        } else if (paren_depth > 0) {
+            continue;
+        }
+
+        if (token_is(t, ";")) {
+            if (is_out) {
+                drop_out_qualifiers(p, stmt_begin, i);
+            }
+            stmt_begin = i + 1;
+            in_initializer = false;
+            is_out = false;
+            is_precision = false;
+        } else if (token_is(t, "=")) {
+            in_initializer = true;
+        } else if (token_is(t, ",")) {
+            in_initializer = false;
+        } else if (t->kind == TOK_IDENT) {
+            u32 next = next_significant(p, i);
+            if (token_is(t, "precision")) {
+                is_precision = true;
+            } else if (token_is(t, "out")) {
+                is_out = true;
+            } else if (token_is(t, "struct")) {
+                if (next < p->n_tokens && p->tokens[next].kind == TOK_IDENT &&
+                    declare_global(p, p->tokens[next].text) != 0) {
+                    return -1;
+                }
+            } else if (!in_initializer && !is_precision && !token_is(t, "layout") && next < p->n_tokens &&
+                       (token_is(&p->tokens[next], "(") || token_is(&p->tokens[next], ";") ||
+                        token_is(&p->tokens[next], "=") || token_is(&p->tokens[next], ",") ||
+                        token_is(&p->tokens[next], "["))) {
+                if (declare_global(p, t->text) != 0) {
+                    return -1;
+                }
+                if (is_out) {
+                    p->out_name = t->text;
+                    p->out_type = prev_ident;
+                    p->n_outs++;
+                }
+            }
+            prev_ident = t->text;
+        }
+    }
+
+    return 0;
+}
+
+static i32 emit_pass(Emitter *e, const ScannedPass *p, const FusionPass *fp,
+                     const ScannedPass *prev, const FusionPass *prev_fp)
+{
+    i32 brace_depth = 0;
+    const Token *prev_sig = NULL;
+
+    for (u32 i = 0; i < p->n_tokens; i++) {
+        const Token *t = &p->tokens[i];
+        if (t->drop) {
+            continue;
+        }
+
+        if (t->kind == TOK_PUNCT && t->directive == 0) {
+            brace_depth += token_is(t, "{") ? 1 : 0;
+            brace_depth -= token_is(t, "}") ? 1 : 0;
+        }
+
+        if (t->kind != TOK_IDENT) {
+            emit(e, t->text);
+            prev_sig = (t->kind != TOK_SPACE) ? t : prev_sig;
+            continue;
+        }
+
+        /* replace sampling of the input with the output of the previous pass */
+        if (prev != NULL && fp->input.length > 0) {
+            b8 is_sampling_function = false;
+            for (u32 j = 0; j < sizeof(SAMPLING_FUNCTIONS) / sizeof(SAMPLING_FUNCTIONS[0]); j++) {
+                is_sampling_function |= token_is(t, SAMPLING_FUNCTIONS[j]);
+            }
+            u32 lparen  = next_significant(p, i);
+            u32 sampler = (lparen < p->n_tokens) ? next_significant(p, lparen) : p->n_tokens;
+            u32 comma   = (sampler < p->n_tokens) ? next_significant(p, sampler) : p->n_tokens;
+            if (is_sampling_function && comma < p->n_tokens &&
+                token_is(&p->tokens[lparen], "(") &&
+                sv_equals(p->tokens[sampler].text, fp->input) &&
+                token_is(&p->tokens[comma], ",")) {
+                emit_cstr(e, "(");
+                emit(e, prev_fp->prefix);
+                emit(e, prev->out_name);
+                emit_cstr(e, ")");
+                i = matching_paren(p, lparen);
+                prev_sig = &p->tokens[i];
+                continue;
+            }
+            if (brace_depth > 0 && sv_equals(t->text, fp->input)) {
+                log_info("Pass fusion: `" SV_FMT "` is used other than as the first argument of `texture()`.",
+                         SV_ARG(fp->input));
+                return -1;
+            }
+        }
+
+        /* members and swizzles are never renamed */
+        b8 is_member = (prev_sig != NULL) && token_is(prev_sig, ".");
+        if (!is_member && is_global(p, t->text)) {
+            emit(e, fp->prefix);
+        }
+        emit(e, t->text);
+        prev_sig = t;
+    }
+
+    return 0;
+}
+
+static b8 is_global(const ScannedPass *p, StringView name)
+{
+    for (u32 i = 0; i < p->n_globals; i++) {
+        if (sv_equals(p->globals[i], name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static i32 declare_global(ScannedPass *p, StringView name)
+{
+    if (is_global(p, name)) {
+        return 0; /* e.g. a function prototype */
+    }
+    if (p->n_globals >= FUSION_MAX_N_GLOBALS) {
+        log_info("Pass fusion: too many global declarations.");
+        return -1;
+    }
+    p->globals[p->n_globals++] = name;
+    return 0;
+}
+
+static void drop_out_qualifiers(ScannedPass *p, u32 begin, u32 end)
+{
+    for (u32 i = begin; i < end; i++) {
+        Token *t = &p->tokens[i];
+        if (token_is(t, "out")) {
+            t->drop = true;
+        } else if (token_is(t, "layout")) {
+            u32 lparen = next_significant(p, i);
+            if (lparen < end && token_is(&p->tokens[lparen], "(")) {
+                u32 rparen = matching_paren(p, lparen);
+                for (u32 j = i; j <= rparen && j < end; j++) p->tokens[j].drop = true;
+                i = rparen;
+            }
+        }
+    }
+}
+
+static u32 next_significant(const ScannedPass *p, u32 i)
+{
+    for (i = i + 1; i < p->n_tokens; i++) {
+        if (p->tokens[i].kind != TOK_SPACE) {
+            break;
+        }
+    }
+    return i;
+}
+
+static u32 matching_paren(const ScannedPass *p, u32 i)
+{
+    i32 depth = 0;
+    for (; i < p->n_tokens; i++) {
+        depth += token_is(&p->tokens[i], "(") ? 1 : 0;
+        depth -= token_is(&p->tokens[i], ")") ? 1 : 0;
+        if (depth == 0) {
+            break;
+        }
+    }
+    return (i < p->n_tokens) ? i : p->n_tokens - 1;
+}
+
+static b8 token_is(const Token *t, const char *cstr)
+{
+    return sv_equals(t->text, sv_from_cstr(cstr));
+}
+
+static void emit(Emitter *e, StringView sv)
+{
+    if (e->size + sv.length >= e->capacity) {
+        return; /* can't happen - the capacity is an upper bound */
+    }
+    memcpy(&e->buf[e->size], sv.start, sv.length);
+    e->size += sv.length;
+}
+
+static void emit_cstr(Emitter *e, const char *cstr)
+{
+    emit(e, sv_from_cstr(cstr));
+}
+
@@ -0,0 +1,27 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+/*--- Include files ---------------------------------------------------------------------*/
+
+#include "str.h"
+#include "hgl_int.h"
+
+/*--- Public macros ---------------------------------------------------------------------*/
+
+/*--- Public type definitions -----------------------------------------------------------*/
+
+/* One pass in a chain of point-wise passes that are fused into a single program. */
+typedef struct {
+    StringView source; /* GLSL source of the pass */
+    StringView prefix; /* prepended to every global identifier of the pass */
+    StringView input;  /* sampler uniform fed by the previous pass. Empty for the first pass */
+} FusionPass;
+
+/*--- Public variables ------------------------------------------------------------------*/
+
+/*--- Public function prototypes --------------------------------------------------------*/
+
+char *fusion_make_source(const FusionPass *passes, u32 n_passes);
+
+#endif /* FUSION_H */
+
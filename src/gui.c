@@ -9,6 +9,7 @@
 #include "renderer.h"
 #include "log.h"
 #include "uniform.h"
+#include "hgl_da.h"
 
 /*--- Private macros --------------------------------------------------------------------*/
 
@@ -16,16 +17,25 @@
 
 typedef struct
 {
-    StringView label;
+    StringView label; // points into `imgui_label`. The label passed in only lives until the next reload
+    char *imgui_label; // owned. The label followed by "##widget"
     SelValue value;
     WidgetKind kind;
     u8 secondary_args[64];
-    b8 touched_this_frame;
+    u32 secondary_args_size;
+    u64 hash;
+    u64 touched_at;   // last frame an expression asked for the widget
+    b8 is_listed;     // shown in the widget panel
 } Widget;
 
 /*--- Private function prototypes -------------------------------------------------------*/
 
 static inline void draw_and_update_widget(Widget *w);
+static u64 widget_hash(StringView label, WidgetKind kind, const void *secondary_args, u32 secondary_args_size);
+static i32 widget_find(StringView label, WidgetKind kind, const void *secondary_args, u32 secondary_args_size);
+static u32 widget_insert(StringView label, WidgetKind kind, const void *secondary_args, u32 secondary_args_size);
+static inline void widget_touch(u32 handle);
+static void widget_index_rebuild(u32 capacity);
 static inline void draw_uniform(const Uniform *u);
 
 /*--- Public variables ------------------------------------------------------------------*/
@@ -34,7 +44,10 @@ static inline void draw_uniform(const Uniform *u);
 
 static struct
 {
-    Array(Widget, SHAQ_MAX_N_DYNAMIC_GUI_ITEMS) widgets;
+    HglDynamicArray(Widget) widgets; // the handles index it, so widgets only move on a reload
+    HglDynamicArray(u32) listed;     // the widgets shown in the panel
+    u32 *index;                      // open addressing on `hash`: 1 + handle, or 0 if empty
+    u32 index_capacity;              // a power of two, at least twice the number of widgets
     b8 dark_mode;
     b8 should_reload;
     b8 shader_window_is_active;
@@ -42,6 +55,7 @@ static struct
     IVec2 shader_window_position;
     IVec2 shader_window_size;
     f32 smoothed_deltatime;
+    u64 frame;
 } gui;
 
 /*--- Public functions ------------------------------------------------------------------*/
@@ -58,16 +72,45 @@ void gui_init(GLFWwindow *window, GLFWmonitor *monitor)
 void gui_final()
 {
     imgui_final();
+    gui_clear_widgets();
+    hgl_da_free(&gui.widgets);
+    hgl_da_free(&gui.listed);
+    free(gui.index);
 }
 
 void gui_reload()
 {
     gui.should_reload = false;
+
+    /* 
+     * The expressions holding handles are about to be recompiled, so this is when 
+     * widgets left out of the panel are dropped for good (see `gui_end_frame()`).
+     */
+    u32 n = 0;
+    for (u32 i = 0; i < gui.widgets.length; i++) {
+        Widget *w = &gui.widgets.arr[i];
+        if (!w->is_listed) {
+            free(w->imgui_label);
+            continue;
+        }
+        gui.widgets.arr[n++] = *w;
+    }
+    gui.widgets.length = n;
+    gui.listed.length = 0;
+    for (u32 i = 0; i < gui.widgets.length; i++) {
+        hgl_da_push(&gui.listed, i);
+    }
+    widget_index_rebuild(gui.index_capacity);
 }
 
 void gui_clear_widgets()
 {
-    array_clear(&gui.widgets);
+    for (u32 i = 0; i < gui.widgets.length; i++) {
+        free(gui.widgets.arr[i].imgui_label);
+    }
+    gui.widgets.length = 0;
+    gui.listed.length = 0;
+    widget_index_rebuild(gui.index_capacity);
 }
 
 void gui_begin_frame()
@@ -221,7 +264,7 @@ void gui_draw_shader_info(const Shader *s)
             imgui_tree_pop();
         }
         if (imgui_tree_node("Uniforms")) {
-            imgui_begin_table(" ", 2);
+            imgui_begin_table(" ", 3);
             for (u32 j = 0; j < s->uniforms.count; j++) {
                 draw_uniform(&s->uniforms.arr[j]);
             }
@@ -232,6 +275,38 @@ void gui_draw_shader_info(const Shader *s)
     }
 }
 
+/* Hit rates of the memoized builtin calls (see `FUNC_FLAG_MEMO`) of the frame programs */
+void gui_draw_memo_stats(ExeExpr *const *programs, u32 n)
+{
+    if (n == 0 || !imgui_tree_node("Memoized calls")) {
+        return;
+    }
+    imgui_begin_table(" ", 2);
+    for (u32 i = 0; i < N_BUILTIN_FUNCTIONS; i++) {
+        const Func *f = &BUILTIN_FUNCTIONS[i];
+        if (!(f->flags & FUNC_FLAG_MEMO)) {
+            continue;
+        }
+        u32 n_hits = 0;
+        u32 n_calls = 0;
+        for (u32 j = 0; j < n; j++) {
+            u32 program_n_hits;
+            n_calls += sel_memo_stats(programs[j], i, &program_n_hits);
+            n_hits += program_n_hits;
+        }
+        if (n_calls == 0) {
+            continue;
+        }
+        imgui_table_next_row();
+        imgui_table_next_col();
+        imgui_textf(SV_FMT, SV_ARG(f->id));
+        imgui_table_next_col();
+        imgui_textf("%u of %u calls (%.1f%%) reused", n_hits, n_calls, 100.0 * n_hits / n_calls);
+    }
+    imgui_end_table();
+    imgui_tree_pop();
+}
+
 void gui_draw_shader(const Shader *s)
 {
     if (!shader_is_ok(s)) {
@@ -246,9 +321,14 @@ void gui_draw_shader(const Shader *s)
 void gui_draw_widgets()
 {
     imgui_textf("Widgets:"); imgui_newline();
-    for (u32 i = 0; i < gui.widgets.count; i++) {
-        Widget *w = &gui.widgets.arr[i];
-        draw_and_update_widget(w);
+
+    /* every widget is one line high, so only the visible ones need to be drawn */
+    i32 start, end;
+    imgui_begin_list_clipper((i32) gui.listed.length);
+    while (imgui_list_clipper_step(&start, &end)) {
+        for (i32 i = start; i < end; i++) {
+            draw_and_update_widget(&gui.widgets.arr[gui.listed.arr[i]]);
+        }
     }
     imgui_separator();
 }
@@ -267,14 +347,25 @@ void gui_end_main_window()
 void gui_end_frame()
 {
     imgui_end_frame();
-    for (u32 i = 0; i < gui.widgets.count; i++) {
-        Widget *w = &gui.widgets.arr[i];
-        if (w->touched_this_frame) {
-            w->touched_this_frame = false;
-        } else {
-            array_delete(&gui.widgets, i);
+
+    /*
+     * Expressions are only re-evaluated when something they depend on changes,
+     * so an untouched widget is not necessarily unused. After a reload however,
+     * every expression is evaluated anew and any widget left untouched belongs 
+     * to an expression that no longer exists. It is taken out of the panel, and 
+     * dropped on the next reload unless something asks for it again.
+     */
+    if (shaq_reloaded_this_frame()) {
+        gui.listed.length = 0;
+        for (u32 i = 0; i < gui.widgets.length; i++) {
+            Widget *w = &gui.widgets.arr[i];
+            w->is_listed = (w->touched_at == gui.frame);
+            if (w->is_listed) {
+                hgl_da_push(&gui.listed, i);
+            }
         }
     }
+    gui.frame++;
 }
 
 void gui_draw_log_window()
@@ -406,55 +497,40 @@ SelValue gui_get_widget_value(StringView label,
                               void *secondary_args,
                               u32 secondary_args_size)
 {
-    // TODO cache items somehow?
+    i32 handle = widget_find(label, kind, secondary_args, secondary_args_size);
+    if (handle != -1) {
+        return gui_get_widget_value_by_handle((u32) handle);
+    }
+    (void) widget_insert(label, kind, secondary_args, secondary_args_size);
 
-    /* try lookup */
-    for (u32 i = 0; i < gui.widgets.count; i++) {
-        Widget *w = &gui.widgets.arr[i];
-        if (w->kind != kind) {
-            continue;
-        }
-        if (!sv_equals(w->label, label)) {
-            continue;
-        }
-        if (0 != memcmp(w->secondary_args, secondary_args, secondary_args_size)) {
-            continue;
-        }
-        w->touched_this_frame = true;
-        return w->value;
-    }
-    
-    /* not found - insert */
-    i32 *args_i32   = (i32 *)secondary_args;
-    f32 *args_f32   = (f32 *)secondary_args;
-    Vec2 *args_vec2 = (Vec2 *)secondary_args;
-    Vec3 *args_vec3 = (Vec3 *)secondary_args;
-    Vec4 *args_vec4 = (Vec4 *)secondary_args;
-    SelValue default_value;
-    switch (kind) {
-        case INPUT_INT:        default_value.val_i32  = args_i32[0];  break;
-        case INPUT_FLOAT:      default_value.val_f32  = args_f32[0];  break;
-        case INPUT_VEC2:       default_value.val_vec2 = args_vec2[0]; break;
-        case INPUT_VEC3:       default_value.val_vec3 = args_vec3[0]; break;
-        case INPUT_VEC4:       default_value.val_vec4 = args_vec4[0]; break;
-        case CHECKBOX:         default_value.val_bool = args_i32[0];  break;
-        case DRAG_INT:         default_value.val_i32  = args_i32[3];  break;
-        case SLIDER_FLOAT:     default_value.val_f32  = args_f32[2];  break;
-        case SLIDER_FLOAT_LOG: default_value.val_f32  = args_f32[2];  break;
-        case COLOR_PICKER:     default_value.val_vec4 = args_vec4[0]; break;
-    } 
-    Widget w = (Widget) {
-        .label              = label,
-        .kind               = kind,
-        .value              = default_value,
-        .touched_this_frame = true,
-    };
-    memcpy(w.secondary_args, secondary_args, secondary_args_size);
-    array_push(&gui.widgets, w);
+    /* the default value is reported from the next evaluation and on */
+    sel_signal(SEL_DEP_WIDGET);
 
     return (SelValue) {0};
 }
 
+/*
+ * Registers the widget, unless it already exists, and returns a handle to it for 
+ * `gui_get_widget_value_by_handle()`. Handles are valid until the next reload. 
+ */
+u32 gui_register_widget(StringView label,
+                        WidgetKind kind,
+                        const void *secondary_args,
+                        u32 secondary_args_size)
+{
+    i32 handle = widget_find(label, kind, secondary_args, secondary_args_size);
+    if (handle != -1) {
+        return (u32) handle;
+    }
+    return widget_insert(label, kind, secondary_args, secondary_args_size);
+}
+
+SelValue gui_get_widget_value_by_handle(u32 handle)
+{
+    widget_touch(handle);
+    return gui.widgets.arr[handle].value;
+}
+
 b8 gui_should_reload()
 {
 #if SHAQ_RELOAD_DURING_RESIZE
@@ -481,22 +557,8 @@ b8 gui_should_reload()
 
 static inline void draw_and_update_widget(Widget *w)
 {
-    StringBuilder sb = sb_make(.initial_capacity = 256,
-                               .mem_alloc        = tmp_alloc,
-                               .mem_realloc      = dummy_realloc,
-                               .mem_free         = dummy_free);
-    sb_append_sv(&sb, &w->label);
-    sb_append_cstr(&sb, "##widget");
-    char *label_cstr = sb.cstr;
-
-    /**
-     * TODO: Figure out why this happens. It doesn't seem to cause any
-     *       unexpected behaviors though.
-     */
-    if (strlen(label_cstr) == 0) {
-        assert(false && "Huh?");
-        return;
-    }
+    SelValue last = w->value;
+    const char *label_cstr = w->imgui_label;
 
     switch (w->kind) {
         case INPUT_INT: {
@@ -544,15 +606,23 @@ static inline void draw_and_update_widget(Widget *w)
             imgui_color_picker(label_cstr, (f32 *)&w->value.val_vec4);
         } break;
     }
+
+    if (memcmp(&last, &w->value, sizeof(SelValue)) != 0) {
+        sel_signal(SEL_DEP_WIDGET);
+    }
 }
 
 static inline void draw_uniform(const Uniform *u)
 {
     imgui_table_next_row();
     imgui_table_next_col();
-    imgui_textf("%s " SV_FMT, TYPE_TO_STR[u->type], SV_ARG(u->name));
+    if (u->count > 0) {
+        imgui_textf("%s " SV_FMT "[%u]", TYPE_TO_STR[u->type], SV_ARG(u->name), u->count);
+    } else {
+        imgui_textf("%s " SV_FMT, TYPE_TO_STR[u->type], SV_ARG(u->name));
+    }
     imgui_table_next_col();
-    SelValue v = u->exe->cached_computed_value;
+    SelValue v = uniform_get_value(u); // the first element, for arrays
     switch (u->type) {
         case TYPE_BOOL:    imgui_textf(v.val_bool ? "= true" : "= false"); break;
         case TYPE_INT:     imgui_textf("= %d", v.val_i32);  break;
@@ -574,6 +644,135 @@ static inline void draw_uniform(const Uniform *u)
         case N_TYPES:
             log_error("Strange logic error that shouldn't happen<%s:%d>", __FILE__, __LINE__);
     }
+    imgui_table_next_col();
+    if (u->exe != NULL) {
+        imgui_textf((u->exe->qualifier & QUALIFIER_CONST) ? "cost %u, once" : "cost %u", u->exe->cost);
+    }
     imgui_newline();
 }
 
+static u64 widget_hash(StringView label, WidgetKind kind, const void *secondary_args, u32 secondary_args_size)
+{
+    u64 h = 14695981039346656037ull;
+    #define HASH_BYTES(ptr_, size_)                                 \
+        for (u32 i_ = 0; i_ < (size_); i_++) {                      \
+            h = (h ^ ((const u8 *)(ptr_))[i_]) * 1099511628211ull;  \
+        }
+    HASH_BYTES(&kind, sizeof(kind));
+    HASH_BYTES(label.start, label.length);
+    HASH_BYTES(secondary_args, secondary_args_size);
+    #undef HASH_BYTES
+    return h;
+}
+
+/* Handle of the widget, or -1 if there is no such widget */
+static i32 widget_find(StringView label, WidgetKind kind, const void *secondary_args, u32 secondary_args_size)
+{
+    if (gui.index_capacity == 0) {
+        return -1;
+    }
+    u64 hash = widget_hash(label, kind, secondary_args, secondary_args_size);
+    u32 mask = gui.index_capacity - 1;
+    for (u32 i = (u32) hash & mask; gui.index[i] != 0; i = (i + 1) & mask) {
+        u32 handle = gui.index[i] - 1;
+        Widget *w = &gui.widgets.arr[handle];
+        if (w->hash == hash &&
+            w->kind == kind &&
+            sv_equals(w->label, label) &&
+            memcmp(w->secondary_args, secondary_args, secondary_args_size) == 0) {
+            return (i32) handle;
+        }
+    }
+    return -1;
+}
+
+static u32 widget_insert(StringView label, WidgetKind kind, const void *secondary_args, u32 secondary_args_size)
+{
+    /* 
+     * The secondary arguments are packed by the VM and are not necessarily aligned 
+     * for the vector types, so copy them out. 
+     */
+    const u8 *args8 = (const u8 *)secondary_args;
+    SelValue default_value = {0};
+    switch (kind) {
+        case INPUT_INT:        memcpy(&default_value.val_i32,  args8,             sizeof(i32));  break;
+        case INPUT_FLOAT:      memcpy(&default_value.val_f32,  args8,             sizeof(f32));  break;
+        case INPUT_VEC2:       memcpy(&default_value.val_vec2, args8,             2*sizeof(f32)); break;
+        case INPUT_VEC3:       memcpy(&default_value.val_vec3, args8,             3*sizeof(f32)); break;
+        case INPUT_VEC4:       memcpy(&default_value.val_vec4, args8,             4*sizeof(f32)); break;
+        case DRAG_INT:         memcpy(&default_value.val_i32,  args8 + 12,        sizeof(i32));  break;
+        case SLIDER_FLOAT:     memcpy(&default_value.val_f32,  args8 + 8,         sizeof(f32));  break;
+        case SLIDER_FLOAT_LOG: memcpy(&default_value.val_f32,  args8 + 8,         sizeof(f32));  break;
+        case COLOR_PICKER:     memcpy(&default_value.val_vec4, args8,             4*sizeof(f32)); break;
+        case CHECKBOX: {
+            i32 checked;
+            memcpy(&checked, args8, sizeof(i32));
+            default_value.val_bool = checked;
+        } break;
+    } 
+    static const char suffix[] = "##widget";
+    char *imgui_label = malloc(label.length + sizeof(suffix));
+    assert(imgui_label != NULL);
+    memcpy(imgui_label, label.start, label.length);
+    memcpy(imgui_label + label.length, suffix, sizeof(suffix));
+    Widget w = (Widget) {
+        .label               = (StringView) {.start = imgui_label, .length = label.length},
+        .imgui_label         = imgui_label,
+        .kind                = kind,
+        .value               = default_value,
+        .secondary_args_size = secondary_args_size,
+        .hash                = widget_hash(label, kind, secondary_args, secondary_args_size),
+        .touched_at          = gui.frame,
+        .is_listed           = true,
+    };
+    assert(secondary_args_size <= sizeof(w.secondary_args));
+    memcpy(w.secondary_args, secondary_args, secondary_args_size);
+    u32 handle = (u32) gui.widgets.length;
+    hgl_da_push(&gui.widgets, w);
+    hgl_da_push(&gui.listed, handle);
+
+    /* keep the index at most half full */
+    if (2*gui.widgets.length > gui.index_capacity) {
+        widget_index_rebuild((gui.index_capacity == 0) ? 64 : 2*gui.index_capacity);
+    } else {
+        u32 mask = gui.index_capacity - 1;
+        u32 i = (u32) w.hash & mask;
+        while (gui.index[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        gui.index[i] = handle + 1;
+    }
+    return handle;
+}
+
+static inline void widget_touch(u32 handle)
+{
+    Widget *w = &gui.widgets.arr[handle];
+    w->touched_at = gui.frame;
+    if (!w->is_listed) {
+        w->is_listed = true;
+        hgl_da_push(&gui.listed, handle);
+    }
+}
+
+static void widget_index_rebuild(u32 capacity)
+{
+    if (capacity != gui.index_capacity) {
+        free(gui.index);
+        gui.index = malloc(capacity * sizeof(u32));
+        assert(gui.index != NULL);
+        gui.index_capacity = capacity;
+    }
+    if (capacity == 0) {
+        return;
+    }
+    memset(gui.index, 0, capacity * sizeof(u32));
+    u32 mask = capacity - 1;
+    for (u32 handle = 0; handle < gui.widgets.length; handle++) {
+        u32 i = (u32) gui.widgets.arr[handle].hash & mask;
+        while (gui.index[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        gui.index[i] = handle + 1;
+    }
+}
@@ -44,6 +44,7 @@ b8 gui_begin_shader_window(void);
 void gui_draw_help(void);
 i32 gui_draw_shader_display_selector(i32 current_idx, Shader *shaders, u32 n_shaders);
 void gui_draw_shader_info(const Shader *s);
+void gui_draw_memo_stats(ExeExpr *const *programs, u32 n);
 void gui_draw_shader(const Shader *s);
 void gui_draw_widgets(void);
 void gui_end_shader_window(void);
@@ -60,6 +61,11 @@ SelValue gui_get_widget_value(StringView label,
                               WidgetKind kind,
                               void *secondary_args,
                               u32 secondary_args_size);
+u32 gui_register_widget(StringView label,
+                        WidgetKind kind,
+                        const void *secondary_args,
+                        u32 secondary_args_size);
+SelValue gui_get_widget_value_by_handle(u32 handle);
 b8 gui_should_reload(void);
 
 #endif /* GUI_HELPERS_H */
@@ -30,6 +30,9 @@ extern "C" {
 
 /*--- Private variables -----------------------------------------------------------------*/
 
+/* at most one list is clipped at a time. See `imgui_begin_list_clipper()` */
+static ImGuiListClipper list_clipper;
+
 /*--- Public functions ------------------------------------------------------------------*/
 
 #ifdef __cplusplus
@@ -431,6 +434,21 @@ void imgui_end_child()
     ImGui::PopStyleColor();
 }
 
+void imgui_begin_list_clipper(i32 n_items)
+{
+    list_clipper.Begin(n_items);
+}
+
+b8 imgui_list_clipper_step(i32 *start, i32 *end)
+{
+    if (!list_clipper.Step()) {
+        return false;
+    }
+    *start = list_clipper.DisplayStart;
+    *end = list_clipper.DisplayEnd;
+    return true;
+}
+
 void imgui_end()
 {
     ImGui::End();
@@ -82,6 +82,8 @@ void imgui_get_current_window_dimensions(int *x, int *y, int *w, int *h);
 void imgui_end_combo(void);
 void imgui_end_table(void);
 void imgui_end_child(void);
+void imgui_begin_list_clipper(i32 n_items);
+b8 imgui_list_clipper_step(i32 *start, i32 *end);
 void imgui_end(void);
 void imgui_end_frame(void);
 
@@ -12,6 +12,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 /*--- Private macros --------------------------------------------------------------------*/
 
@@ -116,6 +117,68 @@ out:
     return data;
 }
 
+/*
+ * Writes `data` to a temporary file next to `filepath` and renames it over `filepath`, 
+ * so that readers, and mappings of the old file, never see a partially written file.
+ */
+i32 io_write_entire_file(const char *filepath, const void *data, size_t size)
+{
+    char tmp_filepath[1024];
+    i32 n = snprintf(tmp_filepath, sizeof(tmp_filepath), "%s.tmp", filepath);
+    if (n < 0 || (size_t)n >= sizeof(tmp_filepath)) {
+        return -1;
+    }
+
+    FILE *fp = fopen(tmp_filepath, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+    size_t n_written_bytes = fwrite(data, 1, size, fp);
+    i32 err = fclose(fp);
+    if (n_written_bytes != size || err != 0) {
+        remove(tmp_filepath);
+        return -1;
+    }
+
+    return (rename(tmp_filepath, filepath) == 0) ? 0 : -1;
+}
+
+/* Maps the file at `filepath` read-only. Returns NULL if it doesn't exist, or is empty */
+u8 *io_map_file(const char *filepath, size_t *size)
+{
+    u8 *data = NULL;
+    *size = 0;
+
+    i32 fd = open(filepath, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) == -1 || statbuf.st_size <= 0) {
+        goto out;
+    }
+
+    void *map = mmap(NULL, (size_t) statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        goto out;
+    }
+
+    data = map;
+    *size = (size_t) statbuf.st_size;
+
+out:
+    close(fd);
+    return data;
+}
+
+void io_unmap_file(u8 *data, size_t size)
+{
+    if (data != NULL) {
+        munmap(data, size);
+    }
+}
+
 char *io_get_timestamp_str()
 {
     char *buf = tmp_alloc(256);
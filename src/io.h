@@ -19,6 +19,9 @@
 
 i64 io_get_file_modify_time(const char *filepath, bool retry_on_failure);
 u8 *io_read_entire_file(HglAllocator *allocator, const char *filepath, size_t *size);
+i32 io_write_entire_file(const char *filepath, const void *data, size_t size);
+u8 *io_map_file(const char *filepath, size_t *size);
+void io_unmap_file(u8 *data, size_t size);
 char *io_get_timestamp_str(void);
 
 #endif /* IO_H */
@@ -5,6 +5,7 @@
 #include "hgl_int.h"
 
 #include <stdio.h>
+#include <pthread.h>
 
 /*--- Private macros --------------------------------------------------------------------*/
 
@@ -28,7 +29,10 @@ static struct {
     Array(char, 128*1024) error_buffer;
     Array(u32,  128)      error_entries;
     u32 error_iterator;
-} logs;
+
+    /* SEL builtins may log from the workers that evaluate uniforms (see `sel_start_workers()`) */
+    pthread_mutex_t lock;
+} logs = {.lock = PTHREAD_MUTEX_INITIALIZER};
 
 /*--- Public functions ------------------------------------------------------------------*/
 
@@ -53,9 +57,11 @@ void log_info(const char *fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
+    pthread_mutex_lock(&logs.lock);
     array_push(&logs.info_entries, logs.info_buffer.count);
     logs.info_buffer.count += vsprintf(&logs.info_buffer.arr[logs.info_buffer.count], fmt, args);
     logs.info_buffer.arr[logs.info_buffer.count++] = '\0';
+    pthread_mutex_unlock(&logs.lock);
     va_end(args);
 }
 
@@ -63,9 +69,11 @@ void log_error(const char *fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
+    pthread_mutex_lock(&logs.lock);
     array_push(&logs.error_entries, logs.error_buffer.count);
     logs.error_buffer.count += vsprintf(&logs.error_buffer.arr[logs.error_buffer.count], fmt, args);
     logs.error_buffer.arr[logs.error_buffer.count++] = '\0';
+    pthread_mutex_unlock(&logs.lock);
     va_end(args);
 }
 
@@ -31,6 +31,12 @@ int main(int argc, char *argv[])
     u64 *opt_rng_seed = hgl_flags_add_u64("-s,--seed", "`srand()` seed (defaults to `time(NULL)`)", 0, 0);
     bool *opt_list_builtins = hgl_flags_add_bool("-l,--list-builtins", "List the built-in functions and constants in the Simple Expression Language (SEL)", false, 0);
     bool *opt_quiet = hgl_flags_add_bool("-q,--quiet", "Less verbose log messages on stdout/stderr", false, 0);
+    const char **opt_output = hgl_flags_add_str("-o,--output", "Render the project offline, in tiles, to a PPM image file and exit", NULL, 0);
+    u64 *opt_output_width = hgl_flags_add_u64("-W,--output-width", "Width of the offline rendered image", 3840, 0);
+    u64 *opt_output_height = hgl_flags_add_u64("-H,--output-height", "Height of the offline rendered image", 2160, 0);
+    u64 *opt_tile_size = hgl_flags_add_u64("-t,--tile-size", "Tile size (in pixels) used for offline rendering", 1024, 0);
+    u64 *opt_tile_overlap = hgl_flags_add_u64("--tile-overlap", "Extra pixels rendered around each tile in intermediate passes", 0, 0);
+    bool *opt_dump_sel = hgl_flags_add_bool("--dump-sel", "Print the SEL expressions of the project, costliest first, and exit", false, 0);
     bool *opt_help = hgl_flags_add_bool("-help,--help", "Display this message", false, 0);
 
     i32 err = hgl_flags_parse(argc, argv);
@@ -48,6 +54,18 @@ int main(int argc, char *argv[])
     srand(*opt_rng_seed == 0 ? (u64)time(NULL): *opt_rng_seed);
 
     shaq_begin(*opt_input, *opt_quiet);
+    if (*opt_dump_sel) {
+        err = shaq_dump_sel();
+        shaq_end();
+        return (err != 0) ? 1 : 0;
+    }
+    if (*opt_output != NULL) {
+        err = shaq_render_tiled(*opt_output, 
+                                ivec2_make((i32)*opt_output_width, (i32)*opt_output_height),
+                                (i32)*opt_tile_size, (i32)*opt_tile_overlap);
+        shaq_end();
+        return (err != 0) ? 1 : 0;
+    }
     while (!shaq_should_close()) {
         //hgl_sleep_ms(200.0);
         shaq_new_frame();
@@ -22,6 +22,9 @@
 /*--- Private function prototypes -------------------------------------------------------*/
 
 static void resize_callback(GLFWwindow *window, i32 w, i32 h);
+static i32 bind_render_targets(const Shader *s);
+static void blit_region(const Shader *s, IVec4 region);
+static IVec4 clip_region(IVec4 region, IVec2 resolution);
 
 static i32 mini(i32 x, i32 y);
 static i32 maxi(i32 x, i32 y);
@@ -31,13 +34,22 @@ GLFWmonitor* get_current_monitor(GLFWwindow *window);
 
 /*--- Private variables -----------------------------------------------------------------*/
 
+static const GLenum DRAW_BUFFERS[SHAQ_MAX_N_OUTPUTS] = {
+    GL_COLOR_ATTACHMENT0,
+    GL_COLOR_ATTACHMENT1,
+    GL_COLOR_ATTACHMENT2,
+    GL_COLOR_ATTACHMENT3,
+};
+
 static struct {
     GLFWwindow *window;
     IVec2 window_size;
     Shader last_pass_shader;
+    Shader interleave_pattern_shader;
     u32 VBO;
     u32 VAO;
     u32 offscreen_fb;
+    u32 blit_fb;
 
     b8 should_reload;
     b8 is_fullscreen;
@@ -105,10 +117,12 @@ void renderer_init()
     glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vec2), (void *)0);
     glEnableVertexAttribArray(0);
     glGenFramebuffers(1, &renderer.offscreen_fb);
+    glGenFramebuffers(1, &renderer.blit_fb);
     glViewport(0, 0, renderer.window_size.x, renderer.window_size.y);
     glClearColor(0.117f, 0.117f, 0.117f, 1.0f);
 
     shader_make_last_pass_shader(&renderer.last_pass_shader);
+    shader_make_interleave_pattern_shader(&renderer.interleave_pattern_shader);
     gui_init(renderer.window, glfwGetPrimaryMonitor());
 
     if (gl_check_errors() != 0) {
@@ -143,15 +157,113 @@ void renderer_do_shader_pass(Shader *s)
     glViewport(0, 0, s->attributes.resolution.x, s->attributes.resolution.y);
 
     /* prepare offscreen frame buffer */
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer.offscreen_fb);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 
-                           s->render_texture_current->gl_texture_id, 0);
-    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    if (bind_render_targets(s) != 0) {
         return; /* possibly no `source` entry in *.ini file or shader compilation failure */
     }
 
+    IVec2 res = s->attributes.resolution;
+    IVec4 full = ivec4_make(0, 0, res.x, res.y);
+
+    /* 
+     * Interleaved rendering: Only the pixels belonging to this frame's phase are 
+     * shaded. The rest are carried over from the previous frame. The phases are 
+     * visited in an order that maximizes the distance between consecutive phases.
+     */
+    i32 phase = 0;
+    if (s->attributes.interleave > 1) {
+        static const i32 PHASE_ORDER[2][4] = {{0, 1, 0, 1}, {0, 3, 1, 2}};
+        i32 n = s->attributes.interleave;
+        phase = PHASE_ORDER[n == 4][shaq_frame_count() % n];
+        IVec2 offset = (n == 4) ? ivec2_make(phase & 1, phase >> 1) : ivec2_make(phase, 0);
+        glUniform1i(glGetUniformLocation(s->gl_shader_program_id, "interleave_phase"), phase);
+        glUniform2iv(glGetUniformLocation(s->gl_shader_program_id, "interleave_offset"), 1, (i32 *)&offset);
+        blit_region(s, full);
+    }
+
+    /* 
+     * Partial rendering: Only the pixels inside `region` are shaded. The current 
+     * render texture holds the frame before last, so the region drawn last frame 
+     * is copied over from the last render texture to keep the rest up to date. The 
+     * first two frames after a reload are always drawn in full.
+     */
+    IVec4 region = full;
+    if (s->attributes.region != NULL && 
+        !shaq_reloaded_this_frame() && !shaq_reloaded_last_frame()) {
+        region = clip_region(sel_eval(s->attributes.region, (SVMContext){s}, false).val_ivec4, res);
+        if (s->attributes.interleave <= 1) {
+            blit_region(s, s->last_drawn_region);
+        }
+    }
+    s->last_drawn_region = region;
+    if (region.z <= 0 || region.w <= 0) {
+        return;
+    }
+
     /* Draw */
+    if (s->attributes.interleave > 1) {
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_EQUAL, phase, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    }
+    if (region.z != res.x || region.w != res.y) {
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(region.x, region.y, region.z, region.w);
+        glViewport(region.x, region.y, region.z, region.w);
+    }
     glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_STENCIL_TEST);
+}
+
+void renderer_make_interleave_stencil(Shader *s)
+{
+    u32 prog = renderer.interleave_pattern_shader.gl_shader_program_id;
+    if (prog == 0) {
+        return;
+    }
+
+    glGenRenderbuffers(1, &s->gl_interleave_stencil_rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, s->gl_interleave_stencil_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_STENCIL_INDEX8, 
+                          s->attributes.resolution.x, s->attributes.resolution.y);
+
+    if (bind_render_targets(s) != 0) {
+        log_error("[Renderer] Unable to create interleave stencil for shader \"" SV_FMT "\".", 
+                  SV_ARG(s->name));
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return;
+    }
+
+    /* write phase index `i` to the stencil buffer for each pixel in phase `i` */
+    glUseProgram(prog);
+    glViewport(0, 0, s->attributes.resolution.x, s->attributes.resolution.y);
+    glUniform1i(glGetUniformLocation(prog, "interleave"), s->attributes.interleave);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glEnable(GL_STENCIL_TEST);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    for (i32 i = 0; i < s->attributes.interleave; i++) {
+        glUniform1i(glGetUniformLocation(prog, "phase"), i);
+        glStencilFunc(GL_ALWAYS, i, 0xFF);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glDisable(GL_STENCIL_TEST);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void renderer_read_pixels(const Shader *s, IVec4 region, u8 *dst)
+{
+    if (!shader_is_ok(s)) {
+        return;
+    }
+
+    if (bind_render_targets(s) != 0) {
+        return;
+    }
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(region.x, region.y, region.z, region.w, GL_RGB, GL_UNSIGNED_BYTE, dst);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void renderer_draw_fullscreen_shader(Shader *s)
@@ -256,6 +368,54 @@ static void resize_callback(GLFWwindow *window, i32 w, i32 h)
     renderer.should_reload = true;
 }
 
+/* attach the current render textures (one per output) of `s` to the offscreen frame buffer */
+static i32 bind_render_targets(const Shader *s)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer.offscreen_fb);
+    for (i32 i = 0; i < SHAQ_MAX_N_OUTPUTS; i++) {
+        u32 tex_id = (i < s->attributes.outputs) ? s->render_texture_current[i].gl_texture_id : 0;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, tex_id, 0);
+    }
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 
+                              s->gl_interleave_stencil_rb);
+    glDrawBuffers(s->attributes.outputs, DRAW_BUFFERS);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        return -1;
+    }
+    return 0;
+}
+
+/* 
+ * copy `region` of the last render textures of `s` into the current render textures, 
+ * which are expected to be bound to the offscreen frame buffer.
+ */
+static void blit_region(const Shader *s, IVec4 region)
+{
+    if (region.z <= 0 || region.w <= 0) {
+        return;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer.blit_fb);
+    for (i32 i = 0; i < s->attributes.outputs; i++) {
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 
+                               s->render_texture_last[i].gl_texture_id, 0);
+        glDrawBuffer(GL_COLOR_ATTACHMENT0 + i);
+        glBlitFramebuffer(region.x, region.y, region.x + region.z, region.y + region.w,
+                          region.x, region.y, region.x + region.z, region.y + region.w,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    glDrawBuffers(s->attributes.outputs, DRAW_BUFFERS);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer.offscreen_fb);
+}
+
+static IVec4 clip_region(IVec4 region, IVec2 resolution)
+{
+    i32 x0 = maxi(region.x, 0);
+    i32 y0 = maxi(region.y, 0);
+    i32 x1 = mini(region.x + region.z, resolution.x);
+    i32 y1 = mini(region.y + region.w, resolution.y);
+    return ivec4_make(x0, y0, maxi(x1 - x0, 0), maxi(y1 - y0, 0));
+}
+
 static i32 mini(i32 x, i32 y)
 {
     return x < y ? x : y;
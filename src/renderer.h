@@ -21,6 +21,8 @@ void renderer_final(void);
 void renderer_reload(void);
 void renderer_clear_current_framebuffer(void);
 void renderer_do_shader_pass(Shader *s);
+void renderer_make_interleave_stencil(Shader *s);
+void renderer_read_pixels(const Shader *s, IVec4 region, u8 *dst);
 void renderer_draw_fullscreen_shader(Shader *s);
 void renderer_begin_final_pass(void);
 void renderer_end_final_pass(void);
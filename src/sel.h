@@ -12,8 +12,149 @@
 /*--- Public macros ---------------------------------------------------------------------*/
 
 #define SEL_FUNC_MAX_N_ARGS 8
+#define SEL_MAX_STACK_SIZE (16*1024) // bytes of stack of the stack VM. Larger expressions are rejected
+#define SEL_MAX_N_SHARED_VALUES 256
+#define SEL_MAX_N_GLOBALS 256
+#define SEL_MAX_ARRAY_SIZE 1024 // elements of an array uniform
+#define SEL_MAX_N_STATES 4096 // calls to `FUNC_FLAG_STATE` builtins. A power of two
+#define SEL_JIT_THRESHOLD 16 // evaluations before an expression is compiled to native code
+#define SEL_MAX_N_WORKERS 15 // threads, besides the main thread, that run frame programs side by side
 #define SEL_EMPTY_SVM_CONTEXT (SVMContext){.shader = NULL}
 
+/* 
+ * The type-specialized instructions of the register VM, as 
+ * X(name, kind, type, T, handler, fn). `handler` is the macro in selvm.c that 
+ * implements the instruction for values of C type `T`, applying the operator `fn`. 
+ * Instructions of type TYPE_NIL work on values of any type. Comparisons, whose result is 
+ * always a bool, are specialized on the type of their operands instead. Calls to 
+ * builtins flagged `FUNC_FLAG_MEMO` are MEMO, and to those flagged `FUNC_FLAG_STATE` 
+ * STATE rather than CALL instructions.
+ */
+#define SEL_REG_OPS(X)                                                          \
+    X(ADD_I32,       OP_ADD,     TYPE_INT,     i32,   REG_BINOP,   addi)        \
+    X(ADD_U32,       OP_ADD,     TYPE_UINT,    u32,   REG_BINOP,   addu)        \
+    X(ADD_F32,       OP_ADD,     TYPE_FLOAT,   f32,   REG_BINOP,   addf)        \
+    X(ADD_VEC2,      OP_ADD,     TYPE_VEC2,    Vec2,  REG_BINOP,   addv2)       \
+    X(ADD_VEC3,      OP_ADD,     TYPE_VEC3,    Vec3,  REG_BINOP,   addv3)       \
+    X(ADD_VEC4,      OP_ADD,     TYPE_VEC4,    Vec4,  REG_BINOP,   addv4)       \
+    X(ADD_IVEC2,     OP_ADD,     TYPE_IVEC2,   IVec2, REG_BINOP,   addiv2)      \
+    X(ADD_IVEC3,     OP_ADD,     TYPE_IVEC3,   IVec3, REG_BINOP,   addiv3)      \
+    X(ADD_IVEC4,     OP_ADD,     TYPE_IVEC4,   IVec4, REG_BINOP,   addiv4)      \
+    X(ADD_MAT2,      OP_ADD,     TYPE_MAT2,    Mat2,  REG_BINOP,   addm2)       \
+    X(ADD_MAT3,      OP_ADD,     TYPE_MAT3,    Mat3,  REG_BINOP,   addm3)       \
+    X(ADD_MAT4,      OP_ADD,     TYPE_MAT4,    Mat4,  REG_BINOP,   addm4)       \
+    X(SUB_I32,       OP_SUB,     TYPE_INT,     i32,   REG_BINOP,   subi)        \
+    X(SUB_U32,       OP_SUB,     TYPE_UINT,    u32,   REG_BINOP,   subu)        \
+    X(SUB_F32,       OP_SUB,     TYPE_FLOAT,   f32,   REG_BINOP,   subf)        \
+    X(SUB_VEC2,      OP_SUB,     TYPE_VEC2,    Vec2,  REG_BINOP,   subv2)       \
+    X(SUB_VEC3,      OP_SUB,     TYPE_VEC3,    Vec3,  REG_BINOP,   subv3)       \
+    X(SUB_VEC4,      OP_SUB,     TYPE_VEC4,    Vec4,  REG_BINOP,   subv4)       \
+    X(SUB_IVEC2,     OP_SUB,     TYPE_IVEC2,   IVec2, REG_BINOP,   subiv2)      \
+    X(SUB_IVEC3,     OP_SUB,     TYPE_IVEC3,   IVec3, REG_BINOP,   subiv3)      \
+    X(SUB_IVEC4,     OP_SUB,     TYPE_IVEC4,   IVec4, REG_BINOP,   subiv4)      \
+    X(SUB_MAT2,      OP_SUB,     TYPE_MAT2,    Mat2,  REG_BINOP,   subm2)       \
+    X(SUB_MAT3,      OP_SUB,     TYPE_MAT3,    Mat3,  REG_BINOP,   subm3)       \
+    X(SUB_MAT4,      OP_SUB,     TYPE_MAT4,    Mat4,  REG_BINOP,   subm4)       \
+    X(MUL_I32,       OP_MUL,     TYPE_INT,     i32,   REG_BINOP,   muli)        \
+    X(MUL_U32,       OP_MUL,     TYPE_UINT,    u32,   REG_BINOP,   mulu)        \
+    X(MUL_F32,       OP_MUL,     TYPE_FLOAT,   f32,   REG_BINOP,   mulf)        \
+    X(MUL_VEC2,      OP_MUL,     TYPE_VEC2,    Vec2,  REG_BINOP,   mulv2)       \
+    X(MUL_VEC3,      OP_MUL,     TYPE_VEC3,    Vec3,  REG_BINOP,   mulv3)       \
+    X(MUL_VEC4,      OP_MUL,     TYPE_VEC4,    Vec4,  REG_BINOP,   mulv4)       \
+    X(MUL_IVEC2,     OP_MUL,     TYPE_IVEC2,   IVec2, REG_BINOP,   muliv2)      \
+    X(MUL_IVEC3,     OP_MUL,     TYPE_IVEC3,   IVec3, REG_BINOP,   muliv3)      \
+    X(MUL_IVEC4,     OP_MUL,     TYPE_IVEC4,   IVec4, REG_BINOP,   muliv4)      \
+    X(MUL_MAT2,      OP_MUL,     TYPE_MAT2,    Mat2,  REG_BINOP,   mulm2)       \
+    X(MUL_MAT3,      OP_MUL,     TYPE_MAT3,    Mat3,  REG_BINOP,   mulm3)       \
+    X(MUL_MAT4,      OP_MUL,     TYPE_MAT4,    Mat4,  REG_BINOP,   mulm4)       \
+    X(DIV_I32,       OP_DIV,     TYPE_INT,     i32,   REG_BINOP,   divi)        \
+    X(DIV_U32,       OP_DIV,     TYPE_UINT,    u32,   REG_BINOP,   divu)        \
+    X(DIV_F32,       OP_DIV,     TYPE_FLOAT,   f32,   REG_BINOP,   divf)        \
+    X(DIV_VEC2,      OP_DIV,     TYPE_VEC2,    Vec2,  REG_BINOP,   divv2)       \
+    X(DIV_VEC3,      OP_DIV,     TYPE_VEC3,    Vec3,  REG_BINOP,   divv3)       \
+    X(DIV_VEC4,      OP_DIV,     TYPE_VEC4,    Vec4,  REG_BINOP,   divv4)       \
+    X(DIV_IVEC2,     OP_DIV,     TYPE_IVEC2,   IVec2, REG_BINOP,   diviv2)      \
+    X(DIV_IVEC3,     OP_DIV,     TYPE_IVEC3,   IVec3, REG_BINOP,   diviv3)      \
+    X(DIV_IVEC4,     OP_DIV,     TYPE_IVEC4,   IVec4, REG_BINOP,   diviv4)      \
+    X(REM_I32,       OP_REM,     TYPE_INT,     i32,   REG_BINOP,   remi)        \
+    X(REM_U32,       OP_REM,     TYPE_UINT,    u32,   REG_BINOP,   remu)        \
+    X(NEG_I32,       OP_NEG,     TYPE_INT,     i32,   REG_UNOP,    negi)        \
+    X(NEG_F32,       OP_NEG,     TYPE_FLOAT,   f32,   REG_UNOP,    negf)        \
+    X(NEG_VEC2,      OP_NEG,     TYPE_VEC2,    Vec2,  REG_UNOP,    negv2)       \
+    X(NEG_VEC3,      OP_NEG,     TYPE_VEC3,    Vec3,  REG_UNOP,    negv3)       \
+    X(NEG_VEC4,      OP_NEG,     TYPE_VEC4,    Vec4,  REG_UNOP,    negv4)       \
+    X(NEG_IVEC2,     OP_NEG,     TYPE_IVEC2,   IVec2, REG_UNOP,    negiv2)      \
+    X(NEG_IVEC3,     OP_NEG,     TYPE_IVEC3,   IVec3, REG_UNOP,    negiv3)      \
+    X(NEG_IVEC4,     OP_NEG,     TYPE_IVEC4,   IVec4, REG_UNOP,    negiv4)      \
+    X(SWIZZLE_F32,   OP_SWIZZLE, TYPE_FLOAT,   f32,   REG_SWIZZLE, _)           \
+    X(SWIZZLE_VEC2,  OP_SWIZZLE, TYPE_VEC2,    Vec2,  REG_SWIZZLE, _)           \
+    X(SWIZZLE_VEC3,  OP_SWIZZLE, TYPE_VEC3,    Vec3,  REG_SWIZZLE, _)           \
+    X(SWIZZLE_VEC4,  OP_SWIZZLE, TYPE_VEC4,    Vec4,  REG_SWIZZLE, _)           \
+    X(SWIZZLE_I32,   OP_SWIZZLE, TYPE_INT,     i32,   REG_SWIZZLE, _)           \
+    X(SWIZZLE_IVEC2, OP_SWIZZLE, TYPE_IVEC2,   IVec2, REG_SWIZZLE, _)           \
+    X(SWIZZLE_IVEC3, OP_SWIZZLE, TYPE_IVEC3,   IVec3, REG_SWIZZLE, _)           \
+    X(SWIZZLE_IVEC4, OP_SWIZZLE, TYPE_IVEC4,   IVec4, REG_SWIZZLE, _)           \
+    X(EQ_BOOL,       OP_EQ,      TYPE_BOOL,    i32,   REG_COMPARE, eqi)         \
+    X(EQ_I32,        OP_EQ,      TYPE_INT,     i32,   REG_COMPARE, eqi)         \
+    X(EQ_U32,        OP_EQ,      TYPE_UINT,    u32,   REG_COMPARE, equ)         \
+    X(EQ_F32,        OP_EQ,      TYPE_FLOAT,   f32,   REG_COMPARE, eqf)         \
+    X(NE_BOOL,       OP_NE,      TYPE_BOOL,    i32,   REG_COMPARE, nei)         \
+    X(NE_I32,        OP_NE,      TYPE_INT,     i32,   REG_COMPARE, nei)         \
+    X(NE_U32,        OP_NE,      TYPE_UINT,    u32,   REG_COMPARE, neu)         \
+    X(NE_F32,        OP_NE,      TYPE_FLOAT,   f32,   REG_COMPARE, nef)         \
+    X(LT_I32,        OP_LT,      TYPE_INT,     i32,   REG_COMPARE, lti)         \
+    X(LT_U32,        OP_LT,      TYPE_UINT,    u32,   REG_COMPARE, ltu)         \
+    X(LT_F32,        OP_LT,      TYPE_FLOAT,   f32,   REG_COMPARE, ltf)         \
+    X(LE_I32,        OP_LE,      TYPE_INT,     i32,   REG_COMPARE, lei)         \
+    X(LE_U32,        OP_LE,      TYPE_UINT,    u32,   REG_COMPARE, leu)         \
+    X(LE_F32,        OP_LE,      TYPE_FLOAT,   f32,   REG_COMPARE, lef)         \
+    X(GT_I32,        OP_GT,      TYPE_INT,     i32,   REG_COMPARE, gti)         \
+    X(GT_U32,        OP_GT,      TYPE_UINT,    u32,   REG_COMPARE, gtu)         \
+    X(GT_F32,        OP_GT,      TYPE_FLOAT,   f32,   REG_COMPARE, gtf)         \
+    X(GE_I32,        OP_GE,      TYPE_INT,     i32,   REG_COMPARE, gei)         \
+    X(GE_U32,        OP_GE,      TYPE_UINT,    u32,   REG_COMPARE, geu)         \
+    X(GE_F32,        OP_GE,      TYPE_FLOAT,   f32,   REG_COMPARE, gef)         \
+    SEL_REG_OPS_FOR_VALUE_TYPES_(X, CALL, OP_FUNC, REG_CALL)                    \
+    SEL_REG_OPS_FOR_VALUE_TYPES_(X, MOVE, OP_MOVE, REG_MOVE)                    \
+    X(JUMP_IF_FALSE, OP_JUMP_IF_FALSE, TYPE_NIL, u8,  REG_JUMP_IF_FALSE, _)     \
+    X(JUMP,          OP_JUMP,    TYPE_NIL,     u8,    REG_JUMP,    _)           \
+    X(SHARED,        OP_SHARED,  TYPE_NIL,     u8,    REG_SHARED,  _)           \
+    X(PUBLISH,       OP_PUBLISH, TYPE_NIL,     u8,    REG_PUBLISH, _)           \
+    X(GLOBAL,        OP_GLOBAL,  TYPE_NIL,     u8,    REG_GLOBAL,  _)           \
+    X(CONTEXT,       OP_CONTEXT, TYPE_NIL,     u8,    REG_CONTEXT, _)           \
+    X(GUARD,         OP_GUARD,   TYPE_NIL,     u8,    REG_GUARD,   _)           \
+    X(STAGE,         OP_STAGE,   TYPE_NIL,     u8,    REG_STAGE,   _)           \
+    X(MEMO,          OP_FUNC,    TYPE_NIL,     u8,    REG_MEMO,    _)           \
+    X(STATE,         OP_FUNC,    TYPE_NIL,     u8,    REG_STATE,   _)
+
+#define SEL_REG_OPS_FOR_VALUE_TYPES_(X, name, kind, handler)                    \
+    X(name##_BOOL,    kind,      TYPE_BOOL,    i32,   handler,     _)           \
+    X(name##_I32,     kind,      TYPE_INT,     i32,   handler,     _)           \
+    X(name##_U32,     kind,      TYPE_UINT,    u32,   handler,     _)           \
+    X(name##_F32,     kind,      TYPE_FLOAT,   f32,   handler,     _)           \
+    X(name##_VEC2,    kind,      TYPE_VEC2,    Vec2,  handler,     _)           \
+    X(name##_VEC3,    kind,      TYPE_VEC3,    Vec3,  handler,     _)           \
+    X(name##_VEC4,    kind,      TYPE_VEC4,    Vec4,  handler,     _)           \
+    X(name##_IVEC2,   kind,      TYPE_IVEC2,   IVec2, handler,     _)           \
+    X(name##_IVEC3,   kind,      TYPE_IVEC3,   IVec3, handler,     _)           \
+    X(name##_IVEC4,   kind,      TYPE_IVEC4,   IVec4, handler,     _)           \
+    X(name##_MAT2,    kind,      TYPE_MAT2,    Mat2,  handler,     _)           \
+    X(name##_MAT3,    kind,      TYPE_MAT3,    Mat3,  handler,     _)           \
+    X(name##_MAT4,    kind,      TYPE_MAT4,    Mat4,  handler,     _)           \
+    X(name##_STR,     kind,      TYPE_STR,     StringView,        handler, _)  \
+    X(name##_TEXTURE, kind,      TYPE_TEXTURE, TextureDescriptor, handler, _)
+
+/* 
+ * Superinstructions, fused from pairs of the instructions above by the compiler. 
+ * Picked by how often the pairs occur in the examples. 
+ */
+#define SEL_REG_SUPEROPS(X)                                                     \
+    X(MOVE_BLOCK,    OP_MOVE,    TYPE_NIL,     u8,    REG_MOVE_BLOCK, _)        \
+    X(CALL_MUL_F32,  OP_FUNC,    TYPE_FLOAT,   f32,   REG_CALL_BINOP, mulf)     \
+    X(CALL_ADD_F32,  OP_FUNC,    TYPE_FLOAT,   f32,   REG_CALL_BINOP, addf)     \
+    X(MUL_ADD_F32,   OP_MUL,     TYPE_FLOAT,   f32,   REG_MUL_BINOP,  addf)     \
+    X(MUL_SUB_F32,   OP_MUL,     TYPE_FLOAT,   f32,   REG_MUL_BINOP,  subf)
+
 /*--- Public type definitions -----------------------------------------------------------*/
 
 typedef enum
@@ -49,6 +190,37 @@ typedef enum
     QUALIFIER_PURE  = (1 << 1), // for pure functions
 } TypeQualifier;
 
+typedef enum
+{
+    FUNC_FLAG_NONE     =  0,
+    FUNC_FLAG_SESSION  = (1 << 0), // result depends on the loaded session. Never evaluated at compile time
+    FUNC_FLAG_VOLATILE = (1 << 1), // result differs between calls. Never shared between expressions
+    FUNC_FLAG_CONTEXT  = (1 << 2), // result depends on the shader being evaluated. Never shared between expressions
+    FUNC_FLAG_LINKED   = (1 << 3), // takes handles in place of the names of its overload. Never called by name
+    FUNC_FLAG_MEMO     = (1 << 4), // costly to compute. Calls skip the computation if their arguments are unchanged
+    FUNC_FLAG_MAIN     = (1 << 5), // touches state of the main thread (the GUI, loaded textures). Never called by workers
+    FUNC_FLAG_STATE    = (1 << 6), // keeps a state from frame to frame, one per call site. Never shared between expressions
+} FuncFlags;
+
+/* 
+ * Sources of change, other than its arguments, that the result of a function depends 
+ * on. Expressions are only recomputed when one of their sources has changed (see 
+ * `sel_signal()`).
+ */
+typedef enum
+{
+    SEL_DEP_NONE     =  0,
+    SEL_DEP_FRAME    = (1 << 0), // changes every frame (and every tile)
+    SEL_DEP_TIME     = (1 << 1),
+    SEL_DEP_MOUSE    = (1 << 2),
+    SEL_DEP_KEYBOARD = (1 << 3),
+    SEL_DEP_WIDGET   = (1 << 4),
+    SEL_DEP_VIEWPORT = (1 << 5),
+    SEL_DEP_RELOAD   = (1 << 6), // the loaded session. Implied by FUNC_FLAG_SESSION
+    SEL_DEP_UNIFORMS = (1 << 7), // the values of other uniforms
+} SelDependency;
+#define SEL_N_DEPS 8
+
 typedef enum
 {
     SHADER_CURRENT_RENDER_TEXTURE,
@@ -63,6 +235,7 @@ typedef struct
     i32 id;
     i32 filter; // Both min & mag filters
     i32 wrap;   // Both S & T directions
+    i32 output; // Render target index, for shaders with multiple outputs
 } TextureDescriptor;
 
 typedef union
@@ -84,12 +257,16 @@ typedef union
     TextureDescriptor val_tex;
 } SelValue;
 
-typedef struct
+typedef struct Func
 {
     StringView id;
     TypeQualifier qualifier;
+    u32 flags;
+    u32 deps;
+    u32 cost; // estimated cost of a call, on top of that of any call. See `codegen_measure()`
     Type type;
     SelValue (*impl)(void *args);
+    b8 (*link)(const struct Func *f, const SelValue *const *args, i32 *handles); // see `sel_end_session()`
     Type argtypes[SEL_FUNC_MAX_N_ARGS];
     const char *synopsis;
     const char *desc;
@@ -106,6 +283,21 @@ typedef enum
     OP_NEG,
     OP_FUNC,
     OP_SWIZZLE,
+    OP_EQ,      // compares two values of type `lhs_type`, and pushes the bool result
+    OP_NE,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_JUMP_IF_FALSE, // followed by a u32 skip. Pops a bool, and skips as many bytes of code if it is false
+    OP_JUMP,    // followed by a u32 skip. Skips as many bytes of code. Ends the first branch of a conditional
+    OP_SHARED,  // followed by a u32 slot and a u32 skip. Pushes the slot value if computed this frame
+    OP_PUBLISH, // followed by a u32 slot. Stores the top of the stack in the slot
+    OP_GLOBAL,  // followed by a u32 index. Pushes the value of the global (see `sel_define_globals()`)
+    OP_MOVE,    // register VM only
+    OP_CONTEXT, // register VM only. Switches to the imm'th context of a frame program
+    OP_GUARD,   // register VM only. Skips the imm'th expression of a frame program unless it is stale
+    OP_STAGE,   // register VM only. Moves a value to the staging area, noting whether it changed
 } OpKind;
 
 typedef struct
@@ -122,18 +314,59 @@ typedef struct
 } Op;
 static_assert(sizeof(Op) == 4, "");
 
-/* "executable" expression */
+typedef enum
+{
+#define X(name, ...) REG_OP_##name,
+    SEL_REG_OPS(X)
+    SEL_REG_SUPEROPS(X)
+#undef X
+    REG_OP_HALT,
+    N_REG_OPS,
+} RegOpCode;
+static_assert(N_REG_OPS <= UINT16_MAX, "");
+
+/* 
+ * Three-address instruction of the register VM. `dst`, `lhs`, and `rhs` are byte 
+ * offsets into the register file of the expression. Function arguments are passed 
+ * in consecutive registers starting at `lhs`. The VM only looks at `code`; `kind` 
+ * and the types are kept for the compiler.
+ */
 typedef struct
 {
-    u8 *code;
-    u32 size;
-    u32 capacity;
-    Type type;
-    TypeQualifier qualifier;
-    SelValue cached_computed_value;
-    b8 has_been_computed_once;
-    const char *source_code;
-} ExeExpr;
+    u8 kind;      // OpKind
+    u8 type;      // type of the result
+    u8 lhs_type;
+    u8 rhs_type;
+    u16 dst;
+    u16 lhs;
+    u16 rhs;      // OP_SHARED/OP_GUARD/OP_JUMP*: number of instructions to skip. MOVE_BLOCK: size 
+                  // in bytes. MEMO: the memo slot (see `SelMemoSlot`). STATE: the state (see
+                  // `sel_claim_state()`)
+    u16 code;     // RegOpCode
+    u32 imm;      // OP_FUNC: function id. OP_SWIZZLE: descriptor. OP_SHARED/OP_PUBLISH: slot.
+                  // OP_GLOBAL: global index. OP_CONTEXT/OP_GUARD: expression index.
+                  // MUL_ADD_F32/MUL_SUB_F32: the third operand
+} RegOp;
+static_assert(sizeof(RegOp) == 16, "");
+
+/* 
+ * Memo slot of a call to a `FUNC_FLAG_MEMO` builtin, in the register file of the 
+ * expression after its temporaries. Followed by the arguments and the result of the 
+ * last call.
+ */
+typedef struct
+{
+    u32 args_size;
+    u32 n_calls; // 0 until the first call fills the slot
+    u32 n_hits;  // calls whose arguments were those of the call before
+} SelMemoSlot;
+
+/* Value of a shared subexpression, cached for the frame in which it was computed */
+typedef struct
+{
+    SelValue value;
+    u64 frame;
+} SelSharedValue;
 
 /* 
  * Describes the context in which an executable expression
@@ -144,6 +377,71 @@ typedef struct
     struct Shader *shader;
 } SVMContext;
 
+/* 
+ * The state of the SVM that is private to each thread evaluating expressions: the 
+ * context, and the values of the subexpressions shared between the expressions it 
+ * evaluates (see `sel_start_workers()`)
+ */
+typedef struct
+{
+    SVMContext ctx;
+    SelSharedValue shared[SEL_MAX_N_SHARED_VALUES];
+} SelThreadState;
+
+/* Native code for the register program of an expression. See seljit.c */
+typedef void (*SelJitFn)(u8 *regs, SelThreadState *thread);
+
+/* 
+ * Replaces the result of every call to the builtin `func` by the i'th of `values` in 
+ * the i'th evaluation of a batch (see `sel_eval_batch()`)
+ */
+typedef struct
+{
+    StringView func;
+    const void *values; // packed values of the return type of `func`
+} SelOverride;
+
+/* The state of the SVM, shared by all threads, that native code reads and writes directly */
+typedef struct
+{
+    const u64 *frame;
+    const u64 *changed_at; // indexed by the bit of a SelDependency
+    const SelValue *globals;
+    void (*state_call)(u8 *regs, const RegOp *op); // runs a STATE instruction
+} SelJitEnv;
+
+/* "executable" expression */
+typedef struct ExeExpr
+{
+    u8 *code;
+    u32 size;
+    u32 capacity;
+    u32 stack_size;  // bytes of stack the stack VM needs to run `code`
+    u32 cost;        // estimated cost of an evaluation. See `codegen_measure()`
+    RegOp *ops;      // register VM program, translated from `code`
+    u32 n_ops;
+    u8 *regs;        // register file. Constants first, then temporaries
+    u32 regs_size;
+    u32 result;      // register holding the result
+    SelJitFn jit;    // native code for `ops`, or NULL
+    u32 n_evals;     // evaluations so far. Expressions are JIT compiled once they are hot
+    Type type;
+    TypeQualifier qualifier;
+    u32 deps;        // SelDependency. Sources of change of the functions called
+    b8 main_thread;  // calls a `FUNC_FLAG_MAIN` builtin, copies other uniforms, or shares a state. Never evaluated by workers
+    b8 calls_index;  // calls `index()`, so its value depends on the element of an array uniform
+    u32 n_elements;  // arguments of its `array()` calls, or 0 if there are none
+    u32 n_states;    // calls of `FUNC_FLAG_STATE` builtins, each with a state of its own
+    u64 computed_at; // frame of the last computation, or 0
+    SelValue cached_computed_value;
+    b8 has_been_computed_once;
+    const char *source_code;
+
+    /* frame programs only: the expressions linked, and the contexts they are evaluated in */
+    struct ExeExpr *const *linked;
+    const SVMContext *contexts;
+} ExeExpr;
+
 /*--- Public variables ------------------------------------------------------------------*/
 
 extern const Func BUILTIN_FUNCTIONS[];
@@ -196,10 +494,32 @@ static_assert(sizeof(TYPE_TO_SIZE)/sizeof(TYPE_TO_SIZE[0]) == N_TYPES);
 /*--- Public function prototypes --------------------------------------------------------*/
 
 ExeExpr *sel_compile(const char *src); // selc.c
+void sel_begin_session(void); // selc.c
+void sel_end_session(void); // selc.c
 void sel_list_builtins(void); // selc.c
 void sel_print_value(Type t, SelValue v); // selc.c
+ExeExpr *sel_link_frame_program(ExeExpr *const *exes, const SVMContext *contexts, u32 n, u8 **values); // selc.c
+i32 sel_define_globals(const StringView *names, const Type *types, const char *const *srcs, u32 n); // selc.c
+void sel_update_globals(void); // selc.c
+void sel_cache_open(const char *filepath); // selc.c
+void sel_cache_close(void); // selc.c
 
 SelValue sel_eval(ExeExpr *exe, SVMContext ctx, b8 force_recompute); // selvm.c
+SelValue sel_eval_stack(ExeExpr *exe, SVMContext ctx); // selvm.c
+i32 sel_eval_batch(const ExeExpr *exe, SVMContext ctx, const SelOverride *overrides, u32 n_overrides, void *results, u32 n); // selvm.c
+i32 sel_eval_array(ExeExpr *exe, SVMContext ctx, void *values, u32 n, b8 force_recompute); // selvm.c
+void sel_begin_frame(void); // selvm.c
+void sel_run_frame_program(ExeExpr *program); // selvm.c
+void sel_run_frame_programs(ExeExpr *const *programs, u32 n); // selvm.c
+u32 sel_start_workers(u32 n); // selvm.c
+void sel_stop_workers(void); // selvm.c
+void sel_signal(u32 deps); // selvm.c
+void sel_set_global(u32 index, SelValue value); // selvm.c
+u32 sel_memo_stats(const ExeExpr *exe, u32 func_id, u32 *n_hits); // selvm.c
+u32 sel_claim_state(u64 site, const ExeExpr *exe, u32 session); // selvm.c
+
+SelJitFn sel_jit_compile(const ExeExpr *exe, const SelJitEnv *env); // seljit.c
+void sel_jit_reset(void); // seljit.c
 
 #endif /* SEL_H */
 
@@ -2,14 +2,25 @@
 
 #include "sel.h"
 #include "alloc.h"
+#include "array.h"
+#include "io.h"
+#include "hgl_da.h"
 #include "glad/glad.h"
 #include "log.h"
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /*--- Private macros --------------------------------------------------------------------*/
 
+#define SESSION_MAX_N_EXPRS    4096
+#define SESSION_MAX_N_SUBEXPRS 4096 /* must be a power of two */
+#define NAME_TABLE_SIZE        1024 /* must be a power of two, and at least twice the number of builtins */
+#define SEL_CACHE_VERSION      2    /* bump on changes to the bytecode not caught by `cache_abi_hash()` */
+#define CODEGEN_COST_CALL      4    /* estimated cost of calling any builtin. See `codegen_measure()` */
+
 #define TRY(expr_)                                         \
     do {                                                   \
         i32 err_ = (i32) (expr_);                          \
@@ -68,6 +79,14 @@ typedef enum
     TOK_PERCENT,
     TOK_COMMA,
     TOK_DOT,
+    TOK_QUESTION,
+    TOK_COLON,
+    TOK_EQ,
+    TOK_NE,
+    TOK_LT,
+    TOK_LE,
+    TOK_GT,
+    TOK_GE,
     TOK_BOOL_LITERAL,
     TOK_INT_LITERAL,
     TOK_UINT_LITERAL,
@@ -89,6 +108,9 @@ typedef struct
 typedef struct
 {
     StringView buf; 
+    Token peeked;   /* the next token, if `has_peeked` */
+    b8 has_peeked;
+    u32 n_elements; /* arguments of the `array()` calls parsed so far, or 0 */
 } Lexer;
 
 typedef enum
@@ -100,11 +122,20 @@ typedef enum
     EXPR_REM,
     EXPR_NEG,
     EXPR_SWIZZLE,
+    EXPR_EQ,
+    EXPR_NE,
+    EXPR_LT,
+    EXPR_LE,
+    EXPR_GT,
+    EXPR_GE,
+    EXPR_COND,
+    EXPR_BRANCHES,
     EXPR_PAREN,
     EXPR_FUNC,
     EXPR_ARGLIST,
     EXPR_LIT,
     EXPR_ID,
+    EXPR_GLOBAL,
     N_EXPR_KINDS,
 } ExprKind;
 
@@ -130,6 +161,9 @@ typedef struct
  * Whether an expression is unary, binary, or atomic is determined by its `kind`. E.g. 
  * `ADD`, `MUL`, and `REM` are binary operations, and thus binary expressions; `FUNC` 
  * and `PAREN` are unary expressions; `LIT` is atomic.
+ *
+ * A conditional `c ? a : b` is the binary `COND`, with the condition `c` as its `lhs`, 
+ * and a binary `BRANCHES` holding `a` and `b` as its `rhs`.
  */
 typedef struct ExprTree
 {
@@ -137,6 +171,10 @@ typedef struct ExprTree
     Token token;
     Type type;
     TypeQualifier qualifier;
+    u32 func_id;    /* index into BUILTIN_FUNCTIONS, resolved by the type-/namechecker */
+    u32 global_id;  /* index into the session globals, likewise */
+    SelValue value; /* value of literals and constants. Descriptor of the rhs of a swizzle */
+    i32 shared;     /* index into the session subexpression table, or -1 */
     union {
         struct ExprTree *child;
         struct ExprTree *lhs;
@@ -144,6 +182,50 @@ typedef struct ExprTree
     struct ExprTree *rhs;
 } ExprTree;
 
+/* A subexpression that may be shared between the expressions of a session */
+typedef struct
+{
+    u64 hash;
+    const ExprTree *e; /* first occurrence */
+    u32 n_refs;
+    i32 slot;          /* SVM slot holding its value, or -1 if not shared */
+} SubExpr;
+
+
+/* A named value of the project, evaluated once per frame (see `sel_define_globals()`) */
+typedef struct
+{
+    StringView name;
+    Type type;
+    ExeExpr *exe;
+} Global;
+
+/* 
+ * The cache file (see `sel_cache_open()`): a header, followed by the entries, sorted on 
+ * `key`, followed by a blob holding the source code and the bytecode of every entry. 
+ * String literals in the bytecode hold their offset into the source code in place of 
+ * a pointer.
+ */
+typedef struct
+{
+    char magic[4];  /* "SELC" */
+    u32 version;    /* SEL_CACHE_VERSION */
+    u64 abi;        /* see `cache_abi_hash()` */
+    u32 n_entries;
+    u32 blob_size;
+} CacheHeader;
+
+typedef struct
+{
+    u64 key;        /* see `cache_key()` */
+    u64 globals;    /* hash of the globals of the session if the code refers to any, otherwise 0 */
+    u32 offset;     /* of the source code in the blob, which the bytecode follows */
+    u32 src_length;
+    u32 code_size;
+    u8 type;
+    u8 qualifier;
+    u16 n_elements; /* see `ExeExpr` */
+} CacheEntry;
 
 /*--- Private function prototypes -------------------------------------------------------*/
 
@@ -152,30 +234,86 @@ static Lexer lexer_begin(const char *str);
 static Token lexer_next(Lexer *l);
 static void lexer_eat(Lexer *l);
 static Token lexer_peek(Lexer *l);
+static Token lexer_lex(Lexer *l);
 static ExprTree *new_binary_expr(ExprKind kind, Token token, ExprTree *lhs, ExprTree *rhs);
 static ExprTree *new_unary_expr(ExprKind kind, Token token, ExprTree *child);
 static ExprTree *new_atom_expr(ExprKind kind, Token token);
+static ExprTree *new_expr(ExprKind kind, Token token);
 
 /* parser */
-static ExprTree *parse_expr(const char *str);
+static ExprTree *parse_expr(const char *str, u32 *n_elements);
+static i32 parse_cond_expr(ExprTree **e, Lexer *l);
+static i32 parse_compare_expr(ExprTree **e, Lexer *l);
 static i32 parse_add_expr(ExprTree **e, Lexer *l);
 static i32 parse_mul_expr(ExprTree **e, Lexer *l);
 static i32 parse_dot_expr(ExprTree **e, Lexer *l);
 static i32 parse_unary_or_atom_expr(ExprTree **e, Lexer *l);
 static i32 parse_arglist_expr(ExprTree **e, Lexer *l);
+static ExprTree *array_to_cond_expr(ExprTree *args, Token t, u32 index);
+
+/* builtin names */
+static i32 find_function(StringView name);
+static i32 next_overload(i32 func_id);
+static i32 find_constant(StringView name);
+static void build_name_tables(void);
+static u16 *function_slot(StringView name);
+static u16 *constant_slot(StringView name);
+static u32 name_hash(StringView name);
 
 /* Type-/namechecker */
 static TypeAndQualifier type_and_namecheck(ExprTree *e);
-static TypeAndQualifier type_and_namecheck_function(ExprTree *e, const Func *f, const Type *argtypes, b8 const_args);
+static TypeAndQualifier type_and_namecheck_function(ExprTree *e);
+static b8 function_accepts_arguments(const Func *f, const Type *argtypes, u32 n_args);
+
+/* optimizer */
+static b8 optimize(ExprTree *e);
+static void fold(ExprTree *e);
+static void simplify(ExprTree *e);
+static b8 is_integer_literal_zero(const ExprTree *e);
+static b8 is_literal_one(const ExprTree *e);
+static b8 has_integer_zero_component(const ExprTree *e);
+
+/* linker */
+static b8 link_names(ExprTree *e);
+static i32 find_linked_function(const Func *f);
+
+/* subexpression sharing */
+static b8 intern_subexprs(ExprTree *e);
+static i32 subexpr_intern(const ExprTree *e);
+static u64 subexpr_hash(const ExprTree *e);
+static b8 subexpr_equals(const ExprTree *a, const ExprTree *b);
+static b8 has_shared_subexpr(const ExprTree *e);
+static b8 is_shared(const ExprTree *e);
 
 /* codegen */
 static ExeExpr *codegen(const ExprTree *e);
+static void codegen_code(ExeExpr *exe, const ExprTree *e);
 static void codegen_expr(ExeExpr *exe, const ExprTree *e);
+static void codegen_node(ExeExpr *exe, const ExprTree *e);
+static void codegen_measure(ExeExpr *exe);
 static void exe_append_op(ExeExpr *exe, Op op);
-static void exe_append_i32(ExeExpr *exe, i32 v);
 static void exe_append_u32(ExeExpr *exe, u32 v);
-static void exe_append_f32(ExeExpr *exe, f32 v);
 static void exe_append(ExeExpr *exe, const void *val, u32 size);
+static i32 order_globals(u32 index, u8 *state, u32 *n_ordered);
+static void assemble_registers(ExeExpr *exe);
+static u16 reg_op_code(OpKind kind, Type type);
+static void fuse_reg_ops(ExeExpr *exe);
+static u32 memo_args_size(const Func *f);
+static u64 state_site(const char *src, u32 ordinal);
+static u32 op_operand_size(const Op *op);
+
+/* cache */
+static ExeExpr *cache_load(const char *src, ExprTree **e);
+static void cache_store(const ExeExpr *exe, const char *src);
+static void cache_push(const CacheEntry *entry, const char *src, const u8 *code);
+static i32 cache_relocate_strs(u8 *code, u32 size, const char *src, u32 src_length, b8 to_offsets);
+static ExprTree *cache_rebuild_tree(const ExeExpr *exe);
+static b8 cache_file_is_valid(void);
+static void cache_write(void);
+static i32 cache_entry_compare(const void *a, const void *b);
+static u64 cache_key(const char *src, u32 src_length);
+static u64 cache_abi_hash(void);
+static u64 globals_hash(void);
 
 /* misc. debug */
 static void token_print(Token *t);
@@ -201,6 +339,15 @@ static const char *const TOKEN_TO_STR[] =
     [TOK_FSLASH]        = "/",
     [TOK_PERCENT]       = "%",
     [TOK_COMMA]         = ",",
+    [TOK_DOT]           = ".",
+    [TOK_QUESTION]      = "?",
+    [TOK_COLON]         = ":",
+    [TOK_EQ]            = "==",
+    [TOK_NE]            = "!=",
+    [TOK_LT]            = "<",
+    [TOK_LE]            = "<=",
+    [TOK_GT]            = ">",
+    [TOK_GE]            = ">=",
     [TOK_BOOL_LITERAL]  = "<bool-literal>",
     [TOK_INT_LITERAL]   = "<int-literal>",
     [TOK_FLOAT_LITERAL] = "<float-literal>",
@@ -239,14 +386,75 @@ const Const BUILTIN_CONSTANTS[] =
 };
 static const size_t N_BUILTIN_CONSTANTS = sizeof(BUILTIN_CONSTANTS) / sizeof(BUILTIN_CONSTANTS[0]);
 
+/*
+ * The builtin functions and constants, hashed on their names. Slots hold 1 + an index 
+ * into `BUILTIN_FUNCTIONS`, resp. `BUILTIN_CONSTANTS`, or 0 if empty. A function slot 
+ * refers to the first overload of the name, and the other overloads are chained to it 
+ * through `next_overload`, in the order of `BUILTIN_FUNCTIONS`. Built on first use.
+ */
+static struct {
+    b8 is_built;
+    u16 functions[NAME_TABLE_SIZE];
+    u16 constants[NAME_TABLE_SIZE];
+    u16 next_overload[NAME_TABLE_SIZE];
+} builtin_names = {0};
+
+/* Code is generated here first, and moved to the r2r arena once complete */
+static struct {
+    u8 *arr;
+    u32 capacity;
+} codegen_buffer = {0};
+
+/* The cache of compiled expressions opened by `sel_cache_open()` */
+static struct {
+    b8 is_open;
+    char *filepath;
+    u8 *file;                       /* mapped, or NULL if there is no valid cache file */
+    size_t file_size;
+    const CacheEntry *entries;      /* of `file` */
+    u32 n_entries;
+    const u8 *blob;                 /* of `file` */
+    u32 blob_size;
+    HglDynamicArray(CacheEntry) new_entries; /* of the expressions compiled since opening */
+    HglDynamicArray(u8) new_blob;
+    HglDynamicArray(ExprTree *) stack;       /* scratch of `cache_rebuild_tree()` */
+    u32 n_hits;
+    u32 n_misses;
+    u32 n_stored;                   /* misses that could be cached */
+} cache = {0};
+
+/* Expressions compiled since `sel_begin_session()` and their subexpressions */
+static struct {
+    b8 is_open;
+    b8 is_linking;
+    Array(struct { ExeExpr *exe; ExprTree *e; }, SESSION_MAX_N_EXPRS) exprs;
+    SubExpr subexprs[SESSION_MAX_N_SUBEXPRS]; /* open addressing on `hash` */
+    Array(Global, SEL_MAX_N_GLOBALS) globals;
+    u32 global_order[SEL_MAX_N_GLOBALS]; /* in which the globals are evaluated */
+    u64 globals_hash; /* see `globals_hash()` */
+    b8 is_defining_globals;
+    u32 id; /* incremented by every `sel_begin_session()`. See `sel_claim_state()` */
+} session = {0};
+
 /*--- Public functions ------------------------------------------------------------------*/
 
 ExeExpr *sel_compile(const char *src)
 {
     ExeExpr *exe = NULL;
+    ExprTree *e = NULL;
+    u32 n_elements = 0;
+
+    /* compiled by an earlier run? */
+    if (cache.is_open) {
+        exe = cache_load(src, &e);
+        if (exe != NULL) {
+            goto out_compiled;
+        }
+        cache.n_misses++;
+    }
 
     /* lexer + parser step */
-    ExprTree *e = parse_expr(src);
+    e = parse_expr(src, &n_elements);
     if (e == NULL) {
         goto out;
     }
@@ -262,16 +470,383 @@ ExeExpr *sel_compile(const char *src)
         goto out;
     }
 
+    /* optimization step */
+    (void) optimize(e);
+
     /* codegen step. *Should* never fail if the previous steps succeed */
     exe = codegen(e);
-
-    /* Attach source code reference */
+    if (exe->stack_size > SEL_MAX_STACK_SIZE) {
+        log_error("Codegen error: The expression needs %u bytes of stack. At most %d are available.", 
+                  exe->stack_size, SEL_MAX_STACK_SIZE);
+        exe = NULL;
+        goto out;
+    }
+    /* Attach source code reference. The states of stateful calls are keyed on it */
     exe->source_code = src;
+    exe->n_elements = n_elements;
+    assemble_registers(exe);
+    if (cache.is_open) {
+        cache_store(exe, src);
+    }
+
+out_compiled:
+    /* Remember the expression for `sel_end_session()` */
+    if (session.is_open && e != NULL && session.exprs.count < SESSION_MAX_N_EXPRS) {
+        session.exprs.arr[session.exprs.count].exe = exe;
+        session.exprs.arr[session.exprs.count].e = e;
+        session.exprs.count++;
+    }
 
 out:
+    /* the tree of an expression in a session is kept until `sel_end_session()` */
+    if (!session.is_open) {
+        hgl_free_all(g_sel_arena);
+    }
     return exe;
 }
 
+void sel_begin_session(void)
+{
+    session.is_open = true;
+    session.id++;
+    array_clear(&session.exprs);
+    array_clear(&session.globals);
+    session.globals_hash = 0;
+
+    /* the trees of a session never ended, e.g. after a failed reload */
+    hgl_free_all(g_sel_arena);
+}
+
+/*
+ * Shares identical subexpressions between all expressions compiled since the call
+ * to `sel_begin_session()`. A subexpression occurring more than once is evaluated 
+ * by whichever occurrence is reached first in a frame (see `sel_begin_frame()`), 
+ * and its value is reused by the others. Calls to functions flagged 
+ * `FUNC_FLAG_VOLATILE`, `FUNC_FLAG_CONTEXT` or `FUNC_FLAG_STATE` are never shared. 
+ * The expression trees, kept in the SEL arena since their compilation, are freed.
+ */
+void sel_end_session(void)
+{
+    if (!session.is_open) {
+        return;
+    }
+    session.is_open = false;
+
+    /* resolve the names of shaders, uniforms, and textures, now that they are all loaded */
+    b8 linked[SESSION_MAX_N_EXPRS];
+    for (u32 i = 0; i < session.exprs.count; i++) {
+        linked[i] = link_names(session.exprs.arr[i].e);
+    }
+
+    /* count the occurrences of every subexpression */
+    memset(session.subexprs, 0, sizeof(session.subexprs));
+    for (u32 i = 0; i < session.exprs.count; i++) {
+        (void) intern_subexprs(session.exprs.arr[i].e);
+    }
+
+    /* subexpressions occurring more than once get a slot in the SVM */
+    u32 n_slots = 0;
+    for (u32 i = 0; i < SESSION_MAX_N_SUBEXPRS; i++) {
+        SubExpr *sub = &session.subexprs[i];
+        sub->slot = -1;
+        if (sub->e != NULL && sub->n_refs > 1 && n_slots < SEL_MAX_N_SHARED_VALUES) {
+            sub->slot = (i32) n_slots++;
+        }
+    }
+
+    /* regenerate the code of the expressions referencing them */
+    session.is_linking = true;
+    for (u32 i = 0; i < session.exprs.count; i++) {
+        ExeExpr *exe = session.exprs.arr[i].exe;
+        ExprTree *e = session.exprs.arr[i].e;
+        if (linked[i] || has_shared_subexpr(e)) {
+            exe->has_been_computed_once = false;
+            codegen_code(exe, e);
+            assemble_registers(exe);
+        }
+    }
+    session.is_linking = false;
+    array_clear(&session.exprs);
+    hgl_free_all(g_sel_arena);
+
+    /* slots may have been reassigned */
+    sel_begin_frame();
+}
+
+/*
+ * Links the register programs of `exes` into a single frame program, which evaluates 
+ * all of them, in order, in one run of the VM (see `sel_run_frame_program()`). 
+ * `exes[i]` is evaluated in `contexts[i]`, and its value is left at `values[i]`. The 
+ * values are stored contiguously, in the order of `exes`, in a staging area at the 
+ * start of the register file of the program. Constant expressions are evaluated once, 
+ * here. The others are only recomputed when stale, like in `sel_eval()`. Returns NULL, 
+ * leaving `values` untouched, if the registers of all expressions don't fit in a 
+ * single register file.
+ */
+ExeExpr *sel_link_frame_program(ExeExpr *const *exes, const SVMContext *contexts, u32 n, u8 **values)
+{
+    /* lay out the staging area, followed by the registers of every expression */
+    u32 *staging = hgl_alloc(g_frame_arena, n * sizeof(u32) + 1);
+    u32 *base = hgl_alloc(g_frame_arena, n * sizeof(u32) + 1);
+    u32 top = 0;
+    for (u32 i = 0; i < n; i++) {
+        staging[i] = top;
+        top += (TYPE_TO_SIZE[exes[i]->type] + 3) & ~3u;
+    }
+    top = (top + 15) & ~15u; /* temporaries stay aligned */
+    u32 n_ops = 0;
+    u32 cost = 0;
+    for (u32 i = 0; i < n; i++) {
+        if (exes[i]->qualifier & QUALIFIER_CONST) {
+            continue;
+        }
+        base[i] = top;
+        top += (exes[i]->regs_size + 15) & ~15u;
+        cost += exes[i]->cost;
+        n_ops += exes[i]->n_ops + 3; /* plus a context switch, a guard, and a move to the staging area */
+    }
+    if (top > UINT16_MAX) {
+        return NULL;
+    }
+
+    ExeExpr *program = hgl_alloc(g_r2r_arena, sizeof(ExeExpr));
+    memset(program, 0, sizeof(ExeExpr));
+    program->type = TYPE_NIL;
+    program->cost = cost; /* when every expression is stale */
+    program->regs = hgl_alloc(g_r2r_arena, top + 1);
+    program->regs_size = top;
+    memset(program->regs, 0, top + 1);
+    program->ops = hgl_alloc(g_r2r_arena, (n_ops + 1) * sizeof(RegOp));
+    SVMContext *program_contexts = hgl_alloc(g_r2r_arena, n * sizeof(SVMContext) + 1);
+    memcpy(program_contexts, contexts, n * sizeof(SVMContext));
+    program->contexts = program_contexts;
+    ExeExpr **linked = hgl_alloc(g_r2r_arena, n * sizeof(ExeExpr *) + 1);
+    memcpy(linked, exes, n * sizeof(ExeExpr *));
+    program->linked = linked;
+
+    i32 current_context = -1;
+    for (u32 i = 0; i < n; i++) {
+        ExeExpr *exe = exes[i];
+        values[i] = &program->regs[staging[i]];
+        if (exe->qualifier & QUALIFIER_CONST) {
+            SelValue v = sel_eval(exe, contexts[i], false);
+            memcpy(values[i], &v, TYPE_TO_SIZE[exe->type]);
+            continue;
+        }
+
+        if ((current_context == -1) || (contexts[i].shader != contexts[current_context].shader)) {
+            program->ops[program->n_ops++] = (RegOp) {.kind = OP_CONTEXT, .code = REG_OP_CONTEXT, .imm = i};
+            current_context = (i32) i;
+        }
+
+        /* skipped unless stale. Computed by the first run in any case */
+        exe->computed_at = 0;
+        program->ops[program->n_ops++] = (RegOp) {
+            .kind = OP_GUARD,
+            .code = REG_OP_GUARD,
+            .rhs  = (u16) (exe->n_ops + 1),
+            .imm  = i,
+        };
+
+        /* relocate the program of the expression to its registers */
+        memcpy(&program->regs[base[i]], exe->regs, exe->regs_size);
+        for (u32 j = 0; j < exe->n_ops; j++) {
+            RegOp op = exe->ops[j];
+            op.dst = (u16) (op.dst + base[i]);
+            op.lhs = (u16) (op.lhs + base[i]);
+            if ((op.code != REG_OP_SHARED) && (op.code != REG_OP_MOVE_BLOCK) && 
+                (op.code != REG_OP_JUMP_IF_FALSE) && (op.code != REG_OP_JUMP) && 
+                (op.code != REG_OP_STATE)) {
+                op.rhs = (u16) (op.rhs + base[i]); /* not a skip, a size, or a state */
+            }
+            if ((op.code == REG_OP_MUL_ADD_F32) || (op.code == REG_OP_MUL_SUB_F32)) {
+                op.imm += base[i];
+            }
+            program->ops[program->n_ops++] = op;
+        }
+
+        program->ops[program->n_ops++] = (RegOp) {
+            .kind = OP_STAGE,
+            .type = exe->type,
+            .dst  = (u16) staging[i],
+            .lhs  = (u16) (base[i] + exe->result),
+            .code = REG_OP_STAGE,
+        };
+    }
+    program->ops[program->n_ops] = (RegOp) {.code = REG_OP_HALT};
+
+    return program;
+}
+
+/*
+ * Defines the globals of the session: named values that any expression compiled 
+ * afterwards may refer to by name, like a constant. Global `i` is called `names[i]`, 
+ * and is the value of the expression `srcs[i]`, of type `types[i]`. Globals may refer 
+ * to each other, in any order, as long as no global depends on itself. A reference to 
+ * a global compiles to a single load of its value, which `sel_update_globals()` keeps 
+ * up to date, and an expression referring to a global inherits its sources of change. 
+ * Replaces any previously defined globals. Returns 0 on success and -1 otherwise, 
+ * leaving no globals defined.
+ */
+i32 sel_define_globals(const StringView *names, const Type *types, const char *const *srcs, u32 n)
+{
+    array_clear(&session.globals);
+    session.globals_hash = 0;
+    if (n > SEL_MAX_N_GLOBALS) {
+        log_error("At most %d globals may be defined.", SEL_MAX_N_GLOBALS);
+        return -1;
+    }
+
+    /* declare them all first, so that they may be referred to before they are defined */
+    for (u32 i = 0; i < n; i++) {
+        if (types[i] == TYPE_TEXTURE) {
+            log_error("The global `" SV_FMT "` is a texture. Globals may not be textures.", SV_ARG(names[i]));
+            goto out_error;
+        }
+        if (find_constant(names[i]) != -1) {
+            log_error("The global `" SV_FMT "` has the name of a builtin constant.", SV_ARG(names[i]));
+            goto out_error;
+        }
+        for (u32 j = 0; j < i; j++) {
+            if (sv_equals(names[i], names[j])) {
+                log_error("The global `" SV_FMT "` is defined more than once.", SV_ARG(names[i]));
+                goto out_error;
+            }
+        }
+        array_push(&session.globals, ((Global) {.name = names[i], .type = types[i], .exe = NULL}));
+    }
+    session.globals_hash = globals_hash();
+
+    /* compile them */
+    session.is_defining_globals = true;
+    for (u32 i = 0; i < n; i++) {
+        ExeExpr *exe = sel_compile(srcs[i]);
+        if (exe == NULL) {
+            log_error("Could not compile the global `" SV_FMT "`: `%s`.", SV_ARG(names[i]), srcs[i]);
+            session.is_defining_globals = false;
+            goto out_error;
+        }
+        if (exe->type != types[i]) {
+            log_error("The expression `%s` has type `%s` which does not match the specified type `%s` of the global `" SV_FMT "`.", 
+                      srcs[i], TYPE_TO_STR[exe->type], TYPE_TO_STR[types[i]], SV_ARG(names[i]));
+            session.is_defining_globals = false;
+            goto out_error;
+        }
+        session.globals.arr[i].exe = exe;
+    }
+    session.is_defining_globals = false;
+
+    /* every global is evaluated after the globals it refers to */
+    u8 state[SEL_MAX_N_GLOBALS] = {0};
+    u32 n_ordered = 0;
+    for (u32 i = 0; i < n; i++) {
+        if (order_globals(i, state, &n_ordered) != 0) {
+            goto out_error;
+        }
+    }
+
+    return 0;
+
+out_error:
+    array_clear(&session.globals);
+    session.globals_hash = 0;
+    return -1;
+}
+
+/* 
+ * Evaluates the globals, each after the globals it refers to. Called once per frame, 
+ * after `sel_begin_frame()` and before any expression referring to them is evaluated.
+ * Globals whose sources of change haven't changed keep their values.
+ */
+void sel_update_globals(void)
+{
+    for (u32 i = 0; i < session.globals.count; i++) {
+        u32 index = session.global_order[i];
+        SelValue v = sel_eval(session.globals.arr[index].exe, SEL_EMPTY_SVM_CONTEXT, false);
+        sel_set_global(index, v);
+    }
+}
+
+/*
+ * Opens the cache of compiled expressions at `filepath`, closing any cache already 
+ * open. Until `sel_cache_close()`, `sel_compile()` loads the bytecode of expressions 
+ * compiled by an earlier run from the cache, and skips their compilation. The cache 
+ * is keyed on the source code, and is discarded as a whole if the builtin functions 
+ * and constants, whose ids and values the bytecode refers to, have changed. A missing 
+ * or invalid cache file is treated as an empty cache.
+ */
+void sel_cache_open(const char *filepath)
+{
+    sel_cache_close();
+
+    size_t length = strlen(filepath);
+    cache.filepath = malloc(length + 1);
+    if (cache.filepath == NULL) {
+        return;
+    }
+    memcpy(cache.filepath, filepath, length + 1);
+    cache.is_open = true;
+    cache.n_hits = 0;
+    cache.n_misses = 0;
+    cache.n_stored = 0;
+
+    cache.file = io_map_file(filepath, &cache.file_size);
+    if (cache.file != NULL && !cache_file_is_valid()) {
+        io_unmap_file(cache.file, cache.file_size);
+        cache.file = NULL;
+    }
+    if (cache.file != NULL) {
+        const CacheHeader *header = (const CacheHeader *) cache.file;
+        cache.entries = (const CacheEntry *) (cache.file + sizeof(CacheHeader));
+        cache.n_entries = header->n_entries;
+        cache.blob = cache.file + sizeof(CacheHeader) + header->n_entries * sizeof(CacheEntry);
+        cache.blob_size = header->blob_size;
+    }
+}
+
+/*
+ * Reports the hit rate of the cache, and replaces the cache file with the expressions 
+ * compiled since `sel_cache_open()`, unless they all came from it. 
+ */
+void sel_cache_close(void)
+{
+    if (!cache.is_open) {
+        return;
+    }
+    cache.is_open = false;
+
+    u32 n_compiled = cache.n_hits + cache.n_misses;
+    if (n_compiled > 0) {
+        log_info("SEL cache: %u of %u expressions (%.0f%%) loaded from `%s`.", cache.n_hits, 
+                 n_compiled, 100.0 * cache.n_hits / n_compiled, cache.filepath);
+    }
+
+    /* sorted on the key, without duplicates */
+    CacheEntry *entries = cache.new_entries.arr;
+    u32 n = (u32) cache.new_entries.length;
+    if (n > 0) {
+        qsort(entries, n, sizeof(CacheEntry), cache_entry_compare);
+    }
+    u32 n_unique = 0;
+    for (u32 i = 0; i < n; i++) {
+        if (n_unique == 0 || entries[i].key != entries[n_unique - 1].key) {
+            entries[n_unique++] = entries[i];
+        }
+    }
+    cache.new_entries.length = n_unique;
+
+    io_unmap_file(cache.file, cache.file_size);
+    if (cache.n_stored > 0 || n_unique != cache.n_entries) {
+        cache_write();
+    }
+
+    hgl_da_free(&cache.new_entries);
+    hgl_da_free(&cache.new_blob);
+    hgl_da_free(&cache.stack);
+    free(cache.filepath);
+    memset(&cache, 0, sizeof(cache));
+}
+
 void sel_list_builtins(void) {
     printf("# Constants:\n");
     printf("```\n");
@@ -288,7 +863,7 @@ void sel_list_builtins(void) {
         printf("```\n");
         for (u32 i = 0; i < N_BUILTIN_FUNCTIONS; i++) {
             const Func *f = &BUILTIN_FUNCTIONS[i];
-            if (f->type != t) {
+            if (f->type != t || (f->flags & FUNC_FLAG_LINKED)) {
                 continue;
             }
             printf("%-80s %s\n", f->synopsis, (f->desc != NULL) ? f->desc : "-");
@@ -341,6 +916,7 @@ static Token lexer_next(Lexer *l)
 {
     Token t = lexer_peek(l);
     sv_lchop(&l->buf, t.length);
+    l->has_peeked = false;
     return t;
 }
 
@@ -349,7 +925,20 @@ static void lexer_eat(Lexer *l)
     (void) lexer_next(l);
 }
 
+/* 
+ * Keeps the peeked token, so a token peeked at several times before it is consumed is 
+ * lexed only once
+ */
 static Token lexer_peek(Lexer *l)
+{
+    if (!l->has_peeked) {
+        l->peeked = lexer_lex(l);
+        l->has_peeked = true;
+    }
+    return l->peeked;
+}
+
+static Token lexer_lex(Lexer *l)
 {
     // TODO anneal this brittle crap
 
@@ -372,6 +961,19 @@ static Token lexer_peek(Lexer *l)
         case '%':  return (Token) {.kind = TOK_PERCENT, .text = sv_substr(l->buf, 0, 1), .length = 1}; break;
         case ',':  return (Token) {.kind = TOK_COMMA,   .text = sv_substr(l->buf, 0, 1), .length = 1}; break;
         case '.':  return (Token) {.kind = TOK_DOT,     .text = sv_substr(l->buf, 0, 1), .length = 1}; break;
+        case '?':  return (Token) {.kind = TOK_QUESTION, .text = sv_substr(l->buf, 0, 1), .length = 1}; break;
+        case ':':  return (Token) {.kind = TOK_COLON,   .text = sv_substr(l->buf, 0, 1), .length = 1}; break;
+
+        case '<': case '>': case '=': case '!': {
+            b8 is_two_chars = l->buf.length > 1 && l->buf.start[1] == '=';
+            TokenKind kind = (c == '<') ? (is_two_chars ? TOK_LE : TOK_LT) :
+                             (c == '>') ? (is_two_chars ? TOK_GE : TOK_GT) :
+                             (c == '=') ? TOK_EQ : TOK_NE;
+            LEXER_ASSERT(is_two_chars || c == '<' || c == '>', 
+                         "Expected `%c=`. Assignment and logical not are not supported.", c);
+            u32 length = is_two_chars ? 2 : 1;
+            return (Token) {.kind = kind, .text = sv_substr(l->buf, 0, length), .length = length};
+        } break;
 
         case '"': {
             size_t i = 1;
@@ -480,12 +1082,12 @@ static Token lexer_peek(Lexer *l)
 
 /*--- PARSER ----------------------------------------------------------------------------*/
 
-static ExprTree *parse_expr(const char *str)
+static ExprTree *parse_expr(const char *str, u32 *n_elements)
 {
     i32 err;
     Lexer l = lexer_begin(str);
     ExprTree *e = NULL;
-    err = parse_add_expr(&e, &l);
+    err = parse_cond_expr(&e, &l);
     if (err != 0) {
         return NULL;
     }
@@ -497,9 +1099,60 @@ static ExprTree *parse_expr(const char *str)
         return NULL;
     }
 
+    *n_elements = l.n_elements;
     return e;
 }
 
+/* 
+ * `c ? a : b` binds weakest, and associates to the right, so that `c ? a : d ? b : e` 
+ * chains like in C 
+ */
+static i32 parse_cond_expr(ExprTree **e, Lexer *l)
+{
+    ExprTree *then, *otherwise;
+
+    TRY(parse_compare_expr(e, l));
+    Token t = lexer_peek(l);
+    if (t.kind != TOK_QUESTION) {
+        return 0;
+    }
+    lexer_eat(l);
+    TRY(parse_cond_expr(&then, l));
+    Token colon = lexer_next(l);
+    PARSER_ASSERT(colon.kind == TOK_COLON, "Expected ':' in conditional expression.");
+    TRY(parse_cond_expr(&otherwise, l));
+    ExprTree *branches = new_binary_expr(EXPR_BRANCHES, colon, then, otherwise);
+    *e = (branches != NULL) ? new_binary_expr(EXPR_COND, t, *e, branches) : NULL;
+
+    return (*e != NULL) ? 0 : -1;
+}
+
+static i32 parse_compare_expr(ExprTree **e, Lexer *l)
+{
+    ExprTree *tmp;
+
+    TRY(parse_add_expr(e, l));
+    while (true) {
+        Token t = lexer_peek(l);
+        if (t.kind < TOK_EQ || t.kind > TOK_GE) {
+            break;
+        }
+        lexer_eat(l);
+        TRY(parse_add_expr(&tmp, l));
+        *e = (t.kind == TOK_EQ) ? new_binary_expr(EXPR_EQ, t, *e, tmp) : 
+             (t.kind == TOK_NE) ? new_binary_expr(EXPR_NE, t, *e, tmp) : 
+             (t.kind == TOK_LT) ? new_binary_expr(EXPR_LT, t, *e, tmp) : 
+             (t.kind == TOK_LE) ? new_binary_expr(EXPR_LE, t, *e, tmp) : 
+             (t.kind == TOK_GT) ? new_binary_expr(EXPR_GT, t, *e, tmp) : 
+                                  new_binary_expr(EXPR_GE, t, *e, tmp);
+        if (*e == NULL) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 static i32 parse_add_expr(ExprTree **e, Lexer *l)
 {
     ExprTree *tmp;
@@ -515,6 +1168,9 @@ static i32 parse_add_expr(ExprTree **e, Lexer *l)
         TRY(parse_mul_expr(&tmp, l));
         *e = (t.kind == TOK_PLUS) ? new_binary_expr(EXPR_ADD, t, *e, tmp) : 
                                     new_binary_expr(EXPR_SUB, t, *e, tmp);
+        if (*e == NULL) {
+            return -1;
+        }
     }
 
     return 0;
@@ -535,6 +1191,9 @@ static i32 parse_mul_expr(ExprTree **e, Lexer *l)
         *e = (t.kind == TOK_STAR)   ? new_binary_expr(EXPR_MUL, t, *e, tmp) : 
              (t.kind == TOK_FSLASH) ? new_binary_expr(EXPR_DIV, t, *e, tmp) : 
                                       new_binary_expr(EXPR_REM, t, *e, tmp);
+        if (*e == NULL) {
+            return -1;
+        }
     }
 
     return 0;
@@ -553,6 +1212,9 @@ static i32 parse_dot_expr(ExprTree **e, Lexer *l)
         lexer_eat(l);
         TRY(parse_unary_or_atom_expr(&tmp, l));
         *e = new_binary_expr(EXPR_SWIZZLE, t, *e, tmp);
+        if (*e == NULL) {
+            return -1;
+        }
     }
 
     return 0;
@@ -572,7 +1234,7 @@ static i32 parse_unary_or_atom_expr(ExprTree **e, Lexer *l)
     switch (t.kind) {
         case TOK_LPAREN: {
             PARSER_ASSERT(lexer_peek(l).kind != TOK_RPAREN, "Expected expression after opening '('.");
-            TRY(parse_add_expr(&tmp, l));
+            TRY(parse_cond_expr(&tmp, l));
             *e = new_unary_expr(EXPR_PAREN, t, tmp);
             PARSER_ASSERT(lexer_next(l).kind == TOK_RPAREN, "Expected closing ')'.");
         } break;
@@ -586,8 +1248,30 @@ static i32 parse_unary_or_atom_expr(ExprTree **e, Lexer *l)
             if (lexer_peek(l).kind == TOK_LPAREN) {
                 lexer_eat(l);
                 TRY(parse_arglist_expr(&tmp, l));
-                *e = new_unary_expr(EXPR_FUNC, t, tmp);
                 PARSER_ASSERT(lexer_next(l).kind == TOK_RPAREN, "Expected closing ')'.");
+                if (sv_equals(t.text, SV_LIT("select"))) {
+                    /* `select(c, a, b)` is `c ? a : b`, and reuses the argument nodes */
+                    PARSER_ASSERT(tmp != NULL && tmp->rhs != NULL && tmp->rhs->rhs != NULL &&
+                                  tmp->rhs->rhs->rhs == NULL, 
+                                  "`select()` takes exactly 3 arguments.");
+                    ExprTree *branches = tmp->rhs;
+                    branches->kind = EXPR_BRANCHES;
+                    branches->rhs = branches->rhs->lhs;
+                    *e = new_binary_expr(EXPR_COND, t, tmp->lhs, branches);
+                } else if (sv_equals(t.text, SV_LIT("array"))) {
+                    PARSER_ASSERT(tmp != NULL, "`array()` takes at least 1 argument.");
+                    u32 n_args = 0;
+                    for (ExprTree *arg = tmp; arg != NULL; arg = arg->rhs) {
+                        n_args++;
+                    }
+                    PARSER_ASSERT(l->n_elements == 0 || l->n_elements == n_args, 
+                                  "Each `array()` of an expression takes the same number of arguments. "
+                                  "Got %u and %u.", l->n_elements, n_args);
+                    l->n_elements = n_args;
+                    *e = array_to_cond_expr(tmp, t, 0);
+                } else {
+                    *e = new_unary_expr(EXPR_FUNC, t, tmp);
+                }
             } else {
                 *e = new_atom_expr(EXPR_ID, t);            
             }
@@ -607,7 +1291,15 @@ static i32 parse_unary_or_atom_expr(ExprTree **e, Lexer *l)
         case TOK_FSLASH:
         case TOK_PERCENT:
         case TOK_COMMA: 
-        case TOK_DOT: {
+        case TOK_DOT: 
+        case TOK_QUESTION:
+        case TOK_COLON:
+        case TOK_EQ:
+        case TOK_NE:
+        case TOK_LT:
+        case TOK_LE:
+        case TOK_GT:
+        case TOK_GE: {
             PARSER_ERROR("Unexpected token: `%s`.", TOKEN_TO_STR[t.kind]);
         } break;
 
@@ -625,7 +1317,7 @@ static i32 parse_unary_or_atom_expr(ExprTree **e, Lexer *l)
             return -1;
     }
 
-    return 0;
+    return (*e != NULL) ? 0 : -1;
 }
 
 static i32 parse_arglist_expr(ExprTree **e, Lexer *l)
@@ -637,8 +1329,11 @@ static i32 parse_arglist_expr(ExprTree **e, Lexer *l)
         *e = NULL;
         return 0;
     }
-    TRY(parse_add_expr(&tmp, l));
+    TRY(parse_cond_expr(&tmp, l));
     *e = new_binary_expr(EXPR_ARGLIST, t, tmp, NULL);
+    if (*e == NULL) {
+        return -1;
+    }
     while (true) {
         t = lexer_peek(l);
         if (t.kind != TOK_COMMA) {
@@ -652,33 +1347,153 @@ static i32 parse_arglist_expr(ExprTree **e, Lexer *l)
     return 0;
 }
 
+/* 
+ * `array(a, b, c)` is `index() == 0 ? a : index() == 1 ? b : c`, which picks the element 
+ * computed by `sel_eval_array()`, and reuses the argument nodes. The uniform checks that 
+ * it has as many elements as there are arguments. Returns NULL if the arena is full.
+ */
+static ExprTree *array_to_cond_expr(ExprTree *args, Token t, u32 index)
+{
+    if (args->rhs == NULL) {
+        return args->lhs;
+    }
+
+    char *text = hgl_alloc(g_sel_arena, 16);
+    if (text == NULL) {
+        log_error("Parser error: Out of memory for expression trees. Too many expressions in one session.");
+        return NULL;
+    }
+    u32 length = (u32) snprintf(text, 16, "%u", index);
+    Token func = {.kind = TOK_IDENTIFIER, .text = SV_LIT("index"), .length = 5};
+    Token lit = {.kind = TOK_INT_LITERAL, .text = sv_from(text, length), .length = length};
+    ExprTree *cond = new_binary_expr(EXPR_EQ, t, new_unary_expr(EXPR_FUNC, func, NULL), 
+                                     new_atom_expr(EXPR_LIT, lit));
+    ExprTree *rest = array_to_cond_expr(args->rhs, t, index + 1);
+    if (cond == NULL || cond->lhs == NULL || cond->rhs == NULL || rest == NULL) {
+        return NULL;
+    }
+    ExprTree *branches = args;
+    branches->kind = EXPR_BRANCHES;
+    branches->rhs = rest;
+    return new_binary_expr(EXPR_COND, t, cond, branches);
+}
+
 static ExprTree *new_binary_expr(ExprKind kind, Token token, ExprTree *lhs, ExprTree *rhs)
 {
-    ExprTree *e = hgl_alloc(g_frame_arena, sizeof(ExprTree));
-    e->kind = kind;
-    e->token = token;
-    e->lhs = lhs;
-    e->rhs = rhs;
+    ExprTree *e = new_expr(kind, token);
+    if (e != NULL) {
+        e->lhs = lhs;
+        e->rhs = rhs;
+    }
     return e;
 }
 
 static ExprTree *new_unary_expr(ExprKind kind, Token token, ExprTree *child)
 {
-    ExprTree *e = hgl_alloc(g_frame_arena, sizeof(ExprTree));
-    e->kind = kind;
-    e->token = token;
-    e->child = child;
+    ExprTree *e = new_expr(kind, token);
+    if (e != NULL) {
+        e->child = child;
+    }
     return e;
 }
 
 static ExprTree *new_atom_expr(ExprKind kind, Token token)
 {
-    ExprTree *e = hgl_alloc(g_frame_arena, sizeof(ExprTree));
+    return new_expr(kind, token);
+}
+
+/* 
+ * Trees live in the SEL arena until the expression is compiled, or until the end of 
+ * the session, if one is open. Scratch memory of later passes is pushed on top of 
+ * them, and popped when done. Returns NULL if the arena is full.
+ */
+static ExprTree *new_expr(ExprKind kind, Token token)
+{
+    ExprTree *e = hgl_alloc(g_sel_arena, sizeof(ExprTree));
+    if (e == NULL) {
+        log_error("Parser error: Out of memory for expression trees. Too many expressions in one session.");
+        return NULL;
+    }
     e->kind = kind;
     e->token = token;
+    e->shared = -1;
+    e->lhs = NULL;
+    e->rhs = NULL;
     return e;
 }
 
+/*--- BUILTIN NAMES -------------------------------------------------------------------*/
+
+/* Index into `BUILTIN_FUNCTIONS` of the first overload of `name`, or -1 if there is none */
+static i32 find_function(StringView name)
+{
+    if (!builtin_names.is_built) {
+        build_name_tables();
+    }
+    return (i32) *function_slot(name) - 1;
+}
+
+/* The overload of the same name following `func_id`, or -1 */
+static i32 next_overload(i32 func_id)
+{
+    return (i32) builtin_names.next_overload[func_id] - 1;
+}
+
+/* Index into `BUILTIN_CONSTANTS` of `name`, or -1 if there is no such constant */
+static i32 find_constant(StringView name)
+{
+    if (!builtin_names.is_built) {
+        build_name_tables();
+    }
+    return (i32) *constant_slot(name) - 1;
+}
+
+static void build_name_tables(void)
+{
+    assert(2*N_BUILTIN_FUNCTIONS <= NAME_TABLE_SIZE && "NAME_TABLE_SIZE is too small");
+    assert(2*N_BUILTIN_CONSTANTS <= NAME_TABLE_SIZE && "NAME_TABLE_SIZE is too small");
+
+    /* backwards, so that every overload is pushed in front of the ones following it */
+    for (i32 i = (i32)N_BUILTIN_FUNCTIONS - 1; i >= 0; i--) {
+        u16 *slot = function_slot(BUILTIN_FUNCTIONS[i].id);
+        builtin_names.next_overload[i] = *slot;
+        *slot = (u16)(i + 1);
+    }
+    for (u32 i = 0; i < N_BUILTIN_CONSTANTS; i++) {
+        *constant_slot(BUILTIN_CONSTANTS[i].id) = (u16)(i + 1);
+    }
+    builtin_names.is_built = true;
+}
+
+static u16 *function_slot(StringView name)
+{
+    for (u32 i = name_hash(name);; i++) {
+        u16 *slot = &builtin_names.functions[i & (NAME_TABLE_SIZE - 1)];
+        if (*slot == 0 || sv_equals(BUILTIN_FUNCTIONS[*slot - 1].id, name)) {
+            return slot;
+        }
+    }
+}
+
+static u16 *constant_slot(StringView name)
+{
+    for (u32 i = name_hash(name);; i++) {
+        u16 *slot = &builtin_names.constants[i & (NAME_TABLE_SIZE - 1)];
+        if (*slot == 0 || sv_equals(BUILTIN_CONSTANTS[*slot - 1].id, name)) {
+            return slot;
+        }
+    }
+}
+
+/* FNV-1a */
+static u32 name_hash(StringView name)
+{
+    u32 h = 2166136261u;
+    for (size_t i = 0; i < name.length; i++) {
+        h = (h ^ (u8)name.start[i]) * 16777619u;
+    }
+    return h;
+}
 
 /*--- TYPE-/NAMECHECKER -----------------------------------------------------------------*/
 
@@ -823,6 +1638,7 @@ static TypeAndQualifier type_and_namecheck(ExprTree *e)
                     }
                 }
             }
+            e->rhs->value.val_u32 = construct_swizzle_descriptor(e->rhs->token.text);
            
             /* 
              * Inherit qualifier from lhs. Infer type from number of elements in the rhs
@@ -849,18 +1665,71 @@ static TypeAndQualifier type_and_namecheck(ExprTree *e)
             }
         } break;
 
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE: {
+            t0 = type_and_namecheck(e->lhs); 
+            t1 = type_and_namecheck(e->rhs); 
+            TYPE_AND_NAMECHECK_ASSERT(t0.type == t1.type, "Operands to comparison are of different types: "
+                                      "Got `%s` and `%s`.", TYPE_TO_STR[t0.type], TYPE_TO_STR[t1.type]);
+            b8 is_ordered = t0.type == TYPE_INT || t0.type == TYPE_UINT || t0.type == TYPE_FLOAT;
+            if (e->kind == EXPR_EQ || e->kind == EXPR_NE) {
+                TYPE_AND_NAMECHECK_ASSERT(is_ordered || t0.type == TYPE_BOOL, "Operands to `%s` operator must be "
+                                          "of type BOOL, INT, UINT, or FLOAT.", TOKEN_TO_STR[e->token.kind]);
+            } else {
+                TYPE_AND_NAMECHECK_ASSERT(is_ordered, "Operands to `%s` operator must be of type INT, UINT, or "
+                                          "FLOAT.", TOKEN_TO_STR[e->token.kind]);
+            }
+            t0.type = TYPE_BOOL;
+            if ((t0.qualifier == QUALIFIER_CONST) && 
+                (t1.qualifier == QUALIFIER_CONST)) {
+                t0.qualifier = QUALIFIER_CONST;
+            } else {
+                t0.qualifier = QUALIFIER_NONE;
+            }
+        } break;
+
+        case EXPR_COND: {
+            TypeAndQualifier cond = type_and_namecheck(e->lhs);
+            if (cond.type == TYPE_AND_NAMECHECKER_ERROR_) {
+                return cond;
+            }
+            TYPE_AND_NAMECHECK_ASSERT(cond.type == TYPE_BOOL, "Condition of conditional expression must be of "
+                                      "type BOOL. Got `%s`.", TYPE_TO_STR[cond.type]);
+            t0 = type_and_namecheck(e->rhs);
+            if (t0.type == TYPE_AND_NAMECHECKER_ERROR_) {
+                return t0;
+            }
+            if (cond.qualifier != QUALIFIER_CONST) {
+                t0.qualifier = QUALIFIER_NONE;
+            }
+        } break;
+
+        case EXPR_BRANCHES: {
+            t0 = type_and_namecheck(e->lhs); 
+            if (t0.type == TYPE_AND_NAMECHECKER_ERROR_) {
+                return t0;
+            }
+            t1 = type_and_namecheck(e->rhs); 
+            if (t1.type == TYPE_AND_NAMECHECKER_ERROR_) {
+                return t1;
+            }
+            TYPE_AND_NAMECHECK_ASSERT(t0.type == t1.type, "Branches of conditional expression are of different "
+                                      "types: Got `%s` and `%s`.", TYPE_TO_STR[t0.type], TYPE_TO_STR[t1.type]);
+            if (t1.qualifier != QUALIFIER_CONST) {
+                t0.qualifier = QUALIFIER_NONE;
+            }
+        } break;
+
         case EXPR_PAREN: {
             t0 = type_and_namecheck(e->child);
         } break;
         
         case EXPR_FUNC: {
-            for (size_t i = 0; i < N_BUILTIN_FUNCTIONS; i++) {
-                if (sv_equals(e->token.text, BUILTIN_FUNCTIONS[i].id)) {
-                    t0 = type_and_namecheck_function(e->child, &BUILTIN_FUNCTIONS[i], BUILTIN_FUNCTIONS[i].argtypes, true);
-                    goto out;
-                } 
-            }
-            TYPE_AND_NAMECHECK_ERROR("No such function: `" SV_FMT "(..)`.", SV_ARG(e->token.text));
+            t0 = type_and_namecheck_function(e);
         } break;
         
         case EXPR_ARGLIST: {
@@ -870,14 +1739,19 @@ static TypeAndQualifier type_and_namecheck(ExprTree *e)
         case EXPR_LIT: {
             if (e->token.kind == TOK_BOOL_LITERAL) {
                 t0.type = TYPE_BOOL;
+                e->value.val_bool = sv_equals(e->token.text, SV_LIT("true")) ? 1 : 0;
             } else if (e->token.kind == TOK_INT_LITERAL) {
                 t0.type = TYPE_INT;
+                e->value.val_i32 = (i32) sv_to_i64(e->token.text);
             } else if (e->token.kind == TOK_UINT_LITERAL) {
                 t0.type = TYPE_UINT;
+                e->value.val_u32 = (u32) sv_to_u64(e->token.text);
             } else if (e->token.kind == TOK_FLOAT_LITERAL) {
                 t0.type = TYPE_FLOAT;
+                e->value.val_f32 = (f32) sv_to_f64(e->token.text);
             } else if (e->token.kind == TOK_STR_LITERAL) {
                 t0.type = TYPE_STR;
+                e->value.val_str = e->token.text;
             } else {
                 TYPE_AND_NAMECHECK_ASSERT(false, "You should not see this #2"); // TODO
             }
@@ -885,16 +1759,30 @@ static TypeAndQualifier type_and_namecheck(ExprTree *e)
         } break;
         
         case EXPR_ID: {
-            /* Freestanding identifier - must be a constant */
-            for (size_t i = 0; i < N_BUILTIN_CONSTANTS; i++) {
-                if (sv_equals(e->token.text, BUILTIN_CONSTANTS[i].id)) {
-                    t0 = (TypeAndQualifier) {BUILTIN_CONSTANTS[i].type, QUALIFIER_CONST};
+            /* Freestanding identifier - must be a constant ... */
+            i32 c = find_constant(e->token.text);
+            if (c != -1) {
+                t0 = (TypeAndQualifier) {BUILTIN_CONSTANTS[c].type, QUALIFIER_CONST};
+                e->value = BUILTIN_CONSTANTS[c].value;
+                goto out;
+            }
+
+            /* ... or a global */
+            for (u32 i = 0; i < session.globals.count; i++) {
+                if (sv_equals(e->token.text, session.globals.arr[i].name)) {
+                    t0 = (TypeAndQualifier) {session.globals.arr[i].type, QUALIFIER_NONE};
+                    e->kind = EXPR_GLOBAL;
+                    e->global_id = i;
                     goto out;
-                } 
+                }
             }
             TYPE_AND_NAMECHECK_ERROR("Unknown identifier: `" SV_FMT "`.", SV_ARG(e->token.text));
         } break;
 
+        case EXPR_GLOBAL: {
+            t0 = (TypeAndQualifier) {session.globals.arr[e->global_id].type, QUALIFIER_NONE};
+        } break;
+
         case N_EXPR_KINDS: {
             TYPE_AND_NAMECHECK_ASSERT(false, "You should not see this #3"); // TODO
         } break;
@@ -906,41 +1794,694 @@ out:
     return t0;
 }
 
-static TypeAndQualifier type_and_namecheck_function(ExprTree *e, const Func *f, const Type *argtypes, b8 const_args)
+static TypeAndQualifier type_and_namecheck_function(ExprTree *e)
 {
-    /* no more actual arguments? */
-    if (e == NULL) {
-        TYPE_AND_NAMECHECK_ASSERT(*argtypes == TYPE_NIL, "Too few arguments to built-in function: `%s`.", f->synopsis);
-        return (TypeAndQualifier){
-            .type = f->type, 
-            .qualifier = ((f->qualifier == QUALIFIER_PURE) && const_args) ? QUALIFIER_CONST : QUALIFIER_NONE,
-        };
+    Type argtypes[SEL_FUNC_MAX_N_ARGS];
+    u32 n_args = 0;
+    b8 const_args = true;
+
+    /* Typecheck the arguments */
+    for (ExprTree *arg = e->child; arg != NULL; arg = arg->rhs) {
+        TYPE_AND_NAMECHECK_ASSERT(arg->kind == EXPR_ARGLIST, "You should not see this #4");
+        TypeAndQualifier t = type_and_namecheck(arg->lhs);
+        if (t.type == TYPE_AND_NAMECHECKER_ERROR_) {
+            return t;
+        }
+        TYPE_AND_NAMECHECK_ASSERT(n_args < SEL_FUNC_MAX_N_ARGS, "Too many arguments to built-in function: `"
+                                  SV_FMT "(..)`.", SV_ARG(e->token.text));
+        argtypes[n_args++] = t.type;
+        const_args = const_args && (t.qualifier == QUALIFIER_CONST);
     }
 
-    /* no more arguments expected? */
-    if (*argtypes == TYPE_NIL) {
-        TYPE_AND_NAMECHECK_ERROR("Too many arguments to built-in function: `%s`.", f->synopsis);
-        return (TypeAndQualifier){
-            .type = f->type, 
-            .qualifier = ((f->qualifier == QUALIFIER_PURE) && const_args) ? QUALIFIER_CONST : QUALIFIER_NONE,
-        };
+    /* Find the overload of the function that accepts the argument types */
+    const Func *candidate = NULL;
+    u32 n_candidates = 0;
+    for (i32 i = find_function(e->token.text); i != -1; i = next_overload(i)) {
+        const Func *f = &BUILTIN_FUNCTIONS[i];
+        if (f->flags & FUNC_FLAG_LINKED) {
+            continue;
+        }
+        if (function_accepts_arguments(f, argtypes, n_args)) {
+            TYPE_AND_NAMECHECK_ASSERT(!(session.is_defining_globals && (f->flags & FUNC_FLAG_CONTEXT)), 
+                                      "`%s` depends on the shader it is called for, and may not be used "
+                                      "in a global.", f->synopsis);
+            e->func_id = (u32) i;
+            return (TypeAndQualifier){
+                .type = f->type, 
+                .qualifier = ((f->qualifier == QUALIFIER_PURE) && const_args) ? QUALIFIER_CONST : QUALIFIER_NONE,
+            };
+        }
+        candidate = f;
+        n_candidates++;
     }
 
-    /* Typecheck left-hand-side expression (head of argslist)*/
-    TYPE_AND_NAMECHECK_ASSERT(e->kind == EXPR_ARGLIST, "You should not see this #4");
-    TypeAndQualifier t = type_and_namecheck(e->lhs);
-    if (t.type == TYPE_AND_NAMECHECKER_ERROR_) {
-        return t;
+    if (n_candidates == 0) {
+        TYPE_AND_NAMECHECK_ERROR("No such function: `" SV_FMT "(..)`.", SV_ARG(e->token.text));
     }
-    TYPE_AND_NAMECHECK_ASSERT(t.type == *argtypes, "Type mismatch in arguments to built-in function: "
-                              "`%s`. Expected `%s` - Got `%s`.", f->synopsis, TYPE_TO_STR[*argtypes], 
-                              TYPE_TO_STR[t.type]);
 
-    /* Typecheck right-hand-side expression (tail of argslist)*/
-    return type_and_namecheck_function(e->rhs, f, ++argtypes, const_args && (t.qualifier == QUALIFIER_CONST));
+    if (n_candidates > 1) {
+        TYPE_AND_NAMECHECK_ERROR("No overload of built-in function `" SV_FMT "(..)` accepts the "
+                                 "given argument types.", SV_ARG(e->token.text));
+    }
+
+    /* Single candidate - report exactly what is wrong */
+    for (u32 i = 0; i < n_args; i++) {
+        TYPE_AND_NAMECHECK_ASSERT(candidate->argtypes[i] != TYPE_NIL, "Too many arguments to built-in function: "
+                                  "`%s`.", candidate->synopsis);
+        TYPE_AND_NAMECHECK_ASSERT(argtypes[i] == candidate->argtypes[i], "Type mismatch in arguments to built-in "
+                                  "function: `%s`. Expected `%s` - Got `%s`.", candidate->synopsis, 
+                                  TYPE_TO_STR[candidate->argtypes[i]], TYPE_TO_STR[argtypes[i]]);
+    }
+    TYPE_AND_NAMECHECK_ERROR("Too few arguments to built-in function: `%s`.", candidate->synopsis);
+}
+
+static b8 function_accepts_arguments(const Func *f, const Type *argtypes, u32 n_args)
+{
+    for (u32 i = 0; i < n_args; i++) {
+        if (f->argtypes[i] != argtypes[i]) {
+            return false;
+        }
+    }
+    return (n_args == SEL_FUNC_MAX_N_ARGS) || (f->argtypes[n_args] == TYPE_NIL);
+}
+
+
+/*--- OPTIMIZER -------------------------------------------------------------------------*/
+
+/*
+ * Simplifies a type-/namechecked expression tree in place. Constant subtrees are 
+ * evaluated at compile time and replaced by literals, and the identities `x*1`, 
+ * `1*x`, `x/1`, and `-(-x)` are applied to what remains. `x+0`, `0+x`, and `x-0` 
+ * are only applied to integers, as `-0.0 + 0.0` is `+0.0`.
+ * Subtrees calling functions that depend on the loaded session (e.g. `output_of()`) 
+ * are left for the VM. Returns true if `e` was evaluated at compile time.
+ */
+static b8 optimize(ExprTree *e)
+{
+    b8 foldable = false;
+
+    switch (e->kind) {
+        case EXPR_ADD:
+        case EXPR_SUB:
+        case EXPR_MUL:
+        case EXPR_DIV:
+        case EXPR_REM: {
+            b8 lhs = optimize(e->lhs);
+            b8 rhs = optimize(e->rhs);
+            foldable = lhs && rhs;
+
+            /* integer division by zero is left to happen at runtime */
+            if ((e->kind == EXPR_DIV || e->kind == EXPR_REM) && has_integer_zero_component(e->rhs)) {
+                foldable = false;
+            }
+        } break;
+
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE: {
+            b8 lhs = optimize(e->lhs);
+            b8 rhs = optimize(e->rhs);
+            foldable = lhs && rhs;
+        } break;
+
+        case EXPR_NEG: {
+            foldable = optimize(e->child);
+        } break;
+
+        case EXPR_SWIZZLE: {
+            foldable = optimize(e->lhs);
+        } break;
+
+        case EXPR_COND: {
+            /* a constant condition leaves only the taken branch, which is never generated otherwise */
+            if (optimize(e->lhs)) {
+                ExprTree *taken = e->lhs->value.val_bool ? e->rhs->lhs : e->rhs->rhs;
+                foldable = optimize(taken);
+                *e = *taken;
+                return foldable;
+            }
+            optimize(e->rhs->lhs);
+            optimize(e->rhs->rhs);
+        } break;
+
+        case EXPR_PAREN: {
+            /* parentheses only matter to the parser */
+            foldable = optimize(e->child);
+            *e = *e->child;
+            return foldable;
+        } break;
+
+        case EXPR_FUNC: {
+            const Func *f = &BUILTIN_FUNCTIONS[e->func_id];
+            foldable = (f->qualifier == QUALIFIER_PURE) && !(f->flags & FUNC_FLAG_SESSION);
+            for (ExprTree *arg = e->child; arg != NULL; arg = arg->rhs) {
+                foldable = optimize(arg->lhs) && foldable;
+            }
+        } break;
+
+        case EXPR_LIT: {
+            return true;
+        } break;
+
+        case EXPR_ID: {
+            e->kind = EXPR_LIT;
+            return true;
+        } break;
+
+        case EXPR_GLOBAL: {
+            return false;
+        } break;
+
+        case EXPR_ARGLIST:
+        case EXPR_BRANCHES:
+        case N_EXPR_KINDS: {
+            assert(false && "Logic error in previous compiler steps... #3");
+        } break;
+    }
+
+    if (foldable) {
+        fold(e);
+    } else {
+        simplify(e);
+    }
+    return foldable;
+}
+
+static void fold(ExprTree *e)
+{
+    ExeExpr *exe = codegen(e);
+    e->value = sel_eval_stack(exe, SEL_EMPTY_SVM_CONTEXT);
+    e->kind = EXPR_LIT;
+    e->child = NULL;
+    e->rhs = NULL;
+    hgl_free(g_r2r_arena, exe->code);
+    hgl_free(g_r2r_arena, exe);
+}
+
+static void simplify(ExprTree *e)
+{
+    switch (e->kind) {
+        case EXPR_ADD: {
+            if (is_integer_literal_zero(e->lhs)) {
+                *e = *e->rhs;
+            } else if (is_integer_literal_zero(e->rhs)) {
+                *e = *e->lhs;
+            }
+        } break;
+
+        case EXPR_SUB: {
+            if (is_integer_literal_zero(e->rhs)) {
+                *e = *e->lhs;
+            }
+        } break;
+
+        case EXPR_MUL: {
+            if (is_literal_one(e->lhs)) {
+                *e = *e->rhs;
+            } else if (is_literal_one(e->rhs)) {
+                *e = *e->lhs;
+            }
+        } break;
+
+        case EXPR_DIV: {
+            if (is_literal_one(e->rhs)) {
+                *e = *e->lhs;
+            }
+        } break;
+
+        case EXPR_NEG: {
+            if (e->child->kind == EXPR_NEG) {
+                *e = *e->child->child;
+            }
+        } break;
+
+        case EXPR_REM:
+        case EXPR_SWIZZLE:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE:
+        case EXPR_COND:
+        case EXPR_BRANCHES:
+        case EXPR_PAREN:
+        case EXPR_FUNC:
+        case EXPR_ARGLIST:
+        case EXPR_LIT:
+        case EXPR_ID:
+        case EXPR_GLOBAL:
+        case N_EXPR_KINDS:
+            break;
+    }
+}
+
+static b8 is_integer_literal_zero(const ExprTree *e)
+{
+    if (e->kind != EXPR_LIT) {
+        return false;
+    }
+
+    switch ((i32)e->type) {
+        case TYPE_INT:   return e->value.val_i32 == 0;
+        case TYPE_UINT:  return e->value.val_u32 == 0;
+        case TYPE_IVEC2: return e->value.val_ivec2.x == 0 && e->value.val_ivec2.y == 0;
+        case TYPE_IVEC3: return e->value.val_ivec3.x == 0 && e->value.val_ivec3.y == 0 && 
+                                e->value.val_ivec3.z == 0;
+        case TYPE_IVEC4: return e->value.val_ivec4.x == 0 && e->value.val_ivec4.y == 0 && 
+                                e->value.val_ivec4.z == 0 && e->value.val_ivec4.w == 0;
+        default: return false;
+    }
+}
+
+static b8 is_literal_one(const ExprTree *e)
+{
+    if (e->kind != EXPR_LIT) {
+        return false;
+    }
+
+    /* 
+     * the multiplicative identity of each type. Vectors multiply element-wise. A matrix 
+     * product sums `0*x` terms, which are not zero for infinite `x`, so identity 
+     * matrices are left alone 
+     */
+    SelValue one = {0};
+    switch ((i32)e->type) {
+        case TYPE_INT:   one.val_i32   = 1; break;
+        case TYPE_UINT:  one.val_u32   = 1; break;
+        case TYPE_FLOAT: one.val_f32   = 1.0f; break;
+        case TYPE_VEC2:  one.val_vec2  = vec2_make(1.0f, 1.0f); break;
+        case TYPE_VEC3:  one.val_vec3  = vec3_make(1.0f, 1.0f, 1.0f); break;
+        case TYPE_VEC4:  one.val_vec4  = vec4_make(1.0f, 1.0f, 1.0f, 1.0f); break;
+        case TYPE_IVEC2: one.val_ivec2 = ivec2_make(1, 1); break;
+        case TYPE_IVEC3: one.val_ivec3 = ivec3_make(1, 1, 1); break;
+        case TYPE_IVEC4: one.val_ivec4 = ivec4_make(1, 1, 1, 1); break;
+        default: return false;
+    }
+    return memcmp(&e->value, &one, TYPE_TO_SIZE[e->type]) == 0;
+}
+
+static b8 has_integer_zero_component(const ExprTree *e)
+{
+    if (e->kind != EXPR_LIT) {
+        return false;
+    }
+
+    switch ((i32)e->type) {
+        case TYPE_INT:   return e->value.val_i32 == 0;
+        case TYPE_UINT:  return e->value.val_u32 == 0;
+        case TYPE_IVEC2: return e->value.val_ivec2.x == 0 || e->value.val_ivec2.y == 0;
+        case TYPE_IVEC3: return e->value.val_ivec3.x == 0 || e->value.val_ivec3.y == 0 || 
+                                e->value.val_ivec3.z == 0;
+        case TYPE_IVEC4: return e->value.val_ivec4.x == 0 || e->value.val_ivec4.y == 0 || 
+                                e->value.val_ivec4.z == 0 || e->value.val_ivec4.w == 0;
+        default: return false;
+    }
+}
+
+/*--- LINKER ----------------------------------------------------------------------------*/
+
+/* 
+ * Rewrites calls to builtins with a `link` function into calls to their 
+ * `FUNC_FLAG_LINKED` overload, if the function can resolve the arguments passed as 
+ * literals. The names are resolved once, here, and replaced by the handles. Returns 
+ * true if `e` was rewritten.
+ */
+static b8 link_names(ExprTree *e)
+{
+    if (e == NULL) {
+        return false;
+    }
+
+    switch (e->kind) {
+        case EXPR_ADD:
+        case EXPR_SUB:
+        case EXPR_MUL:
+        case EXPR_DIV:
+        case EXPR_REM:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE:
+        case EXPR_COND:
+        case EXPR_BRANCHES:
+        case EXPR_ARGLIST: {
+            b8 lhs = link_names(e->lhs);
+            b8 rhs = link_names(e->rhs);
+            return lhs || rhs;
+        } break;
+
+        case EXPR_NEG:
+        case EXPR_SWIZZLE:
+        case EXPR_PAREN: {
+            return link_names(e->child);
+        } break;
+
+        case EXPR_FUNC: break;
+
+        case EXPR_LIT:
+        case EXPR_ID:
+        case EXPR_GLOBAL:
+        case N_EXPR_KINDS: {
+            return false;
+        } break;
+    }
+
+    b8 linked = link_names(e->child);
+    const Func *f = &BUILTIN_FUNCTIONS[e->func_id];
+    if (f->link == NULL) {
+        return linked;
+    }
+
+    const SelValue *args[SEL_FUNC_MAX_N_ARGS];
+    ExprTree *names[SEL_FUNC_MAX_N_ARGS];
+    u32 n_args = 0;
+    u32 n_names = 0;
+    for (ExprTree *arg = e->child; arg != NULL; arg = arg->rhs) {
+        args[n_args++] = (arg->lhs->kind == EXPR_LIT) ? &arg->lhs->value : NULL;
+        if (arg->lhs->type == TYPE_STR) {
+            names[n_names++] = arg->lhs;
+        }
+    }
+
+    i32 handles[SEL_FUNC_MAX_N_ARGS];
+    if (!f->link(f, args, handles)) {
+        return linked; /* not known until evaluated */
+    }
+    i32 id = find_linked_function(f);
+    assert(id != -1 && "builtins with a link function have a linked overload");
+    for (u32 i = 0; i < n_names; i++) {
+        assert(names[i]->kind == EXPR_LIT && "only literal names are linked");
+        names[i]->type = TYPE_INT;
+        names[i]->value = (SelValue) {.val_i32 = handles[i]};
+    }
+    e->func_id = (u32) id;
+    return true;
+}
 
+/* The `FUNC_FLAG_LINKED` overload of `f`: the same, but taking an int for every str */
+static i32 find_linked_function(const Func *f)
+{
+    for (i32 i = find_function(f->id); i != -1; i = next_overload(i)) {
+        const Func *g = &BUILTIN_FUNCTIONS[i];
+        if (!(g->flags & FUNC_FLAG_LINKED) || g->type != f->type) {
+            continue;
+        }
+        b8 match = true;
+        for (u32 j = 0; j < SEL_FUNC_MAX_N_ARGS && match; j++) {
+            Type t = (f->argtypes[j] == TYPE_STR) ? TYPE_INT : f->argtypes[j];
+            match = (g->argtypes[j] == t);
+            if (f->argtypes[j] == TYPE_NIL) {
+                break;
+            }
+        }
+        if (match) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*--- SUBEXPRESSION SHARING -------------------------------------------------------------*/
+
+/*
+ * Interns every shareable subexpression of `e` in the session subexpression table,
+ * and records its index in `shared`. Returns true if `e` itself may be shared, i.e.
+ * if it calls no volatile or context dependent functions.
+ */
+static b8 intern_subexprs(ExprTree *e)
+{
+    b8 shareable = true;
+    e->shared = -1;
+
+    switch (e->kind) {
+        case EXPR_ADD:
+        case EXPR_SUB:
+        case EXPR_MUL:
+        case EXPR_DIV:
+        case EXPR_REM:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE: {
+            b8 lhs = intern_subexprs(e->lhs);
+            b8 rhs = intern_subexprs(e->rhs);
+            shareable = lhs && rhs;
+        } break;
+
+        case EXPR_COND: {
+            b8 cond = intern_subexprs(e->lhs);
+            b8 then = intern_subexprs(e->rhs->lhs);
+            b8 otherwise = intern_subexprs(e->rhs->rhs);
+            e->rhs->shared = -1;
+            shareable = cond && then && otherwise;
+        } break;
+
+        case EXPR_NEG: {
+            shareable = intern_subexprs(e->child);
+        } break;
+
+        case EXPR_SWIZZLE: {
+            shareable = intern_subexprs(e->lhs);
+            e->rhs->shared = -1;
+        } break;
+
+        case EXPR_FUNC: {
+            const Func *f = &BUILTIN_FUNCTIONS[e->func_id];
+            shareable = !(f->flags & (FUNC_FLAG_VOLATILE | FUNC_FLAG_CONTEXT | FUNC_FLAG_STATE));
+            for (ExprTree *arg = e->child; arg != NULL; arg = arg->rhs) {
+                arg->shared = -1;
+                shareable = intern_subexprs(arg->lhs) && shareable;
+            }
+        } break;
+
+        case EXPR_LIT:
+        case EXPR_ID:
+        case EXPR_GLOBAL: {
+            /* nothing to gain from sharing a literal, or a global */
+            return true;
+        } break;
+
+        case EXPR_PAREN:
+        case EXPR_ARGLIST:
+        case EXPR_BRANCHES:
+        case N_EXPR_KINDS: {
+            assert(false && "Logic error in previous compiler steps... #4");
+        } break;
+    }
+
+    /* a call without arguments is no more expensive than reading its shared value */
+    b8 is_leaf_call = (e->kind == EXPR_FUNC) && (e->child == NULL);
+    if (shareable && !is_leaf_call) {
+        e->shared = subexpr_intern(e);
+    }
+    return shareable;
+}
+
+static i32 subexpr_intern(const ExprTree *e)
+{
+    u64 hash = subexpr_hash(e);
+    for (u32 i = 0; i < SESSION_MAX_N_SUBEXPRS; i++) {
+        u32 idx = (u32)(hash + i) & (SESSION_MAX_N_SUBEXPRS - 1);
+        SubExpr *sub = &session.subexprs[idx];
+        if (sub->e == NULL) {
+            *sub = (SubExpr) {.hash = hash, .e = e, .n_refs = 1, .slot = -1};
+            return (i32) idx;
+        }
+        if (sub->hash == hash && subexpr_equals(sub->e, e)) {
+            sub->n_refs++;
+            return (i32) idx;
+        }
+    }
+    return -1; /* table is full. Simply don't share */
+}
+
+/* FNV-1a over the structure of the expression */
+static u64 subexpr_hash(const ExprTree *e)
+{
+    u64 h = 14695981039346656037ull;
+    #define HASH_BYTES(ptr_, size_)                         \
+        for (u32 i_ = 0; i_ < (size_); i_++) {              \
+            h = (h ^ ((const u8 *)(ptr_))[i_]) * 1099511628211ull; \
+        }
+
+    HASH_BYTES(&e->kind, sizeof(e->kind));
+    HASH_BYTES(&e->type, sizeof(e->type));
+    switch (e->kind) {
+        case EXPR_FUNC: {
+            HASH_BYTES(&e->func_id, sizeof(e->func_id));
+            for (const ExprTree *arg = e->child; arg != NULL; arg = arg->rhs) {
+                u64 arg_hash = subexpr_hash(arg->lhs);
+                HASH_BYTES(&arg_hash, sizeof(arg_hash));
+            }
+        } break;
+
+        case EXPR_SWIZZLE: {
+            u64 lhs_hash = subexpr_hash(e->lhs);
+            HASH_BYTES(&lhs_hash, sizeof(lhs_hash));
+            HASH_BYTES(&e->rhs->value.val_u32, sizeof(u32));
+        } break;
+
+        case EXPR_LIT:
+        case EXPR_ID: {
+            if (e->type == TYPE_STR) {
+                HASH_BYTES(e->value.val_str.start, e->value.val_str.length);
+            } else {
+                HASH_BYTES(&e->value, TYPE_TO_SIZE[e->type]);
+            }
+        } break;
+
+        case EXPR_GLOBAL: {
+            HASH_BYTES(&e->global_id, sizeof(e->global_id));
+        } break;
+
+        case EXPR_NEG:
+        case EXPR_PAREN: {
+            u64 child_hash = subexpr_hash(e->child);
+            HASH_BYTES(&child_hash, sizeof(child_hash));
+        } break;
+
+        case EXPR_ADD:
+        case EXPR_SUB:
+        case EXPR_MUL:
+        case EXPR_DIV:
+        case EXPR_REM:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE:
+        case EXPR_COND:
+        case EXPR_BRANCHES:
+        case EXPR_ARGLIST: {
+            u64 lhs_hash = subexpr_hash(e->lhs);
+            u64 rhs_hash = subexpr_hash(e->rhs);
+            HASH_BYTES(&lhs_hash, sizeof(lhs_hash));
+            HASH_BYTES(&rhs_hash, sizeof(rhs_hash));
+        } break;
+
+        case N_EXPR_KINDS: break;
+    }
+
+    #undef HASH_BYTES
+    return h;
+}
+
+static b8 subexpr_equals(const ExprTree *a, const ExprTree *b)
+{
+    if (a->kind != b->kind || a->type != b->type) {
+        return false;
+    }
+
+    switch (a->kind) {
+        case EXPR_FUNC: {
+            if (a->func_id != b->func_id) {
+                return false;
+            }
+            const ExprTree *arg_a = a->child;
+            const ExprTree *arg_b = b->child;
+            for (; arg_a != NULL && arg_b != NULL; arg_a = arg_a->rhs, arg_b = arg_b->rhs) {
+                if (!subexpr_equals(arg_a->lhs, arg_b->lhs)) {
+                    return false;
+                }
+            }
+            return arg_a == NULL && arg_b == NULL;
+        } break;
+
+        case EXPR_SWIZZLE: {
+            return a->rhs->value.val_u32 == b->rhs->value.val_u32 && 
+                   subexpr_equals(a->lhs, b->lhs);
+        } break;
+
+        case EXPR_LIT:
+        case EXPR_ID: {
+            if (a->type == TYPE_STR) {
+                return sv_equals(a->value.val_str, b->value.val_str);
+            }
+            return memcmp(&a->value, &b->value, TYPE_TO_SIZE[a->type]) == 0;
+        } break;
+
+        case EXPR_GLOBAL: {
+            return a->global_id == b->global_id;
+        } break;
+
+        case EXPR_NEG:
+        case EXPR_PAREN: {
+            return subexpr_equals(a->child, b->child);
+        } break;
+
+        case EXPR_ADD:
+        case EXPR_SUB:
+        case EXPR_MUL:
+        case EXPR_DIV:
+        case EXPR_REM:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE:
+        case EXPR_COND:
+        case EXPR_BRANCHES:
+        case EXPR_ARGLIST: {
+            return subexpr_equals(a->lhs, b->lhs) && subexpr_equals(a->rhs, b->rhs);
+        } break;
+
+        case N_EXPR_KINDS: break;
+    }
+    return false;
+}
+
+static b8 has_shared_subexpr(const ExprTree *e)
+{
+    if (e == NULL) {
+        return false;
+    }
+    if (is_shared(e)) {
+        return true;
+    }
+
+    switch (e->kind) {
+        case EXPR_ADD:
+        case EXPR_SUB:
+        case EXPR_MUL:
+        case EXPR_DIV:
+        case EXPR_REM:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE:
+        case EXPR_COND:
+        case EXPR_BRANCHES:
+        case EXPR_ARGLIST: return has_shared_subexpr(e->lhs) || has_shared_subexpr(e->rhs);
+        case EXPR_NEG:
+        case EXPR_SWIZZLE:
+        case EXPR_PAREN:
+        case EXPR_FUNC:    return has_shared_subexpr(e->child);
+        case EXPR_LIT:
+        case EXPR_ID:
+        case EXPR_GLOBAL:
+        case N_EXPR_KINDS: return false;
+    }
+    return false;
 }
 
+static b8 is_shared(const ExprTree *e)
+{
+    return session.is_linking && 
+           e->shared != -1 && 
+           session.subexprs[e->shared].slot != -1;
+}
 
 /*--- CODEGEN ---------------------------------------------------------------------------*/
 
@@ -951,11 +2492,64 @@ static ExeExpr *codegen(const ExprTree *e)
     exe->type = e->type;
     exe->qualifier = e->qualifier;
     exe->has_been_computed_once = false;
-    codegen_expr(exe, e);
+    codegen_code(exe, e);
     return exe;
 }
 
-static void codegen_expr(ExeExpr *exe, const ExprTree *e)
+/* 
+ * Generates the code of `e` into `codegen_buffer`, and moves it to the r2r arena in 
+ * one allocation, now that its size is known.
+ */
+static void codegen_code(ExeExpr *exe, const ExprTree *e)
+{
+    exe->code = codegen_buffer.arr;
+    exe->size = 0;
+    exe->capacity = codegen_buffer.capacity;
+    codegen_expr(exe, e);
+
+    exe->code = hgl_alloc(g_r2r_arena, exe->size);
+    assert(exe->code != NULL && "r2r arena alloc failed");
+    memcpy(exe->code, codegen_buffer.arr, exe->size);
+    exe->capacity = exe->size;
+    codegen_measure(exe);
+}
+
+static void codegen_expr(ExeExpr *exe, const ExprTree *e)
+{
+    if (e == NULL) {
+        return;
+    }
+
+    if (!is_shared(e)) {
+        codegen_node(exe, e);
+        return;
+    }
+
+    /* 
+     * Skip over the subexpression if its value was already computed this frame,
+     * otherwise compute it and store it for the other occurrences.
+     */
+    u32 slot = (u32) session.subexprs[e->shared].slot;
+    exe_append_op(exe, (Op){
+        .kind    = OP_SHARED,
+        .type    = e->type,
+        .argsize = 2*sizeof(u32),
+    });
+    exe_append_u32(exe, slot);
+    u32 skip_offset = exe->size;
+    exe_append_u32(exe, 0);
+    codegen_node(exe, e);
+    exe_append_op(exe, (Op){
+        .kind    = OP_PUBLISH,
+        .type    = e->type,
+        .argsize = sizeof(u32),
+    });
+    exe_append_u32(exe, slot);
+    u32 skip = exe->size - (skip_offset + sizeof(u32));
+    memcpy(&exe->code[skip_offset], &skip, sizeof(skip));
+}
+
+static void codegen_node(ExeExpr *exe, const ExprTree *e)
 {
     static OpKind expr_to_op[] = {
         [EXPR_ADD]  = OP_ADD,
@@ -964,6 +2558,12 @@ static void codegen_expr(ExeExpr *exe, const ExprTree *e)
         [EXPR_DIV]  = OP_DIV,
         [EXPR_REM]  = OP_REM,
         [EXPR_NEG]  = OP_NEG,
+        [EXPR_EQ]   = OP_EQ,
+        [EXPR_NE]   = OP_NE,
+        [EXPR_LT]   = OP_LT,
+        [EXPR_LE]   = OP_LE,
+        [EXPR_GT]   = OP_GT,
+        [EXPR_GE]   = OP_GE,
         [EXPR_FUNC] = OP_FUNC,
     };
 
@@ -1004,7 +2604,7 @@ static void codegen_expr(ExeExpr *exe, const ExprTree *e)
                 .type    = e->type,
                 .argsize = TYPE_TO_SIZE[TYPE_UINT],
             });
-            exe_append_u32(exe, construct_swizzle_descriptor(e->rhs->token.text));
+            exe_append_u32(exe, e->rhs->value.val_u32); /* the descriptor */
             exe_append_op(exe, (Op){
                 .kind     = OP_SWIZZLE, 
                 .type     = e->type,
@@ -1013,24 +2613,63 @@ static void codegen_expr(ExeExpr *exe, const ExprTree *e)
             });
         } break;
 
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE: {
+            codegen_expr(exe, e->lhs);
+            codegen_expr(exe, e->rhs);
+            exe_append_op(exe, (Op){
+                .kind = expr_to_op[e->kind], 
+                .type = TYPE_BOOL,
+                .lhs_type = e->lhs->type,
+                .rhs_type = e->lhs->type,
+            });
+        } break;
+
+        case EXPR_COND: {
+            /* only the taken branch is evaluated. The skips are patched once the branches are generated */
+            codegen_expr(exe, e->lhs);
+            exe_append_op(exe, (Op){
+                .kind    = OP_JUMP_IF_FALSE,
+                .type    = TYPE_BOOL,
+                .argsize = sizeof(u32),
+            });
+            u32 else_offset = exe->size;
+            exe_append_u32(exe, 0);
+            codegen_expr(exe, e->rhs->lhs);
+            exe_append_op(exe, (Op){
+                .kind    = OP_JUMP,
+                .type    = e->type,
+                .argsize = sizeof(u32),
+            });
+            u32 join_offset = exe->size;
+            exe_append_u32(exe, 0);
+            u32 skip = exe->size - (else_offset + sizeof(u32));
+            memcpy(&exe->code[else_offset], &skip, sizeof(skip));
+            codegen_expr(exe, e->rhs->rhs);
+            skip = exe->size - (join_offset + sizeof(u32));
+            memcpy(&exe->code[join_offset], &skip, sizeof(skip));
+        } break;
+
+        case EXPR_BRANCHES: {
+            assert(false && "Logic error in previous compiler steps... #5");
+        } break;
+
         case EXPR_PAREN: {
             codegen_expr(exe, e->child);
         } break;
 
         case EXPR_FUNC: {
             codegen_expr(exe, e->child);
-            u32 i = 0;
-            for (i = 0; i < (u32)N_BUILTIN_FUNCTIONS; i++) {
-                if (sv_equals(e->token.text, BUILTIN_FUNCTIONS[i].id)) {
-                    break;
-                }
-            }
             exe_append_op(exe, (Op){
                 .kind = expr_to_op[e->kind], 
                 .type = e->type,
                 .argsize = sizeof(u32),
             });
-            exe_append_u32(exe, i);
+            exe_append_u32(exe, e->func_id);
             //printf("FUNC: " SV_FMT "\n", SV_ARG(e->token.text));
         } break;
 
@@ -1039,45 +2678,25 @@ static void codegen_expr(ExeExpr *exe, const ExprTree *e)
             codegen_expr(exe, e->rhs);
         } break;
 
-        case EXPR_LIT: {
+        case EXPR_LIT:
+        case EXPR_ID: {
+            /* Literals and freestanding identifiers (constants) - may be of any type after folding */
+            assert(e->type != TYPE_TEXTURE && "Logic error in previous compiler steps... #1");
             exe_append_op(exe, (Op){
                 .kind    = OP_PUSH,
                 .type    = e->type,
                 .argsize = TYPE_TO_SIZE[e->type],
             });
-            if (e->type == TYPE_BOOL) {
-                i32 val = sv_equals(e->token.text, SV_LIT("true")) ? 1 : 0;
-                exe_append_i32(exe, val);
-            } else if (e->type == TYPE_INT) {
-                i32 val = (i32) sv_to_i64(e->token.text);
-                exe_append_i32(exe, val);
-            } else if (e->type == TYPE_UINT) {
-                u32 val = (u32) sv_to_u64(e->token.text);
-                exe_append_u32(exe, val);
-            } else if (e->type == TYPE_FLOAT) {
-                f32 val = (f32) sv_to_f64(e->token.text);
-                exe_append_f32(exe, val);
-            } else if (e->type == TYPE_STR) {
-                exe_append(exe, &e->token.text, TYPE_TO_SIZE[e->type]);
-            } else {
-                assert(false && "Logic error in previous compiler steps... #1");
-            }
+            exe_append(exe, &e->value, TYPE_TO_SIZE[e->type]);
         } break;
 
-        case EXPR_ID: {
-            /* Freestanding identifier - must be a constant */
-            for (size_t i = 0; i < N_BUILTIN_CONSTANTS; i++) {
-                if (sv_equals(e->token.text, BUILTIN_CONSTANTS[i].id)) {
-                    exe_append_op(exe, (Op){
-                        .kind    = OP_PUSH,
-                        .type    = e->type,
-                        .argsize = TYPE_TO_SIZE[BUILTIN_CONSTANTS[i].type],
-                    });
-                    exe_append(exe, &BUILTIN_CONSTANTS[i].value, 
-                               TYPE_TO_SIZE[BUILTIN_CONSTANTS[i].type]);
-                    break; 
-                } 
-            }
+        case EXPR_GLOBAL: {
+            exe_append_op(exe, (Op){
+                .kind    = OP_GLOBAL,
+                .type    = e->type,
+                .argsize = sizeof(u32),
+            });
+            exe_append_u32(exe, e->global_id);
         } break;
 
         case N_EXPR_KINDS: {
@@ -1089,14 +2708,100 @@ static void codegen_expr(ExeExpr *exe, const ExprTree *e)
     return; 
 }
 
-static void exe_append_op(ExeExpr *exe, Op op)
+/*
+ * Measures the code of `exe`: the most stack the stack VM needs to run it, and the 
+ * estimated cost of an evaluation, in float additions. Arithmetic costs one per 
+ * component, and a matrix product one per multiply-add. A call costs CODEGEN_COST_CALL 
+ * plus the `cost` of the builtin. Shared subexpressions are counted as if they were 
+ * computed every time, and both branches of a conditional as if they were both taken.
+ */
+static void codegen_measure(ExeExpr *exe)
 {
-    exe_append(exe, &op, sizeof(op));
+    u32 sp = 0;
+    exe->stack_size = 0;
+    exe->cost = 0;
+    for (u32 pc = 0; pc < exe->size;) {
+        const Op *op = (const Op *)&exe->code[pc];
+        const u8 *operands = &exe->code[pc + sizeof(Op)];
+        pc += sizeof(Op) + op_operand_size(op);
+        u32 tsize = TYPE_TO_SIZE[op->type];
+        u32 n_components = tsize / sizeof(u32);
+
+        switch ((OpKind)op->kind) {
+            case OP_PUSH: {
+                sp += op->argsize;
+            } break;
+
+            case OP_ADD:
+            case OP_SUB:
+            case OP_MUL:
+            case OP_DIV:
+            case OP_REM:
+            case OP_SWIZZLE:
+            case OP_EQ:
+            case OP_NE:
+            case OP_LT:
+            case OP_LE:
+            case OP_GT:
+            case OP_GE: {
+                sp = sp - TYPE_TO_SIZE[op->lhs_type] - TYPE_TO_SIZE[op->rhs_type] + tsize;
+                b8 is_matrix_product = (op->kind == OP_MUL) && (op->type >= TYPE_MAT2) && (op->type <= TYPE_MAT4);
+                u32 n = (op->type == TYPE_MAT2) ? 2 : (op->type == TYPE_MAT3) ? 3 : 4;
+                exe->cost += is_matrix_product ? n*n*n : n_components;
+            } break;
+
+            case OP_NEG: {
+                exe->cost += n_components;
+            } break;
+
+            case OP_FUNC: {
+                u32 func_id;
+                memcpy(&func_id, operands, sizeof(func_id));
+                const Func *f = &BUILTIN_FUNCTIONS[func_id];
+                for (u32 i = 0; i < SEL_FUNC_MAX_N_ARGS && f->argtypes[i] != TYPE_NIL; i++) {
+                    sp -= TYPE_TO_SIZE[f->argtypes[i]];
+                }
+                sp += tsize;
+                exe->cost += CODEGEN_COST_CALL + f->cost;
+            } break;
+
+            case OP_JUMP_IF_FALSE: {
+                sp -= tsize;
+                exe->cost += 1;
+            } break;
+
+            case OP_JUMP: {
+                sp -= tsize; /* the else branch starts from where the then branch did */
+                exe->cost += 1;
+            } break;
+
+            case OP_SHARED: {
+                exe->cost += 1; /* if computed this frame, pushes the value the subexpression would have left */
+            } break;
+
+            case OP_PUBLISH: {
+                exe->cost += n_components;
+            } break;
+
+            case OP_GLOBAL: {
+                sp += tsize;
+                exe->cost += n_components;
+            } break;
+
+            case OP_MOVE:
+            case OP_CONTEXT:
+            case OP_GUARD:
+            case OP_STAGE: {
+                assert(false && "not a stack op");
+            } break;
+        }
+        exe->stack_size = (sp > exe->stack_size) ? sp : exe->stack_size;
+    }
 }
 
-static void exe_append_i32(ExeExpr *exe, i32 v)
+static void exe_append_op(ExeExpr *exe, Op op)
 {
-    exe_append(exe, &v, sizeof(v));
+    exe_append(exe, &op, sizeof(op));
 }
 
 static void exe_append_u32(ExeExpr *exe, u32 v)
@@ -1104,29 +2809,944 @@ static void exe_append_u32(ExeExpr *exe, u32 v)
     exe_append(exe, &v, sizeof(v));
 }
 
-static void exe_append_f32(ExeExpr *exe, f32 v)
-{
-    exe_append(exe, &v, sizeof(v));
-}
-
 static void exe_append(ExeExpr *exe, const void *val, u32 size)
 {
-    if (exe->code == NULL) {
-        exe->size = 0;
-        exe->capacity = 64;
-        exe->code = hgl_alloc(g_r2r_arena, exe->capacity * sizeof(*exe->code));
-    } 
     if (exe->capacity < exe->size + size) {
-        while (exe->capacity < exe->size + size) {
-            exe->capacity *= 2;
+        u32 capacity = (exe->capacity == 0) ? 1024 : exe->capacity;
+        while (capacity < exe->size + size) {
+            capacity *= 2;
         }
-        exe->code = hgl_realloc(g_r2r_arena, exe->code, exe->capacity * sizeof(*exe->code));
+        codegen_buffer.arr = realloc(codegen_buffer.arr, capacity * sizeof(*exe->code));
+        codegen_buffer.capacity = capacity;
+        exe->code = codegen_buffer.arr;
+        exe->capacity = capacity;
     }
-    assert(exe->code != NULL && "eexe_allocator alloc failed");
+    assert(exe->code != NULL && "codegen buffer alloc failed");
     memcpy(&exe->code[exe->size], val, size);
     exe->size += size;
 }
 
+/*
+ * Translates the stack bytecode of `exe` into a program for the register VM. The 
+ * stack pointer before every stack op is known at compile time, so every stack 
+ * position simply becomes a register, and operands are read where the stack VM 
+ * would have popped them. Constants get registers of their own, loaded once, and 
+ * are only copied to their stack position when passed to a function, or when they 
+ * are the value of a branch of a conditional. Both branches leave their value in the 
+ * same register.
+ */
+static void assemble_registers(ExeExpr *exe)
+{
+    typedef struct {
+        u32 reg;  /* where the value is */
+        u32 home; /* where the stack VM would have put it */
+    } Entry;
+
+    typedef struct {
+        u32 jump_if_false; /* index of the op ending the condition */
+        u32 jump;          /* index of the op ending the first branch */
+        u32 join;          /* pc after the second branch, once known */
+        u32 home;          /* where both branches leave their value */
+    } Branch;
+
+    /* count ops and constant bytes */
+    u32 n_stack_ops = 0;
+    u32 const_size = 0;
+    for (u32 pc = 0; pc < exe->size;) {
+        const Op *op = (const Op *)&exe->code[pc];
+        if (op->kind == OP_PUSH) {
+            const_size += op->argsize;
+        }
+        pc += sizeof(Op) + op_operand_size(op);
+        n_stack_ops++;
+    }
+
+    /* any native code, and any computed value, is for the previous program */
+    exe->jit = NULL;
+    exe->n_evals = 0;
+    exe->computed_at = 0;
+    exe->deps = SEL_DEP_NONE;
+    exe->main_thread = false;
+    exe->calls_index = false;
+
+    /* each stack op becomes at most one op, plus one move per constant, plus a halt */
+    exe->ops = hgl_alloc(g_r2r_arena, (2 * n_stack_ops + 1) * sizeof(RegOp));
+    exe->n_ops = 0;
+    Entry *stack = hgl_alloc(g_sel_arena, n_stack_ops * sizeof(Entry) + 1);
+    u32 *open_shared = hgl_alloc(g_sel_arena, n_stack_ops * sizeof(u32) + 1);
+    Branch *branches = hgl_alloc(g_sel_arena, n_stack_ops * sizeof(Branch) + 1);
+    u32 n_entries = 0;
+    u32 n_open_shared = 0;
+    u32 n_branches = 0;
+    u32 const_top = 0;
+    u32 sp = (const_size + 15) & ~15u; /* temporaries are aligned like on the SVM stack */
+    u32 max_sp = sp;
+
+    for (u32 pc = 0;;) {
+        /* the second branch of a conditional ends here. Innermost conditionals first */
+        while ((n_branches > 0) && (branches[n_branches - 1].join == pc)) {
+            Branch *b = &branches[--n_branches];
+            Entry val = stack[n_entries - 1];
+            if (val.reg != val.home) {
+                exe->ops[exe->n_ops++] = (RegOp) {
+                    .kind = OP_MOVE,
+                    .type = exe->ops[b->jump].type,
+                    .dst  = (u16) val.home,
+                    .lhs  = (u16) val.reg,
+                };
+            }
+            assert(val.home == b->home);
+            exe->ops[b->jump].rhs = (u16) (exe->n_ops - b->jump - 1);
+            stack[n_entries - 1] = (Entry) {.reg = b->home, .home = b->home};
+            sp = b->home + TYPE_TO_SIZE[exe->ops[b->jump].type];
+        }
+        if (pc >= exe->size) {
+            break;
+        }
+
+        const Op *op = (const Op *)&exe->code[pc];
+        const u8 *operands = &exe->code[pc + sizeof(Op)];
+        pc += sizeof(Op) + op_operand_size(op);
+        u32 tsize = TYPE_TO_SIZE[op->type];
+        RegOp *rop = &exe->ops[exe->n_ops];
+        *rop = (RegOp) {.kind = op->kind, .type = op->type};
+
+        switch ((OpKind)op->kind) {
+            case OP_PUSH: {
+                stack[n_entries++] = (Entry) {.reg = const_top, .home = sp};
+                const_top += op->argsize;
+                sp += op->argsize;
+                max_sp = (sp > max_sp) ? sp : max_sp;
+                continue; /* nothing to emit */
+            } break;
+
+            case OP_ADD:
+            case OP_SUB:
+            case OP_MUL:
+            case OP_DIV:
+            case OP_REM:
+            case OP_EQ:
+            case OP_NE:
+            case OP_LT:
+            case OP_LE:
+            case OP_GT:
+            case OP_GE: {
+                Entry rhs = stack[--n_entries];
+                Entry lhs = stack[--n_entries];
+                rop->lhs_type = op->lhs_type;
+                rop->rhs_type = op->rhs_type;
+                rop->dst = (u16) lhs.home;
+                rop->lhs = (u16) lhs.reg;
+                rop->rhs = (u16) rhs.reg;
+            } break;
+
+            case OP_JUMP_IF_FALSE: {
+                Entry cond = stack[--n_entries];
+                rop->lhs = (u16) cond.reg;
+                branches[n_branches++] = (Branch) {
+                    .jump_if_false = exe->n_ops, 
+                    .join = UINT32_MAX, 
+                    .home = cond.home,
+                };
+                sp = cond.home;
+                exe->n_ops++;
+                continue; /* the branches push the result */
+            } break;
+
+            case OP_JUMP: {
+                Branch *b = &branches[n_branches - 1];
+                Entry val = stack[--n_entries];
+                if (val.reg != val.home) {
+                    exe->ops[exe->n_ops++] = (RegOp) {
+                        .kind = OP_MOVE,
+                        .type = op->type,
+                        .dst  = (u16) val.home,
+                        .lhs  = (u16) val.reg,
+                    };
+                }
+                assert(val.home == b->home);
+                rop = &exe->ops[exe->n_ops];
+                *rop = (RegOp) {.kind = OP_JUMP, .type = op->type, .dst = (u16) b->home};
+                b->jump = exe->n_ops;
+                exe->ops[b->jump_if_false].rhs = (u16) (b->jump - b->jump_if_false);
+                u32 skip;
+                memcpy(&skip, operands, sizeof(skip));
+                b->join = pc + skip;
+                sp = b->home;
+                exe->n_ops++;
+                continue; /* the second branch pushes the result in its place */
+            } break;
+
+            case OP_NEG: {
+                Entry val = stack[--n_entries];
+                rop->dst = (u16) val.home;
+                rop->lhs = (u16) val.reg;
+            } break;
+
+            case OP_SWIZZLE: {
+                Entry desc = stack[--n_entries];
+                Entry lhs = stack[--n_entries];
+                assert(desc.reg < const_size && "swizzle descriptors are always constants");
+                rop->lhs_type = op->lhs_type;
+                rop->dst = (u16) lhs.home;
+                rop->lhs = (u16) lhs.reg;
+                rop->imm = (u32) -1; /* patched below, once the constants are loaded */
+                rop->rhs = (u16) desc.reg;
+            } break;
+
+            case OP_FUNC: {
+                u32 func_id;
+                memcpy(&func_id, operands, sizeof(func_id));
+                const Func *f = &BUILTIN_FUNCTIONS[func_id];
+                assert(((f->qualifier & QUALIFIER_PURE) || (f->deps != SEL_DEP_NONE)) && 
+                       "impure functions must name what they depend on");
+                exe->deps |= f->deps;
+                if (f->flags & FUNC_FLAG_SESSION) {
+                    exe->deps |= SEL_DEP_RELOAD;
+                }
+                if (f->flags & FUNC_FLAG_MAIN) {
+                    exe->main_thread = true;
+                }
+                if (sv_equals(f->id, SV_LIT("index"))) {
+                    exe->calls_index = true;
+                }
+                u32 n_args = 0;
+                while (n_args < SEL_FUNC_MAX_N_ARGS && f->argtypes[n_args] != TYPE_NIL) {
+                    n_args++;
+                }
+                n_entries -= n_args;
+                u32 base = (n_args > 0) ? stack[n_entries].home : sp;
+                for (u32 i = 0; i < n_args; i++) {
+                    Entry arg = stack[n_entries + i];
+                    if (arg.reg != arg.home) {
+                        exe->ops[exe->n_ops++] = (RegOp) {
+                            .kind = OP_MOVE,
+                            .type = f->argtypes[i],
+                            .dst  = (u16) arg.home,
+                            .lhs  = (u16) arg.reg,
+                        };
+                    }
+                }
+                rop = &exe->ops[exe->n_ops];
+                *rop = (RegOp) {.kind = OP_FUNC, .type = op->type, .dst = (u16) base, .lhs = (u16) base, .imm = func_id};
+            } break;
+
+            case OP_SHARED: {
+                memcpy(&rop->imm, operands, sizeof(u32));
+                rop->dst = (u16) sp;
+                open_shared[n_open_shared++] = exe->n_ops;
+                exe->n_ops++;
+                continue; /* the result is pushed by the matching OP_PUBLISH */
+            } break;
+
+            case OP_PUBLISH: {
+                Entry val = stack[n_entries - 1];
+                assert(val.reg == val.home && "shared subexpressions are never constants");
+                memcpy(&rop->imm, operands, sizeof(u32));
+                rop->lhs = (u16) val.reg;
+                exe->n_ops++;
+                RegOp *shared = &exe->ops[open_shared[--n_open_shared]];
+                shared->rhs = (u16) (exe->n_ops - (u32)(shared - exe->ops) - 1);
+                continue;
+            } break;
+
+            case OP_GLOBAL: {
+                memcpy(&rop->imm, operands, sizeof(u32));
+                rop->dst = (u16) sp;
+
+                /* recomputed whenever the global is. See `order_globals()` for globals referring to globals */
+                const ExeExpr *global = session.globals.arr[rop->imm].exe;
+                if (global != NULL) {
+                    exe->deps |= global->deps;
+                }
+            } break;
+
+            case OP_MOVE:
+            case OP_CONTEXT:
+            case OP_GUARD:
+            case OP_STAGE: {
+                assert(false && "not a stack op");
+            } break;
+        }
+
+        /* the result is left where the stack VM would have pushed it */
+        stack[n_entries++] = (Entry) {.reg = rop->dst, .home = rop->dst};
+        sp = rop->dst + tsize;
+        max_sp = (sp > max_sp) ? sp : max_sp;
+        exe->n_ops++;
+    }
+    assert(n_entries == 1);
+    exe->result = stack[0].reg;
+
+    /* copies of other uniforms must see them computed in the order of the passes */
+    if (exe->deps & SEL_DEP_UNIFORMS) {
+        exe->main_thread = true;
+    }
+
+    /* memoized calls get a slot each, after the temporaries */
+    u32 regs_size = max_sp;
+    for (u32 i = 0; i < exe->n_ops; i++) {
+        RegOp *rop = &exe->ops[i];
+        if (rop->kind == OP_FUNC && (BUILTIN_FUNCTIONS[rop->imm].flags & FUNC_FLAG_MEMO)) {
+            rop->rhs = (u16) regs_size;
+            regs_size += sizeof(SelMemoSlot) + memo_args_size(&BUILTIN_FUNCTIONS[rop->imm]) + 
+                         TYPE_TO_SIZE[rop->type];
+        }
+    }
+    assert(regs_size <= UINT16_MAX && "expression too large for the register VM");
+
+    /* load the constants */
+    exe->regs = hgl_alloc(g_r2r_arena, regs_size + 1);
+    exe->regs_size = regs_size;
+    const_top = 0;
+    for (u32 pc = 0; pc < exe->size;) {
+        const Op *op = (const Op *)&exe->code[pc];
+        if (op->kind == OP_PUSH) {
+            memcpy(&exe->regs[const_top], &exe->code[pc + sizeof(Op)], op->argsize);
+            const_top += op->argsize;
+        }
+        pc += sizeof(Op) + op_operand_size(op);
+    }
+    u32 n_states = 0;
+    for (u32 i = 0; i < exe->n_ops; i++) {
+        RegOp *rop = &exe->ops[i];
+        if (rop->kind == OP_SWIZZLE) {
+            memcpy(&rop->imm, &exe->regs[rop->rhs], sizeof(u32));
+            rop->rhs = 0;
+        }
+        b8 is_comparison = (rop->kind >= OP_EQ) && (rop->kind <= OP_GE);
+        rop->code = reg_op_code((OpKind)rop->kind, (Type)(is_comparison ? rop->lhs_type : rop->type));
+        if (rop->kind == OP_FUNC && (BUILTIN_FUNCTIONS[rop->imm].flags & FUNC_FLAG_MEMO)) {
+            const Func *f = &BUILTIN_FUNCTIONS[rop->imm];
+            assert((f->qualifier & QUALIFIER_PURE) && !(f->flags & FUNC_FLAG_SESSION) && 
+                   "only functions of their arguments alone can be memoized");
+            SelMemoSlot slot = {.args_size = memo_args_size(f)};
+            memcpy(&exe->regs[rop->rhs], &slot, sizeof(slot));
+            rop->code = REG_OP_MEMO;
+        }
+        if (rop->kind == OP_FUNC && (BUILTIN_FUNCTIONS[rop->imm].flags & FUNC_FLAG_STATE)) {
+            u64 site = state_site(exe->source_code, n_states++);
+            rop->rhs = (u16) sel_claim_state(site, exe, session.id);
+            rop->code = REG_OP_STATE;
+            if (rop->rhs == SEL_MAX_N_STATES) {
+                exe->main_thread = true; /* the extra state is shared with other expressions */
+            }
+        }
+    }
+    exe->n_states = n_states;
+
+    fuse_reg_ops(exe);
+    exe->ops[exe->n_ops] = (RegOp) {.code = REG_OP_HALT};
+
+    hgl_free(g_sel_arena, branches);
+    hgl_free(g_sel_arena, open_shared);
+    hgl_free(g_sel_arena, stack);
+}
+
+/* Looks up the instruction specialized for `kind` on values of type `type` */
+static u16 reg_op_code(OpKind kind, Type type)
+{
+#define X(name_, kind_, type_, ...)                                  \
+    if ((kind == kind_) && ((type == type_) || (type_ == TYPE_NIL))) { \
+        return REG_OP_##name_;                                        \
+    }
+    SEL_REG_OPS(X)
+#undef X
+    assert(false && "no register VM instruction for this op and type");
+    return REG_OP_HALT;
+}
+
+/*
+ * Fuses the most common pairs of register instructions into superinstructions, and 
+ * merges runs of moves between contiguous registers (typically the constant arguments 
+ * of a function) into a single block move. An instruction that is jumped to is never 
+ * merged into the one before it.
+ */
+static void fuse_reg_ops(ExeExpr *exe)
+{
+    RegOp *ops = exe->ops;
+    u32 n = exe->n_ops;
+    u32 *new_index = hgl_alloc(g_sel_arena, (n + 1) * sizeof(u32));
+    u32 *skip_target = hgl_alloc(g_sel_arena, (n + 1) * sizeof(u32));
+    b8 *is_target = hgl_alloc(g_sel_arena, (n + 1) * sizeof(b8));
+    memset(is_target, 0, (n + 1) * sizeof(b8));
+
+    for (u32 i = 0; i < n; i++) {
+        if (ops[i].kind == OP_SHARED || ops[i].kind == OP_JUMP_IF_FALSE || ops[i].kind == OP_JUMP) {
+            skip_target[i] = i + ops[i].rhs + 1;
+            is_target[skip_target[i]] = true;
+        }
+    }
+
+    u32 n_fused = 0;
+    for (u32 i = 0; i < n; i++) {
+        RegOp op = ops[i];
+        new_index[i] = n_fused;
+        const RegOp *next = (i + 1 < n) && !is_target[i + 1] ? &ops[i + 1] : NULL;
+
+        if (op.kind == OP_MOVE) {
+            u32 size = TYPE_TO_SIZE[op.type];
+            u32 j = i + 1;
+            while ((j < n) && (ops[j].kind == OP_MOVE) && !is_target[j] &&
+                   (ops[j].lhs == op.lhs + size) && (ops[j].dst == op.dst + size)) {
+                new_index[j] = n_fused;
+                size += TYPE_TO_SIZE[ops[j].type];
+                j++;
+            }
+            if (j > i + 1) {
+                op.code = REG_OP_MOVE_BLOCK;
+                op.type = TYPE_NIL;
+                op.rhs  = (u16) size;
+                i = j - 1;
+            }
+        } else if ((op.code == REG_OP_CALL_F32) && (next != NULL) &&
+                   ((next->code == REG_OP_MUL_F32) || (next->code == REG_OP_ADD_F32)) &&
+                   ((next->lhs == op.dst) || (next->rhs == op.dst))) {
+            op.code = (next->code == REG_OP_MUL_F32) ? REG_OP_CALL_MUL_F32 : REG_OP_CALL_ADD_F32;
+            op.rhs  = (next->lhs == op.dst) ? next->rhs : next->lhs;
+            op.dst  = next->dst;
+            new_index[++i] = n_fused;
+        } else if ((op.code == REG_OP_MUL_F32) && (next != NULL) &&
+                   (((next->code == REG_OP_ADD_F32) && ((next->lhs == op.dst) || (next->rhs == op.dst))) ||
+                    ((next->code == REG_OP_SUB_F32) && (next->lhs == op.dst)))) {
+            op.code = (next->code == REG_OP_ADD_F32) ? REG_OP_MUL_ADD_F32 : REG_OP_MUL_SUB_F32;
+            op.imm  = (next->lhs == op.dst) ? next->rhs : next->lhs;
+            op.dst  = next->dst;
+            new_index[++i] = n_fused;
+        }
+
+        ops[n_fused++] = op;
+    }
+    new_index[n] = n_fused;
+
+    /* jumps are never fused, and neither are their targets into the instruction before */
+    for (u32 i = 0; i < n; i++) {
+        RegOp *op = &ops[new_index[i]];
+        if (op->kind == OP_SHARED || op->kind == OP_JUMP_IF_FALSE || op->kind == OP_JUMP) {
+            op->rhs = (u16) (new_index[skip_target[i]] - new_index[i] - 1);
+        }
+    }
+    exe->n_ops = n_fused;
+
+    hgl_free(g_sel_arena, is_target);
+    hgl_free(g_sel_arena, skip_target);
+    hgl_free(g_sel_arena, new_index);
+}
+
+/* Size in bytes of the arguments of `f`, as kept in its memo slots */
+static u32 memo_args_size(const Func *f)
+{
+    u32 size = 0;
+    for (u32 i = 0; i < SEL_FUNC_MAX_N_ARGS && f->argtypes[i] != TYPE_NIL; i++) {
+        size += TYPE_TO_SIZE[f->argtypes[i]];
+    }
+    return size;
+}
+
+/* 
+ * Identifies the `ordinal`th call to a `FUNC_FLAG_STATE` builtin in the expression 
+ * `src` across compilations: FNV-1a of the source code and the ordinal.
+ */
+static u64 state_site(const char *src, u32 ordinal)
+{
+    assert(src != NULL && "the source of an expression is attached before its registers are assembled");
+    u64 h = 14695981039346656037ull;
+    for (const char *c = src; *c != '\0'; c++) {
+        h = (h ^ (u8)*c) * 1099511628211ull;
+    }
+    for (u32 i = 0; i < sizeof(ordinal); i++) {
+        h = (h ^ (u8)(ordinal >> (8*i))) * 1099511628211ull;
+    }
+    return h;
+}
+
+/* Size in bytes of the operands following `op` in the stack bytecode */
+static u32 op_operand_size(const Op *op)
+{
+    switch ((OpKind)op->kind) {
+        case OP_PUSH:    return op->argsize;
+        case OP_FUNC:    return sizeof(u32);
+        case OP_SHARED:  return 2*sizeof(u32);
+        case OP_PUBLISH: return sizeof(u32);
+        case OP_GLOBAL:  return sizeof(u32);
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP:    return sizeof(u32);
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_REM:
+        case OP_NEG:
+        case OP_SWIZZLE:
+        case OP_EQ:
+        case OP_NE:
+        case OP_LT:
+        case OP_LE:
+        case OP_GT:
+        case OP_GE:
+        case OP_MOVE:
+        case OP_CONTEXT:
+        case OP_GUARD:
+        case OP_STAGE:   return 0;
+    }
+    return 0;
+}
+
+/*
+ * Appends global `index` to the evaluation order after the globals it refers to, depth 
+ * first, and completes its sources of change with theirs. `state` is 0 for globals not 
+ * yet visited, 1 for globals being visited, and 2 for globals already in the order.
+ */
+static i32 order_globals(u32 index, u8 *state, u32 *n_ordered)
+{
+    Global *g = &session.globals.arr[index];
+    if (state[index] == 2) {
+        return 0;
+    }
+    if (state[index] == 1) {
+        log_error("The global `" SV_FMT "` depends on itself.", SV_ARG(g->name));
+        return -1;
+    }
+
+    state[index] = 1;
+    for (u32 i = 0; i < g->exe->n_ops; i++) {
+        const RegOp *op = &g->exe->ops[i];
+        if (op->kind == OP_GLOBAL) {
+            TRY(order_globals(op->imm, state, n_ordered));
+            g->exe->deps |= session.globals.arr[op->imm].exe->deps;
+        }
+    }
+    state[index] = 2;
+    session.global_order[(*n_ordered)++] = index;
+    return 0;
+}
+
+/*--- CACHE -----------------------------------------------------------------------------*/
+
+/* 
+ * The expression compiled from `src` by an earlier run, or NULL if there is none. In a 
+ * session, `e` is set to its tree, rebuilt from the bytecode, for `sel_end_session()`.
+ */
+static ExeExpr *cache_load(const char *src, ExprTree **e)
+{
+    if (cache.file == NULL) {
+        return NULL;
+    }
+
+    /* binary search on the key */
+    u32 src_length = (u32) strlen(src);
+    u64 key = cache_key(src, src_length);
+    u32 lo = 0;
+    u32 hi = cache.n_entries;
+    while (lo < hi) {
+        u32 mid = lo + (hi - lo) / 2;
+        if (cache.entries[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == cache.n_entries || cache.entries[lo].key != key) {
+        return NULL;
+    }
+
+    CacheEntry entry = cache.entries[lo];
+    if (entry.src_length != src_length || 
+        (u64)entry.offset + entry.src_length + entry.code_size > cache.blob_size ||
+        memcmp(&cache.blob[entry.offset], src, src_length) != 0 ||
+        (entry.globals != 0 && entry.globals != session.globals_hash)) {
+        return NULL;
+    }
+    const u8 *code = &cache.blob[entry.offset + entry.src_length];
+
+    ExeExpr *exe = hgl_alloc(g_r2r_arena, sizeof(ExeExpr));
+    assert(exe != NULL && "r2r arena alloc failed");
+    memset(exe, 0, sizeof(ExeExpr));
+    exe->type = (Type) entry.type;
+    exe->qualifier = (TypeQualifier) entry.qualifier;
+    exe->n_elements = entry.n_elements;
+    exe->code = hgl_alloc(g_r2r_arena, entry.code_size);
+    assert(exe->code != NULL && "r2r arena alloc failed");
+    memcpy(exe->code, code, entry.code_size);
+    exe->size = entry.code_size;
+    exe->capacity = entry.code_size;
+    if (cache_relocate_strs(exe->code, exe->size, src, src_length, false) < 0) {
+        hgl_free(g_r2r_arena, exe->code);
+        hgl_free(g_r2r_arena, exe);
+        return NULL;
+    }
+    codegen_measure(exe);
+    exe->source_code = src;
+    assemble_registers(exe);
+
+    /* without its tree, the expression is simply left out of the session */
+    if (session.is_open) {
+        *e = cache_rebuild_tree(exe);
+    }
+
+    cache_push(&entry, src, code);
+    cache.n_hits++;
+    return exe;
+}
+
+/* Adds the freshly compiled `exe` to the cache, unless its bytecode refers to memory other than `src` */
+static void cache_store(const ExeExpr *exe, const char *src)
+{
+    u32 src_length = (u32) strlen(src);
+    u8 *code = malloc(exe->size);
+    if (code == NULL) {
+        return;
+    }
+    memcpy(code, exe->code, exe->size);
+
+    i32 refs = cache_relocate_strs(code, exe->size, src, src_length, true);
+    if (refs >= 0) {
+        CacheEntry entry = {
+            .key        = cache_key(src, src_length),
+            .globals    = (refs > 0) ? session.globals_hash : 0,
+            .src_length = src_length,
+            .code_size  = exe->size,
+            .type       = (u8) exe->type,
+            .qualifier  = (u8) exe->qualifier,
+            .n_elements = (u16) exe->n_elements,
+        };
+        cache_push(&entry, src, code);
+        cache.n_stored++;
+    }
+    free(code);
+}
+
+static void cache_push(const CacheEntry *entry, const char *src, const u8 *code)
+{
+    CacheEntry e = *entry;
+    e.offset = (u32) cache.new_blob.length;
+    hgl_da_push(&cache.new_entries, e);
+
+    size_t length = cache.new_blob.length + e.src_length + e.code_size;
+    if (cache.new_blob.capacity < length) {
+        while (cache.new_blob.capacity < length) {
+            cache.new_blob.capacity = (cache.new_blob.capacity == 0) ? 4096 : 2*cache.new_blob.capacity;
+        }
+        cache.new_blob.arr = realloc(cache.new_blob.arr, cache.new_blob.capacity);
+        assert(cache.new_blob.arr != NULL && "cache blob alloc failed");
+    }
+    memcpy(&cache.new_blob.arr[cache.new_blob.length], src, e.src_length);
+    memcpy(&cache.new_blob.arr[cache.new_blob.length + e.src_length], code, e.code_size);
+    cache.new_blob.length = length;
+}
+
+/*
+ * Replaces the pointers of the string literals in `code` by their offsets into `src`, 
+ * or the reverse if not `to_offsets`. Returns the number of references to globals in 
+ * `code`, or -1 if a string literal lies outside `src`.
+ */
+static i32 cache_relocate_strs(u8 *code, u32 size, const char *src, u32 src_length, b8 to_offsets)
+{
+    static_assert(sizeof(const char *) == sizeof(u64), "");
+    i32 n_globals = 0;
+    for (u32 pc = 0; pc < size;) {
+        const Op *op = (const Op *)&code[pc];
+        u8 *operands = &code[pc + sizeof(Op)];
+        pc += sizeof(Op) + op_operand_size(op);
+        if (op->kind == OP_GLOBAL) {
+            n_globals++;
+        }
+        if (op->kind != OP_PUSH || op->type != TYPE_STR) {
+            continue;
+        }
+
+        StringView sv;
+        memcpy(&sv, operands, sizeof(sv));
+        if (to_offsets) {
+            if (sv.start < src || sv.start + sv.length > src + src_length) {
+                return -1;
+            }
+            u64 offset = (u64) (sv.start - src);
+            memcpy(operands, &offset, sizeof(offset));
+        } else {
+            u64 offset;
+            memcpy(&offset, operands, sizeof(offset));
+            if (offset + sv.length > src_length) {
+                return -1;
+            }
+            sv.start = src + offset;
+            memcpy(operands, &sv, sizeof(sv));
+        }
+    }
+    return n_globals;
+}
+
+/*
+ * Rebuilds the tree of an expression loaded from the cache from its bytecode. Only 
+ * what the passes of `sel_end_session()` look at is restored: kinds, types, values, 
+ * and function and global ids. Returns NULL if out of memory.
+ */
+static ExprTree *cache_rebuild_tree(const ExeExpr *exe)
+{
+    static const ExprKind op_to_expr[] = {
+        [OP_ADD] = EXPR_ADD,
+        [OP_SUB] = EXPR_SUB,
+        [OP_MUL] = EXPR_MUL,
+        [OP_DIV] = EXPR_DIV,
+        [OP_REM] = EXPR_REM,
+        [OP_EQ]  = EXPR_EQ,
+        [OP_NE]  = EXPR_NE,
+        [OP_LT]  = EXPR_LT,
+        [OP_LE]  = EXPR_LE,
+        [OP_GT]  = EXPR_GT,
+        [OP_GE]  = EXPR_GE,
+    };
+
+    cache.stack.length = 0;
+    for (u32 pc = 0; pc < exe->size;) {
+        const Op *op = (const Op *)&exe->code[pc];
+        const u8 *operands = &exe->code[pc + sizeof(Op)];
+        pc += sizeof(Op) + op_operand_size(op);
+
+        ExprTree *e = new_expr(EXPR_LIT, (Token) {0});
+        if (e == NULL) {
+            return NULL;
+        }
+        e->type = (Type) op->type;
+        e->qualifier = QUALIFIER_NONE;
+
+        /* the operands of an op are the trees last pushed */
+        u32 n_operands = 0;
+        if (op->kind == OP_NEG || op->kind == OP_JUMP_IF_FALSE || op->kind == OP_JUMP) {
+            n_operands = 1;
+        } else if ((op->kind >= OP_ADD && op->kind <= OP_REM) || (op->kind >= OP_SWIZZLE && op->kind <= OP_GE)) {
+            n_operands = 2;
+        } else if (op->kind == OP_FUNC) {
+            u32 id;
+            memcpy(&id, operands, sizeof(u32));
+            const Func *f = &BUILTIN_FUNCTIONS[id];
+            while (n_operands < SEL_FUNC_MAX_N_ARGS && f->argtypes[n_operands] != TYPE_NIL) {
+                n_operands++;
+            }
+        }
+        if (cache.stack.length < n_operands) {
+            return NULL;
+        }
+        ExprTree **top = &cache.stack.arr[cache.stack.length - n_operands];
+        cache.stack.length -= n_operands;
+
+        switch ((OpKind)op->kind) {
+            case OP_PUSH: {
+                memcpy(&e->value, operands, op->argsize);
+            } break;
+
+            case OP_ADD:
+            case OP_SUB:
+            case OP_MUL:
+            case OP_DIV:
+            case OP_REM: 
+            case OP_SWIZZLE:
+            case OP_EQ:
+            case OP_NE:
+            case OP_LT:
+            case OP_LE:
+            case OP_GT:
+            case OP_GE: {
+                e->kind = (op->kind == OP_SWIZZLE) ? EXPR_SWIZZLE : op_to_expr[op->kind];
+                e->lhs = top[0];
+                e->rhs = top[1];
+            } break;
+
+            case OP_JUMP_IF_FALSE: {
+                /* stays on the stack below the branches, until they are complete */
+                e->kind = EXPR_COND;
+                e->lhs = top[0];
+            } break;
+
+            case OP_JUMP: {
+                if (cache.stack.length == 0 || cache.stack.arr[cache.stack.length - 1]->kind != EXPR_COND) {
+                    return NULL;
+                }
+                ExprTree *cond = cache.stack.arr[cache.stack.length - 1];
+                e->kind = EXPR_BRANCHES;
+                e->lhs = top[0];
+                cond->rhs = e;
+                u32 skip;
+                memcpy(&skip, operands, sizeof(skip));
+                cond->value.val_u32 = pc + skip; /* where the second branch ends */
+                continue;
+            } break;
+
+            case OP_NEG: {
+                e->kind = EXPR_NEG;
+                e->child = top[0];
+            } break;
+
+            case OP_FUNC: {
+                e->kind = EXPR_FUNC;
+                memcpy(&e->func_id, operands, sizeof(u32));
+                for (u32 i = n_operands; i > 0; i--) {
+                    ExprTree *arg = new_expr(EXPR_ARGLIST, (Token) {0});
+                    if (arg == NULL) {
+                        return NULL;
+                    }
+                    arg->lhs = top[i - 1];
+                    arg->rhs = e->child;
+                    e->child = arg;
+                }
+            } break;
+
+            case OP_GLOBAL: {
+                e->kind = EXPR_GLOBAL;
+                memcpy(&e->global_id, operands, sizeof(u32));
+            } break;
+
+            case OP_SHARED:
+            case OP_PUBLISH:
+            case OP_MOVE:
+            case OP_CONTEXT:
+            case OP_GUARD:
+            case OP_STAGE: {
+                assert(false && "op not emitted by `sel_compile()`");
+            } break;
+        }
+        hgl_da_push(&cache.stack, e);
+
+        /* the value of the second branch completes its conditional */
+        while (cache.stack.length >= 2) {
+            ExprTree *cond = cache.stack.arr[cache.stack.length - 2];
+            if (cond->kind != EXPR_COND || cond->rhs == NULL || cond->rhs->rhs != NULL || 
+                cond->value.val_u32 != pc) {
+                break;
+            }
+            cond->rhs->rhs = cache.stack.arr[--cache.stack.length];
+            cond->rhs->type = cond->rhs->lhs->type;
+            cond->type = cond->rhs->lhs->type;
+        }
+    }
+
+    if (cache.stack.length != 1) {
+        return NULL;
+    }
+    ExprTree *e = cache.stack.arr[0];
+    e->qualifier = exe->qualifier;
+    return e;
+}
+
+static b8 cache_file_is_valid(void)
+{
+    if (cache.file_size < sizeof(CacheHeader)) {
+        return false;
+    }
+    const CacheHeader *header = (const CacheHeader *) cache.file;
+    return memcmp(header->magic, "SELC", 4) == 0 &&
+           header->version == SEL_CACHE_VERSION &&
+           header->abi == cache_abi_hash() &&
+           cache.file_size == sizeof(CacheHeader) + (size_t)header->n_entries * sizeof(CacheEntry) + 
+                              header->blob_size;
+}
+
+/* Writes `cache.new_entries` to the cache file, their source code and bytecode gathered into a single blob */
+static void cache_write(void)
+{
+    u32 n = (u32) cache.new_entries.length;
+    u32 blob_size = 0;
+    for (u32 i = 0; i < n; i++) {
+        blob_size += cache.new_entries.arr[i].src_length + cache.new_entries.arr[i].code_size;
+    }
+
+    size_t size = sizeof(CacheHeader) + n * sizeof(CacheEntry) + blob_size;
+    u8 *data = malloc(size);
+    if (data == NULL) {
+        return;
+    }
+    CacheHeader *header = (CacheHeader *) data;
+    CacheEntry *entries = (CacheEntry *) (data + sizeof(CacheHeader));
+    u8 *blob = data + sizeof(CacheHeader) + n * sizeof(CacheEntry);
+    *header = (CacheHeader) {
+        .magic     = {'S', 'E', 'L', 'C'},
+        .version   = SEL_CACHE_VERSION,
+        .abi       = cache_abi_hash(),
+        .n_entries = n,
+        .blob_size = blob_size,
+    };
+
+    u32 offset = 0;
+    for (u32 i = 0; i < n; i++) {
+        CacheEntry e = cache.new_entries.arr[i];
+        u32 entry_size = e.src_length + e.code_size;
+        memcpy(&blob[offset], &cache.new_blob.arr[e.offset], entry_size);
+        e.offset = offset;
+        entries[i] = e;
+        offset += entry_size;
+    }
+
+    if (io_write_entire_file(cache.filepath, data, size) != 0) {
+        log_error("Could not write the SEL cache file `%s`.", cache.filepath);
+    }
+    free(data);
+}
+
+static i32 cache_entry_compare(const void *a, const void *b)
+{
+    u64 ka = ((const CacheEntry *) a)->key;
+    u64 kb = ((const CacheEntry *) b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+/* FNV-1a of the source code, and of whether it defines a global (which may not call some functions) */
+static u64 cache_key(const char *src, u32 src_length)
+{
+    u64 h = 14695981039346656037ull;
+    for (u32 i = 0; i < src_length; i++) {
+        h = (h ^ (u8)src[i]) * 1099511628211ull;
+    }
+    h = (h ^ (u8)session.is_defining_globals) * 1099511628211ull;
+    return h;
+}
+
+/* 
+ * Hash of everything the bytecode depends on besides its source: the ops, the types, 
+ * and the signatures of the builtin functions (whose ids are indices into the table), 
+ * and the values of the constants.
+ */
+static u64 cache_abi_hash(void)
+{
+    u64 h = 14695981039346656037ull;
+    #define HASH_BYTES(ptr_, size_)                         \
+        for (u32 i_ = 0; i_ < (size_); i_++) {              \
+            h = (h ^ ((const u8 *)(ptr_))[i_]) * 1099511628211ull; \
+        }
+
+    const u32 layout[] = {sizeof(Op), sizeof(SelValue), sizeof(StringView), N_TYPES, OP_STAGE};
+    HASH_BYTES(layout, sizeof(layout));
+    for (u32 i = 0; i < N_BUILTIN_FUNCTIONS; i++) {
+        const Func *f = &BUILTIN_FUNCTIONS[i];
+        const u32 signature[] = {f->type, f->qualifier, f->flags};
+        HASH_BYTES(f->id.start, f->id.length);
+        HASH_BYTES(signature, sizeof(signature));
+        HASH_BYTES(f->argtypes, sizeof(f->argtypes));
+    }
+    for (u32 i = 0; i < N_BUILTIN_CONSTANTS; i++) {
+        const Const *c = &BUILTIN_CONSTANTS[i];
+        HASH_BYTES(c->id.start, c->id.length);
+        HASH_BYTES(&c->type, sizeof(c->type));
+        HASH_BYTES(&c->value, TYPE_TO_SIZE[c->type]);
+    }
+
+    #undef HASH_BYTES
+    return h;
+}
+
+/* Hash of the names and types of the globals, which the bytecode refers to by index */
+static u64 globals_hash(void)
+{
+    u64 h = 14695981039346656037ull;
+    for (u32 i = 0; i < session.globals.count; i++) {
+        const Global *g = &session.globals.arr[i];
+        for (size_t j = 0; j < g->name.length; j++) {
+            h = (h ^ (u8)g->name.start[j]) * 1099511628211ull;
+        }
+        h = (h ^ (u8)g->type) * 1099511628211ull;
+    }
+    return h;
+}
+
 /*--- Misc. -----------------------------------------------------------------------------*/
 
 static void token_print(Token *token)
@@ -1181,7 +3801,7 @@ static void print_expr(ExprTree *e)
         return;
     }
 
-    if (e->kind == EXPR_LIT || e->kind == EXPR_ID) {
+    if (e->kind == EXPR_LIT || e->kind == EXPR_ID || e->kind == EXPR_GLOBAL) {
         token_print(&e->token);
         return;
     }
@@ -1222,12 +3842,21 @@ static void print_expr(ExprTree *e)
         case EXPR_DIV:     printf("/"); break;
         case EXPR_REM:     printf("%%"); break;
         case EXPR_SWIZZLE: printf("."); break;
+        case EXPR_EQ:      printf("=="); break;
+        case EXPR_NE:      printf("!="); break;
+        case EXPR_LT:      printf("<"); break;
+        case EXPR_LE:      printf("<="); break;
+        case EXPR_GT:      printf(">"); break;
+        case EXPR_GE:      printf(">="); break;
+        case EXPR_COND:    printf("?"); break;
+        case EXPR_BRANCHES: printf(":"); break;
         case EXPR_NEG:
         case EXPR_PAREN:
         case EXPR_FUNC:
         case EXPR_ARGLIST:
         case EXPR_LIT:
         case EXPR_ID:
+        case EXPR_GLOBAL:
         case N_EXPR_KINDS:
         default: assert(false); 
     }
@@ -1251,6 +3880,17 @@ static void print_expr_tree_helper(ExprTree *e, i32 indent)
         case EXPR_DIV:     printf("%*s/\n", pad, "");  print_expr_tree_helper(e->lhs, indent + 1); print_expr_tree_helper(e->rhs, indent + 1); break;
         case EXPR_REM:     printf("%*s%%\n", pad, ""); print_expr_tree_helper(e->lhs, indent + 1); print_expr_tree_helper(e->rhs, indent + 1); break;
         case EXPR_SWIZZLE: printf("%*s.\n", pad, "");  print_expr_tree_helper(e->lhs, indent + 1); print_expr_tree_helper(e->rhs, indent + 1); break;
+        case EXPR_EQ:      printf("%*s==\n", pad, ""); print_expr_tree_helper(e->lhs, indent + 1); print_expr_tree_helper(e->rhs, indent + 1); break;
+        case EXPR_NE:      printf("%*s!=\n", pad, ""); print_expr_tree_helper(e->lhs, indent + 1); print_expr_tree_helper(e->rhs, indent + 1); break;
+        case EXPR_LT:      printf("%*s<\n", pad, "");  print_expr_tree_helper(e->lhs, indent + 1); print_expr_tree_helper(e->rhs, indent + 1); break;
+        case EXPR_LE:      printf("%*s<=\n", pad, ""); print_expr_tree_helper(e->lhs, indent + 1); print_expr_tree_helper(e->rhs, indent + 1); break;
+        case EXPR_GT:      printf("%*s>\n", pad, "");  print_expr_tree_helper(e->lhs, indent + 1); print_expr_tree_helper(e->rhs, indent + 1); break;
+        case EXPR_GE:      printf("%*s>=\n", pad, ""); print_expr_tree_helper(e->lhs, indent + 1); print_expr_tree_helper(e->rhs, indent + 1); break;
+        case EXPR_COND:    printf("%*s?\n", pad, "");  print_expr_tree_helper(e->lhs, indent + 1); print_expr_tree_helper(e->rhs, indent); break;
+        case EXPR_BRANCHES: print_expr_tree_helper(e->lhs, indent + 1); 
+                           printf("%*s:\n", pad, ""); 
+                           print_expr_tree_helper(e->rhs, indent + 1); 
+                           break;
         case EXPR_NEG:     printf("%*sN\n", pad, "");  print_expr_tree_helper(e->child, indent + 1);break;
         case EXPR_PAREN:   
                            printf("%*s(\n", pad, ""); 
@@ -1267,6 +3907,7 @@ static void print_expr_tree_helper(ExprTree *e, i32 indent)
                            print_expr_tree_helper(e->rhs, indent); 
                            break;
         case EXPR_ID:
+        case EXPR_GLOBAL:
         case EXPR_LIT:     printf("%*s", pad, ""); 
                            token_print(&e->token); 
                            printf("\n"); 
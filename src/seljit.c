@@ -0,0 +1,792 @@
+/*--- Include files ---------------------------------------------------------------------*/
+
+#include "sel.h"
+#include "alloc.h"
+#include "log.h"
+#include "shaq_config.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#if SHAQ_SEL_JIT && defined(__x86_64__)
+#include <sys/mman.h>
+#define JIT_ENABLED 1
+#else
+#define JIT_ENABLED 0
+#endif
+
+/*--- Private macros --------------------------------------------------------------------*/
+
+#define JIT_ARENA_SIZE (4*1024*1024)
+
+/* 
+ * Stack space for the SelValue returned by builtins, followed by the state of the 
+ * thread passed to the native code. Keeps the stack 16-byte aligned.
+ */
+#define JIT_FRAME_SIZE 80
+#define JIT_FRAME_THREAD 64
+static_assert(sizeof(SelValue) <= JIT_FRAME_THREAD, "");
+
+/* x86-64 general purpose registers */
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3 /* holds `regs` */
+#define RSP 4
+#define RSI 6
+#define RDI 7
+
+#define XMM0 0
+#define XMM1 1
+#define XMM2 2
+#define XMM3 3
+#define XMM4 4
+#define XMM5 5
+
+/* SSE instruction prefixes and opcodes (following 0x0F) */
+#define SSE_PS      0x00
+#define SSE_SS      0xF3
+#define SSE_MOVLOAD 0x10
+#define SSE_MOVSTOR 0x11
+#define SSE_MOVAPS  0x28
+#define SSE_UCOMI   0x2E
+#define SSE_XOR     0x57
+#define SSE_ADD     0x58
+#define SSE_MUL     0x59
+#define SSE_SUB     0x5C
+#define SSE_DIV     0x5E
+#define SSE_SHUF    0xC6
+
+/*--- Private type definitions ----------------------------------------------------------*/
+
+typedef struct
+{
+    u8 *code;
+    u32 size;
+    u32 capacity;
+    b8 overflow;
+} JitBuffer;
+
+/* A jump to the instruction `op`, whose rel32 is at `at` */
+typedef struct
+{
+    u32 at;
+    u32 op;
+} JitPatch;
+
+typedef struct
+{
+    const SelJitEnv *env;
+    const ExeExpr *exe;
+    JitPatch *patches;
+    u32 n_patches;
+} JitContext;
+
+/*--- Private function prototypes -------------------------------------------------------*/
+
+#if JIT_ENABLED
+static b8 jit_emit_op(JitBuffer *b, const RegOp *op, u32 index, JitContext *ctx);
+static b8 jit_emit_f32_op(JitBuffer *b, u8 sse_op, const RegOp *op);
+static void jit_emit_mat4_mul(JitBuffer *b, const RegOp *op);
+static b8 jit_emit_i32_op(JitBuffer *b, OpKind kind, const RegOp *op);
+static void jit_emit_compare(JitBuffer *b, const RegOp *op);
+static void jit_emit_call(JitBuffer *b, const RegOp *op);
+static void jit_emit_thread_ptr(JitBuffer *b, u8 reg, u32 offset);
+static void jit_patch_here(JitBuffer *b, const u32 *at, u32 n);
+
+static void emit_u8(JitBuffer *b, u8 v);
+static void emit_u32(JitBuffer *b, u32 v);
+static void emit_u64(JitBuffer *b, u64 v);
+static void emit_mem(JitBuffer *b, u8 reg, u8 base, u32 disp);
+static void emit_load32(JitBuffer *b, u8 reg, u8 base, u32 disp);
+static void emit_store32(JitBuffer *b, u8 base, u32 disp, u8 reg);
+static void emit_load64(JitBuffer *b, u8 reg, u8 base, u32 disp);
+static void emit_store64(JitBuffer *b, u8 base, u32 disp, u8 reg);
+static void emit_mov_imm64(JitBuffer *b, u8 reg, u64 imm);
+static void emit_sse(JitBuffer *b, u8 prefix, u8 opcode, u8 xmm, u8 base, u32 disp);
+static void emit_sse_rr(JitBuffer *b, u8 prefix, u8 opcode, u8 dst, u8 src);
+static void emit_copy(JitBuffer *b, u8 dst_base, u32 dst, u8 src_base, u32 src, u32 size);
+#endif
+
+/*--- Private variables -----------------------------------------------------------------*/
+
+#if JIT_ENABLED
+static struct {
+    u8 *memory; /* mapped on first use */
+    u32 top;
+} jit = {0};
+#endif
+
+/*--- Public functions ------------------------------------------------------------------*/
+
+/*
+ * Translates the register program of `exe` into native x86-64 code, which accesses 
+ * the state of the VM shared by all threads through `env`, and that of the thread 
+ * running it through its second argument. Not re-entrant. Returns
+ * NULL if the program uses an instruction that is not supported, in which case the
+ * caller keeps interpreting it.
+ */
+SelJitFn sel_jit_compile(const ExeExpr *exe, const SelJitEnv *env)
+{
+#if JIT_ENABLED
+    if (jit.memory == NULL) {
+        void *memory = mmap(NULL, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            log_error("Failed to map memory for the SEL JIT.");
+            return NULL;
+        }
+        jit.memory = memory;
+    } else if (0 != mprotect(jit.memory, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE)) {
+        return NULL;
+    }
+
+    JitBuffer b = {
+        .code     = jit.memory + jit.top,
+        .capacity = JIT_ARENA_SIZE - jit.top,
+    };
+    JitContext ctx = {
+        .env     = env,
+        .exe     = exe,
+        .patches = hgl_alloc(g_frame_arena, (exe->n_ops + 1) * sizeof(JitPatch)),
+    };
+    u32 *op_offsets = hgl_alloc(g_frame_arena, (exe->n_ops + 1) * sizeof(u32));
+
+    /* prologue: keep `regs` in rbx, and the state of the thread on the stack */
+    emit_u8(&b, 0x53);                                       // push rbx
+    emit_u8(&b, 0x48); emit_u8(&b, 0x89); emit_u8(&b, 0xFB); // mov rbx, rdi
+    emit_u8(&b, 0x48); emit_u8(&b, 0x81); emit_u8(&b, 0xEC); // sub rsp, JIT_FRAME_SIZE
+    emit_u32(&b, JIT_FRAME_SIZE);
+    emit_store64(&b, RSP, JIT_FRAME_THREAD, RSI);            // mov [rsp + JIT_FRAME_THREAD], rsi
+
+    /* the program ends with REG_OP_HALT, which emits the epilogue */
+    b8 ok = true;
+    for (u32 i = 0; ok && (i <= exe->n_ops); i++) {
+        op_offsets[i] = b.size;
+        ok = jit_emit_op(&b, &exe->ops[i], i, &ctx);
+    }
+
+    if (!ok || b.overflow) {
+        (void) mprotect(jit.memory, JIT_ARENA_SIZE, PROT_READ | PROT_EXEC);
+        return NULL;
+    }
+
+    for (u32 i = 0; i < ctx.n_patches; i++) {
+        u32 rel = op_offsets[ctx.patches[i].op] - (ctx.patches[i].at + sizeof(u32));
+        memcpy(&b.code[ctx.patches[i].at], &rel, sizeof(u32));
+    }
+
+    jit.top += (b.size + 15) & ~15u;
+    if (0 != mprotect(jit.memory, JIT_ARENA_SIZE, PROT_READ | PROT_EXEC)) {
+        return NULL;
+    }
+    return (SelJitFn)(void *) b.code;
+#else
+    (void) exe;
+    (void) env;
+    return NULL;
+#endif
+}
+
+/* Frees all native code. Called on reload, when the expressions it was compiled from go away */
+void sel_jit_reset()
+{
+#if JIT_ENABLED
+    jit.top = 0;
+#endif
+}
+
+/*--- Private functions -----------------------------------------------------------------*/
+
+#if JIT_ENABLED
+
+static b8 jit_emit_op(JitBuffer *b, const RegOp *op, u32 index, JitContext *ctx)
+{
+    u32 size = TYPE_TO_SIZE[op->type];
+
+    /* instructions that are not a plain op on a type */
+    switch (op->code) {
+        case REG_OP_HALT: {
+            emit_u8(b, 0x48); emit_u8(b, 0x81); emit_u8(b, 0xC4); // add rsp, JIT_FRAME_SIZE
+            emit_u32(b, JIT_FRAME_SIZE);
+            emit_u8(b, 0x5B);                                     // pop rbx
+            emit_u8(b, 0xC3);                                     // ret
+        } return true;
+
+        case REG_OP_MOVE_BLOCK: {
+            emit_copy(b, RBX, op->dst, RBX, op->lhs, op->rhs);
+        } return true;
+
+        case REG_OP_CALL_MUL_F32:
+        case REG_OP_CALL_ADD_F32: {
+            jit_emit_call(b, op);
+            u8 sse_op = (op->code == REG_OP_CALL_MUL_F32) ? SSE_MUL : SSE_ADD;
+            emit_sse(b, SSE_SS, SSE_MOVLOAD, XMM0, RSP, 0);
+            emit_sse(b, SSE_SS, sse_op, XMM0, RBX, op->rhs);
+            emit_sse(b, SSE_SS, SSE_MOVSTOR, XMM0, RBX, op->dst);
+        } return true;
+
+        case REG_OP_MEMO: {
+            /* a hit if the slot is filled, and holds the arguments, compared 4 bytes at a time */
+            SelMemoSlot slot;
+            memcpy(&slot, &ctx->exe->regs[op->rhs], sizeof(slot));
+            u32 args = op->rhs + sizeof(SelMemoSlot);
+            u32 result = args + slot.args_size;
+            u32 miss_at[SEL_FUNC_MAX_N_ARGS * sizeof(Mat4) / sizeof(u32) + 1];
+            u32 n_miss = 0;
+            emit_u8(b, 0x83); emit_mem(b, 7, RBX, op->rhs + offsetof(SelMemoSlot, n_calls)); // cmp dword [n_calls], 0
+            emit_u8(b, 0x00);
+            emit_u8(b, 0x0F); emit_u8(b, 0x84);                                             // je miss
+            miss_at[n_miss++] = b->size;
+            emit_u32(b, 0);
+            for (u32 i = 0; i < slot.args_size; i += sizeof(u32)) {
+                emit_load32(b, RAX, RBX, op->lhs + i);
+                emit_u8(b, 0x3B); emit_mem(b, RAX, RBX, args + i);                          // cmp eax, [args + i]
+                emit_u8(b, 0x0F); emit_u8(b, 0x85);                                         // jne miss
+                miss_at[n_miss++] = b->size;
+                emit_u32(b, 0);
+            }
+            emit_u8(b, 0x83); emit_mem(b, 0, RBX, op->rhs + offsetof(SelMemoSlot, n_hits));  // add dword [n_hits], 1
+            emit_u8(b, 0x01);
+            emit_copy(b, RBX, op->dst, RBX, result, size);
+            emit_u8(b, 0xE9);                                                               // jmp done
+            u32 done_at = b->size;
+            emit_u32(b, 0);
+
+            /* the result overwrites the arguments, so they are saved first */
+            jit_patch_here(b, miss_at, n_miss);
+            emit_copy(b, RBX, args, RBX, op->lhs, slot.args_size);
+            jit_emit_call(b, op);
+            emit_copy(b, RBX, result, RSP, 0, size);
+            emit_copy(b, RBX, op->dst, RSP, 0, size);
+            jit_patch_here(b, &done_at, 1);
+            emit_u8(b, 0x83); emit_mem(b, 0, RBX, op->rhs + offsetof(SelMemoSlot, n_calls)); // add dword [n_calls], 1
+            emit_u8(b, 0x01);
+        } return true;
+
+        case REG_OP_STATE: {
+            /* the states are private to the VM, which is called to run the instruction */
+            emit_u8(b, 0x48); emit_u8(b, 0x89); emit_u8(b, 0xDF); // mov rdi, rbx
+            emit_mov_imm64(b, RSI, (u64) op);
+            emit_mov_imm64(b, RAX, (u64) ctx->env->state_call);
+            emit_u8(b, 0xFF); emit_u8(b, 0xD0);                   // call rax
+        } return true;
+
+        case REG_OP_MUL_ADD_F32:
+        case REG_OP_MUL_SUB_F32: {
+            u8 sse_op = (op->code == REG_OP_MUL_ADD_F32) ? SSE_ADD : SSE_SUB;
+            emit_sse(b, SSE_SS, SSE_MOVLOAD, XMM0, RBX, op->lhs);
+            emit_sse(b, SSE_SS, SSE_MUL, XMM0, RBX, op->rhs);
+            emit_sse(b, SSE_SS, sse_op, XMM0, RBX, op->imm);
+            emit_sse(b, SSE_SS, SSE_MOVSTOR, XMM0, RBX, op->dst);
+        } return true;
+
+        default: break;
+    }
+
+    switch ((OpKind)op->kind) {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_REM:
+        case OP_NEG: {
+            switch ((Type)op->type) {
+                case TYPE_FLOAT:
+                case TYPE_VEC2:
+                case TYPE_VEC3:
+                case TYPE_VEC4:
+                case TYPE_MAT2:
+                case TYPE_MAT3:
+                case TYPE_MAT4: {
+                    if (op->kind == OP_MUL && op->type == TYPE_MAT4) {
+                        jit_emit_mat4_mul(b, op);
+                        return true;
+                    }
+                    if (op->kind == OP_MUL && op->type >= TYPE_MAT2) {
+                        return false; /* matrix product */
+                    }
+                    u8 sse_op = (op->kind == OP_ADD) ? SSE_ADD :
+                                (op->kind == OP_SUB) ? SSE_SUB :
+                                (op->kind == OP_MUL) ? SSE_MUL :
+                                (op->kind == OP_DIV) ? SSE_DIV : 0;
+                    return jit_emit_f32_op(b, sse_op, op);
+                }
+                case TYPE_INT:
+                case TYPE_UINT:
+                case TYPE_IVEC2:
+                case TYPE_IVEC3:
+                case TYPE_IVEC4: {
+                    return jit_emit_i32_op(b, (OpKind)op->kind, op);
+                }
+                case TYPE_NIL:
+                case TYPE_BOOL:
+                case TYPE_STR:
+                case TYPE_TEXTURE:
+                case TYPE_AND_NAMECHECKER_ERROR_:
+                case N_TYPES:
+                    return false;
+            }
+        } return false;
+
+        case OP_EQ:
+        case OP_NE:
+        case OP_LT:
+        case OP_LE:
+        case OP_GT:
+        case OP_GE: {
+            jit_emit_compare(b, op);
+        } return true;
+
+        case OP_JUMP_IF_FALSE: {
+            emit_u8(b, 0x83); emit_mem(b, 7, RBX, op->lhs); emit_u8(b, 0x00); // cmp dword [cond], 0
+            emit_u8(b, 0x0F); emit_u8(b, 0x84);                               // je (the second branch)
+            ctx->patches[ctx->n_patches++] = (JitPatch) {.at = b->size, .op = index + op->rhs + 1};
+            emit_u32(b, 0);
+        } return true;
+
+        case OP_JUMP: {
+            emit_u8(b, 0xE9);                                                 // jmp past the second branch
+            ctx->patches[ctx->n_patches++] = (JitPatch) {.at = b->size, .op = index + op->rhs + 1};
+            emit_u32(b, 0);
+        } return true;
+
+        case OP_FUNC: {
+            jit_emit_call(b, op);
+            emit_copy(b, RBX, op->dst, RSP, 0, size);
+        } return true;
+
+        case OP_SWIZZLE: {
+            /* read all components before writing any, `dst` may overlap `lhs` */
+            static const u8 regs[4] = {RAX, RCX, RDX, RSI};
+            u32 n_components = size / sizeof(u32);
+            for (u32 i = 0; i < n_components; i++) {
+                u32 component = (op->imm >> (8*i)) & 0xFF;
+                emit_load32(b, regs[i], RBX, op->lhs + component*sizeof(u32));
+            }
+            for (u32 i = 0; i < n_components; i++) {
+                emit_store32(b, RBX, op->dst + i*sizeof(u32), regs[i]);
+            }
+        } return true;
+
+        case OP_MOVE: {
+            emit_copy(b, RBX, op->dst, RBX, op->lhs, size);
+        } return true;
+
+        case OP_SHARED: {
+            jit_emit_thread_ptr(b, RAX, offsetof(SelThreadState, shared) + op->imm*sizeof(SelSharedValue));
+            emit_mov_imm64(b, RCX, (u64) ctx->env->frame);
+            emit_u8(b, 0x48); emit_u8(b, 0x8B); emit_u8(b, 0x09); // mov rcx, [rcx]
+            emit_u8(b, 0x48); emit_u8(b, 0x3B);                   // cmp rcx, [rax + frame]
+            emit_mem(b, RCX, RAX, offsetof(SelSharedValue, frame));
+            emit_u8(b, 0x0F); emit_u8(b, 0x85);                   // jne (not cached yet)
+            u32 not_cached_at = b->size;
+            emit_u32(b, 0);
+            emit_copy(b, RBX, op->dst, RAX, offsetof(SelSharedValue, value), size);
+            emit_u8(b, 0xE9);                                     // jmp past the subexpression
+            ctx->patches[ctx->n_patches++] = (JitPatch) {.at = b->size, .op = index + op->rhs + 1};
+            emit_u32(b, 0);
+            jit_patch_here(b, &not_cached_at, 1);
+        } return true;
+
+        case OP_PUBLISH: {
+            jit_emit_thread_ptr(b, RAX, offsetof(SelThreadState, shared) + op->imm*sizeof(SelSharedValue));
+            emit_copy(b, RAX, offsetof(SelSharedValue, value), RBX, op->lhs, size);
+            emit_mov_imm64(b, RCX, (u64) ctx->env->frame);
+            emit_u8(b, 0x48); emit_u8(b, 0x8B); emit_u8(b, 0x09); // mov rcx, [rcx]
+            emit_store64(b, RAX, offsetof(SelSharedValue, frame), RCX);
+        } return true;
+
+        case OP_GLOBAL: {
+            emit_mov_imm64(b, RAX, (u64) &ctx->env->globals[op->imm]);
+            emit_copy(b, RBX, op->dst, RAX, 0, size);
+        } return true;
+
+        case OP_CONTEXT: {
+            static_assert(sizeof(SVMContext) == sizeof(u64), "");
+            emit_mov_imm64(b, RAX, (u64) ctx->exe->contexts[op->imm].shader);
+            jit_emit_thread_ptr(b, RCX, offsetof(SelThreadState, ctx));
+            emit_store64(b, RCX, 0, RAX);
+        } return true;
+
+        case OP_GUARD: {
+            /* stale if never computed, or if a source of change changed since */
+            const ExeExpr *e = ctx->exe->linked[op->imm];
+            u32 stale_at[SEL_N_DEPS + 1];
+            u32 n_stale = 0;
+            emit_mov_imm64(b, RAX, (u64) &e->computed_at);
+            emit_u8(b, 0x48); emit_u8(b, 0x8B); emit_u8(b, 0x08); // mov rcx, [rax]
+            emit_u8(b, 0x48); emit_u8(b, 0x85); emit_u8(b, 0xC9); // test rcx, rcx
+            emit_u8(b, 0x0F); emit_u8(b, 0x84);                   // jz stale
+            stale_at[n_stale++] = b->size;
+            emit_u32(b, 0);
+            for (u32 i = 0; i < SEL_N_DEPS; i++) {
+                if (!(e->deps & (1u << i))) {
+                    continue;
+                }
+                emit_mov_imm64(b, RDX, (u64) &ctx->env->changed_at[i]);
+                emit_u8(b, 0x48); emit_u8(b, 0x39); emit_u8(b, 0x0A); // cmp [rdx], rcx
+                emit_u8(b, 0x0F); emit_u8(b, 0x83);                   // jae stale
+                stale_at[n_stale++] = b->size;
+                emit_u32(b, 0);
+            }
+            emit_u8(b, 0xE9);                                         // jmp past the expression
+            ctx->patches[ctx->n_patches++] = (JitPatch) {.at = b->size, .op = index + op->rhs + 1};
+            emit_u32(b, 0);
+            jit_patch_here(b, stale_at, n_stale);
+            emit_mov_imm64(b, RCX, (u64) ctx->env->frame);
+            emit_u8(b, 0x48); emit_u8(b, 0x8B); emit_u8(b, 0x09); // mov rcx, [rcx]
+            emit_u8(b, 0x48); emit_u8(b, 0x89); emit_u8(b, 0x08); // mov [rax], rcx
+        } return true;
+
+        case OP_STAGE: {
+            /* compare 4 bytes at a time, and only copy and signal the value if it changed */
+            if (size % sizeof(u32) != 0) {
+                return false;
+            }
+            u32 changed_at[sizeof(SelValue) / sizeof(u32)];
+            u32 n_changed = 0;
+            for (u32 i = 0; i < size; i += sizeof(u32)) {
+                emit_load32(b, RAX, RBX, op->lhs + i);
+                emit_u8(b, 0x3B); emit_mem(b, RAX, RBX, op->dst + i); // cmp eax, [dst + i]
+                emit_u8(b, 0x0F); emit_u8(b, 0x85);                   // jne changed
+                changed_at[n_changed++] = b->size;
+                emit_u32(b, 0);
+            }
+            emit_u8(b, 0xE9);                                         // jmp unchanged
+            u32 unchanged_at = b->size;
+            emit_u32(b, 0);
+            jit_patch_here(b, changed_at, n_changed);
+            emit_copy(b, RBX, op->dst, RBX, op->lhs, size);
+            emit_mov_imm64(b, RAX, (u64) &ctx->env->changed_at[__builtin_ctz(SEL_DEP_UNIFORMS)]);
+            emit_mov_imm64(b, RCX, (u64) ctx->env->frame);
+            emit_u8(b, 0x48); emit_u8(b, 0x8B); emit_u8(b, 0x09); // mov rcx, [rcx]
+            emit_u8(b, 0x48); emit_u8(b, 0x89); emit_u8(b, 0x08); // mov [rax], rcx
+            jit_patch_here(b, &unchanged_at, 1);
+        } return true;
+
+        case OP_PUSH: return false;
+    }
+    return false;
+}
+
+/* Element-wise float ops. 16 bytes at a time with packed SSE, the rest with scalar SSE */
+static b8 jit_emit_f32_op(JitBuffer *b, u8 sse_op, const RegOp *op)
+{
+    u32 size = TYPE_TO_SIZE[op->type];
+
+    if (op->kind == OP_NEG) {
+        if (op->type == TYPE_FLOAT) {
+            emit_load32(b, RAX, RBX, op->lhs);
+            emit_u8(b, 0x35); emit_u32(b, 0x80000000); // xor eax, sign bit
+            emit_store32(b, RBX, op->dst, RAX);
+            return true;
+        }
+        /* vectors are negated as 0 - v, which differs from flipping the sign for 0 */
+        u32 i = 0;
+        for (; i + 16 <= size; i += 16) {
+            emit_sse_rr(b, SSE_PS, SSE_XOR, XMM0, XMM0);
+            emit_sse(b, SSE_PS, SSE_MOVLOAD, XMM1, RBX, op->lhs + i);
+            emit_sse_rr(b, SSE_PS, SSE_SUB, XMM0, XMM1);
+            emit_sse(b, SSE_PS, SSE_MOVSTOR, XMM0, RBX, op->dst + i);
+        }
+        for (; i < size; i += sizeof(f32)) {
+            emit_sse_rr(b, SSE_PS, SSE_XOR, XMM0, XMM0);
+            emit_sse(b, SSE_SS, SSE_SUB, XMM0, RBX, op->lhs + i);
+            emit_sse(b, SSE_SS, SSE_MOVSTOR, XMM0, RBX, op->dst + i);
+        }
+        return true;
+    }
+
+    if (op->kind == OP_DIV && op->type != TYPE_FLOAT) {
+        /* vectors are divided by multiplying with the reciprocal */
+        u32 i = 0;
+        if (size >= 16) {
+            emit_u8(b, 0xB8); emit_u32(b, 0x3F800000);                 // mov eax, 1.0f
+            emit_u8(b, 0x66); emit_u8(b, 0x0F); emit_u8(b, 0x6E); emit_u8(b, 0xD0); // movd xmm2, eax
+            emit_sse_rr(b, SSE_PS, SSE_SHUF, XMM2, XMM2);             // shufps xmm2, xmm2, 0
+            emit_u8(b, 0x00);
+        }
+        for (; i + 16 <= size; i += 16) {
+            emit_sse(b, SSE_PS, SSE_MOVLOAD, XMM1, RBX, op->rhs + i);
+            emit_sse_rr(b, SSE_PS, SSE_MOVAPS, XMM3, XMM2);
+            emit_sse_rr(b, SSE_PS, SSE_DIV, XMM3, XMM1);
+            emit_sse(b, SSE_PS, SSE_MOVLOAD, XMM0, RBX, op->lhs + i);
+            emit_sse_rr(b, SSE_PS, SSE_MUL, XMM0, XMM3);
+            emit_sse(b, SSE_PS, SSE_MOVSTOR, XMM0, RBX, op->dst + i);
+        }
+        for (; i < size; i += sizeof(f32)) {
+            emit_u8(b, 0xB8); emit_u32(b, 0x3F800000);                 // mov eax, 1.0f
+            emit_u8(b, 0x66); emit_u8(b, 0x0F); emit_u8(b, 0x6E); emit_u8(b, 0xC8); // movd xmm1, eax
+            emit_sse(b, SSE_SS, SSE_DIV, XMM1, RBX, op->rhs + i);
+            emit_sse(b, SSE_SS, SSE_MOVLOAD, XMM0, RBX, op->lhs + i);
+            emit_sse_rr(b, SSE_SS, SSE_MUL, XMM0, XMM1);
+            emit_sse(b, SSE_SS, SSE_MOVSTOR, XMM0, RBX, op->dst + i);
+        }
+        return true;
+    }
+
+    if (sse_op == 0) {
+        return false;
+    }
+
+    u32 i = 0;
+    for (; i + 16 <= size; i += 16) {
+        emit_sse(b, SSE_PS, SSE_MOVLOAD, XMM0, RBX, op->lhs + i);
+        emit_sse(b, SSE_PS, SSE_MOVLOAD, XMM1, RBX, op->rhs + i);
+        emit_sse_rr(b, SSE_PS, sse_op, XMM0, XMM1);
+        emit_sse(b, SSE_PS, SSE_MOVSTOR, XMM0, RBX, op->dst + i);
+    }
+    for (; i < size; i += sizeof(f32)) {
+        emit_sse(b, SSE_SS, SSE_MOVLOAD, XMM0, RBX, op->lhs + i);
+        emit_sse(b, SSE_SS, sse_op, XMM0, RBX, op->rhs + i);
+        emit_sse(b, SSE_SS, SSE_MOVSTOR, XMM0, RBX, op->dst + i);
+    }
+    return true;
+}
+
+/* 
+ * The product of two `mat4`: each column of `rhs` weights the columns of `lhs`, which are 
+ * summed in order like in the VM, without fused multiply-adds. The four columns of the 
+ * result are kept in xmm0-3 until all are done, as `dst` may overlap the operands.
+ */
+static void jit_emit_mat4_mul(JitBuffer *b, const RegOp *op)
+{
+    for (u32 j = 0; j < 4; j++) {
+        for (u32 k = 0; k < 4; k++) {
+            emit_sse(b, SSE_SS, SSE_MOVLOAD, XMM4, RBX, op->rhs + 16*j + 4*k);
+            emit_sse_rr(b, SSE_PS, SSE_SHUF, XMM4, XMM4);              // shufps xmm4, xmm4, 0
+            emit_u8(b, 0x00);
+            emit_sse(b, SSE_PS, SSE_MOVLOAD, XMM5, RBX, op->lhs + 16*k);
+            emit_sse_rr(b, SSE_PS, SSE_MUL, XMM5, XMM4);
+            emit_sse_rr(b, SSE_PS, (k == 0) ? SSE_MOVAPS : SSE_ADD, (u8) j, XMM5);
+        }
+    }
+    for (u32 j = 0; j < 4; j++) {
+        emit_sse(b, SSE_PS, SSE_MOVSTOR, (u8) j, RBX, op->dst + 16*j);
+    }
+}
+
+/* Component-wise int ops, one component at a time in eax */
+static b8 jit_emit_i32_op(JitBuffer *b, OpKind kind, const RegOp *op)
+{
+    u32 size = TYPE_TO_SIZE[op->type];
+    b8 is_unsigned = (op->type == TYPE_UINT);
+
+    for (u32 i = 0; i < size; i += sizeof(i32)) {
+        emit_load32(b, RAX, RBX, op->lhs + i);
+        switch (kind) {
+            case OP_ADD: emit_u8(b, 0x03); emit_mem(b, RAX, RBX, op->rhs + i); break;
+            case OP_SUB: emit_u8(b, 0x2B); emit_mem(b, RAX, RBX, op->rhs + i); break;
+            case OP_MUL: emit_u8(b, 0x0F); emit_u8(b, 0xAF); emit_mem(b, RAX, RBX, op->rhs + i); break;
+            case OP_NEG: emit_u8(b, 0xF7); emit_u8(b, 0xD8); break;
+            case OP_DIV:
+            case OP_REM: {
+                if (is_unsigned) {
+                    emit_u8(b, 0x31); emit_u8(b, 0xD2);              // xor edx, edx
+                    emit_u8(b, 0xF7); emit_mem(b, 6, RBX, op->rhs + i); // div dword [rhs]
+                } else {
+                    emit_u8(b, 0x99);                                // cdq
+                    emit_u8(b, 0xF7); emit_mem(b, 7, RBX, op->rhs + i); // idiv dword [rhs]
+                }
+            } break;
+            case OP_PUSH:
+            case OP_FUNC:
+            case OP_SWIZZLE:
+            case OP_EQ:
+            case OP_NE:
+            case OP_LT:
+            case OP_LE:
+            case OP_GT:
+            case OP_GE:
+            case OP_JUMP_IF_FALSE:
+            case OP_JUMP:
+            case OP_SHARED:
+            case OP_PUBLISH:
+            case OP_GLOBAL:
+            case OP_MOVE:
+            case OP_CONTEXT:
+            case OP_GUARD:
+            case OP_STAGE:
+                return false;
+        }
+        emit_store32(b, RBX, op->dst + i, (kind == OP_REM) ? RDX : RAX);
+    }
+    return true;
+}
+
+/* 
+ * Comparisons leave 1 or 0 in `dst`, like a bool. Floats are compared with ucomiss, 
+ * which sets ZF, PF, and CF for NaN: `a < b` is tested as `b > a`, so that above and 
+ * above-or-equal are false for NaN, and equality also checks the parity flag.
+ */
+static void jit_emit_compare(JitBuffer *b, const RegOp *op)
+{
+    if (op->lhs_type == TYPE_FLOAT) {
+        b8 swap = (op->kind == OP_LT) || (op->kind == OP_LE);
+        emit_sse(b, SSE_SS, SSE_MOVLOAD, XMM0, RBX, swap ? op->rhs : op->lhs);
+        emit_sse(b, SSE_PS, SSE_UCOMI, XMM0, RBX, swap ? op->lhs : op->rhs); // ucomiss xmm0, [m32]
+        switch (op->kind) {
+            case OP_EQ: {
+                emit_u8(b, 0x0F); emit_u8(b, 0x94); emit_u8(b, 0xC0); // sete al
+                emit_u8(b, 0x0F); emit_u8(b, 0x9B); emit_u8(b, 0xC1); // setnp cl
+                emit_u8(b, 0x20); emit_u8(b, 0xC8);                   // and al, cl
+            } break;
+            case OP_NE: {
+                emit_u8(b, 0x0F); emit_u8(b, 0x95); emit_u8(b, 0xC0); // setne al
+                emit_u8(b, 0x0F); emit_u8(b, 0x9A); emit_u8(b, 0xC1); // setp cl
+                emit_u8(b, 0x08); emit_u8(b, 0xC8);                   // or al, cl
+            } break;
+            case OP_LT:
+            case OP_GT: emit_u8(b, 0x0F); emit_u8(b, 0x97); emit_u8(b, 0xC0); break; // seta al
+            default:    emit_u8(b, 0x0F); emit_u8(b, 0x93); emit_u8(b, 0xC0); break; // setae al
+        }
+    } else {
+        /* setcc opcodes for EQ, NE, LT, LE, GT, GE */
+        static const u8 setcc_signed[6]   = {0x94, 0x95, 0x9C, 0x9E, 0x9F, 0x9D};
+        static const u8 setcc_unsigned[6] = {0x94, 0x95, 0x92, 0x96, 0x97, 0x93};
+        u32 i = op->kind - OP_EQ;
+        emit_load32(b, RAX, RBX, op->lhs);
+        emit_u8(b, 0x3B); emit_mem(b, RAX, RBX, op->rhs);                     // cmp eax, [rhs]
+        emit_u8(b, 0x0F);
+        emit_u8(b, (op->lhs_type == TYPE_UINT) ? setcc_unsigned[i] : setcc_signed[i]);
+        emit_u8(b, 0xC0);                                                     // setcc al
+    }
+    emit_u8(b, 0x0F); emit_u8(b, 0xB6); emit_u8(b, 0xC0);                     // movzx eax, al
+    emit_store32(b, RBX, op->dst, RAX);
+}
+
+/* Calls the builtin of `op`, which returns its SelValue at [rsp] */
+static void jit_emit_call(JitBuffer *b, const RegOp *op)
+{
+    emit_u8(b, 0x48); emit_u8(b, 0x8D); emit_mem(b, RSI, RBX, op->lhs); // lea rsi, [args]
+    emit_u8(b, 0x48); emit_u8(b, 0x89); emit_u8(b, 0xE7);              // mov rdi, rsp
+    emit_mov_imm64(b, RAX, (u64) BUILTIN_FUNCTIONS[op->imm].impl);
+    emit_u8(b, 0xFF); emit_u8(b, 0xD0);                                 // call rax
+}
+
+/* Loads the address of the member at `offset` in the state of the thread into `reg` */
+static void jit_emit_thread_ptr(JitBuffer *b, u8 reg, u32 offset)
+{
+    emit_load64(b, reg, RSP, JIT_FRAME_THREAD);                     // mov reg, [rsp + JIT_FRAME_THREAD]
+    emit_u8(b, 0x48); emit_u8(b, 0x8D); emit_mem(b, reg, reg, offset); // lea reg, [reg + offset]
+}
+
+/* Points the forward jumps, whose rel32 are at `at`, to the end of the code */
+static void jit_patch_here(JitBuffer *b, const u32 *at, u32 n)
+{
+    if (b->overflow) {
+        return;
+    }
+    for (u32 i = 0; i < n; i++) {
+        u32 rel = b->size - (at[i] + sizeof(u32));
+        memcpy(&b->code[at[i]], &rel, sizeof(u32));
+    }
+}
+
+static void emit_u8(JitBuffer *b, u8 v)
+{
+    if (b->size >= b->capacity) {
+        b->overflow = true;
+        return;
+    }
+    b->code[b->size++] = v;
+}
+
+static void emit_u32(JitBuffer *b, u32 v)
+{
+    for (u32 i = 0; i < 4; i++) {
+        emit_u8(b, (u8)(v >> (8*i)));
+    }
+}
+
+static void emit_u64(JitBuffer *b, u64 v)
+{
+    emit_u32(b, (u32) v);
+    emit_u32(b, (u32)(v >> 32));
+}
+
+/* ModRM (and SIB) for [base + disp32] */
+static void emit_mem(JitBuffer *b, u8 reg, u8 base, u32 disp)
+{
+    emit_u8(b, (u8)(0x80 | (reg << 3) | base));
+    if (base == RSP) {
+        emit_u8(b, 0x24);
+    }
+    emit_u32(b, disp);
+}
+
+static void emit_load32(JitBuffer *b, u8 reg, u8 base, u32 disp)
+{
+    emit_u8(b, 0x8B);
+    emit_mem(b, reg, base, disp);
+}
+
+static void emit_store32(JitBuffer *b, u8 base, u32 disp, u8 reg)
+{
+    emit_u8(b, 0x89);
+    emit_mem(b, reg, base, disp);
+}
+
+static void emit_load64(JitBuffer *b, u8 reg, u8 base, u32 disp)
+{
+    emit_u8(b, 0x48);
+    emit_load32(b, reg, base, disp);
+}
+
+static void emit_store64(JitBuffer *b, u8 base, u32 disp, u8 reg)
+{
+    emit_u8(b, 0x48);
+    emit_store32(b, base, disp, reg);
+}
+
+static void emit_mov_imm64(JitBuffer *b, u8 reg, u64 imm)
+{
+    emit_u8(b, 0x48);
+    emit_u8(b, (u8)(0xB8 + reg));
+    emit_u64(b, imm);
+}
+
+static void emit_sse(JitBuffer *b, u8 prefix, u8 opcode, u8 xmm, u8 base, u32 disp)
+{
+    if (prefix != SSE_PS) {
+        emit_u8(b, prefix);
+    }
+    emit_u8(b, 0x0F);
+    emit_u8(b, opcode);
+    emit_mem(b, xmm, base, disp);
+}
+
+static void emit_sse_rr(JitBuffer *b, u8 prefix, u8 opcode, u8 dst, u8 src)
+{
+    if (prefix != SSE_PS) {
+        emit_u8(b, prefix);
+    }
+    emit_u8(b, 0x0F);
+    emit_u8(b, opcode);
+    emit_u8(b, (u8)(0xC0 | (dst << 3) | src));
+}
+
+/* 
+ * Copies `size` bytes through xmm0 and rcx. Sizes are always a multiple of 4. Vectors 
+ * are copied whole, so that later vector loads of them can be forwarded from the store.
+ */
+static void emit_copy(JitBuffer *b, u8 dst_base, u32 dst, u8 src_base, u32 src, u32 size)
+{
+    u32 i = 0;
+    for (; i + 16 <= size; i += 16) {
+        emit_sse(b, SSE_PS, SSE_MOVLOAD, XMM0, src_base, src + i);
+        emit_sse(b, SSE_PS, SSE_MOVSTOR, XMM0, dst_base, dst + i);
+    }
+    for (; i + 8 <= size; i += 8) {
+        emit_load64(b, RCX, src_base, src + i);
+        emit_store64(b, dst_base, dst + i, RCX);
+    }
+    for (; i < size; i += 4) {
+        emit_load32(b, RCX, src_base, src + i);
+        emit_store32(b, dst_base, dst + i, RCX);
+    }
+}
+
+#endif /* JIT_ENABLED */
+
@@ -8,23 +8,230 @@
 #include "log.h" // ???
 
 #include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#   include <immintrin.h>
+#endif
 
 /*--- Private macros --------------------------------------------------------------------*/
 
-#define SVM_STACK_SIZE (16*1024)
+#define SVM_BATCH_VECTOR_WIDTH 8 // lanes per vector. 8 floats fill an AVX2 register
+#define SVM_BATCH_N_VECTORS 4     // vectors per instruction, to spread the cost of dispatch
+#define SVM_BATCH_WIDTH (SVM_BATCH_N_VECTORS * SVM_BATCH_VECTOR_WIDTH)
+#define SVM_BATCH_MAX_N_OVERRIDES 8
+#define SVM_BATCH_MAX_REGS_SIZE (16*1024)
+
+/* 
+ * The vector kernels use SSE, and AVX where available, but fall back to hglm. Either 
+ * way they compute the same bits as the scalar functions of hglm. 
+ */
+#ifdef __SSE2__
+#   define SVM_SIMD 1
+#else
+#   define SVM_SIMD 0
+#endif
+
+/* 
+ * Handlers of the register VM instructions listed in `SEL_REG_OPS` (sel.h). Registers 
+ * are packed, so operands are copied to and from properly aligned locals. The copies 
+ * have a constant size and compile to plain (unaligned) loads and stores. Note that 
+ * e.g. `Mat3` is padded, and larger than its `TYPE_TO_SIZE`.
+ */
+#define REG_BINOP(type_, T_, fn_)                                               \
+    do {                                                                        \
+        T_ a_, b_, r_;                                                          \
+        memcpy(&a_, &regs[op->lhs], TYPE_TO_SIZE[type_]);                       \
+        memcpy(&b_, &regs[op->rhs], TYPE_TO_SIZE[type_]);                       \
+        r_ = fn_(&a_, &b_);                                                     \
+        memcpy(&regs[op->dst], &r_, TYPE_TO_SIZE[type_]);                       \
+    } while (0)
+
+#define REG_UNOP(type_, T_, fn_)                                                \
+    do {                                                                        \
+        T_ a_, r_;                                                              \
+        memcpy(&a_, &regs[op->lhs], TYPE_TO_SIZE[type_]);                       \
+        r_ = fn_(&a_);                                                          \
+        memcpy(&regs[op->dst], &r_, TYPE_TO_SIZE[type_]);                       \
+    } while (0)
+
+/* `type_` is the type of the operands. The result is a bool */
+#define REG_COMPARE(type_, T_, fn_)                                             \
+    do {                                                                        \
+        T_ a_, b_;                                                              \
+        memcpy(&a_, &regs[op->lhs], TYPE_TO_SIZE[type_]);                       \
+        memcpy(&b_, &regs[op->rhs], TYPE_TO_SIZE[type_]);                       \
+        i32 r_ = fn_(&a_, &b_);                                                 \
+        memcpy(&regs[op->dst], &r_, sizeof(r_));                                \
+    } while (0)
+
+/* float and int components are both 4 bytes; only the bits are moved */
+#define REG_SWIZZLE(type_, T_, fn_)                                             \
+    do {                                                                        \
+        u32 c_[4];                                                              \
+        for (u32 i_ = 0; i_ < TYPE_TO_SIZE[type_] / sizeof(u32); i_++) {        \
+            u32 index_ = (op->imm >> (8*i_)) & 0xFF;                            \
+            memcpy(&c_[i_], &regs[op->lhs + index_*sizeof(u32)], sizeof(u32));  \
+        }                                                                       \
+        memcpy(&regs[op->dst], c_, TYPE_TO_SIZE[type_]);                        \
+    } while (0)
+
+#define REG_CALL(type_, T_, fn_)                                                \
+    do {                                                                        \
+        SelValue v_ = (BUILTIN_FUNCTIONS[op->imm].impl)(&regs[op->lhs]);        \
+        memcpy(&regs[op->dst], &v_, TYPE_TO_SIZE[type_]);                       \
+    } while (0)
+
+#define REG_MOVE(type_, T_, fn_)                                                \
+    memcpy(&regs[op->dst], &regs[op->lhs], TYPE_TO_SIZE[type_])
+
+/* Only the taken branch of a conditional is run */
+#define REG_JUMP_IF_FALSE(type_, T_, fn_)                                       \
+    do {                                                                        \
+        i32 cond_;                                                              \
+        memcpy(&cond_, &regs[op->lhs], sizeof(cond_));                          \
+        if (!cond_) {                                                           \
+            op += op->rhs;                                                      \
+        }                                                                       \
+    } while (0)
+
+#define REG_JUMP(type_, T_, fn_)                                                \
+    op += op->rhs
+
+#define REG_SHARED(type_, T_, fn_)                                              \
+    do {                                                                        \
+        if (svm_thread.state.shared[op->imm].frame == svm.frame) {              \
+            reg_copy(&regs[op->dst], &svm_thread.state.shared[op->imm].value,   \
+                     TYPE_TO_SIZE[op->type]);                                   \
+            op += op->rhs;                                                      \
+        }                                                                       \
+    } while (0)
+
+#define REG_PUBLISH(type_, T_, fn_)                                             \
+    do {                                                                        \
+        reg_copy(&svm_thread.state.shared[op->imm].value, &regs[op->lhs],       \
+                 TYPE_TO_SIZE[op->type]);                                       \
+        svm_thread.state.shared[op->imm].frame = svm.frame;                     \
+    } while (0)
+
+#define REG_GLOBAL(type_, T_, fn_)                                              \
+    reg_copy(&regs[op->dst], &svm.globals[op->imm], TYPE_TO_SIZE[op->type])
+
+/* Frame programs switch between the contexts of their expressions */
+#define REG_CONTEXT(type_, T_, fn_)                                             \
+    svm_thread.state.ctx = exe->contexts[op->imm]
+
+/* ... and skip the expressions none of whose sources of change have changed */
+#define REG_GUARD(type_, T_, fn_)                                               \
+    do {                                                                        \
+        ExeExpr *e_ = exe->linked[op->imm];                                     \
+        if (svm_is_stale(e_)) {                                                 \
+            e_->computed_at = svm.frame;                                        \
+        } else {                                                                \
+            op += op->rhs;                                                      \
+        }                                                                       \
+    } while (0)
+
+/* Moves a value to the staging area of a frame program. Changes are signaled to copy_*() */
+#define REG_STAGE(type_, T_, fn_)                                               \
+    do {                                                                        \
+        u32 size_ = TYPE_TO_SIZE[op->type];                                     \
+        if (memcmp(&regs[op->dst], &regs[op->lhs], size_) != 0) {               \
+            memcpy(&regs[op->dst], &regs[op->lhs], size_);                      \
+            sel_signal(SEL_DEP_UNIFORMS);                                       \
+        }                                                                       \
+    } while (0)
+
+/* Calls a `FUNC_FLAG_MEMO` builtin, unless its arguments are those of the last call */
+#define REG_MEMO(type_, T_, fn_)                                                \
+    reg_memo_call(regs, op)
+
+/* Calls a `FUNC_FLAG_STATE` builtin on its state, unless it was called in this frame already */
+#define REG_STATE(type_, T_, fn_)                                               \
+    reg_state_call(regs, op)
+
+/* Superinstructions. `fn` must be commutative where the fused operand may be either side */
+#define REG_MOVE_BLOCK(type_, T_, fn_)                                          \
+    memcpy(&regs[op->dst], &regs[op->lhs], op->rhs)
+
+#define REG_CALL_BINOP(type_, T_, fn_)                                          \
+    do {                                                                        \
+        SelValue v_ = (BUILTIN_FUNCTIONS[op->imm].impl)(&regs[op->lhs]);        \
+        T_ a_, b_, r_;                                                          \
+        memcpy(&a_, &v_, TYPE_TO_SIZE[type_]);                                  \
+        memcpy(&b_, &regs[op->rhs], TYPE_TO_SIZE[type_]);                       \
+        r_ = fn_(&a_, &b_);                                                     \
+        memcpy(&regs[op->dst], &r_, TYPE_TO_SIZE[type_]);                       \
+    } while (0)
+
+#define REG_MUL_BINOP(type_, T_, fn_)                                           \
+    do {                                                                        \
+        T_ a_, b_, c_, m_, r_;                                                  \
+        memcpy(&a_, &regs[op->lhs], TYPE_TO_SIZE[type_]);                       \
+        memcpy(&b_, &regs[op->rhs], TYPE_TO_SIZE[type_]);                       \
+        memcpy(&c_, &regs[op->imm], TYPE_TO_SIZE[type_]);                       \
+        m_ = mulf(&a_, &b_);                                                    \
+        r_ = fn_(&m_, &c_);                                                     \
+        memcpy(&regs[op->dst], &r_, TYPE_TO_SIZE[type_]);                       \
+    } while (0)
 
 /*--- Private type definitions ----------------------------------------------------------*/
 
+/* 
+ * The state of a call site of a `FUNC_FLAG_STATE` builtin (see `sel_claim_state()`). 
+ * Kept outside the arenas, so that it outlives the expression over a reload.
+ */
+typedef struct
+{
+    u64 site;
+    const ExeExpr *owner; // of the claim, or NULL if never claimed
+    u32 session;          // of the claim
+    u64 frame;            // of the last call, or 0
+    Vec4 result;          // of the last call
+    f32 values[8];        // kept by the builtin from call to call
+} SelState;
+
+/* 
+ * One 4-byte word of a register, in every lane of a batch. The arithmetic on these 
+ * compiles to vector instructions (AVX2 with -march=native on x86-64).
+ */
+typedef f32 SvmLanesF32 __attribute__((vector_size(SVM_BATCH_VECTOR_WIDTH * sizeof(f32))));
+typedef u32 SvmLanesU32 __attribute__((vector_size(SVM_BATCH_VECTOR_WIDTH * sizeof(u32))));
+typedef union
+{
+    SvmLanesF32 f[SVM_BATCH_N_VECTORS];
+    SvmLanesU32 u[SVM_BATCH_N_VECTORS];
+    u32 lane[SVM_BATCH_WIDTH];
+} SvmLanes;
+
 /*--- Private function prototypes -------------------------------------------------------*/
 
 static void svm_run(void);
+static void svm_compile_if_hot(ExeExpr *exe);
+static void svm_execute(const ExeExpr *exe);
+static void *svm_worker_main(void *arg);
+static b8 svm_is_stale(const ExeExpr *exe);
+static void svm_run_registers(const ExeExpr *exe);
+static inline void reg_copy(void *dst, const void *src, u32 size);
+static void reg_memo_call(u8 *regs, const RegOp *op);
+static void reg_state_call(u8 *regs, const RegOp *op);
+static SelState *svm_call_state(void);
 static void svm_reset(void);
+static void svm_batch_run(const RegOp *op, const RegOp *end);
+static void svm_batch_arithmetic(const RegOp *op, SvmLanes *tmp);
+static void svm_batch_compare(const RegOp *op);
+static void svm_batch_call(const RegOp *op, SvmLanes *result);
+static void svm_batch_per_lane(const RegOp *op);
+static b8 svm_batch_is_lanewise(const RegOp *op);
+static inline SvmLanes *svm_batch_reg(u32 offset);
 
 static inline void *svm_next_bytes(u32 size);
 static inline Op *svm_next_op(void);
 static inline void svm_stack_push(void *data, u32 size);
 static inline void svm_stack_push_selvalue(SelValue v, Type t);
 static inline void *svm_stack_pop(u32 size);
+static inline SelValue svm_stack_pop_value(u32 size);
+static i32 svm_rand(void);
 static inline i32 addi(i32 *lhs, i32 *rhs);
 static inline u32 addu(u32 *lhs, u32 *rhs);
 static inline f32 addf(f32 *lhs, f32 *rhs);
@@ -80,13 +287,64 @@ static inline Vec4 negv4(Vec4 *val);
 static inline IVec2 negiv2(IVec2 *val);
 static inline IVec3 negiv3(IVec3 *val);
 static inline IVec4 negiv4(IVec4 *val);
+static inline i32 eqi(i32 *lhs, i32 *rhs);
+static inline i32 equ(u32 *lhs, u32 *rhs);
+static inline i32 eqf(f32 *lhs, f32 *rhs);
+static inline i32 nei(i32 *lhs, i32 *rhs);
+static inline i32 neu(u32 *lhs, u32 *rhs);
+static inline i32 nef(f32 *lhs, f32 *rhs);
+static inline i32 lti(i32 *lhs, i32 *rhs);
+static inline i32 ltu(u32 *lhs, u32 *rhs);
+static inline i32 ltf(f32 *lhs, f32 *rhs);
+static inline i32 lei(i32 *lhs, i32 *rhs);
+static inline i32 leu(u32 *lhs, u32 *rhs);
+static inline i32 lef(f32 *lhs, f32 *rhs);
+static inline i32 gti(i32 *lhs, i32 *rhs);
+static inline i32 gtu(u32 *lhs, u32 *rhs);
+static inline i32 gtf(f32 *lhs, f32 *rhs);
+static inline i32 gei(i32 *lhs, i32 *rhs);
+static inline i32 geu(u32 *lhs, u32 *rhs);
+static inline i32 gef(f32 *lhs, f32 *rhs);
+
+static inline Vec4 svm_vec4_add(const void *a, const void *b);
+static inline Vec4 svm_vec4_sub(const void *a, const void *b);
+static inline Vec4 svm_vec4_mul(const void *a, const void *b);
+static inline Vec4 svm_vec4_div(const void *a, const void *b);
+static inline Vec4 svm_vec4_neg(const void *v);
+static inline Vec4 svm_vec4_mul_scalar(const void *v, f32 s);
+static inline Vec4 svm_vec4_lerp(const void *a, const void *b, f32 t);
+static inline f32 svm_vec4_dot(const void *a, const void *b);
+static inline f32 svm_vec4_len(const void *v);
+static inline f32 svm_vec4_distance(const void *a, const void *b);
+static inline Vec4 svm_vec4_normalize(const void *v);
+static inline Mat2 svm_mat2_add(const void *a, const void *b);
+static inline Mat2 svm_mat2_sub(const void *a, const void *b);
+static inline Mat4 svm_mat4_add(const void *a, const void *b);
+static inline Mat4 svm_mat4_sub(const void *a, const void *b);
+static inline Mat4 svm_mat4_mul_scalar(const void *m, f32 s);
+static inline Vec4 svm_mat4_mul_vec4(const void *m, const void *v);
+static inline Mat4 svm_mat4_mul_mat4(const void *a, const void *b);
+static inline Mat4 svm_mat4_scale(const void *m, const void *v);
+static inline Mat4 svm_mat4_translate(const void *m, const void *v);
 
 static SelValue fn_load_image_(void *args);
 static SelValue fn_load_image_ex_(void *args);
 static SelValue fn_output_of_(void *args);
 static SelValue fn_output_of_ex_(void *args);
+static SelValue fn_output_of_n_(void *args);
 static SelValue fn_last_output_of_(void *args);
 static SelValue fn_last_output_of_ex_(void *args);
+static SelValue fn_last_output_of_n_(void *args);
+static SelValue fn_load_image_linked_(void *args);
+static SelValue fn_load_image_ex_linked_(void *args);
+static SelValue fn_output_of_linked_(void *args);
+static SelValue fn_output_of_ex_linked_(void *args);
+static SelValue fn_output_of_n_linked_(void *args);
+static SelValue fn_last_output_of_linked_(void *args);
+static SelValue fn_last_output_of_ex_linked_(void *args);
+static SelValue fn_last_output_of_n_linked_(void *args);
+static SelValue shader_output_(i32 sid, TextureKind kind, i32 filter, i32 wrap, i32 output);
+static SelValue loaded_texture_(i32 id, i32 filter, i32 wrap);
 
 static SelValue fn_left_mouse_button_is_down_(void *args);
 static SelValue fn_right_mouse_button_is_down_(void *args);
@@ -104,6 +362,7 @@ static SelValue fn_maxi_(void *args);
 static SelValue fn_randi_(void *args);
 static SelValue fn_iota_(void *args);
 static SelValue fn_frame_count_(void *args);
+static SelValue fn_index_(void *args);
 
 static SelValue fn_signed_(void *args);
 static SelValue fn_xor_(void *args);
@@ -184,7 +443,10 @@ static SelValue fn_rgba_(void *args);
 static SelValue fn_ivec2_(void *args);
 static SelValue fn_viewport_resolution_(void *args);
 static SelValue fn_resolution_of_(void *args);
+static SelValue fn_resolution_of_linked_(void *args);
 static SelValue fn_resolution_(void *args);
+static SelValue fn_output_resolution_(void *args);
+static SelValue fn_tile_offset_(void *args);
 
 static SelValue fn_ivec3_(void *args);
 
@@ -219,6 +481,28 @@ static SelValue fn_input_vec2_(void *args);
 static SelValue fn_input_vec3_(void *args);
 static SelValue fn_input_vec4_(void *args);
 static SelValue fn_color_picker_(void *args);
+static SelValue fn_widget_linked_(void *args);
+
+static SelValue fn_smooth_(void *args);
+static SelValue fn_smooth_vec2_(void *args);
+static SelValue fn_smooth_vec3_(void *args);
+static SelValue fn_smooth_vec4_(void *args);
+static SelValue fn_integrate_(void *args);
+static SelValue fn_integrate_vec2_(void *args);
+static SelValue fn_integrate_vec3_(void *args);
+static SelValue fn_integrate_vec4_(void *args);
+static SelValue fn_prev_(void *args);
+static SelValue fn_prev_vec2_(void *args);
+static SelValue fn_prev_vec3_(void *args);
+static SelValue fn_prev_vec4_(void *args);
+static SelValue fn_spring_(void *args);
+static SelValue fn_spring_vec2_(void *args);
+static SelValue fn_spring_vec3_(void *args);
+static SelValue fn_counter_(void *args);
+static SelValue state_smooth_(const f32 *args, u32 n);
+static SelValue state_integrate_(const f32 *args, u32 n);
+static SelValue state_prev_(const void *args, u32 n);
+static SelValue state_spring_(const f32 *args, u32 n);
 
 static SelValue fn_copy_bool_(void *args);
 static SelValue fn_copy_int_(void *args);
@@ -233,34 +517,53 @@ static SelValue fn_copy_ivec4_(void *args);
 static SelValue fn_copy_mat2_(void *args);
 static SelValue fn_copy_mat3_(void *args);
 static SelValue fn_copy_mat4_(void *args);
+static SelValue fn_copy_linked_(void *args);
+
+static b8 link_texture_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_shader_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_uniform_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_widget_(const Func *f, const SelValue *const *args, i32 *handles, WidgetKind kind, u32 secondary_args_size);
+static b8 link_input_float_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_checkbox_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_drag_int_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_slider_float_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_slider_float_log_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_input_int_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_input_vec2_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_input_vec3_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_input_vec4_(const Func *f, const SelValue *const *args, i32 *handles);
+static b8 link_color_picker_(const Func *f, const SelValue *const *args, i32 *handles);
 
 /*--- Public variables ------------------------------------------------------------------*/
 
 const Func BUILTIN_FUNCTIONS[] = 
 {
-    { .id = SV_LIT("load_image"),        .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_load_image_,        .argtypes = {TYPE_STR, TYPE_NIL}, .synopsis = "texture load_image(str filepath)", .desc = "Returns a reference to a texture loaded from `filepath`", },
-    { .id = SV_LIT("load_image_ex"),     .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_load_image_ex_,     .argtypes = {TYPE_STR, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "texture load_image_ex(str filepath, i32 filter, i32 wrap)", .desc = "Returns a reference to a texture loaded from `filepath` with the given filter and wrap mode", },
-    { .id = SV_LIT("output_of"),         .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_output_of_,         .argtypes = {TYPE_STR, TYPE_NIL}, .synopsis = "texture output_of(str shader)", .desc = "Returns a reference to a texture rendered to by the shader `shader` in this frame. Calling this function implicitly defines the render order.", },
-    { .id = SV_LIT("output_of_ex"),      .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_output_of_ex_,      .argtypes = {TYPE_STR, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "texture output_of_ex(str shader, i32 filter, i32 wrap)", .desc = "Returns a reference to a texture rendered to by the shader `shader` in this frame with the given filter and wrap mode. Calling this function implicitly defines the render order.", },
-    { .id = SV_LIT("last_output_of"),    .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_last_output_of_,    .argtypes = {TYPE_STR, TYPE_NIL}, .synopsis = "texture last_output_of(str shader)", .desc = "Returns a reference to a texture rendered to by the shader `shader` in the last frame.", },
-    { .id = SV_LIT("last_output_of_ex"), .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_last_output_of_ex_, .argtypes = {TYPE_STR, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "texture last_output_of_ex(str shader, i32 filter, i32 wrap)", .desc = "Returns a reference to a texture rendered to by the shader `shader` in the last frame with the given filter and wrap mode.", },
-
-    { .id = SV_LIT("left_mouse_button_is_down"),      .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_left_mouse_button_is_down_, .argtypes = {TYPE_NIL},      .synopsis = "bool left_mouse_button_is_down()", .desc = "Returns true if the left mouse button is currently down", },
-    { .id = SV_LIT("right_mouse_button_is_down"),     .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_right_mouse_button_is_down_, .argtypes = {TYPE_NIL},     .synopsis = "bool right_mouse_button_is_down()", .desc = "Returns true if the right mouse button is currently down", },
-    { .id = SV_LIT("left_mouse_button_was_clicked"),  .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_left_mouse_button_was_clicked_, .argtypes = {TYPE_NIL},  .synopsis = "bool left_mouse_button_was_clicked()", .desc = "Returns true if the left mouse button was pressed in the last frame.", },
-    { .id = SV_LIT("right_mouse_button_was_clicked"), .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_right_mouse_button_was_clicked_, .argtypes = {TYPE_NIL}, .synopsis = "bool right_mouse_button_was_clicked()", .desc = "Returns true if the right mouse button was pressed in the last frame.", },
-    { .id = SV_LIT("key_is_down"),                    .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_key_is_down_, .argtypes = {TYPE_STR, TYPE_NIL}, .synopsis = "bool key_is_down(str key)", .desc = "Returns true if `key` is down. `key` can be any letter in the English alphabet.", },
-    { .id = SV_LIT("key_was_pressed"),                .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_key_was_pressed_, .argtypes = {TYPE_STR, TYPE_NIL}, .synopsis = "bool key_was_pressed(str key)", .desc = "Returns true if `key` was pressed . `key` can be any letter in the English alphabet.", },
-    { .id = SV_LIT("shaq_reloaded_this_frame"),       .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_shaq_reloaded_this_frame_, .argtypes = {TYPE_NIL}, .synopsis = "bool shaq_reloaded_this_frame()", .desc = "Returns true if Shaq performed an internal reload operation this frame.", },
-    { .id = SV_LIT("shaq_reloaded_last_frame"),       .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_shaq_reloaded_last_frame_, .argtypes = {TYPE_NIL}, .synopsis = "bool shaq_reloaded_last_frame()", .desc = "Returns true if Shaq performed an internal reload operation last frame.", },
+    { .id = SV_LIT("load_image"),        .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_load_image_,        .argtypes = {TYPE_STR, TYPE_NIL}, .synopsis = "texture load_image(str filepath)", .desc = "Returns a reference to a texture loaded from `filepath`", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_MAIN, .link = link_texture_, },
+    { .id = SV_LIT("load_image_ex"),     .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_load_image_ex_,     .argtypes = {TYPE_STR, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "texture load_image_ex(str filepath, i32 filter, i32 wrap)", .desc = "Returns a reference to a texture loaded from `filepath` with the given filter and wrap mode", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_MAIN, .link = link_texture_, },
+    { .id = SV_LIT("output_of"),         .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_output_of_,         .argtypes = {TYPE_STR, TYPE_NIL}, .synopsis = "texture output_of(str shader)", .desc = "Returns a reference to a texture rendered to by the shader `shader` in this frame. Calling this function implicitly defines the render order.", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_CONTEXT, .link = link_shader_, },
+    { .id = SV_LIT("output_of_ex"),      .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_output_of_ex_,      .argtypes = {TYPE_STR, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "texture output_of_ex(str shader, i32 filter, i32 wrap)", .desc = "Returns a reference to a texture rendered to by the shader `shader` in this frame with the given filter and wrap mode. Calling this function implicitly defines the render order.", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_CONTEXT, .link = link_shader_, },
+    { .id = SV_LIT("output_of"),         .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_output_of_n_,       .argtypes = {TYPE_STR, TYPE_INT, TYPE_NIL}, .synopsis = "texture output_of(str shader, int output)", .desc = "Returns a reference to the texture rendered to output number `output` of the shader `shader` in this frame. See the `outputs` attribute.", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_CONTEXT, .link = link_shader_, },
+    { .id = SV_LIT("last_output_of"),    .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_last_output_of_,    .argtypes = {TYPE_STR, TYPE_NIL}, .synopsis = "texture last_output_of(str shader)", .desc = "Returns a reference to a texture rendered to by the shader `shader` in the last frame.", .flags = FUNC_FLAG_SESSION, .link = link_shader_, },
+    { .id = SV_LIT("last_output_of"),    .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_last_output_of_n_,  .argtypes = {TYPE_STR, TYPE_INT, TYPE_NIL}, .synopsis = "texture last_output_of(str shader, int output)", .desc = "Returns a reference to the texture rendered to output number `output` of the shader `shader` in the last frame. See the `outputs` attribute.", .flags = FUNC_FLAG_SESSION, .link = link_shader_, },
+    { .id = SV_LIT("last_output_of_ex"), .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_last_output_of_ex_, .argtypes = {TYPE_STR, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "texture last_output_of_ex(str shader, i32 filter, i32 wrap)", .desc = "Returns a reference to a texture rendered to by the shader `shader` in the last frame with the given filter and wrap mode.", .flags = FUNC_FLAG_SESSION, .link = link_shader_, },
+
+    { .id = SV_LIT("left_mouse_button_is_down"),      .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_left_mouse_button_is_down_, .argtypes = {TYPE_NIL},      .synopsis = "bool left_mouse_button_is_down()", .desc = "Returns true if the left mouse button is currently down", .deps = SEL_DEP_MOUSE, },
+    { .id = SV_LIT("right_mouse_button_is_down"),     .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_right_mouse_button_is_down_, .argtypes = {TYPE_NIL},     .synopsis = "bool right_mouse_button_is_down()", .desc = "Returns true if the right mouse button is currently down", .deps = SEL_DEP_MOUSE, },
+    { .id = SV_LIT("left_mouse_button_was_clicked"),  .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_left_mouse_button_was_clicked_, .argtypes = {TYPE_NIL},  .synopsis = "bool left_mouse_button_was_clicked()", .desc = "Returns true if the left mouse button was pressed in the last frame.", .deps = SEL_DEP_MOUSE, },
+    { .id = SV_LIT("right_mouse_button_was_clicked"), .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_right_mouse_button_was_clicked_, .argtypes = {TYPE_NIL}, .synopsis = "bool right_mouse_button_was_clicked()", .desc = "Returns true if the right mouse button was pressed in the last frame.", .deps = SEL_DEP_MOUSE, },
+    { .id = SV_LIT("key_is_down"),                    .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_key_is_down_, .argtypes = {TYPE_STR, TYPE_NIL}, .synopsis = "bool key_is_down(str key)", .desc = "Returns true if `key` is down. `key` can be any letter in the English alphabet.", .deps = SEL_DEP_KEYBOARD, },
+    { .id = SV_LIT("key_was_pressed"),                .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_key_was_pressed_, .argtypes = {TYPE_STR, TYPE_NIL}, .synopsis = "bool key_was_pressed(str key)", .desc = "Returns true if `key` was pressed . `key` can be any letter in the English alphabet.", .deps = SEL_DEP_KEYBOARD, },
+    { .id = SV_LIT("shaq_reloaded_this_frame"),       .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_shaq_reloaded_this_frame_, .argtypes = {TYPE_NIL}, .synopsis = "bool shaq_reloaded_this_frame()", .desc = "Returns true if Shaq performed an internal reload operation this frame.", .deps = SEL_DEP_RELOAD, },
+    { .id = SV_LIT("shaq_reloaded_last_frame"),       .type = TYPE_BOOL, .qualifier = QUALIFIER_NONE, .impl = fn_shaq_reloaded_last_frame_, .argtypes = {TYPE_NIL}, .synopsis = "bool shaq_reloaded_last_frame()", .desc = "Returns true if Shaq performed an internal reload operation last frame.", .deps = SEL_DEP_RELOAD, },
 
     { .id = SV_LIT("int"),           .type = TYPE_INT,  .qualifier = QUALIFIER_PURE, .impl = fn_int_,           .argtypes = {TYPE_FLOAT, TYPE_NIL},          .synopsis = "int int(float x)", .desc = "Typecast float to int.", },
     { .id = SV_LIT("unsigned"),      .type = TYPE_UINT, .qualifier = QUALIFIER_PURE, .impl = fn_unsigned_,      .argtypes = {TYPE_INT, TYPE_NIL},            .synopsis = "uint unsigned(int x)", .desc = "Typecast int to uint.", },
     { .id = SV_LIT("mini"),          .type = TYPE_INT,  .qualifier = QUALIFIER_PURE, .impl = fn_mini_,          .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},  .synopsis = "int mini(int a, int b)", .desc = "Returns the minimum of `a` and `b`.", },
     { .id = SV_LIT("maxi"),          .type = TYPE_INT,  .qualifier = QUALIFIER_PURE, .impl = fn_maxi_,          .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},  .synopsis = "int maxi(int a, int b)", .desc = "Returns the maximum of `a` and `b`.", },
-    { .id = SV_LIT("randi"),         .type = TYPE_INT,  .qualifier = QUALIFIER_NONE, .impl = fn_randi_,         .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},  .synopsis = "int randi(int min, int max)", .desc = "Returns a random number in [`min`, `max`].", },
-    { .id = SV_LIT("iota"),          .type = TYPE_INT,  .qualifier = QUALIFIER_NONE, .impl = fn_iota_,          .argtypes = {TYPE_NIL},                      .synopsis = "int iota()", .desc = "Returns the number of times it's been called. See the `iota` in golang.", },
-    { .id = SV_LIT("frame_count"),   .type = TYPE_INT,  .qualifier = QUALIFIER_NONE, .impl = fn_frame_count_,   .argtypes = {TYPE_NIL},                      .synopsis = "int frame_count()", .desc = "Returns the frame count.", },
+    { .id = SV_LIT("randi"),         .type = TYPE_INT,  .qualifier = QUALIFIER_NONE, .impl = fn_randi_,         .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},  .synopsis = "int randi(int min, int max)", .desc = "Returns a random number in [`min`, `max`].", .flags = FUNC_FLAG_VOLATILE, .deps = SEL_DEP_FRAME, .cost = 10, },
+    { .id = SV_LIT("iota"),          .type = TYPE_INT,  .qualifier = QUALIFIER_NONE, .impl = fn_iota_,          .argtypes = {TYPE_NIL},                      .synopsis = "int iota()", .desc = "Returns the number of times it's been called. See the `iota` in golang.", .flags = FUNC_FLAG_VOLATILE | FUNC_FLAG_MAIN, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("frame_count"),   .type = TYPE_INT,  .qualifier = QUALIFIER_NONE, .impl = fn_frame_count_,   .argtypes = {TYPE_NIL},                      .synopsis = "int frame_count()", .desc = "Returns the frame count.", .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("index"),         .type = TYPE_INT,  .qualifier = QUALIFIER_NONE, .impl = fn_index_,         .argtypes = {TYPE_NIL},                      .synopsis = "int index()", .desc = "Returns the index of the element being computed, in the expression of an array uniform. Returns 0 anywhere else.", .flags = FUNC_FLAG_VOLATILE, .deps = SEL_DEP_RELOAD, },
 
     { .id = SV_LIT("signed"), .type = TYPE_INT,  .qualifier = QUALIFIER_PURE, .impl = fn_signed_, .argtypes = {TYPE_UINT, TYPE_NIL},             .synopsis = "int signed(uint x)", .desc = "Typecast uint to int.", },
     { .id = SV_LIT("xor"),    .type = TYPE_UINT, .qualifier = QUALIFIER_PURE, .impl = fn_xor_,    .argtypes = {TYPE_UINT, TYPE_UINT, TYPE_NIL},  .synopsis = "uint xor(uint a, uint b)", .desc = "bitwise XOR of `a` and `b`.", },
@@ -273,22 +576,22 @@ const Func BUILTIN_FUNCTIONS[] =
     { .id = SV_LIT("ror"),    .type = TYPE_UINT, .qualifier = QUALIFIER_PURE, .impl = fn_ror_,    .argtypes = {TYPE_UINT, TYPE_UINT, TYPE_NIL},  .synopsis = "uint ror(uint x, uint n)", .desc = "right rotate of `x` by `n`.", },
 
     { .id = SV_LIT("float"),        .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_float_,        .argtypes = {TYPE_INT, TYPE_NIL},                                                   .synopsis = "float float(int x)", .desc = "Typecast int to float.", },
-    { .id = SV_LIT("time"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_time_,         .argtypes = {TYPE_NIL},                                                             .synopsis = "float time()", .desc = "Returns the program runtime in seconds.", },
-    { .id = SV_LIT("deltatime"),    .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_deltatime_,    .argtypes = {TYPE_NIL},                                                             .synopsis = "float deltatime()", .desc = "Returns the frame delta time in seconds.", },
-    { .id = SV_LIT("rand"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_rand_,         .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},                                     .synopsis = "float rand(float min, float max)", .desc = "Returns a random number in [`min`, `max`].", },
-    { .id = SV_LIT("sqrt"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_sqrt_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float sqrt(float x)", .desc = "Returns the square root of `x`.", },
-    { .id = SV_LIT("pow"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_pow_,          .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},                                     .synopsis = "float pow(float x, float y)", .desc = "Returns the result of `x` raised to the power `y`", },
-    { .id = SV_LIT("exp"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_exp_,          .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float exp(float x)", .desc = "Returns the result of `e` raised to the power `x`", },
-    { .id = SV_LIT("log"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_log_,          .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float log(float x)", .desc = "Returns the natural logarithm of `x`", },
-    { .id = SV_LIT("exp2"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_exp2_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float exp2(float x)", .desc = "Returns the result of 2 raised to the power `x`", },
-    { .id = SV_LIT("log2"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_log2_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float log2(float x)", .desc = "Returns the base-2 logarithm of `x`", },
-    { .id = SV_LIT("sin"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_sin_,          .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float sin(float x)", .desc = "Returns the sine of `x`", },
-    { .id = SV_LIT("cos"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_cos_,          .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float cos(float x)", .desc = "Returns the cosine of `x`", },
-    { .id = SV_LIT("tan"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_tan_,          .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float tan(float x)", .desc = "Returns the tangent of `x`", },
-    { .id = SV_LIT("asin"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_asin_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float asin(float x)", .desc = "Returns the principal value of the arc sine of `x`", },
-    { .id = SV_LIT("acos"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_acos_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float acos(float x)", .desc = "Returns the arc cosine of `x`", },
-    { .id = SV_LIT("atan"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_atan_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float atan(float x)", .desc = "Returns the principal value of the arc tangent of `x`", },
-    { .id = SV_LIT("atan2"),        .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_atan2_,        .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},                                     .synopsis = "float atan2(float y, float x)", .desc = "Returns the principal value of the arc tangent of `y` / `x`, using the sine of the two arguments to determine the quadrant of the result", },
+    { .id = SV_LIT("time"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_time_,         .argtypes = {TYPE_NIL},                                                             .synopsis = "float time()", .desc = "Returns the program runtime in seconds.", .deps = SEL_DEP_TIME, },
+    { .id = SV_LIT("deltatime"),    .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_deltatime_,    .argtypes = {TYPE_NIL},                                                             .synopsis = "float deltatime()", .desc = "Returns the frame delta time in seconds.", .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("rand"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_rand_,         .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},                                     .synopsis = "float rand(float min, float max)", .desc = "Returns a random number in [`min`, `max`].", .flags = FUNC_FLAG_VOLATILE, .deps = SEL_DEP_FRAME, .cost = 10, },
+    { .id = SV_LIT("sqrt"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_sqrt_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float sqrt(float x)", .desc = "Returns the square root of `x`.", .cost = 4, },
+    { .id = SV_LIT("pow"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_pow_,          .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},                                     .synopsis = "float pow(float x, float y)", .desc = "Returns the result of `x` raised to the power `y`", .flags = FUNC_FLAG_MEMO, .cost = 40, },
+    { .id = SV_LIT("exp"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_exp_,          .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float exp(float x)", .desc = "Returns the result of `e` raised to the power `x`", .cost = 20, },
+    { .id = SV_LIT("log"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_log_,          .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float log(float x)", .desc = "Returns the natural logarithm of `x`", .cost = 20, },
+    { .id = SV_LIT("exp2"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_exp2_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float exp2(float x)", .desc = "Returns the result of 2 raised to the power `x`", .cost = 20, },
+    { .id = SV_LIT("log2"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_log2_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float log2(float x)", .desc = "Returns the base-2 logarithm of `x`", .cost = 20, },
+    { .id = SV_LIT("sin"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_sin_,          .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float sin(float x)", .desc = "Returns the sine of `x`", .cost = 20, },
+    { .id = SV_LIT("cos"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_cos_,          .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float cos(float x)", .desc = "Returns the cosine of `x`", .cost = 20, },
+    { .id = SV_LIT("tan"),          .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_tan_,          .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float tan(float x)", .desc = "Returns the tangent of `x`", .cost = 25, },
+    { .id = SV_LIT("asin"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_asin_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float asin(float x)", .desc = "Returns the principal value of the arc sine of `x`", .cost = 25, },
+    { .id = SV_LIT("acos"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_acos_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float acos(float x)", .desc = "Returns the arc cosine of `x`", .cost = 25, },
+    { .id = SV_LIT("atan"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_atan_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float atan(float x)", .desc = "Returns the principal value of the arc tangent of `x`", .cost = 25, },
+    { .id = SV_LIT("atan2"),        .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_atan2_,        .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},                                     .synopsis = "float atan2(float y, float x)", .desc = "Returns the principal value of the arc tangent of `y` / `x`, using the sine of the two arguments to determine the quadrant of the result", .cost = 30, },
     { .id = SV_LIT("round"),        .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_round_,        .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float round(float x)", .desc = "Returns the integer value closest to `x`, as a float", },
     { .id = SV_LIT("floor"),        .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_floor_,        .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float floor(float x)", .desc = "Returns the integer part of `x`, as a float", },
     { .id = SV_LIT("ceil"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_ceil_,         .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float ceil(float x)", .desc = "Returns the smallest integer that is larger than `x`, as a float", },
@@ -299,49 +602,51 @@ const Func BUILTIN_FUNCTIONS[] =
     { .id = SV_LIT("lerp"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_lerp_,         .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},                         .synopsis = "float lerp(float a, float b, float t)", .desc = "Linearly interpolates between `a` and `b` for values of `t` in [0, 1]. I.e. lerp(a,b,t) = a*(1-t)+b*t", },
     { .id = SV_LIT("ilerp"),        .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_ilerp_,        .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},                         .synopsis = "float ilerp(float a, float b, float x)", .desc = "Calculates the inverse of lerp(a,b,t). I.e. solves the equation x = a*(1-t)+b*t for t.", },
     { .id = SV_LIT("remap"),        .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_remap_,        .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "float remap(float in_min, float in_max, float out_min, float out_max, float x)", .desc = "See Freya Holmér's talks :-)", },
-    { .id = SV_LIT("lerpsmooth"),   .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_lerpsmooth_,   .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},             .synopsis = "float lerpsmooth(float a, float b, float dt, float omega)", .desc = "See Freya Holmér's talks :-)" , },
+    { .id = SV_LIT("lerpsmooth"),   .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_lerpsmooth_,   .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},             .synopsis = "float lerpsmooth(float a, float b, float dt, float omega)", .desc = "See Freya Holmér's talks :-)" , .cost = 25, },
     { .id = SV_LIT("smoothstep"),   .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_smoothstep_,   .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float smoothstep(float t)", .desc = "Steps, smoothly. :3", },
     { .id = SV_LIT("radians"),      .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_radians_,      .argtypes = {TYPE_FLOAT, TYPE_NIL},                                                 .synopsis = "float radians(float degrees)", .desc = "Converts degrees into radians", },
-    { .id = SV_LIT("perlin3D"),     .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_perlin3D_,     .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},                         .synopsis = "float perlin3D(float x, float y, float z)", .desc = "Perlin noise at (x,y,z)", },
-    { .id = SV_LIT("aspect_ratio"), .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_aspect_ratio_, .argtypes = {TYPE_NIL},                                                             .synopsis = "float aspect_ratio()", .desc = "Returns the current window aspect ratio (width/height)", },
+    { .id = SV_LIT("perlin3D"),     .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_perlin3D_,     .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},                         .synopsis = "float perlin3D(float x, float y, float z)", .desc = "Perlin noise at (x,y,z)", .flags = FUNC_FLAG_MEMO, .cost = 120, },
+    { .id = SV_LIT("aspect_ratio"), .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_aspect_ratio_, .argtypes = {TYPE_NIL},                                                             .synopsis = "float aspect_ratio()", .desc = "Returns the current window aspect ratio (width/height)", .flags = FUNC_FLAG_SESSION, .deps = SEL_DEP_VIEWPORT, },
 
     { .id = SV_LIT("vec2"),                .type = TYPE_VEC2,  .qualifier = QUALIFIER_PURE, .impl = fn_vec2_,                .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},           .synopsis = "vec2 vec2(float x, float y)", .desc = "Creates a 2D vector with components `x` and `y`", },
-    { .id = SV_LIT("vec2_from_polar"),     .type = TYPE_VEC2,  .qualifier = QUALIFIER_PURE, .impl = fn_vec2_from_polar_,     .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},           .synopsis = "vec2 vec2_from_polar(float r, float phi)", .desc = "Creates a 2D vector from the polar coordinates `r` and `phi`", },
-    { .id = SV_LIT("vec2_distance"),       .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec2_distance_,       .argtypes = {TYPE_VEC2, TYPE_VEC2, TYPE_NIL},             .synopsis = "float vec2_distance(vec2 a, vec2 b)", .desc = "Returns the absolute distance between `a` and `b`", },
-    { .id = SV_LIT("vec2_length"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec2_length_,         .argtypes = {TYPE_VEC2, TYPE_NIL},                        .synopsis = "float vec2_length(vec2 v)", .desc = "Returns the absolute length of `v`", },
-    { .id = SV_LIT("vec2_normalize"),      .type = TYPE_VEC2,  .qualifier = QUALIFIER_PURE, .impl = fn_vec2_normalize_,      .argtypes = {TYPE_VEC2, TYPE_NIL},                        .synopsis = "vec2 vec2_normalize(vec2 v)", .desc = "Returns the normalized vector of `v`", },
+    { .id = SV_LIT("vec2_from_polar"),     .type = TYPE_VEC2,  .qualifier = QUALIFIER_PURE, .impl = fn_vec2_from_polar_,     .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},           .synopsis = "vec2 vec2_from_polar(float r, float phi)", .desc = "Creates a 2D vector from the polar coordinates `r` and `phi`", .cost = 40, },
+    { .id = SV_LIT("vec2_distance"),       .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec2_distance_,       .argtypes = {TYPE_VEC2, TYPE_VEC2, TYPE_NIL},             .synopsis = "float vec2_distance(vec2 a, vec2 b)", .desc = "Returns the absolute distance between `a` and `b`", .cost = 6, },
+    { .id = SV_LIT("vec2_length"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec2_length_,         .argtypes = {TYPE_VEC2, TYPE_NIL},                        .synopsis = "float vec2_length(vec2 v)", .desc = "Returns the absolute length of `v`", .cost = 6, },
+    { .id = SV_LIT("vec2_normalize"),      .type = TYPE_VEC2,  .qualifier = QUALIFIER_PURE, .impl = fn_vec2_normalize_,      .argtypes = {TYPE_VEC2, TYPE_NIL},                        .synopsis = "vec2 vec2_normalize(vec2 v)", .desc = "Returns the normalized vector of `v`", .cost = 8, },
     { .id = SV_LIT("vec2_dot"),            .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec2_dot_,            .argtypes = {TYPE_VEC2, TYPE_VEC2, TYPE_NIL},             .synopsis = "float vec2_dot(vec2 a, vec2 b)", .desc = "Returns the dot product of `a` and `b`", },
     { .id = SV_LIT("vec2_mul_scalar"),     .type = TYPE_VEC2,  .qualifier = QUALIFIER_PURE, .impl = fn_vec2_mul_scalar_,     .argtypes = {TYPE_VEC2, TYPE_FLOAT, TYPE_NIL},            .synopsis = "vec2 vec2_mul_scalar(vec2 v, float s)", .desc = "Calculates the scalar-vector multiplication `s`*`v`", },
     { .id = SV_LIT("vec2_lerp"),           .type = TYPE_VEC2,  .qualifier = QUALIFIER_PURE, .impl = fn_vec2_lerp_,           .argtypes = {TYPE_VEC2, TYPE_VEC2, TYPE_FLOAT, TYPE_NIL}, .synopsis = "vec2 vec2_lerp(vec2 a, vec2 b, float t)", .desc = "Linearly interpolates between `a` and `b` for values of `t` in [0, 1]. I.e. lerp(a,b,t) = a*(1-t)+b*t", },
-    { .id = SV_LIT("vec2_slerp"),          .type = TYPE_VEC2,  .qualifier = QUALIFIER_PURE, .impl = fn_vec2_slerp_,          .argtypes = {TYPE_VEC2, TYPE_VEC2, TYPE_FLOAT, TYPE_NIL}, .synopsis = "vec2 vec2_slerp(vec2 a, vec2 b, float t)", .desc = "Interpolates between `a` and `b` for values of `t` in [0, 1] with constant speed along an arc on the unit circle.", },
-    { .id = SV_LIT("mouse_position"),      .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_mouse_position_,      .argtypes = {TYPE_NIL},                                   .synopsis = "vec2 mouse_position()", .desc = "Returns the current mouse position, in pixel coordinates.", },
-    { .id = SV_LIT("mouse_position_last"), .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_mouse_position_last_, .argtypes = {TYPE_NIL},                                   .synopsis = "vec2 mouse_position_last()", .desc = "Returns the mouse position from the last frame, in pixel coordinates.", },
-    { .id = SV_LIT("mouse_drag_position"), .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_mouse_drag_position_, .argtypes = {TYPE_NIL},                                   .synopsis = "vec2 mouse_drag_position()", .desc = "Returns the mouse position from when the left mouse button was last held, in pixel coordinates.", },
+    { .id = SV_LIT("vec2_slerp"),          .type = TYPE_VEC2,  .qualifier = QUALIFIER_PURE, .impl = fn_vec2_slerp_,          .argtypes = {TYPE_VEC2, TYPE_VEC2, TYPE_FLOAT, TYPE_NIL}, .synopsis = "vec2 vec2_slerp(vec2 a, vec2 b, float t)", .desc = "Interpolates between `a` and `b` for values of `t` in [0, 1] with constant speed along an arc on the unit circle.", .flags = FUNC_FLAG_MEMO, .cost = 80, },
+    { .id = SV_LIT("mouse_position"),      .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_mouse_position_,      .argtypes = {TYPE_NIL},                                   .synopsis = "vec2 mouse_position()", .desc = "Returns the current mouse position, in pixel coordinates.", .deps = SEL_DEP_MOUSE, },
+    { .id = SV_LIT("mouse_position_last"), .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_mouse_position_last_, .argtypes = {TYPE_NIL},                                   .synopsis = "vec2 mouse_position_last()", .desc = "Returns the mouse position from the last frame, in pixel coordinates.", .deps = SEL_DEP_MOUSE, },
+    { .id = SV_LIT("mouse_drag_position"), .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_mouse_drag_position_, .argtypes = {TYPE_NIL},                                   .synopsis = "vec2 mouse_drag_position()", .desc = "Returns the mouse position from when the left mouse button was last held, in pixel coordinates.", .deps = SEL_DEP_MOUSE, },
 
     { .id = SV_LIT("vec3"),                .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_,                .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "vec3 vec3(float x, float y, float z)",                      . desc = "Creates a 3D vector with components `x`, `y`, and `z`", },
-    { .id = SV_LIT("vec2_from_spherical"), .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_from_spherical_, .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "vec3 vec3_from_spherical(float r, float phi, float theta)", . desc = "Creates a 2D vector from the spherical coordinates `r`, `phi`, and `theta`", },
-    { .id = SV_LIT("vec3_distance"),       .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec3_distance_,       .argtypes = {TYPE_VEC3, TYPE_VEC3, TYPE_NIL},               .synopsis = "float vec3_distance(vec3 a, vec3 b)",                        . desc = "Returns the absolute distance between `a` and `b`", },
-    { .id = SV_LIT("vec3_length"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec3_length_,         .argtypes = {TYPE_VEC3, TYPE_NIL},                          .synopsis = "float vec3_length(vec3 v)",                                  . desc = "Returns the absolute length of `v`", },
-    { .id = SV_LIT("vec3_normalize"),      .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_normalize_,      .argtypes = {TYPE_VEC3, TYPE_NIL},                          .synopsis = "vec3 vec3_normalize(vec3 v)",                               . desc = "Returns the normalized vector of `v`", },
+    { .id = SV_LIT("vec2_from_spherical"), .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_from_spherical_, .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "vec3 vec3_from_spherical(float r, float phi, float theta)", . desc = "Creates a 2D vector from the spherical coordinates `r`, `phi`, and `theta`", .cost = 60, },
+    { .id = SV_LIT("vec3_distance"),       .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec3_distance_,       .argtypes = {TYPE_VEC3, TYPE_VEC3, TYPE_NIL},               .synopsis = "float vec3_distance(vec3 a, vec3 b)",                        . desc = "Returns the absolute distance between `a` and `b`", .cost = 8, },
+    { .id = SV_LIT("vec3_length"),         .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec3_length_,         .argtypes = {TYPE_VEC3, TYPE_NIL},                          .synopsis = "float vec3_length(vec3 v)",                                  . desc = "Returns the absolute length of `v`", .cost = 8, },
+    { .id = SV_LIT("vec3_normalize"),      .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_normalize_,      .argtypes = {TYPE_VEC3, TYPE_NIL},                          .synopsis = "vec3 vec3_normalize(vec3 v)",                               . desc = "Returns the normalized vector of `v`", .cost = 10, },
     { .id = SV_LIT("vec3_dot"),            .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec3_dot_,            .argtypes = {TYPE_VEC3, TYPE_VEC3, TYPE_NIL},               .synopsis = "float vec3_dot(vec3 a, vec3 b)",                             . desc = "Returns the dot product of `a` and `b`", },
     { .id = SV_LIT("vec3_mul_scalar"),     .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_mul_scalar_,     .argtypes = {TYPE_VEC3, TYPE_FLOAT, TYPE_NIL},              .synopsis = "vec3 vec3_mul_scalar(vec3 v, float s)",                     . desc = "Calculates the scalar-vector multiplication `s`*`v`", },
     { .id = SV_LIT("vec3_lerp"),           .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_lerp_,           .argtypes = {TYPE_VEC3, TYPE_VEC3, TYPE_FLOAT, TYPE_NIL},   .synopsis = "vec3 vec3_lerp(vec3 a, vec3 b, float t)",                   . desc = "Linearly interpolates between `a` and `b` for values of `t` in [0, 1]. I.e. lerp(a,b,t) = a*(1-t)+b*t", },
-    { .id = SV_LIT("vec3_slerp"),          .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_slerp_,          .argtypes = {TYPE_VEC3, TYPE_VEC3, TYPE_FLOAT, TYPE_NIL},   .synopsis = "vec3 vec3_slerp(vec3 a, vec3 b, float t)",                  . desc = "Interpolates between `a` and `b` for values of `t` in [0, 1] with constant speed along an arc on the unit sphere.", },
-    { .id = SV_LIT("vec3_cross"),          .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_cross_,          .argtypes = {TYPE_VEC3, TYPE_VEC3, TYPE_NIL},               .synopsis = "vec3 vec3_cross(vec3 a, vec3 b)",                           . desc = "Returns the cross product of `a` and `b`", },
+    { .id = SV_LIT("vec3_slerp"),          .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_slerp_,          .argtypes = {TYPE_VEC3, TYPE_VEC3, TYPE_FLOAT, TYPE_NIL},   .synopsis = "vec3 vec3_slerp(vec3 a, vec3 b, float t)",                  . desc = "Interpolates between `a` and `b` for values of `t` in [0, 1] with constant speed along an arc on the unit sphere.", .flags = FUNC_FLAG_MEMO, .cost = 100, },
+    { .id = SV_LIT("vec3_cross"),          .type = TYPE_VEC3,  .qualifier = QUALIFIER_PURE, .impl = fn_vec3_cross_,          .argtypes = {TYPE_VEC3, TYPE_VEC3, TYPE_NIL},               .synopsis = "vec3 vec3_cross(vec3 a, vec3 b)",                           . desc = "Returns the cross product of `a` and `b`", .cost = 6, },
 
     { .id = SV_LIT("vec4"),            .type = TYPE_VEC4,  .qualifier = QUALIFIER_PURE, .impl = fn_vec4_,            .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "vec4 vec4(float x, float y, float z, float w)", .desc = "Creates a 4D vector with components `x`, `y`, `z`, and `w`", },
-    { .id = SV_LIT("vec4_distance"),   .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec4_distance_,   .argtypes = {TYPE_VEC4, TYPE_VEC4, TYPE_NIL},                           .synopsis = "float vec4_distance(vec4 a, vec4 b)",            .desc = "Returns the absolute distance between `a` and `b`", },
-    { .id = SV_LIT("vec4_length"),     .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec4_length_,     .argtypes = {TYPE_VEC4, TYPE_NIL},                                      .synopsis = "float vec4_length(vec4 v)",                      .desc = "Returns the absolute length of `v`", },
-    { .id = SV_LIT("vec4_normalize"),  .type = TYPE_VEC4,  .qualifier = QUALIFIER_PURE, .impl = fn_vec4_normalize_,  .argtypes = {TYPE_VEC4, TYPE_NIL},                                      .synopsis = "vec4 vec4_normalize(vec4 v)",                   .desc = "Returns the normalized vector of `v`", },
+    { .id = SV_LIT("vec4_distance"),   .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec4_distance_,   .argtypes = {TYPE_VEC4, TYPE_VEC4, TYPE_NIL},                           .synopsis = "float vec4_distance(vec4 a, vec4 b)",            .desc = "Returns the absolute distance between `a` and `b`", .cost = 10, },
+    { .id = SV_LIT("vec4_length"),     .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec4_length_,     .argtypes = {TYPE_VEC4, TYPE_NIL},                                      .synopsis = "float vec4_length(vec4 v)",                      .desc = "Returns the absolute length of `v`", .cost = 10, },
+    { .id = SV_LIT("vec4_normalize"),  .type = TYPE_VEC4,  .qualifier = QUALIFIER_PURE, .impl = fn_vec4_normalize_,  .argtypes = {TYPE_VEC4, TYPE_NIL},                                      .synopsis = "vec4 vec4_normalize(vec4 v)",                   .desc = "Returns the normalized vector of `v`", .cost = 12, },
     { .id = SV_LIT("vec4_dot"),        .type = TYPE_FLOAT, .qualifier = QUALIFIER_PURE, .impl = fn_vec4_dot_,        .argtypes = {TYPE_VEC4, TYPE_VEC4, TYPE_NIL},                           .synopsis = "float vec4_dot(vec4 a, vec4 b)",                 .desc = "Returns the dot product of `a` and `b`", },
     { .id = SV_LIT("vec4_mul_scalar"), .type = TYPE_VEC4,  .qualifier = QUALIFIER_PURE, .impl = fn_vec4_mul_scalar_, .argtypes = {TYPE_VEC4, TYPE_FLOAT, TYPE_NIL},                          .synopsis = "vec4 vec4_mul_scalar(vec4 v, float s)",         .desc = "Calculates the scalar-vector multiplication `s`*`v`", },
     { .id = SV_LIT("vec4_lerp"),       .type = TYPE_VEC4,  .qualifier = QUALIFIER_PURE, .impl = fn_vec4_lerp_,       .argtypes = {TYPE_VEC4, TYPE_VEC4, TYPE_FLOAT, TYPE_NIL},               .synopsis = "vec4 vec4_lerp(vec4 a, vec4 b, float t)",       .desc = "Linearly interpolates between `a` and `b` for values of `t` in [0, 1]. I.e. lerp(a,b,t) = a*(1-t)+b*t", },
     { .id = SV_LIT("rgba"),            .type = TYPE_VEC4,  .qualifier = QUALIFIER_PURE, .impl = fn_rgba_,            .argtypes = {TYPE_INT, TYPE_NIL},                                       .synopsis = "vec4 rgba(int hexcode)",                        .desc = "Returns a vector with R, G, B, and A components normalized to 0.0 - 1.0 given a color hexcode", },
 
     { .id = SV_LIT("ivec2"),               .type = TYPE_IVEC2, .qualifier = QUALIFIER_PURE, .impl = fn_ivec2_,               .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},   .synopsis = "ivec2 ivec2(int x, int y)",       .desc = "Creates a 2D integer vector with components `x` and `y`", },
-    { .id = SV_LIT("viewport_resolution"), .type = TYPE_IVEC2, .qualifier = QUALIFIER_PURE, .impl = fn_viewport_resolution_, .argtypes = {TYPE_NIL},                       .synopsis = "ivec2 viewport_resolution()",     .desc = "Returns the current viewport/window resolution", },
-    { .id = SV_LIT("resolution_of"),       .type = TYPE_IVEC2, .qualifier = QUALIFIER_PURE, .impl = fn_resolution_of_,       .argtypes = {TYPE_STR, TYPE_NIL},             .synopsis = "ivec2 resolution_of(str shader)", .desc = "Returns the resolution of `shader`", },
-    { .id = SV_LIT("resolution"),          .type = TYPE_IVEC2, .qualifier = QUALIFIER_PURE, .impl = fn_resolution_,          .argtypes = {TYPE_NIL},                       .synopsis = "ivec2 resolution()",              .desc = "Returns the resolution of the shader to which the current attribute/uniform belongs", },
+    { .id = SV_LIT("viewport_resolution"), .type = TYPE_IVEC2, .qualifier = QUALIFIER_PURE, .impl = fn_viewport_resolution_, .argtypes = {TYPE_NIL},                       .synopsis = "ivec2 viewport_resolution()",     .desc = "Returns the current viewport/window resolution", .flags = FUNC_FLAG_SESSION, .deps = SEL_DEP_VIEWPORT, },
+    { .id = SV_LIT("resolution_of"),       .type = TYPE_IVEC2, .qualifier = QUALIFIER_PURE, .impl = fn_resolution_of_,       .argtypes = {TYPE_STR, TYPE_NIL},             .synopsis = "ivec2 resolution_of(str shader)", .desc = "Returns the resolution of `shader`", .flags = FUNC_FLAG_SESSION, .link = link_shader_, },
+    { .id = SV_LIT("resolution"),          .type = TYPE_IVEC2, .qualifier = QUALIFIER_PURE, .impl = fn_resolution_,          .argtypes = {TYPE_NIL},                       .synopsis = "ivec2 resolution()",              .desc = "Returns the resolution of the shader to which the current attribute/uniform belongs", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_CONTEXT, },
+    { .id = SV_LIT("output_resolution"),   .type = TYPE_IVEC2, .qualifier = QUALIFIER_PURE, .impl = fn_output_resolution_,   .argtypes = {TYPE_NIL},                       .synopsis = "ivec2 output_resolution()",       .desc = "Returns the resolution of the whole output image when rendering in tiles. Otherwise, the same as `resolution()`", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_CONTEXT, },
+    { .id = SV_LIT("tile_offset"),         .type = TYPE_IVEC2, .qualifier = QUALIFIER_NONE, .impl = fn_tile_offset_,         .argtypes = {TYPE_NIL},                       .synopsis = "ivec2 tile_offset()",             .desc = "Returns the output image pixel position of the current tile's lower left corner when rendering in tiles. Otherwise, (0, 0)", .deps = SEL_DEP_FRAME, },
 
     { .id = SV_LIT("ivec3"),      .type = TYPE_IVEC3, .qualifier = QUALIFIER_PURE, .impl = fn_ivec3_,      .argtypes = {TYPE_INT, TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "ivec3 ivec3(int x, int y, int z)", .desc = "Creates a 3D integer vector with components `x`, `y`, and `z`", },
 
@@ -356,53 +661,157 @@ const Func BUILTIN_FUNCTIONS[] =
     { .id = SV_LIT("mat4"),                  .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_,                  .argtypes = {TYPE_VEC4, TYPE_VEC4, TYPE_VEC4, TYPE_VEC4, TYPE_NIL}, .synopsis = "mat4 mat4(vec4 c0, vec4 c1, vec4 c2, vec4 c3)",        .desc = "Creates a 4x4 matrix with column vectors `c0`, `c1`, `c2`, and `c3`.", },
     { .id = SV_LIT("mat4_id"),               .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_id_,               .argtypes = {TYPE_NIL},                                             .synopsis = "mat4 mat4_id()",                                       .desc = "Creates a 4x4 identity matrix.", },
     { .id = SV_LIT("mat4_make_scale"),       .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_make_scale_,       .argtypes = {TYPE_VEC3, TYPE_NIL},                                  .synopsis = "mat4 mat4_make_scale(vec3 v)",                         .desc = "Creates a 4x4 scaling matrix for 3D vectors with scaling coefficients for the x, y, and z-axes given by `v`.", },
-    { .id = SV_LIT("mat4_make_rotation"),    .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_make_rotation_,    .argtypes = {TYPE_FLOAT, TYPE_VEC3, TYPE_NIL},                      .synopsis = "mat4 mat4_make_rotation(float angle, vec3 axis)",      .desc = "Creates a 4x4 rotation matrix for 3D vectors where the rotation operation is given by `angle` and `axis`.", },
+    { .id = SV_LIT("mat4_make_rotation"),    .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_make_rotation_,    .argtypes = {TYPE_FLOAT, TYPE_VEC3, TYPE_NIL},                      .synopsis = "mat4 mat4_make_rotation(float angle, vec3 axis)",      .desc = "Creates a 4x4 rotation matrix for 3D vectors where the rotation operation is given by `angle` and `axis`.", .flags = FUNC_FLAG_MEMO, .cost = 60, },
     { .id = SV_LIT("mat4_make_translation"), .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_make_translation_, .argtypes = {TYPE_VEC3, TYPE_NIL},                                  .synopsis = "mat4 mat4_make_translation(vec3 v)",                   .desc = "Creates a 4x4 translation matrix for 3D vectors where translation components for the x, y, and x-axes is given by `v`.", },
-    { .id = SV_LIT("mat4_look_at"),          .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_look_at_,          .argtypes = {TYPE_VEC3, TYPE_VEC3, TYPE_VEC3, TYPE_NIL},            .synopsis = "mat4 mat4_look_at(vec3 camera, vec3 target, vec3 up)", .desc = "Creates a 4x4 \"look-at\" view matrix, given a camera position `camera`, a target position `target`, and up-vector `up`.", },
-    { .id = SV_LIT("mat4_scale"),            .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_scale_,            .argtypes = {TYPE_MAT4, TYPE_VEC3, TYPE_NIL},                       .synopsis = "mat4 mat4_scale(mat4 m, vec3 v)",                      .desc = "Applies a scale-operation on `m` given scaling coefficients in `v`.", },
-    { .id = SV_LIT("mat4_rotate"),           .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_rotate_,           .argtypes = {TYPE_MAT4, TYPE_FLOAT, TYPE_VEC3, TYPE_NIL},           .synopsis = "mat4 mat4_rotate(mat4 m, float angle, vec3 axis)",     .desc = "Applies a rotation-operation on `m` given `angle` and `axis`.", },
-    { .id = SV_LIT("mat4_translate"),        .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_translate_,        .argtypes = {TYPE_MAT4, TYPE_VEC3, TYPE_NIL},                       .synopsis = "mat4 mat4_translate(mat4 m, vec3 v)",                  .desc = "Applies a translation-operation on `m` given translation components in `v`.", },
-    { .id = SV_LIT("mat4_mul_mat4"),         .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_mul_mat4_,         .argtypes = {TYPE_MAT4, TYPE_MAT4, TYPE_NIL},                       .synopsis = "mat4 mat4_mul_mat4(mat4 lhs, mat4 rhs)",               .desc = "Calculates the matrix-matrix multiplication `lhs`*`rhs`", },
-    { .id = SV_LIT("mat4_mul_vec4"),         .type = TYPE_VEC4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_mul_vec4_,         .argtypes = {TYPE_MAT4, TYPE_VEC4, TYPE_NIL},                       .synopsis = "vec4 mat4_mul_vec4(mat4 m, vec4 v)",                   .desc = "Calculates the matrix-vector multiplication `m`*`v`", },
-    { .id = SV_LIT("mat4_mul_scalar"),       .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_mul_scalar_,       .argtypes = {TYPE_MAT4, TYPE_FLOAT, TYPE_NIL},                      .synopsis = "mat4 mat4_mul_scalar(mat4 m, float s)",                .desc = "Calculates the matrix-scalar multiplication `m`*`s`", },
-
-    { .id = SV_LIT("input_float"),      .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_input_float_,      .argtypes = {TYPE_STR, TYPE_FLOAT, TYPE_NIL}, .synopsis = "float input_float(str label, float default)", .desc = "Creates an input widget for floats with the label `label` and default value `default`", },
-    { .id = SV_LIT("checkbox"),         .type = TYPE_BOOL,  .qualifier = QUALIFIER_NONE, .impl = fn_checkbox_,         .argtypes = {TYPE_STR, TYPE_BOOL, TYPE_NIL}, .synopsis = "bool checkbox(str label, bool default)", .desc = "Creates a checkbox widget with the label `label` and default value `default`", },
-    { .id = SV_LIT("drag_int"),         .type = TYPE_INT,   .qualifier = QUALIFIER_NONE, .impl = fn_drag_int_,         .argtypes = {TYPE_STR, TYPE_FLOAT, TYPE_INT, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "int drag_int(str label, float v, int min, int max, int default)", .desc = "Creates an integer slider widget with the label `label`, speed `v`, minimum and maximum allow values `min` and `max`, and default value `default`", },
-    { .id = SV_LIT("slider_float"),     .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_slider_float_,     .argtypes = {TYPE_STR, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "float slider_float(str label, float min, float max, float default)", .desc = "Creates a float slider widget with the label `label`, minimum and maximum allow values `min` and `max`, and default value `default`", },
-    { .id = SV_LIT("slider_float_log"), .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_slider_float_log_, .argtypes = {TYPE_STR, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "float slider_float_log(str label, float min, float max, float default)", .desc = "Creates a float slider widget, with logarithmic scaling, with the label `label`, minimum and maximum allow values `min` and `max`, and default value `default`", },
-    { .id = SV_LIT("input_int"),        .type = TYPE_INT,   .qualifier = QUALIFIER_NONE, .impl = fn_input_int_,        .argtypes = {TYPE_STR, TYPE_INT, TYPE_NIL}, .synopsis = "int input_int(str label, int default)", .desc = "Creates an input widget for integers with the label `label` and default value `default`", },
-    { .id = SV_LIT("input_vec2"),       .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_input_vec2_,       .argtypes = {TYPE_STR, TYPE_VEC2, TYPE_NIL}, .synopsis = "vec2 input_vec2(str label, vec2 default)", .desc = "Creates an input widget for 2D vectors with the label `label` and default value `default`", },
-    { .id = SV_LIT("input_vec3"),       .type = TYPE_VEC3,  .qualifier = QUALIFIER_NONE, .impl = fn_input_vec3_,       .argtypes = {TYPE_STR, TYPE_VEC3, TYPE_NIL}, .synopsis = "vec3 input_vec3(str label, vec3 default)", .desc = "Creates an input widget for 3D vectors with the label `label` and default value `default`", },
-    { .id = SV_LIT("input_vec4"),       .type = TYPE_VEC4,  .qualifier = QUALIFIER_NONE, .impl = fn_input_vec4_,       .argtypes = {TYPE_STR, TYPE_VEC4, TYPE_NIL}, .synopsis = "vec4 input_vec4(str label, vec4 default)", .desc = "Creates an input widget for 4D vectors with the label `label` and default value `default`", },
-    { .id = SV_LIT("color_picker"),     .type = TYPE_VEC4,  .qualifier = QUALIFIER_NONE, .impl = fn_color_picker_,     .argtypes = {TYPE_STR, TYPE_VEC4, TYPE_NIL}, .synopsis = "vec4 color_picker(str label, vec4 default)", .desc = "Creates a color picker widget with the label `label` and default value `default`", },
-
-    { .id = SV_LIT("copy_bool"),  .type = TYPE_BOOL,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_bool_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "bool copy_bool(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_int"),   .type = TYPE_INT,   .qualifier = QUALIFIER_NONE, .impl = fn_copy_int_,   .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "int copy_int(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_uint"),  .type = TYPE_UINT,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_uint_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "uint copy_uint(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_float"), .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_copy_float_, .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "float copy_float(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_vec2"),  .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_vec2_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "vec2 copy_vec2(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_vec3"),  .type = TYPE_VEC3,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_vec3_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "vec3 copy_vec3(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_vec4"),  .type = TYPE_VEC4,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_vec4_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "vec4 copy_vec4(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_ivec2"), .type = TYPE_IVEC2, .qualifier = QUALIFIER_NONE, .impl = fn_copy_ivec2_, .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "ivec2 copy_ivec2(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_ivec3"), .type = TYPE_IVEC3, .qualifier = QUALIFIER_NONE, .impl = fn_copy_ivec3_, .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "ivec3 copy_ivec3(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_ivec4"), .type = TYPE_IVEC4, .qualifier = QUALIFIER_NONE, .impl = fn_copy_ivec4_, .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "ivec4 copy_ivec4(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_mat2"),  .type = TYPE_MAT2,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_mat2_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "mat2 copy_mat2(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_mat3"),  .type = TYPE_MAT3,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_mat3_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "mat3 copy_mat3(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
-    { .id = SV_LIT("copy_mat4"),  .type = TYPE_MAT4,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_mat4_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "mat4 copy_mat4(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", },
+    { .id = SV_LIT("mat4_look_at"),          .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_look_at_,          .argtypes = {TYPE_VEC3, TYPE_VEC3, TYPE_VEC3, TYPE_NIL},            .synopsis = "mat4 mat4_look_at(vec3 camera, vec3 target, vec3 up)", .desc = "Creates a 4x4 \"look-at\" view matrix, given a camera position `camera`, a target position `target`, and up-vector `up`.", .flags = FUNC_FLAG_MEMO, .cost = 60, },
+    { .id = SV_LIT("mat4_scale"),            .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_scale_,            .argtypes = {TYPE_MAT4, TYPE_VEC3, TYPE_NIL},                       .synopsis = "mat4 mat4_scale(mat4 m, vec3 v)",                      .desc = "Applies a scale-operation on `m` given scaling coefficients in `v`.", .cost = 64, },
+    { .id = SV_LIT("mat4_rotate"),           .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_rotate_,           .argtypes = {TYPE_MAT4, TYPE_FLOAT, TYPE_VEC3, TYPE_NIL},           .synopsis = "mat4 mat4_rotate(mat4 m, float angle, vec3 axis)",     .desc = "Applies a rotation-operation on `m` given `angle` and `axis`.", .flags = FUNC_FLAG_MEMO, .cost = 124, },
+    { .id = SV_LIT("mat4_translate"),        .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_translate_,        .argtypes = {TYPE_MAT4, TYPE_VEC3, TYPE_NIL},                       .synopsis = "mat4 mat4_translate(mat4 m, vec3 v)",                  .desc = "Applies a translation-operation on `m` given translation components in `v`.", .cost = 64, },
+    { .id = SV_LIT("mat4_mul_mat4"),         .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_mul_mat4_,         .argtypes = {TYPE_MAT4, TYPE_MAT4, TYPE_NIL},                       .synopsis = "mat4 mat4_mul_mat4(mat4 lhs, mat4 rhs)",               .desc = "Calculates the matrix-matrix multiplication `lhs`*`rhs`", .cost = 64, },
+    { .id = SV_LIT("mat4_mul_vec4"),         .type = TYPE_VEC4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_mul_vec4_,         .argtypes = {TYPE_MAT4, TYPE_VEC4, TYPE_NIL},                       .synopsis = "vec4 mat4_mul_vec4(mat4 m, vec4 v)",                   .desc = "Calculates the matrix-vector multiplication `m`*`v`", .cost = 16, },
+    { .id = SV_LIT("mat4_mul_scalar"),       .type = TYPE_MAT4, .qualifier = QUALIFIER_PURE, .impl = fn_mat4_mul_scalar_,       .argtypes = {TYPE_MAT4, TYPE_FLOAT, TYPE_NIL},                      .synopsis = "mat4 mat4_mul_scalar(mat4 m, float s)",                .desc = "Calculates the matrix-scalar multiplication `m`*`s`", .cost = 16, },
+
+    { .id = SV_LIT("input_float"),      .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_input_float_,      .argtypes = {TYPE_STR, TYPE_FLOAT, TYPE_NIL}, .synopsis = "float input_float(str label, float default)", .desc = "Creates an input widget for floats with the label `label` and default value `default`", .flags = FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, .link = link_input_float_, },
+    { .id = SV_LIT("checkbox"),         .type = TYPE_BOOL,  .qualifier = QUALIFIER_NONE, .impl = fn_checkbox_,         .argtypes = {TYPE_STR, TYPE_BOOL, TYPE_NIL}, .synopsis = "bool checkbox(str label, bool default)", .desc = "Creates a checkbox widget with the label `label` and default value `default`", .flags = FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, .link = link_checkbox_, },
+    { .id = SV_LIT("drag_int"),         .type = TYPE_INT,   .qualifier = QUALIFIER_NONE, .impl = fn_drag_int_,         .argtypes = {TYPE_STR, TYPE_FLOAT, TYPE_INT, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "int drag_int(str label, float v, int min, int max, int default)", .desc = "Creates an integer slider widget with the label `label`, speed `v`, minimum and maximum allow values `min` and `max`, and default value `default`", .flags = FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, .link = link_drag_int_, },
+    { .id = SV_LIT("slider_float"),     .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_slider_float_,     .argtypes = {TYPE_STR, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "float slider_float(str label, float min, float max, float default)", .desc = "Creates a float slider widget with the label `label`, minimum and maximum allow values `min` and `max`, and default value `default`", .flags = FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, .link = link_slider_float_, },
+    { .id = SV_LIT("slider_float_log"), .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_slider_float_log_, .argtypes = {TYPE_STR, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "float slider_float_log(str label, float min, float max, float default)", .desc = "Creates a float slider widget, with logarithmic scaling, with the label `label`, minimum and maximum allow values `min` and `max`, and default value `default`", .flags = FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, .link = link_slider_float_log_, },
+    { .id = SV_LIT("input_int"),        .type = TYPE_INT,   .qualifier = QUALIFIER_NONE, .impl = fn_input_int_,        .argtypes = {TYPE_STR, TYPE_INT, TYPE_NIL}, .synopsis = "int input_int(str label, int default)", .desc = "Creates an input widget for integers with the label `label` and default value `default`", .flags = FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, .link = link_input_int_, },
+    { .id = SV_LIT("input_vec2"),       .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_input_vec2_,       .argtypes = {TYPE_STR, TYPE_VEC2, TYPE_NIL}, .synopsis = "vec2 input_vec2(str label, vec2 default)", .desc = "Creates an input widget for 2D vectors with the label `label` and default value `default`", .flags = FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, .link = link_input_vec2_, },
+    { .id = SV_LIT("input_vec3"),       .type = TYPE_VEC3,  .qualifier = QUALIFIER_NONE, .impl = fn_input_vec3_,       .argtypes = {TYPE_STR, TYPE_VEC3, TYPE_NIL}, .synopsis = "vec3 input_vec3(str label, vec3 default)", .desc = "Creates an input widget for 3D vectors with the label `label` and default value `default`", .flags = FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, .link = link_input_vec3_, },
+    { .id = SV_LIT("input_vec4"),       .type = TYPE_VEC4,  .qualifier = QUALIFIER_NONE, .impl = fn_input_vec4_,       .argtypes = {TYPE_STR, TYPE_VEC4, TYPE_NIL}, .synopsis = "vec4 input_vec4(str label, vec4 default)", .desc = "Creates an input widget for 4D vectors with the label `label` and default value `default`", .flags = FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, .link = link_input_vec4_, },
+    { .id = SV_LIT("color_picker"),     .type = TYPE_VEC4,  .qualifier = QUALIFIER_NONE, .impl = fn_color_picker_,     .argtypes = {TYPE_STR, TYPE_VEC4, TYPE_NIL}, .synopsis = "vec4 color_picker(str label, vec4 default)", .desc = "Creates a color picker widget with the label `label` and default value `default`", .flags = FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, .link = link_color_picker_, },
+
+    { .id = SV_LIT("smooth"),      .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_smooth_,          .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},          .synopsis = "float smooth(float x, float rate)", .desc = "Returns `x` smoothed over time: the value of the last frame moved towards `x` by a fraction `1 - exp(-rate*deltatime())`. Starts at `x`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("smooth"),      .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_smooth_vec2_,     .argtypes = {TYPE_VEC2, TYPE_FLOAT, TYPE_NIL},           .synopsis = "vec2 smooth(vec2 x, float rate)", .desc = "Returns `x` smoothed over time, per component. See `float smooth(float x, float rate)`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("smooth"),      .type = TYPE_VEC3,  .qualifier = QUALIFIER_NONE, .impl = fn_smooth_vec3_,     .argtypes = {TYPE_VEC3, TYPE_FLOAT, TYPE_NIL},           .synopsis = "vec3 smooth(vec3 x, float rate)", .desc = "Returns `x` smoothed over time, per component. See `float smooth(float x, float rate)`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("smooth"),      .type = TYPE_VEC4,  .qualifier = QUALIFIER_NONE, .impl = fn_smooth_vec4_,     .argtypes = {TYPE_VEC4, TYPE_FLOAT, TYPE_NIL},           .synopsis = "vec4 smooth(vec4 x, float rate)", .desc = "Returns `x` smoothed over time, per component. See `float smooth(float x, float rate)`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("integrate"),   .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_integrate_,       .argtypes = {TYPE_FLOAT, TYPE_NIL},                      .synopsis = "float integrate(float x)", .desc = "Returns the sum of `x*deltatime()` over the frames since the first call, which returns 0.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("integrate"),   .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_integrate_vec2_,  .argtypes = {TYPE_VEC2, TYPE_NIL},                       .synopsis = "vec2 integrate(vec2 x)", .desc = "Returns the sum of `x*deltatime()` over the frames since the first call, which returns 0.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("integrate"),   .type = TYPE_VEC3,  .qualifier = QUALIFIER_NONE, .impl = fn_integrate_vec3_,  .argtypes = {TYPE_VEC3, TYPE_NIL},                       .synopsis = "vec3 integrate(vec3 x)", .desc = "Returns the sum of `x*deltatime()` over the frames since the first call, which returns 0.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("integrate"),   .type = TYPE_VEC4,  .qualifier = QUALIFIER_NONE, .impl = fn_integrate_vec4_,  .argtypes = {TYPE_VEC4, TYPE_NIL},                       .synopsis = "vec4 integrate(vec4 x)", .desc = "Returns the sum of `x*deltatime()` over the frames since the first call, which returns 0.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("prev"),        .type = TYPE_INT,   .qualifier = QUALIFIER_NONE, .impl = fn_prev_,            .argtypes = {TYPE_INT, TYPE_NIL},                        .synopsis = "int prev(int x)", .desc = "Returns the value `x` had in the last frame it was computed in. The first call returns `x`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("prev"),        .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_prev_,            .argtypes = {TYPE_FLOAT, TYPE_NIL},                      .synopsis = "float prev(float x)", .desc = "Returns the value `x` had in the last frame it was computed in. The first call returns `x`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("prev"),        .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_prev_vec2_,       .argtypes = {TYPE_VEC2, TYPE_NIL},                       .synopsis = "vec2 prev(vec2 x)", .desc = "Returns the value `x` had in the last frame it was computed in. The first call returns `x`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("prev"),        .type = TYPE_VEC3,  .qualifier = QUALIFIER_NONE, .impl = fn_prev_vec3_,       .argtypes = {TYPE_VEC3, TYPE_NIL},                       .synopsis = "vec3 prev(vec3 x)", .desc = "Returns the value `x` had in the last frame it was computed in. The first call returns `x`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("prev"),        .type = TYPE_VEC4,  .qualifier = QUALIFIER_NONE, .impl = fn_prev_vec4_,       .argtypes = {TYPE_VEC4, TYPE_NIL},                       .synopsis = "vec4 prev(vec4 x)", .desc = "Returns the value `x` had in the last frame it was computed in. The first call returns `x`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("spring"),      .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_spring_,          .argtypes = {TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "float spring(float target, float k, float d)", .desc = "Returns the position of a damped spring pulled towards `target` with stiffness `k` and damping `d`. Starts at rest at `target`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("spring"),      .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_spring_vec2_,     .argtypes = {TYPE_VEC2, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "vec2 spring(vec2 target, float k, float d)", .desc = "Returns the position of a damped spring pulled towards `target`. See `float spring(float target, float k, float d)`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("spring"),      .type = TYPE_VEC3,  .qualifier = QUALIFIER_NONE, .impl = fn_spring_vec3_,     .argtypes = {TYPE_VEC3, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL}, .synopsis = "vec3 spring(vec3 target, float k, float d)", .desc = "Returns the position of a damped spring pulled towards `target`. See `float spring(float target, float k, float d)`.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+    { .id = SV_LIT("counter"),     .type = TYPE_INT,   .qualifier = QUALIFIER_NONE, .impl = fn_counter_,         .argtypes = {TYPE_NIL},                                  .synopsis = "int counter()", .desc = "Returns the number of frames it was called in before this one.", .flags = FUNC_FLAG_STATE, .deps = SEL_DEP_FRAME, },
+
+    { .id = SV_LIT("copy_bool"),  .type = TYPE_BOOL,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_bool_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "bool copy_bool(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_int"),   .type = TYPE_INT,   .qualifier = QUALIFIER_NONE, .impl = fn_copy_int_,   .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "int copy_int(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_uint"),  .type = TYPE_UINT,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_uint_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "uint copy_uint(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_float"), .type = TYPE_FLOAT, .qualifier = QUALIFIER_NONE, .impl = fn_copy_float_, .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "float copy_float(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_vec2"),  .type = TYPE_VEC2,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_vec2_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "vec2 copy_vec2(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_vec3"),  .type = TYPE_VEC3,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_vec3_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "vec3 copy_vec3(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_vec4"),  .type = TYPE_VEC4,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_vec4_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "vec4 copy_vec4(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_ivec2"), .type = TYPE_IVEC2, .qualifier = QUALIFIER_NONE, .impl = fn_copy_ivec2_, .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "ivec2 copy_ivec2(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_ivec3"), .type = TYPE_IVEC3, .qualifier = QUALIFIER_NONE, .impl = fn_copy_ivec3_, .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "ivec3 copy_ivec3(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_ivec4"), .type = TYPE_IVEC4, .qualifier = QUALIFIER_NONE, .impl = fn_copy_ivec4_, .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "ivec4 copy_ivec4(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_mat2"),  .type = TYPE_MAT2,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_mat2_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "mat2 copy_mat2(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_mat3"),  .type = TYPE_MAT3,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_mat3_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "mat3 copy_mat3(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    { .id = SV_LIT("copy_mat4"),  .type = TYPE_MAT4,  .qualifier = QUALIFIER_NONE, .impl = fn_copy_mat4_,  .argtypes = {TYPE_STR, TYPE_STR, TYPE_NIL}, .synopsis = "mat4 copy_mat4(str shader, str var)", .desc = "Copies the value last assigned to the uniform variable `var` in the shader `shader`", .deps = SEL_DEP_UNIFORMS, .link = link_uniform_, },
+    /* the above, once `sel_end_session()` has resolved the names passed to them */
+    { .id = SV_LIT("load_image"),          .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_load_image_linked_,        .argtypes = {TYPE_INT, TYPE_NIL},                     .synopsis = "texture load_image(str filepath)", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_LINKED, },
+    { .id = SV_LIT("load_image_ex"),       .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_load_image_ex_linked_,     .argtypes = {TYPE_INT, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "texture load_image_ex(str filepath, i32 filter, i32 wrap)", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_LINKED, },
+    { .id = SV_LIT("output_of"),           .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_output_of_linked_,         .argtypes = {TYPE_INT, TYPE_NIL},                     .synopsis = "texture output_of(str shader)", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_CONTEXT | FUNC_FLAG_LINKED, },
+    { .id = SV_LIT("output_of_ex"),        .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_output_of_ex_linked_,      .argtypes = {TYPE_INT, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "texture output_of_ex(str shader, i32 filter, i32 wrap)", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_CONTEXT | FUNC_FLAG_LINKED, },
+    { .id = SV_LIT("output_of"),           .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_output_of_n_linked_,       .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "texture output_of(str shader, int output)", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_CONTEXT | FUNC_FLAG_LINKED, },
+    { .id = SV_LIT("last_output_of"),      .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_last_output_of_linked_,    .argtypes = {TYPE_INT, TYPE_NIL},                     .synopsis = "texture last_output_of(str shader)", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_LINKED, },
+    { .id = SV_LIT("last_output_of"),      .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_last_output_of_n_linked_,  .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "texture last_output_of(str shader, int output)", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_LINKED, },
+    { .id = SV_LIT("last_output_of_ex"),   .type = TYPE_TEXTURE, .qualifier = QUALIFIER_PURE, .impl = fn_last_output_of_ex_linked_, .argtypes = {TYPE_INT, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "texture last_output_of_ex(str shader, i32 filter, i32 wrap)", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_LINKED, },
+    { .id = SV_LIT("resolution_of"),       .type = TYPE_IVEC2,   .qualifier = QUALIFIER_PURE, .impl = fn_resolution_of_linked_,     .argtypes = {TYPE_INT, TYPE_NIL},                     .synopsis = "ivec2 resolution_of(str shader)", .flags = FUNC_FLAG_SESSION | FUNC_FLAG_LINKED, },
+    { .id = SV_LIT("copy_bool"),           .type = TYPE_BOOL,    .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "bool copy_bool(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_int"),            .type = TYPE_INT,     .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "int copy_int(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_uint"),           .type = TYPE_UINT,    .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "uint copy_uint(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_float"),          .type = TYPE_FLOAT,   .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "float copy_float(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_vec2"),           .type = TYPE_VEC2,    .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "vec2 copy_vec2(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_vec3"),           .type = TYPE_VEC3,    .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "vec3 copy_vec3(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_vec4"),           .type = TYPE_VEC4,    .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "vec4 copy_vec4(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_ivec2"),          .type = TYPE_IVEC2,   .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "ivec2 copy_ivec2(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_ivec3"),          .type = TYPE_IVEC3,   .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "ivec3 copy_ivec3(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_ivec4"),          .type = TYPE_IVEC4,   .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "ivec4 copy_ivec4(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_mat2"),           .type = TYPE_MAT2,    .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "mat2 copy_mat2(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_mat3"),           .type = TYPE_MAT3,    .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "mat3 copy_mat3(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("copy_mat4"),           .type = TYPE_MAT4,    .qualifier = QUALIFIER_NONE, .impl = fn_copy_linked_,              .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},           .synopsis = "mat4 copy_mat4(str shader, str var)", .flags = FUNC_FLAG_LINKED, .deps = SEL_DEP_UNIFORMS, },
+    { .id = SV_LIT("input_float"),         .type = TYPE_FLOAT,   .qualifier = QUALIFIER_NONE, .impl = fn_widget_linked_,            .argtypes = {TYPE_INT, TYPE_FLOAT, TYPE_NIL},                               .synopsis = "float input_float(str label, float default)", .flags = FUNC_FLAG_LINKED | FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, },
+    { .id = SV_LIT("checkbox"),            .type = TYPE_BOOL,    .qualifier = QUALIFIER_NONE, .impl = fn_widget_linked_,            .argtypes = {TYPE_INT, TYPE_BOOL, TYPE_NIL},                                .synopsis = "bool checkbox(str label, bool default)", .flags = FUNC_FLAG_LINKED | FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, },
+    { .id = SV_LIT("drag_int"),            .type = TYPE_INT,     .qualifier = QUALIFIER_NONE, .impl = fn_widget_linked_,            .argtypes = {TYPE_INT, TYPE_FLOAT, TYPE_INT, TYPE_INT, TYPE_INT, TYPE_NIL}, .synopsis = "int drag_int(str label, float v, int min, int max, int default)", .flags = FUNC_FLAG_LINKED | FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, },
+    { .id = SV_LIT("slider_float"),        .type = TYPE_FLOAT,   .qualifier = QUALIFIER_NONE, .impl = fn_widget_linked_,            .argtypes = {TYPE_INT, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},       .synopsis = "float slider_float(str label, float min, float max, float default)", .flags = FUNC_FLAG_LINKED | FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, },
+    { .id = SV_LIT("slider_float_log"),    .type = TYPE_FLOAT,   .qualifier = QUALIFIER_NONE, .impl = fn_widget_linked_,            .argtypes = {TYPE_INT, TYPE_FLOAT, TYPE_FLOAT, TYPE_FLOAT, TYPE_NIL},       .synopsis = "float slider_float_log(str label, float min, float max, float default)", .flags = FUNC_FLAG_LINKED | FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, },
+    { .id = SV_LIT("input_int"),           .type = TYPE_INT,     .qualifier = QUALIFIER_NONE, .impl = fn_widget_linked_,            .argtypes = {TYPE_INT, TYPE_INT, TYPE_NIL},                                 .synopsis = "int input_int(str label, int default)", .flags = FUNC_FLAG_LINKED | FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, },
+    { .id = SV_LIT("input_vec2"),          .type = TYPE_VEC2,    .qualifier = QUALIFIER_NONE, .impl = fn_widget_linked_,            .argtypes = {TYPE_INT, TYPE_VEC2, TYPE_NIL},                                .synopsis = "vec2 input_vec2(str label, vec2 default)", .flags = FUNC_FLAG_LINKED | FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, },
+    { .id = SV_LIT("input_vec3"),          .type = TYPE_VEC3,    .qualifier = QUALIFIER_NONE, .impl = fn_widget_linked_,            .argtypes = {TYPE_INT, TYPE_VEC3, TYPE_NIL},                                .synopsis = "vec3 input_vec3(str label, vec3 default)", .flags = FUNC_FLAG_LINKED | FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, },
+    { .id = SV_LIT("input_vec4"),          .type = TYPE_VEC4,    .qualifier = QUALIFIER_NONE, .impl = fn_widget_linked_,            .argtypes = {TYPE_INT, TYPE_VEC4, TYPE_NIL},                                .synopsis = "vec4 input_vec4(str label, vec4 default)", .flags = FUNC_FLAG_LINKED | FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, },
+    { .id = SV_LIT("color_picker"),        .type = TYPE_VEC4,    .qualifier = QUALIFIER_NONE, .impl = fn_widget_linked_,            .argtypes = {TYPE_INT, TYPE_VEC4, TYPE_NIL},                                .synopsis = "vec4 color_picker(str label, vec4 default)", .flags = FUNC_FLAG_LINKED | FUNC_FLAG_MAIN, .deps = SEL_DEP_WIDGET, },
 };
 const size_t N_BUILTIN_FUNCTIONS = sizeof(BUILTIN_FUNCTIONS) / sizeof(BUILTIN_FUNCTIONS[0]);
 
 /*--- Private variables -----------------------------------------------------------------*/
 
-/* Simple Expression Language Virtual Machine */
+/* 
+ * Simple Expression Language Virtual Machine. Shared by all threads, and only changed 
+ * by the main thread while no worker runs, except for the signals of changed uniforms.
+ */
 static struct SVM {
-    const ExeExpr *exe;
-    u8 stack[SVM_STACK_SIZE];
+    u64 frame;
+    u64 changed_at[SEL_N_DEPS]; // frame in which each source of change last changed
+    SelValue globals[SEL_MAX_N_GLOBALS];
+} svm = {.frame = 1};
+
+/* The state of the SVM that is private to each thread */
+static _Thread_local struct SVMThread {
+    const ExeExpr *exe; // of the stack VM
+    u8 stack[SEL_MAX_STACK_SIZE];
     u32 pc;
     u32 sp;
-    SVMContext ctx;
-} svm = {0};
+    SelThreadState state;
+    u32 rand_seed;      // of `rand_r()`. The main thread calls `rand()`, seeded by `srand()`
+    b8 is_worker;
+    SelState *call_state; // of the `FUNC_FLAG_STATE` builtin the register VM is calling, or NULL
+    SelState fresh_state; // of the others (see `svm_call_state()`)
+} svm_thread;
+
+/* 
+ * The states of the call sites of `FUNC_FLAG_STATE` builtins, open addressing on `site`. 
+ * Each is only touched by the thread running its expression. The extra state is shared 
+ * by the call sites claimed once the table was full, so their expressions are only run 
+ * by the main thread.
+ */
+static SelState svm_states[SEL_MAX_N_STATES + 1];
+
+/* The workers, which run frame programs side by side with the main thread */
+static struct {
+    pthread_t threads[SEL_MAX_N_WORKERS];
+    u32 n;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;      // signaled when there are programs to run, or the workers are to stop
+    pthread_cond_t done;      // signaled when the last of the programs run by workers is done
+    u32 seeds[SEL_MAX_N_WORKERS]; // of the `rand_r()` of each worker
+    ExeExpr *const *programs; // worker i runs programs[i + 1]
+    u32 n_programs;
+    u32 n_running;
+    u64 run;                  // incremented by every call to `sel_run_frame_programs()`
+    b8 stop;
+} svm_workers = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+/* State of `sel_eval_batch()`. The register file is stored as structure-of-arrays */
+static struct {
+    SvmLanes regs[SVM_BATCH_MAX_REGS_SIZE / sizeof(u32)];
+    const SelOverride *overrides;
+    u32 override_funcs[SVM_BATCH_MAX_N_OVERRIDES]; // index into BUILTIN_FUNCTIONS
+    u32 n_overrides;
+    u32 first; // evaluation of the first lane
+    u32 n;
+    u32 active; // a bit per lane, clear for lanes not taking the branch being run
+} svm_batch;
+static_assert(SVM_BATCH_WIDTH <= 32, "a bit per lane in `svm_batch.active`");
 
 /*--- Public functions ------------------------------------------------------------------*/
 
@@ -413,35 +822,356 @@ SelValue sel_eval(ExeExpr *exe, SVMContext ctx, b8 force_recompute)
         return (SelValue) {0};
     }
 
-    if ((exe->qualifier & QUALIFIER_CONST) && 
-        (exe->has_been_computed_once) &&
-        (!force_recompute)) {
+    /* Nothing the expression depends on has changed since it was last computed */
+    if (!force_recompute && !svm_is_stale(exe)) {
         return exe->cached_computed_value;
     }
 
+    /* Load context and execute */
+    svm_thread.state.ctx = ctx;
+    exe->computed_at = svm.frame;
+    svm_compile_if_hot(exe);
+    svm_execute(exe);
+
+    /* retreive, pack, and return the result */
+    u32 tsize = TYPE_TO_SIZE[exe->type];
+    SelValue result = {0};
+    reg_copy(&result, &exe->regs[exe->result], tsize);
+    if (exe->has_been_computed_once && (memcmp(&result, &exe->cached_computed_value, tsize) != 0)) {
+        sel_signal(SEL_DEP_UNIFORMS);
+    }
+    exe->cached_computed_value = result;
+    exe->has_been_computed_once = true;
+
+    return result;
+}
+
+/* 
+ * Evaluates `exe` by interpreting its stack bytecode. Never cached. Slower than 
+ * `sel_eval()`, but kept as a reference for testing the register VM against.
+ */
+SelValue sel_eval_stack(ExeExpr *exe, SVMContext ctx)
+{
+    /* the compiler measured the stack the program needs, so pushes and pops are not checked */
+    assert(exe->stack_size <= SEL_MAX_STACK_SIZE);
+
     /* Reset SVM, load program, and load context */
     svm_reset();
-    svm.exe = exe;
-    svm.ctx = ctx;
+    svm_thread.exe = exe;
+    svm_thread.state.ctx = ctx;
 
     /* Execute in interpreter */
     svm_run(); 
 
     /* Assert machine state is as expected */
-    u32 tsize = TYPE_TO_SIZE[svm.exe->type];
-    assert(svm.sp - tsize == 0);
-    assert(svm.pc == svm.exe->size);
+    u32 tsize = TYPE_TO_SIZE[svm_thread.exe->type];
+    assert(svm_thread.sp - tsize == 0);
+    assert(svm_thread.pc == svm_thread.exe->size);
 
     /* retreive, pack, and return the result result */
     void *raw_result = svm_stack_pop(tsize);
     SelValue result = {0};
     memcpy(&result, raw_result, tsize); // Okay? Otherwise switch on exe->type
-    exe->cached_computed_value = result;
-    exe->has_been_computed_once = true;
 
     return result;
 }
 
+/* 
+ * Evaluates `exe` `n` times and leaves the results, packed, in `results`. In the i'th 
+ * evaluation, every call to a builtin named by `overrides` returns the i'th of its 
+ * values instead. The evaluations are run SVM_BATCH_WIDTH at a time, side by side: 
+ * component-wise arithmetic and comparisons are done for all lanes at once, while 
+ * function calls, integer division and matrix products are done lane by lane. Where 
+ * the lanes disagree on the condition of a conditional, both branches are evaluated, 
+ * and each lane keeps the value of its own, though calls are only made by the lanes 
+ * taking the branch. Never cached, and subexpressions are 
+ * never shared. The lanes are not private to a thread, so batches 
+ * are only evaluated on the main thread. Returns 0 on success and -1 otherwise.
+ */
+i32 sel_eval_batch(const ExeExpr *exe, SVMContext ctx, const SelOverride *overrides, u32 n_overrides, 
+                   void *results, u32 n)
+{
+    if (exe == NULL || exe->ops == NULL) {
+        return -1;
+    }
+    if (exe->linked != NULL) {
+        log_error("Frame programs can not be evaluated in batches.");
+        return -1;
+    }
+    if (exe->regs_size > SVM_BATCH_MAX_REGS_SIZE) {
+        log_error("The expression is too large to be evaluated in batches.");
+        return -1;
+    }
+    if (n_overrides > SVM_BATCH_MAX_N_OVERRIDES) {
+        log_error("At most %d builtins may be overridden in a batch.", SVM_BATCH_MAX_N_OVERRIDES);
+        return -1;
+    }
+
+    /* look up the overridden builtins */
+    for (u32 i = 0; i < n_overrides; i++) {
+        u32 id = 0;
+        while (id < N_BUILTIN_FUNCTIONS && !sv_equals(BUILTIN_FUNCTIONS[id].id, overrides[i].func)) {
+            id++;
+        }
+        if (id == N_BUILTIN_FUNCTIONS) {
+            log_error("Can not override `" SV_FMT "`: no such builtin.", SV_ARG(overrides[i].func));
+            return -1;
+        }
+        svm_batch.override_funcs[i] = id;
+    }
+    svm_batch.overrides = overrides;
+    svm_batch.n_overrides = n_overrides;
+    svm_batch.n = n;
+
+    /* broadcast the constants, and whatever the temporaries hold, to all lanes */
+    u32 n_words = (exe->regs_size + sizeof(u32) - 1) / sizeof(u32);
+    for (u32 w = 0; w < n_words; w++) {
+        u32 word = 0;
+        u32 size = (w == n_words - 1) ? exe->regs_size - w*sizeof(u32) : sizeof(u32);
+        memcpy(&word, &exe->regs[w*sizeof(u32)], size);
+        for (u32 l = 0; l < SVM_BATCH_WIDTH; l++) {
+            svm_batch.regs[w].lane[l] = word;
+        }
+    }
+
+    /* evaluate */
+    svm_thread.state.ctx = ctx;
+    u32 tsize = TYPE_TO_SIZE[exe->type];
+    for (svm_batch.first = 0; svm_batch.first < n; svm_batch.first += SVM_BATCH_WIDTH) {
+        svm_batch.active = (u32) ((1ull << SVM_BATCH_WIDTH) - 1);
+        svm_batch_run(exe->ops, &exe->ops[exe->n_ops]);
+        u32 n_lanes = (n - svm_batch.first < SVM_BATCH_WIDTH) ? n - svm_batch.first : SVM_BATCH_WIDTH;
+        for (u32 w = 0; w < tsize / sizeof(u32); w++) {
+            const SvmLanes *word = svm_batch_reg(exe->result + w*sizeof(u32));
+            u8 *out = (u8 *)results + svm_batch.first*tsize + w*sizeof(u32);
+            if (tsize == sizeof(u32)) {
+                memcpy(out, word->lane, n_lanes*sizeof(u32));
+                continue;
+            }
+            for (u32 l = 0; l < n_lanes; l++) {
+                memcpy(&out[l*tsize], &word->lane[l], sizeof(u32));
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* 
+ * Evaluates `exe` for each of the `n` elements of an array uniform, in a batch where 
+ * `index()` returns the index of the element, and leaves the elements, packed, in 
+ * `values`. Like `sel_eval()`, the elements are only recomputed when something the 
+ * expression depends on has changed, so constant arrays are computed once. Returns 1 
+ * if the elements were recomputed, 0 if they were not, and -1 on error.
+ */
+i32 sel_eval_array(ExeExpr *exe, SVMContext ctx, void *values, u32 n, b8 force_recompute)
+{
+    static i32 indices[SEL_MAX_ARRAY_SIZE];
+    static const SelOverride index_override = {.func = SV_LIT("index"), .values = indices};
+
+    if (exe == NULL || n > SEL_MAX_ARRAY_SIZE) {
+        return -1;
+    }
+    if (!force_recompute && !svm_is_stale(exe)) {
+        return 0;
+    }
+
+    for (u32 i = 0; i < n; i++) {
+        indices[i] = (i32) i;
+    }
+    exe->computed_at = svm.frame;
+    if (sel_eval_batch(exe, ctx, &index_override, 1, values, n) != 0) {
+        return -1;
+    }
+    exe->has_been_computed_once = true;
+
+    return 1;
+}
+
+/* Invalidates the values of all subexpressions shared between expressions */
+void sel_begin_frame(void)
+{
+    svm.frame++;
+    sel_signal(SEL_DEP_FRAME);
+}
+
+/* Signals that the sources of change `deps` (SelDependency) have changed */
+void sel_signal(u32 deps)
+{
+    for (u32 i = 0; i < SEL_N_DEPS; i++) {
+        if (deps & (1u << i)) {
+            /* workers signal the uniforms they change at the same time. All store the same frame */
+            __atomic_store_n(&svm.changed_at[i], svm.frame, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* Stores the value of the global `index`, where the expressions referring to it read it */
+void sel_set_global(u32 index, SelValue value)
+{
+    assert(index < SEL_MAX_N_GLOBALS);
+    svm.globals[index] = value;
+}
+
+/* 
+ * Sums the memo slots of the calls to the builtin `func_id` in `exe` (see 
+ * `FUNC_FLAG_MEMO`). Returns the number of calls, and leaves the number of them that 
+ * reused the result of the call before in `n_hits`. The calls of the expressions linked 
+ * into a frame program are counted in the frame program.
+ */
+u32 sel_memo_stats(const ExeExpr *exe, u32 func_id, u32 *n_hits)
+{
+    u32 n_calls = 0;
+    *n_hits = 0;
+    if (exe == NULL || exe->ops == NULL) {
+        return 0;
+    }
+    for (u32 i = 0; i < exe->n_ops; i++) {
+        const RegOp *op = &exe->ops[i];
+        if (op->code != REG_OP_MEMO || op->imm != func_id) {
+            continue;
+        }
+        SelMemoSlot slot;
+        memcpy(&slot, &exe->regs[op->rhs], sizeof(slot));
+        n_calls += slot.n_calls;
+        *n_hits += slot.n_hits;
+    }
+    return n_calls;
+}
+
+/* 
+ * Claims the state of the call site `site` of a `FUNC_FLAG_STATE` builtin in `exe`, 
+ * compiled in the session `session`, and returns its index. The site of a call 
+ * identifies it across compilations. A state claimed in an earlier session goes to 
+ * the first call site with the same site to claim it, so an expression recompiled by 
+ * a reload carries on with the states of the one it replaces. Otherwise the call site 
+ * gets a fresh state, possibly one no longer claimed. Once all are claimed, returns 
+ * `SEL_MAX_N_STATES`, the extra state shared by the call sites past the limit.
+ */
+u32 sel_claim_state(u64 site, const ExeExpr *exe, u32 session)
+{
+    u32 mask = SEL_MAX_N_STATES - 1;
+    i32 fresh = -1;
+    i32 stale = -1;
+    for (u32 n = 0; n < SEL_MAX_N_STATES; n++) {
+        u32 i = (u32) (site + n) & mask;
+        SelState *state = &svm_states[i];
+        if (state->owner == NULL) {
+            fresh = (i32) i;
+            break;
+        }
+        if (state->session != session) {
+            if (state->site == site) {
+                state->owner = exe;
+                state->session = session;
+                return i;
+            }
+            stale = (stale < 0) ? (i32) i : stale;
+        } else if ((state->site == site) && (state->owner == exe)) {
+            return i; /* claimed already, e.g. by a compilation before `sel_end_session()` */
+        }
+    }
+    i32 i = (fresh >= 0) ? fresh : stale;
+    if (i < 0) {
+        log_error("More than %d calls of stateful builtins. Some share a state.", SEL_MAX_N_STATES);
+        return SEL_MAX_N_STATES;
+    }
+    svm_states[i] = (SelState) {.site = site, .owner = exe, .session = session};
+    return (u32) i;
+}
+
+/* 
+ * Runs a frame program (see `sel_link_frame_program()`), which leaves the values of 
+ * all its expressions in their staging areas. 
+ */
+void sel_run_frame_program(ExeExpr *program)
+{
+    svm_compile_if_hot(program);
+    svm_execute(program);
+}
+
+/* 
+ * Runs the frame programs `programs` side by side: the first on the calling thread, 
+ * and the i'th on worker i - 1 (see `sel_start_workers()`). Returns once all of them 
+ * are done. No expression may be linked into more than one of the programs, and only 
+ * the first may link expressions flagged `main_thread`. Native code is compiled here, 
+ * before the workers are woken, as the JIT is not re-entrant.
+ */
+void sel_run_frame_programs(ExeExpr *const *programs, u32 n)
+{
+    assert(n <= svm_workers.n + 1);
+    for (u32 i = 0; i < n; i++) {
+        svm_compile_if_hot(programs[i]);
+    }
+    if (n == 0) {
+        return;
+    }
+    if (n == 1) {
+        svm_execute(programs[0]);
+        return;
+    }
+
+    pthread_mutex_lock(&svm_workers.lock);
+    svm_workers.programs = programs;
+    svm_workers.n_programs = n;
+    svm_workers.n_running = n - 1;
+    svm_workers.run++;
+    pthread_cond_broadcast(&svm_workers.wake);
+    pthread_mutex_unlock(&svm_workers.lock);
+
+    svm_execute(programs[0]);
+
+    pthread_mutex_lock(&svm_workers.lock);
+    while (svm_workers.n_running > 0) {
+        pthread_cond_wait(&svm_workers.done, &svm_workers.lock);
+    }
+    pthread_mutex_unlock(&svm_workers.lock);
+}
+
+/* 
+ * Starts `n` workers for `sel_run_frame_programs()`, but no more than one less than 
+ * the number of processors, nor than SEL_MAX_N_WORKERS. Each has a private SVM state, 
+ * and shares nothing but the frame, the globals and the sources of change with the 
+ * other threads. Returns the number of workers started.
+ */
+u32 sel_start_workers(u32 n)
+{
+    assert(svm_workers.n == 0);
+    long n_processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if ((n_processors > 0) && (n > (u32) n_processors - 1)) {
+        n = (u32) n_processors - 1;
+    }
+    if (n > SEL_MAX_N_WORKERS) {
+        n = SEL_MAX_N_WORKERS;
+    }
+
+    svm_workers.stop = false;
+    svm_workers.run = 0;
+    for (u32 i = 0; i < n; i++) {
+        /* from the main thread, so that the seeds of the workers follow from that of `srand()` */
+        svm_workers.seeds[i] = (u32) rand();
+        if (0 != pthread_create(&svm_workers.threads[i], NULL, svm_worker_main, (void *)(uintptr_t) i)) {
+            log_error("Failed to start SEL worker %u of %u.", i + 1, n);
+            break;
+        }
+        svm_workers.n++;
+    }
+    return svm_workers.n;
+}
+
+/* Stops the workers started by `sel_start_workers()`, once they are done */
+void sel_stop_workers()
+{
+    pthread_mutex_lock(&svm_workers.lock);
+    svm_workers.stop = true;
+    pthread_cond_broadcast(&svm_workers.wake);
+    pthread_mutex_unlock(&svm_workers.lock);
+    for (u32 i = 0; i < svm_workers.n; i++) {
+        pthread_join(svm_workers.threads[i], NULL);
+    }
+    svm_workers.n = 0;
+}
+
 /*--- Private functions -----------------------------------------------------------------*/
 
 static void svm_run()
@@ -449,7 +1179,7 @@ static void svm_run()
     while (true) {
 
         /* end-of-program */
-        if (svm.pc >= svm.exe->size) {
+        if (svm_thread.pc >= svm_thread.exe->size) {
             break;
         }
 
@@ -462,22 +1192,23 @@ static void svm_run()
             } break;
 
             case OP_ADD: {
-                void *rhs = svm_stack_pop(tsize);
-                void *lhs = svm_stack_pop(tsize);
+                SelValue rhs_ = svm_stack_pop_value(tsize);
+                SelValue lhs_ = svm_stack_pop_value(tsize);
+                void *rhs = &rhs_, *lhs = &lhs_;
                 if (op->lhs_type == op->rhs_type) {
                     switch (op->type) {
-                        case TYPE_INT: {i32 tmp = addi(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_UINT: {u32 tmp = addu(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_FLOAT: {f32 tmp = addf(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC2:  {Vec2 tmp = addv2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC3:  {Vec3 tmp = addv3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC4:  {Vec4 tmp = addv4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC2: {IVec2 tmp = addiv2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC3: {IVec3 tmp = addiv3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC4: {IVec4 tmp = addiv4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_MAT2:  {Mat2 tmp = addm2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_MAT3:  {Mat3 tmp = addm3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_MAT4:  {Mat4 tmp = addm4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
+                        case TYPE_INT: {i32 tmp = addi(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_UINT: {u32 tmp = addu(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_FLOAT: {f32 tmp = addf(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC2:  {Vec2 tmp = addv2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC3:  {Vec3 tmp = addv3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC4:  {Vec4 tmp = addv4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC2: {IVec2 tmp = addiv2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC3: {IVec3 tmp = addiv3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC4: {IVec4 tmp = addiv4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_MAT2:  {Mat2 tmp = addm2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_MAT3:  {Mat3 tmp = addm3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_MAT4:  {Mat4 tmp = addm4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
                         default: assert(false);
                     }
                 } else {
@@ -486,22 +1217,23 @@ static void svm_run()
             } break;
 
             case OP_SUB: {
-                void *rhs = svm_stack_pop(tsize);
-                void *lhs = svm_stack_pop(tsize);
+                SelValue rhs_ = svm_stack_pop_value(tsize);
+                SelValue lhs_ = svm_stack_pop_value(tsize);
+                void *rhs = &rhs_, *lhs = &lhs_;
                 if (op->lhs_type == op->rhs_type) {
                     switch (op->type) {
-                        case TYPE_INT: {i32 tmp = subi(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_UINT: {u32 tmp = subu(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_FLOAT: {f32 tmp = subf(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC2:  {Vec2 tmp = subv2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC3:  {Vec3 tmp = subv3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC4:  {Vec4 tmp = subv4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC2: {IVec2 tmp = subiv2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC3: {IVec3 tmp = subiv3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC4: {IVec4 tmp = subiv4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_MAT2:  {Mat2 tmp = subm2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_MAT3:  {Mat3 tmp = subm3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_MAT4:  {Mat4 tmp = subm4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
+                        case TYPE_INT: {i32 tmp = subi(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_UINT: {u32 tmp = subu(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_FLOAT: {f32 tmp = subf(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC2:  {Vec2 tmp = subv2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC3:  {Vec3 tmp = subv3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC4:  {Vec4 tmp = subv4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC2: {IVec2 tmp = subiv2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC3: {IVec3 tmp = subiv3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC4: {IVec4 tmp = subiv4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_MAT2:  {Mat2 tmp = subm2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_MAT3:  {Mat3 tmp = subm3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_MAT4:  {Mat4 tmp = subm4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
                         default: assert(false);
                     }
                 } else {
@@ -510,22 +1242,23 @@ static void svm_run()
             } break;
 
             case OP_MUL: {
-                void *rhs = svm_stack_pop(tsize);
-                void *lhs = svm_stack_pop(tsize);
+                SelValue rhs_ = svm_stack_pop_value(tsize);
+                SelValue lhs_ = svm_stack_pop_value(tsize);
+                void *rhs = &rhs_, *lhs = &lhs_;
                 if (op->lhs_type == op->rhs_type) {
                     switch (op->type) {
-                        case TYPE_INT: {i32 tmp = muli(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_UINT: {u32 tmp = mulu(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_FLOAT: {f32 tmp = mulf(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC2:  {Vec2 tmp = mulv2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC3:  {Vec3 tmp = mulv3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC4:  {Vec4 tmp = mulv4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC2: {IVec2 tmp = muliv2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC3: {IVec3 tmp = muliv3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC4: {IVec4 tmp = muliv4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_MAT2:  {Mat2 tmp = mulm2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_MAT3:  {Mat3 tmp = mulm3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_MAT4:  {Mat4 tmp = mulm4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
+                        case TYPE_INT: {i32 tmp = muli(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_UINT: {u32 tmp = mulu(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_FLOAT: {f32 tmp = mulf(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC2:  {Vec2 tmp = mulv2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC3:  {Vec3 tmp = mulv3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC4:  {Vec4 tmp = mulv4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC2: {IVec2 tmp = muliv2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC3: {IVec3 tmp = muliv3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC4: {IVec4 tmp = muliv4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_MAT2:  {Mat2 tmp = mulm2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_MAT3:  {Mat3 tmp = mulm3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_MAT4:  {Mat4 tmp = mulm4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
                         default: assert(false);
                     }
                 } else {
@@ -534,19 +1267,20 @@ static void svm_run()
             } break;
 
             case OP_DIV: {
-                void *rhs = svm_stack_pop(tsize);
-                void *lhs = svm_stack_pop(tsize);
+                SelValue rhs_ = svm_stack_pop_value(tsize);
+                SelValue lhs_ = svm_stack_pop_value(tsize);
+                void *rhs = &rhs_, *lhs = &lhs_;
                 if (op->lhs_type == op->rhs_type) {
                     switch (op->type) {
-                        case TYPE_INT: {i32 tmp = divi(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_UINT: {u32 tmp = divu(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_FLOAT: {f32 tmp = divf(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC2:  {Vec2 tmp = divv2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC3:  {Vec3 tmp = divv3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_VEC4:  {Vec4 tmp = divv4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC2: {IVec2 tmp = diviv2(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC3: {IVec3 tmp = diviv3(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_IVEC4: {IVec4 tmp = diviv4(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
+                        case TYPE_INT: {i32 tmp = divi(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_UINT: {u32 tmp = divu(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_FLOAT: {f32 tmp = divf(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC2:  {Vec2 tmp = divv2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC3:  {Vec3 tmp = divv3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_VEC4:  {Vec4 tmp = divv4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC2: {IVec2 tmp = diviv2(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC3: {IVec3 tmp = diviv3(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_IVEC4: {IVec4 tmp = diviv4(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
                         default: assert(false);
                     }
                 } else {
@@ -555,12 +1289,13 @@ static void svm_run()
             } break;
 
             case OP_REM: {
-                void *rhs = svm_stack_pop(tsize);
-                void *lhs = svm_stack_pop(tsize);
+                SelValue rhs_ = svm_stack_pop_value(tsize);
+                SelValue lhs_ = svm_stack_pop_value(tsize);
+                void *rhs = &rhs_, *lhs = &lhs_;
                 if (op->lhs_type == op->rhs_type) {
                     switch (op->type) {
-                        case TYPE_INT: {i32 tmp = remi(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
-                        case TYPE_UINT: {u32 tmp = remu(lhs, rhs); svm_stack_push(&tmp, sizeof(tmp));} break;
+                        case TYPE_INT: {i32 tmp = remi(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
+                        case TYPE_UINT: {u32 tmp = remu(lhs, rhs); svm_stack_push(&tmp, tsize);} break;
                         default: assert(false);
                     }
                 } else {
@@ -569,16 +1304,17 @@ static void svm_run()
             } break;
 
             case OP_NEG: {
-                void *val = svm_stack_pop(tsize);
+                SelValue val_ = svm_stack_pop_value(tsize);
+                void *val = &val_;
                 switch (op->type) {
-                    case TYPE_INT: {i32 tmp = negi(val); svm_stack_push(&tmp, sizeof(tmp));} break;
-                    case TYPE_FLOAT: {f32 tmp = negf(val); svm_stack_push(&tmp, sizeof(tmp));} break;
-                    case TYPE_VEC2:  {Vec2 tmp = negv2(val); svm_stack_push(&tmp, sizeof(tmp));} break;
-                    case TYPE_VEC3:  {Vec3 tmp = negv3(val); svm_stack_push(&tmp, sizeof(tmp));} break;
-                    case TYPE_VEC4:  {Vec4 tmp = negv4(val); svm_stack_push(&tmp, sizeof(tmp));} break;
-                    case TYPE_IVEC2: {IVec2 tmp = negiv2(val); svm_stack_push(&tmp, sizeof(tmp));} break;
-                    case TYPE_IVEC3: {IVec3 tmp = negiv3(val); svm_stack_push(&tmp, sizeof(tmp));} break;
-                    case TYPE_IVEC4: {IVec4 tmp = negiv4(val); svm_stack_push(&tmp, sizeof(tmp));} break;
+                    case TYPE_INT: {i32 tmp = negi(val); svm_stack_push(&tmp, tsize);} break;
+                    case TYPE_FLOAT: {f32 tmp = negf(val); svm_stack_push(&tmp, tsize);} break;
+                    case TYPE_VEC2:  {Vec2 tmp = negv2(val); svm_stack_push(&tmp, tsize);} break;
+                    case TYPE_VEC3:  {Vec3 tmp = negv3(val); svm_stack_push(&tmp, tsize);} break;
+                    case TYPE_VEC4:  {Vec4 tmp = negv4(val); svm_stack_push(&tmp, tsize);} break;
+                    case TYPE_IVEC2: {IVec2 tmp = negiv2(val); svm_stack_push(&tmp, tsize);} break;
+                    case TYPE_IVEC3: {IVec3 tmp = negiv3(val); svm_stack_push(&tmp, tsize);} break;
+                    case TYPE_IVEC4: {IVec4 tmp = negiv4(val); svm_stack_push(&tmp, tsize);} break;
                     default: assert(false);
                 }
             } break;
@@ -592,7 +1328,7 @@ static void svm_run()
                     }
                     svm_stack_pop(TYPE_TO_SIZE[func->argtypes[i]]);
                 }
-                SelValue res = (func->impl)(&svm.stack[svm.sp]);
+                SelValue res = (func->impl)(&svm_thread.stack[svm_thread.sp]);
                 svm_stack_push_selvalue(res, func->type);
             } break;
 
@@ -629,53 +1365,703 @@ static void svm_run()
                 }
                 svm_stack_push_selvalue(u.res, op->type);
             } break;
+
+            case OP_EQ: {
+                u32 size = TYPE_TO_SIZE[op->lhs_type];
+                SelValue rhs_ = svm_stack_pop_value(size);
+                SelValue lhs_ = svm_stack_pop_value(size);
+                void *rhs = &rhs_, *lhs = &lhs_;
+                i32 tmp = 0;
+                switch (op->lhs_type) {
+                        case TYPE_BOOL:
+                        case TYPE_INT:   tmp = eqi(lhs, rhs); break;
+                        case TYPE_UINT:  tmp = equ(lhs, rhs); break;
+                        case TYPE_FLOAT: tmp = eqf(lhs, rhs); break;
+                        default: assert(false);
+                }
+                svm_stack_push(&tmp, tsize);
+            } break;
+
+            case OP_NE: {
+                u32 size = TYPE_TO_SIZE[op->lhs_type];
+                SelValue rhs_ = svm_stack_pop_value(size);
+                SelValue lhs_ = svm_stack_pop_value(size);
+                void *rhs = &rhs_, *lhs = &lhs_;
+                i32 tmp = 0;
+                switch (op->lhs_type) {
+                        case TYPE_BOOL:
+                        case TYPE_INT:   tmp = nei(lhs, rhs); break;
+                        case TYPE_UINT:  tmp = neu(lhs, rhs); break;
+                        case TYPE_FLOAT: tmp = nef(lhs, rhs); break;
+                        default: assert(false);
+                }
+                svm_stack_push(&tmp, tsize);
+            } break;
+
+            case OP_LT: {
+                u32 size = TYPE_TO_SIZE[op->lhs_type];
+                SelValue rhs_ = svm_stack_pop_value(size);
+                SelValue lhs_ = svm_stack_pop_value(size);
+                void *rhs = &rhs_, *lhs = &lhs_;
+                i32 tmp = 0;
+                switch (op->lhs_type) {
+                        case TYPE_INT:   tmp = lti(lhs, rhs); break;
+                        case TYPE_UINT:  tmp = ltu(lhs, rhs); break;
+                        case TYPE_FLOAT: tmp = ltf(lhs, rhs); break;
+                        default: assert(false);
+                }
+                svm_stack_push(&tmp, tsize);
+            } break;
+
+            case OP_LE: {
+                u32 size = TYPE_TO_SIZE[op->lhs_type];
+                SelValue rhs_ = svm_stack_pop_value(size);
+                SelValue lhs_ = svm_stack_pop_value(size);
+                void *rhs = &rhs_, *lhs = &lhs_;
+                i32 tmp = 0;
+                switch (op->lhs_type) {
+                        case TYPE_INT:   tmp = lei(lhs, rhs); break;
+                        case TYPE_UINT:  tmp = leu(lhs, rhs); break;
+                        case TYPE_FLOAT: tmp = lef(lhs, rhs); break;
+                        default: assert(false);
+                }
+                svm_stack_push(&tmp, tsize);
+            } break;
+
+            case OP_GT: {
+                u32 size = TYPE_TO_SIZE[op->lhs_type];
+                SelValue rhs_ = svm_stack_pop_value(size);
+                SelValue lhs_ = svm_stack_pop_value(size);
+                void *rhs = &rhs_, *lhs = &lhs_;
+                i32 tmp = 0;
+                switch (op->lhs_type) {
+                        case TYPE_INT:   tmp = gti(lhs, rhs); break;
+                        case TYPE_UINT:  tmp = gtu(lhs, rhs); break;
+                        case TYPE_FLOAT: tmp = gtf(lhs, rhs); break;
+                        default: assert(false);
+                }
+                svm_stack_push(&tmp, tsize);
+            } break;
+
+            case OP_GE: {
+                u32 size = TYPE_TO_SIZE[op->lhs_type];
+                SelValue rhs_ = svm_stack_pop_value(size);
+                SelValue lhs_ = svm_stack_pop_value(size);
+                void *rhs = &rhs_, *lhs = &lhs_;
+                i32 tmp = 0;
+                switch (op->lhs_type) {
+                        case TYPE_INT:   tmp = gei(lhs, rhs); break;
+                        case TYPE_UINT:  tmp = geu(lhs, rhs); break;
+                        case TYPE_FLOAT: tmp = gef(lhs, rhs); break;
+                        default: assert(false);
+                }
+                svm_stack_push(&tmp, tsize);
+            } break;
+
+            case OP_JUMP_IF_FALSE: {
+                u32 skip = *(u32*)svm_next_bytes(sizeof(u32));
+                SelValue cond = svm_stack_pop_value(tsize);
+                if (!cond.val_bool) {
+                    svm_thread.pc += skip;
+                }
+            } break;
+
+            case OP_JUMP: {
+                u32 skip = *(u32*)svm_next_bytes(sizeof(u32));
+                svm_thread.pc += skip;
+            } break;
+
+            case OP_SHARED: {
+                u32 slot = *(u32*)svm_next_bytes(sizeof(u32));
+                u32 skip = *(u32*)svm_next_bytes(sizeof(u32));
+                if (svm_thread.state.shared[slot].frame == svm.frame) {
+                    svm_stack_push_selvalue(svm_thread.state.shared[slot].value, op->type);
+                    svm_thread.pc += skip;
+                }
+            } break;
+
+            case OP_PUBLISH: {
+                u32 slot = *(u32*)svm_next_bytes(sizeof(u32));
+                memcpy(&svm_thread.state.shared[slot].value, &svm_thread.stack[svm_thread.sp - tsize], tsize);
+                svm_thread.state.shared[slot].frame = svm.frame;
+            } break;
+
+            case OP_GLOBAL: {
+                u32 index = *(u32*)svm_next_bytes(sizeof(u32));
+                svm_stack_push_selvalue(svm.globals[index], op->type);
+            } break;
         }
     }
 }
 
+/* Compiles the register program of `exe` to native code once it is hot. Never on workers */
+static void svm_compile_if_hot(ExeExpr *exe)
+{
+    if (svm_thread.is_worker) {
+        return;
+    }
+    if ((exe->jit == NULL) && (exe->n_evals++ == SEL_JIT_THRESHOLD)) {
+        SelJitEnv env = {
+            .frame      = &svm.frame,
+            .changed_at = svm.changed_at,
+            .globals    = svm.globals,
+            .state_call = reg_state_call,
+        };
+        exe->jit = sel_jit_compile(exe, &env);
+    }
+}
+
+/* Runs the register program of `exe`, natively once it has been compiled */
+static void svm_execute(const ExeExpr *exe)
+{
+    if (exe->jit != NULL) {
+        exe->jit(exe->regs, &svm_thread.state);
+    } else {
+        svm_run_registers(exe);
+    }
+}
+
+/* Waits for programs to run from `sel_run_frame_programs()`, until `sel_stop_workers()` */
+static void *svm_worker_main(void *arg)
+{
+    u32 index = (u32)(uintptr_t) arg;
+    svm_thread.is_worker = true;
+    svm_thread.rand_seed = svm_workers.seeds[index];
+
+    /* from 0, not the current run, as the first may have been started before this one */
+    u64 run = 0;
+    pthread_mutex_lock(&svm_workers.lock);
+    while (true) {
+        while (!svm_workers.stop && (svm_workers.run == run)) {
+            pthread_cond_wait(&svm_workers.wake, &svm_workers.lock);
+        }
+        if (svm_workers.stop) {
+            break;
+        }
+        run = svm_workers.run;
+        if (index + 1 >= svm_workers.n_programs) {
+            continue; /* fewer programs than workers this time */
+        }
+        ExeExpr *program = svm_workers.programs[index + 1];
+        pthread_mutex_unlock(&svm_workers.lock);
+
+        svm_execute(program);
+
+        pthread_mutex_lock(&svm_workers.lock);
+        if (--svm_workers.n_running == 0) {
+            pthread_cond_signal(&svm_workers.done);
+        }
+    }
+    pthread_mutex_unlock(&svm_workers.lock);
+    return NULL;
+}
+
+/* Whether a source of change of `exe` changed since the last time it was computed */
+static b8 svm_is_stale(const ExeExpr *exe)
+{
+    if (exe->computed_at == 0) {
+        return true;
+    }
+    for (u32 i = 0; i < SEL_N_DEPS; i++) {
+        if ((exe->deps & (1u << i)) && (__atomic_load_n(&svm.changed_at[i], __ATOMIC_RELAXED) >= exe->computed_at)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* 
+ * Runs the register program of `exe`. Instructions are dispatched through a table of 
+ * label addresses (direct threading), with one handler per specialized instruction. 
+ */
+static void svm_run_registers(const ExeExpr *exe)
+{
+    static const void *handlers[N_REG_OPS] = {
+#define X(name_, ...) [REG_OP_##name_] = &&exec_##name_,
+        SEL_REG_OPS(X)
+        SEL_REG_SUPEROPS(X)
+#undef X
+        [REG_OP_HALT] = &&exec_HALT,
+    };
+
+    u8 *regs = exe->regs;
+    const RegOp *op = exe->ops;
+    goto *handlers[op->code];
+
+#define X(name_, kind_, type_, T_, handler_, fn_) \
+    exec_##name_: handler_(type_, T_, fn_); op++; goto *handlers[op->code];
+    SEL_REG_OPS(X)
+    SEL_REG_SUPEROPS(X)
+#undef X
+
+exec_HALT:
+    return;
+}
+
+/* Copies a value between registers. Constant sizes for the common cases avoid a call to memcpy */
+static inline void reg_copy(void *dst, const void *src, u32 size)
+{
+    switch (size) {
+        case 4:  memcpy(dst, src, 4); break;
+        case 8:  memcpy(dst, src, 8); break;
+        case 12: memcpy(dst, src, 12); break;
+        case 16: memcpy(dst, src, 16); break;
+        case 64: memcpy(dst, src, 64); break;
+        default: memcpy(dst, src, size); break;
+    }
+}
+
+/* 
+ * Calls the builtin of the MEMO instruction `op`, or, if the arguments are the same as 
+ * in the last call from this call site, copies the result of that call. The arguments 
+ * are overwritten by the result, so they are saved before the call.
+ */
+static void reg_memo_call(u8 *regs, const RegOp *op)
+{
+    SelMemoSlot slot;
+    memcpy(&slot, &regs[op->rhs], sizeof(slot));
+    u8 *args = &regs[op->rhs + sizeof(SelMemoSlot)];
+    u8 *result = &args[slot.args_size];
+    u32 tsize = TYPE_TO_SIZE[op->type];
+
+    if ((slot.n_calls > 0) && (memcmp(args, &regs[op->lhs], slot.args_size) == 0)) {
+        slot.n_hits++;
+    } else {
+        memcpy(args, &regs[op->lhs], slot.args_size);
+        SelValue v = (BUILTIN_FUNCTIONS[op->imm].impl)(&regs[op->lhs]);
+        memcpy(result, &v, tsize);
+    }
+    slot.n_calls++;
+    memcpy(&regs[op->rhs], &slot, sizeof(slot));
+    reg_copy(&regs[op->dst], result, tsize);
+}
+
+/* 
+ * Calls the builtin of the STATE instruction `op` on its state, once per frame. Later 
+ * calls in the same frame, e.g. by the frame program the expression is linked into, 
+ * copy the result of the first.
+ */
+static void reg_state_call(u8 *regs, const RegOp *op)
+{
+    SelState *state = &svm_states[op->rhs];
+    u32 tsize = TYPE_TO_SIZE[op->type];
+    if (state->frame != svm.frame) {
+        svm_thread.call_state = state;
+        SelValue v = (BUILTIN_FUNCTIONS[op->imm].impl)(&regs[op->lhs]);
+        svm_thread.call_state = NULL;
+        memcpy(&state->result, &v, tsize);
+        state->frame = svm.frame;
+    }
+    reg_copy(&regs[op->dst], &state->result, tsize);
+}
+
+/* Runs the register instructions from `op` up to `end` on the lanes of `svm_batch` */
+static void svm_batch_run(const RegOp *op, const RegOp *end)
+{
+    SvmLanes r[16]; // large enough for any value
+    for (; op != end; op++) {
+        u32 n_words = TYPE_TO_SIZE[op->type] / sizeof(u32);
+
+        /* instructions that do not follow from their kind */
+        switch (op->code) {
+            case REG_OP_SHARED:
+            case REG_OP_PUBLISH: {
+                continue; /* the lanes differ, so there is nothing to share */
+            } break;
+
+            case REG_OP_JUMP_IF_FALSE: {
+                const RegOp *jump = op + op->rhs; /* ends the first branch */
+                const RegOp *join = jump + jump->rhs + 1;
+                const SvmLanes *cond = svm_batch_reg(op->lhs);
+                u32 taken = 0;
+                for (u32 l = 0; l < SVM_BATCH_WIDTH; l++) {
+                    taken |= (u32) (cond->lane[l] != 0) << l;
+                }
+                u32 active = svm_batch.active;
+                if ((taken & active) == active) {
+                    continue;
+                }
+                if ((taken & active) == 0) {
+                    op = jump;
+                    continue;
+                }
+
+                /* 
+                 * Both branches leave their value in the same registers. Lanes not taking 
+                 * a branch skip its calls and integer divisions, which may be guarded by 
+                 * the condition, but still run its vector arithmetic.
+                 */
+                u32 size = (TYPE_TO_SIZE[jump->type] / sizeof(u32)) * sizeof(SvmLanes);
+                svm_batch.active = active & taken;
+                svm_batch_run(op + 1, jump);
+                memcpy(r, svm_batch_reg(jump->dst), size);
+                svm_batch.active = active & ~taken;
+                svm_batch_run(jump + 1, join);
+                svm_batch.active = active;
+                SvmLanes *d = svm_batch_reg(jump->dst);
+                for (u32 w = 0; w < size / sizeof(SvmLanes); w++) {
+                    for (u32 l = 0; l < SVM_BATCH_WIDTH; l++) {
+                        d[w].lane[l] = (taken & (1u << l)) ? r[w].lane[l] : d[w].lane[l];
+                    }
+                }
+                op = join - 1;
+                continue;
+            } break;
+
+            case REG_OP_JUMP: {
+                op += op->rhs;
+                continue;
+            } break;
+
+            case REG_OP_MOVE_BLOCK: {
+                memmove(svm_batch_reg(op->dst), svm_batch_reg(op->lhs), (op->rhs / sizeof(u32)) * sizeof(SvmLanes));
+                continue;
+            } break;
+
+            case REG_OP_CALL_MUL_F32:
+            case REG_OP_CALL_ADD_F32: {
+                svm_batch_call(op, r);
+                const SvmLanes *b = svm_batch_reg(op->rhs);
+                SvmLanes *d = svm_batch_reg(op->dst);
+                for (u32 v = 0; v < SVM_BATCH_N_VECTORS; v++) {
+                    d->f[v] = (op->code == REG_OP_CALL_MUL_F32) ? r[0].f[v] * b->f[v] : r[0].f[v] + b->f[v];
+                }
+                continue;
+            } break;
+
+            case REG_OP_MUL_ADD_F32:
+            case REG_OP_MUL_SUB_F32: {
+                const SvmLanes *a = svm_batch_reg(op->lhs);
+                const SvmLanes *b = svm_batch_reg(op->rhs);
+                const SvmLanes *c = svm_batch_reg(op->imm);
+                SvmLanes *d = svm_batch_reg(op->dst);
+                for (u32 v = 0; v < SVM_BATCH_N_VECTORS; v++) {
+                    SvmLanesF32 m = a->f[v] * b->f[v];
+                    d->f[v] = (op->code == REG_OP_MUL_ADD_F32) ? m + c->f[v] : m - c->f[v];
+                }
+                continue;
+            } break;
+
+            default: break;
+        }
+
+        switch ((OpKind) op->kind) {
+            case OP_MOVE: {
+                memmove(svm_batch_reg(op->dst), svm_batch_reg(op->lhs), n_words * sizeof(SvmLanes));
+            } break;
+
+            case OP_SWIZZLE: {
+                for (u32 i = 0; i < n_words; i++) {
+                    u32 index = (op->imm >> (8*i)) & 0xFF;
+                    r[i] = *svm_batch_reg(op->lhs + index*sizeof(u32));
+                }
+                memcpy(svm_batch_reg(op->dst), r, n_words * sizeof(SvmLanes));
+            } break;
+
+            case OP_FUNC: {
+                svm_batch_call(op, r);
+                memcpy(svm_batch_reg(op->dst), r, n_words * sizeof(SvmLanes));
+            } break;
+
+            case OP_GLOBAL: {
+                /* the same in every lane. Overrides do not reach into globals */
+                for (u32 i = 0; i < n_words; i++) {
+                    u32 word;
+                    memcpy(&word, (const u8 *)&svm.globals[op->imm] + i*sizeof(u32), sizeof(u32));
+                    SvmLanes *d = svm_batch_reg(op->dst + i*sizeof(u32));
+                    for (u32 l = 0; l < SVM_BATCH_WIDTH; l++) {
+                        d->lane[l] = word;
+                    }
+                }
+            } break;
+
+            case OP_ADD:
+            case OP_SUB:
+            case OP_MUL:
+            case OP_DIV:
+            case OP_REM:
+            case OP_NEG: {
+                if (svm_batch_is_lanewise(op)) {
+                    svm_batch_arithmetic(op, r);
+                } else {
+                    svm_batch_per_lane(op);
+                }
+            } break;
+
+            case OP_EQ:
+            case OP_NE:
+            case OP_LT:
+            case OP_LE:
+            case OP_GT:
+            case OP_GE: {
+                svm_batch_compare(op);
+            } break;
+
+            case OP_PUSH:
+            case OP_JUMP_IF_FALSE:
+            case OP_JUMP:
+            case OP_SHARED:
+            case OP_PUBLISH:
+            case OP_CONTEXT:
+            case OP_GUARD:
+            case OP_STAGE: {
+                assert(false && "not in the register program of an expression");
+            } break;
+        }
+    }
+}
+
+/* 
+ * Component-wise arithmetic, for all lanes at once. Does the same as the scalar 
+ * operators (see vecmath.h), e.g. vectors are divided by multiplying with the 
+ * reciprocal. `tmp` must hold a value.
+ */
+static void svm_batch_arithmetic(const RegOp *op, SvmLanes *tmp)
+{
+    u32 size = TYPE_TO_SIZE[op->type];
+    b8 is_float = (op->type == TYPE_FLOAT) || 
+                  ((op->type >= TYPE_VEC2) && (op->type <= TYPE_VEC4)) ||
+                  ((op->type >= TYPE_MAT2) && (op->type <= TYPE_MAT4));
+    b8 is_vector = (op->type != TYPE_FLOAT);
+
+    /* component i only depends on the i'th of the operands, unless they overlap partially */
+    u32 rhs = (op->kind == OP_NEG) ? op->lhs : op->rhs;
+    b8 in_place = ((op->dst == op->lhs) || (op->dst + size <= op->lhs) || (op->lhs + size <= op->dst)) &&
+                  ((op->dst == rhs) || (op->dst + size <= rhs) || (rhs + size <= op->dst));
+    SvmLanes *d = in_place ? svm_batch_reg(op->dst) : tmp;
+
+    /* the words of a value are consecutive, so all its lanes can be run through at once */
+    u32 n = (size / sizeof(u32)) * SVM_BATCH_N_VECTORS;
+    if (is_float) {
+        SvmLanesF32 *r = (SvmLanesF32 *) d;
+        const SvmLanesF32 *a = (const SvmLanesF32 *) svm_batch_reg(op->lhs);
+        const SvmLanesF32 *b = (const SvmLanesF32 *) svm_batch_reg(rhs);
+        switch (op->kind) {
+            case OP_ADD: for (u32 i = 0; i < n; i++) r[i] = a[i] + b[i]; break;
+            case OP_SUB: for (u32 i = 0; i < n; i++) r[i] = a[i] - b[i]; break;
+            case OP_MUL: for (u32 i = 0; i < n; i++) r[i] = a[i] * b[i]; break;
+            case OP_DIV: for (u32 i = 0; i < n; i++) r[i] = is_vector ? a[i] * (1.0f / b[i]) : a[i] / b[i]; break;
+            case OP_NEG: for (u32 i = 0; i < n; i++) r[i] = is_vector ? 0.0f - a[i] : -a[i]; break;
+            default: assert(false);
+        }
+    } else {
+        SvmLanesU32 *r = (SvmLanesU32 *) d;
+        const SvmLanesU32 *a = (const SvmLanesU32 *) svm_batch_reg(op->lhs);
+        const SvmLanesU32 *b = (const SvmLanesU32 *) svm_batch_reg(rhs);
+        switch (op->kind) {
+            case OP_ADD: for (u32 i = 0; i < n; i++) r[i] = a[i] + b[i]; break;
+            case OP_SUB: for (u32 i = 0; i < n; i++) r[i] = a[i] - b[i]; break;
+            case OP_MUL: for (u32 i = 0; i < n; i++) r[i] = a[i] * b[i]; break;
+            case OP_NEG: for (u32 i = 0; i < n; i++) r[i] = 0u - a[i]; break;
+            default: assert(false);
+        }
+    }
+
+    if (!in_place) {
+        memcpy(svm_batch_reg(op->dst), tmp, size / sizeof(u32) * sizeof(SvmLanes));
+    }
+}
+
+/* 
+ * Comparisons, for all lanes at once. Ints are compared as unsigned with their sign 
+ * bits flipped, and NaNs are neither less, greater, nor equal, like in C.
+ */
+static void svm_batch_compare(const RegOp *op)
+{
+    const SvmLanes *a = svm_batch_reg(op->lhs);
+    const SvmLanes *b = svm_batch_reg(op->rhs);
+    SvmLanes r;
+    for (u32 v = 0; v < SVM_BATCH_N_VECTORS; v++) {
+        SvmLanesU32 lt, gt, eq;
+        if (op->lhs_type == TYPE_FLOAT) {
+            lt = (SvmLanesU32) (a->f[v] < b->f[v]);
+            gt = (SvmLanesU32) (a->f[v] > b->f[v]);
+            eq = (SvmLanesU32) ((a->f[v] <= b->f[v]) & (a->f[v] >= b->f[v]));
+        } else {
+            u32 bias = (op->lhs_type == TYPE_INT) ? 0x80000000u : 0u;
+            SvmLanesU32 x = a->u[v] ^ bias;
+            SvmLanesU32 y = b->u[v] ^ bias;
+            lt = (SvmLanesU32) (x < y);
+            gt = (SvmLanesU32) (x > y);
+            eq = (SvmLanesU32) (x == y);
+        }
+        switch (op->kind) {
+            case OP_EQ: r.u[v] = eq; break;
+            case OP_NE: r.u[v] = ~eq; break;
+            case OP_LT: r.u[v] = lt; break;
+            case OP_LE: r.u[v] = lt | eq; break;
+            case OP_GT: r.u[v] = gt; break;
+            case OP_GE: r.u[v] = gt | eq; break;
+            default: assert(false);
+        }
+        r.u[v] &= 1u; /* the masks are all ones where true */
+    }
+    *svm_batch_reg(op->dst) = r;
+}
+
+/* Calls (or looks up the override of) the builtin of `op` for every active lane */
+static void svm_batch_call(const RegOp *op, SvmLanes *result)
+{
+    u32 func_id = op->imm;
+    const Func *f = &BUILTIN_FUNCTIONS[func_id];
+    u32 n_words = TYPE_TO_SIZE[f->type] / sizeof(u32);
+
+    for (u32 i = 0; i < svm_batch.n_overrides; i++) {
+        u32 override_id = svm_batch.override_funcs[i];
+        if (override_id != func_id && 
+            !((f->flags & FUNC_FLAG_LINKED) && sv_equals(f->id, BUILTIN_FUNCTIONS[override_id].id))) {
+            continue; /* a linked call overrides like the call it was linked from */
+        }
+        const u8 *values = (const u8 *) svm_batch.overrides[i].values;
+        if ((n_words == 1) && (svm_batch.first + SVM_BATCH_WIDTH <= svm_batch.n)) {
+            memcpy(result[0].lane, &values[svm_batch.first*sizeof(u32)], sizeof(SvmLanes));
+            return;
+        }
+        for (u32 l = 0; l < SVM_BATCH_WIDTH; l++) {
+            /* lanes past the end repeat the last evaluation */
+            u32 index = svm_batch.first + l;
+            index = (index < svm_batch.n) ? index : svm_batch.n - 1;
+            const u8 *value = &values[index*n_words*sizeof(u32)];
+            for (u32 w = 0; w < n_words; w++) {
+                memcpy(&result[w].lane[l], &value[w*sizeof(u32)], sizeof(u32));
+            }
+        }
+        return;
+    }
+
+    u32 args_size = 0;
+    for (u32 i = 0; i < SEL_FUNC_MAX_N_ARGS && f->argtypes[i] != TYPE_NIL; i++) {
+        args_size += TYPE_TO_SIZE[f->argtypes[i]];
+    }
+    u32 args[SEL_FUNC_MAX_N_ARGS * sizeof(Mat4) / sizeof(u32)];
+    for (u32 l = 0; l < SVM_BATCH_WIDTH; l++) {
+        if (!(svm_batch.active & (1u << l))) {
+            continue;
+        }
+        for (u32 w = 0; w < args_size / sizeof(u32); w++) {
+            args[w] = svm_batch_reg(op->lhs + w*sizeof(u32))->lane[l];
+        }
+        SelValue v = f->impl(args);
+        for (u32 w = 0; w < n_words; w++) {
+            memcpy(&result[w].lane[l], (u8 *)&v + w*sizeof(u32), sizeof(u32));
+        }
+    }
+}
+
+/* Runs `op` for each active lane in turn, on the scalar register VM */
+static void svm_batch_per_lane(const RegOp *op)
+{
+    u32 size = TYPE_TO_SIZE[op->type];
+    u32 n_words = size / sizeof(u32);
+    u32 regs[3 * sizeof(Mat4) / sizeof(u32)];
+    RegOp program[2] = {*op, {.code = REG_OP_HALT}};
+    program[0].lhs = 0;
+    program[0].rhs = (u16) size;
+    program[0].dst = (u16) (2*size);
+    ExeExpr lane = {.ops = program, .regs = (u8 *) regs};
+
+    for (u32 l = 0; l < SVM_BATCH_WIDTH; l++) {
+        if (!(svm_batch.active & (1u << l))) {
+            continue;
+        }
+        for (u32 w = 0; w < n_words; w++) {
+            regs[w] = svm_batch_reg(op->lhs + w*sizeof(u32))->lane[l];
+            if (op->kind != OP_NEG) {
+                regs[n_words + w] = svm_batch_reg(op->rhs + w*sizeof(u32))->lane[l];
+            }
+        }
+        svm_run_registers(&lane);
+        for (u32 w = 0; w < n_words; w++) {
+            svm_batch_reg(op->dst + w*sizeof(u32))->lane[l] = regs[2*n_words + w];
+        }
+    }
+}
+
+/* Whether the arithmetic instruction `op` works on each component on its own */
+static b8 svm_batch_is_lanewise(const RegOp *op)
+{
+    b8 is_matrix = (op->type >= TYPE_MAT2) && (op->type <= TYPE_MAT4);
+    b8 is_float = (op->type == TYPE_FLOAT) || ((op->type >= TYPE_VEC2) && (op->type <= TYPE_VEC4));
+    switch (op->kind) {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_NEG: return true;
+        case OP_MUL: return !is_matrix;
+        case OP_DIV: return is_float; /* integer division by zero is left to the scalar VM */
+        default:     return false;
+    }
+}
+
+static inline SvmLanes *svm_batch_reg(u32 offset)
+{
+    assert(offset % sizeof(u32) == 0);
+    return &svm_batch.regs[offset / sizeof(u32)];
+}
+
 static void svm_reset(void)
 {
-    svm.exe = NULL;
-    svm.pc  = 0;
-    svm.sp  = 0;
+    svm_thread.exe = NULL;
+    svm_thread.pc  = 0;
+    svm_thread.sp  = 0;
 }
 
 static inline void *svm_next_bytes(u32 size)
 {
-    void *data = (void *)&svm.exe->code[svm.pc]; 
-    svm.pc += size;
+    void *data = (void *)&svm_thread.exe->code[svm_thread.pc]; 
+    svm_thread.pc += size;
     return data;
 }
 
 static inline Op *svm_next_op()
 {
-    Op *op = (Op *)&svm.exe->code[svm.pc];
-    svm.pc += sizeof(Op);
+    Op *op = (Op *)&svm_thread.exe->code[svm_thread.pc];
+    svm_thread.pc += sizeof(Op);
     return op;
 }
 
 static inline void svm_stack_push(void *data, u32 size)
 {
-    if (svm.sp + size > SVM_STACK_SIZE) {
-        assert(false && "out of stack space");
-    }
-    memcpy(&svm.stack[svm.sp], data, size);
-    svm.sp += size;
+    memcpy(&svm_thread.stack[svm_thread.sp], data, size);
+    svm_thread.sp += size;
 }
 
 static inline void svm_stack_push_selvalue(SelValue v, Type t)
 {
-    memcpy(&svm.stack[svm.sp], &v, TYPE_TO_SIZE[t]);
-    svm.sp += TYPE_TO_SIZE[t];
+    memcpy(&svm_thread.stack[svm_thread.sp], &v, TYPE_TO_SIZE[t]);
+    svm_thread.sp += TYPE_TO_SIZE[t];
 }
 
 static inline void *svm_stack_pop(u32 size)
 {
-    if (svm.sp < size) {
-        assert(false && "popping below stack boundary");
+    svm_thread.sp -= size;
+    return &svm_thread.stack[svm_thread.sp];
+}
+
+/* The stack is packed, so operands are copied out to be properly aligned, e.g. `Mat3` */
+static inline SelValue svm_stack_pop_value(u32 size)
+{
+    SelValue v;
+    memcpy(&v, svm_stack_pop(size), size);
+    return v;
+}
+
+/* `rand()` is shared by all threads, and seeded by `srand()`, so workers call `rand_r()` */
+static i32 svm_rand(void)
+{
+    return svm_thread.is_worker ? rand_r(&svm_thread.rand_seed) : rand();
+}
+
+/* 
+ * The state of the `FUNC_FLAG_STATE` builtin being called. The stack VM and batches 
+ * have no call sites, so their calls find a fresh state every time, like a first call.
+ */
+static SelState *svm_call_state(void)
+{
+    if (svm_thread.call_state != NULL) {
+        return svm_thread.call_state;
     }
-    svm.sp -= size;
-    return &svm.stack[svm.sp];
+    svm_thread.fresh_state = (SelState) {0};
+    return &svm_thread.fresh_state;
 }
 
 /* ----------------------- Basic operators -------------------- */
@@ -685,46 +2071,46 @@ static inline u32 addu(u32 *lhs, u32 *rhs) { return (*lhs) + (*rhs); }
 static inline f32 addf(f32 *lhs, f32 *rhs) { return (*lhs) + (*rhs); }
 static inline Vec2 addv2(Vec2 *lhs, Vec2 *rhs) {return vec2_add(*lhs, *rhs);}
 static inline Vec3 addv3(Vec3 *lhs, Vec3 *rhs) {return vec3_add(*lhs, *rhs);}
-static inline Vec4 addv4(Vec4 *lhs, Vec4 *rhs) {return vec4_add(*lhs, *rhs);}
+static inline Vec4 addv4(Vec4 *lhs, Vec4 *rhs) {return svm_vec4_add(lhs, rhs);}
 static inline IVec2 addiv2(IVec2 *lhs, IVec2 *rhs) {return ivec2_add(*lhs, *rhs);}
 static inline IVec3 addiv3(IVec3 *lhs, IVec3 *rhs) {return ivec3_add(*lhs, *rhs);}
 static inline IVec4 addiv4(IVec4 *lhs, IVec4 *rhs) {return ivec4_add(*lhs, *rhs);}
-static inline Mat2 addm2(Mat2 *lhs, Mat2 *rhs) {return mat2_add(*lhs, *rhs);}
+static inline Mat2 addm2(Mat2 *lhs, Mat2 *rhs) {return svm_mat2_add(lhs, rhs);}
 static inline Mat3 addm3(Mat3 *lhs, Mat3 *rhs) {return mat3_add(*lhs, *rhs);}
-static inline Mat4 addm4(Mat4 *lhs, Mat4 *rhs) {return mat4_add(*lhs, *rhs);}
+static inline Mat4 addm4(Mat4 *lhs, Mat4 *rhs) {return svm_mat4_add(lhs, rhs);}
 
 static inline i32 subi(i32 *lhs, i32 *rhs) { return (*lhs) - (*rhs); }
 static inline u32 subu(u32 *lhs, u32 *rhs) { return (*lhs) - (*rhs); }
 static inline f32 subf(f32 *lhs, f32 *rhs) { return (*lhs) - (*rhs); }
 static inline Vec2 subv2(Vec2 *lhs, Vec2 *rhs) { return vec2_sub(*lhs, *rhs);}
 static inline Vec3 subv3(Vec3 *lhs, Vec3 *rhs) { return vec3_sub(*lhs, *rhs);}
-static inline Vec4 subv4(Vec4 *lhs, Vec4 *rhs) { return vec4_sub(*lhs, *rhs);}
+static inline Vec4 subv4(Vec4 *lhs, Vec4 *rhs) { return svm_vec4_sub(lhs, rhs);}
 static inline IVec2 subiv2(IVec2 *lhs, IVec2 *rhs) { return ivec2_sub(*lhs, *rhs);}
 static inline IVec3 subiv3(IVec3 *lhs, IVec3 *rhs) { return ivec3_sub(*lhs, *rhs);}
 static inline IVec4 subiv4(IVec4 *lhs, IVec4 *rhs) { return ivec4_sub(*lhs, *rhs);}
-static inline Mat2 subm2(Mat2 *lhs, Mat2 *rhs) { return mat2_sub(*lhs, *rhs);}
+static inline Mat2 subm2(Mat2 *lhs, Mat2 *rhs) { return svm_mat2_sub(lhs, rhs);}
 static inline Mat3 subm3(Mat3 *lhs, Mat3 *rhs) { return mat3_sub(*lhs, *rhs);}
-static inline Mat4 subm4(Mat4 *lhs, Mat4 *rhs) { return mat4_sub(*lhs, *rhs);}
+static inline Mat4 subm4(Mat4 *lhs, Mat4 *rhs) { return svm_mat4_sub(lhs, rhs);}
 
 static inline i32 muli(i32 *lhs, i32 *rhs) { return (*lhs) * (*rhs); }
 static inline u32 mulu(u32 *lhs, u32 *rhs) { return (*lhs) * (*rhs); }
 static inline f32 mulf(f32 *lhs, f32 *rhs) { return (*lhs) * (*rhs); }
 static inline Vec2 mulv2(Vec2 *lhs, Vec2 *rhs) { return vec2_hadamard(*lhs, *rhs);}
 static inline Vec3 mulv3(Vec3 *lhs, Vec3 *rhs) { return vec3_hadamard(*lhs, *rhs);}
-static inline Vec4 mulv4(Vec4 *lhs, Vec4 *rhs) { return vec4_hadamard(*lhs, *rhs);}
+static inline Vec4 mulv4(Vec4 *lhs, Vec4 *rhs) { return svm_vec4_mul(lhs, rhs);}
 static inline IVec2 muliv2(IVec2 *lhs, IVec2 *rhs) { return ivec2_hadamard_mul(*lhs, *rhs);}
 static inline IVec3 muliv3(IVec3 *lhs, IVec3 *rhs) { return ivec3_hadamard_mul(*lhs, *rhs);}
 static inline IVec4 muliv4(IVec4 *lhs, IVec4 *rhs) { return ivec4_hadamard_mul(*lhs, *rhs);}
 static inline Mat2 mulm2(Mat2 *lhs, Mat2 *rhs) { return mat2_mul_mat2(*lhs, *rhs);}
 static inline Mat3 mulm3(Mat3 *lhs, Mat3 *rhs) { return mat3_mul_mat3(*lhs, *rhs);}
-static inline Mat4 mulm4(Mat4 *lhs, Mat4 *rhs) { return mat4_mul_mat4(*lhs, *rhs);}
+static inline Mat4 mulm4(Mat4 *lhs, Mat4 *rhs) { return svm_mat4_mul_mat4(lhs, rhs);}
 
 static inline i32 divi(i32 *lhs, i32 *rhs) { return (*lhs) / (*rhs); }
 static inline u32 divu(u32 *lhs, u32 *rhs) { return (*lhs) / (*rhs); }
 static inline f32 divf(f32 *lhs, f32 *rhs) { return (*lhs) / (*rhs); }
 static inline Vec2 divv2(Vec2 *lhs, Vec2 *rhs) { return vec2_hadamard(*lhs, vec2_recip(*rhs));}
 static inline Vec3 divv3(Vec3 *lhs, Vec3 *rhs) { return vec3_hadamard(*lhs, vec3_recip(*rhs));}
-static inline Vec4 divv4(Vec4 *lhs, Vec4 *rhs) { return vec4_hadamard(*lhs, vec4_recip(*rhs));}
+static inline Vec4 divv4(Vec4 *lhs, Vec4 *rhs) { return svm_vec4_div(lhs, rhs);}
 static inline IVec2 diviv2(IVec2 *lhs, IVec2 *rhs) { return ivec2_hadamard_div(*lhs, *rhs);}
 static inline IVec3 diviv3(IVec3 *lhs, IVec3 *rhs) { return ivec3_hadamard_div(*lhs, *rhs);}
 static inline IVec4 diviv4(IVec4 *lhs, IVec4 *rhs) { return ivec4_hadamard_div(*lhs, *rhs);}
@@ -735,28 +2121,361 @@ static inline i32 negi(i32 *val) { return -(*val); }
 static inline f32 negf(f32 *val) { return -(*val); }
 static inline Vec2 negv2(Vec2 *val) { return vec2_sub(vec2_make(0,0), *val); }
 static inline Vec3 negv3(Vec3 *val) { return vec3_sub(vec3_make(0,0,0), *val); }
-static inline Vec4 negv4(Vec4 *val) { return vec4_sub(vec4_make(0,0,0,0), *val); }
+static inline Vec4 negv4(Vec4 *val) { return svm_vec4_neg(val); }
 static inline IVec2 negiv2(IVec2 *val) { return ivec2_sub(ivec2_make(0,0), *val); }
 static inline IVec3 negiv3(IVec3 *val) { return ivec3_sub(ivec3_make(0,0,0), *val); }
 static inline IVec4 negiv4(IVec4 *val) { return ivec4_sub(ivec4_make(0,0,0,0), *val); }
+/* Comparisons. Floats compare like in C: NaN is unequal to everything, itself included */
+static inline i32 eqi(i32 *lhs, i32 *rhs) { return (*lhs) == (*rhs); }
+static inline i32 equ(u32 *lhs, u32 *rhs) { return (*lhs) == (*rhs); }
+static inline i32 eqf(f32 *lhs, f32 *rhs) { return (*lhs) <= (*rhs) && (*lhs) >= (*rhs); }
+static inline i32 nei(i32 *lhs, i32 *rhs) { return (*lhs) != (*rhs); }
+static inline i32 neu(u32 *lhs, u32 *rhs) { return (*lhs) != (*rhs); }
+static inline i32 nef(f32 *lhs, f32 *rhs) { return !eqf(lhs, rhs); }
+static inline i32 lti(i32 *lhs, i32 *rhs) { return (*lhs) < (*rhs); }
+static inline i32 ltu(u32 *lhs, u32 *rhs) { return (*lhs) < (*rhs); }
+static inline i32 ltf(f32 *lhs, f32 *rhs) { return (*lhs) < (*rhs); }
+static inline i32 lei(i32 *lhs, i32 *rhs) { return (*lhs) <= (*rhs); }
+static inline i32 leu(u32 *lhs, u32 *rhs) { return (*lhs) <= (*rhs); }
+static inline i32 lef(f32 *lhs, f32 *rhs) { return (*lhs) <= (*rhs); }
+static inline i32 gti(i32 *lhs, i32 *rhs) { return (*lhs) > (*rhs); }
+static inline i32 gtu(u32 *lhs, u32 *rhs) { return (*lhs) > (*rhs); }
+static inline i32 gtf(f32 *lhs, f32 *rhs) { return (*lhs) > (*rhs); }
+static inline i32 gei(i32 *lhs, i32 *rhs) { return (*lhs) >= (*rhs); }
+static inline i32 geu(u32 *lhs, u32 *rhs) { return (*lhs) >= (*rhs); }
+static inline i32 gef(f32 *lhs, f32 *rhs) { return (*lhs) >= (*rhs); }
+
+/* ----------------------- Vector kernels -------------------- */
+
+/* 
+ * Vector and matrix kernels of the operators and builtins. Operands are read with 
+ * unaligned loads, as registers, the SVM stack and the arguments of builtins are 
+ * packed. Sums are formed in the order of the scalar code, and without fused 
+ * multiply-adds, so that the results are bit for bit those of hglm. 
+ */
+
+#if SVM_SIMD
+/* ((p.x + p.y) + p.z) + p.w in the lowest lane, like `a.x*b.x + a.y*b.y + ...` */
+static inline __m128 svm_sum4(__m128 p)
+{
+    __m128 s = _mm_add_ss(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)));
+    s = _mm_add_ss(s, _mm_movehl_ps(p, p));
+    return _mm_add_ss(s, _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3)));
+}
+
+static inline Vec4 svm_store_vec4(__m128 v)
+{
+    Vec4 r;
+    _mm_storeu_ps(r.f, v);
+    return r;
+}
+#endif
+
+static inline Vec4 svm_load_vec4(const void *v)
+{
+    Vec4 r;
+    memcpy(&r, v, sizeof(Vec4));
+    return r;
+}
+
+static inline Mat4 svm_load_mat4(const void *m)
+{
+    Mat4 r;
+    memcpy(&r, m, sizeof(Mat4));
+    return r;
+}
+
+static inline Vec4 svm_vec4_add(const void *a, const void *b)
+{
+#if SVM_SIMD
+    return svm_store_vec4(_mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+#else
+    return vec4_add(svm_load_vec4(a), svm_load_vec4(b));
+#endif
+}
+
+static inline Vec4 svm_vec4_sub(const void *a, const void *b)
+{
+#if SVM_SIMD
+    return svm_store_vec4(_mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+#else
+    return vec4_sub(svm_load_vec4(a), svm_load_vec4(b));
+#endif
+}
+
+static inline Vec4 svm_vec4_mul(const void *a, const void *b)
+{
+#if SVM_SIMD
+    return svm_store_vec4(_mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+#else
+    return vec4_hadamard(svm_load_vec4(a), svm_load_vec4(b));
+#endif
+}
+
+/* `a` times the reciprocal of `b`, like the other vector divisions */
+static inline Vec4 svm_vec4_div(const void *a, const void *b)
+{
+#if SVM_SIMD
+    __m128 recip = _mm_div_ps(_mm_set1_ps(1.0f), _mm_loadu_ps(b));
+    return svm_store_vec4(_mm_mul_ps(_mm_loadu_ps(a), recip));
+#else
+    return vec4_hadamard(svm_load_vec4(a), vec4_recip(svm_load_vec4(b)));
+#endif
+}
+
+/* 0 - v, which differs from flipping the sign for 0 */
+static inline Vec4 svm_vec4_neg(const void *v)
+{
+#if SVM_SIMD
+    return svm_store_vec4(_mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(v)));
+#else
+    return vec4_sub(vec4_make(0,0,0,0), svm_load_vec4(v));
+#endif
+}
+
+static inline Vec4 svm_vec4_mul_scalar(const void *v, f32 s)
+{
+#if SVM_SIMD
+    return svm_store_vec4(_mm_mul_ps(_mm_set1_ps(s), _mm_loadu_ps(v)));
+#else
+    return vec4_mul_scalar(svm_load_vec4(v), s);
+#endif
+}
+
+static inline Vec4 svm_vec4_lerp(const void *a, const void *b, f32 t)
+{
+#if SVM_SIMD
+    __m128 lhs = _mm_mul_ps(_mm_set1_ps(1.0f - t), _mm_loadu_ps(a));
+    __m128 rhs = _mm_mul_ps(_mm_set1_ps(t), _mm_loadu_ps(b));
+    return svm_store_vec4(_mm_add_ps(lhs, rhs));
+#else
+    return vec4_lerp(svm_load_vec4(a), svm_load_vec4(b), t);
+#endif
+}
+
+static inline f32 svm_vec4_dot(const void *a, const void *b)
+{
+#if SVM_SIMD
+    return _mm_cvtss_f32(svm_sum4(_mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))));
+#else
+    return vec4_dot(svm_load_vec4(a), svm_load_vec4(b));
+#endif
+}
+
+static inline f32 svm_vec4_len(const void *v)
+{
+    return sqrtf(svm_vec4_dot(v, v));
+}
+
+static inline f32 svm_vec4_distance(const void *a, const void *b)
+{
+#if SVM_SIMD
+    __m128 d = _mm_sub_ps(_mm_loadu_ps(b), _mm_loadu_ps(a));
+    return sqrtf(_mm_cvtss_f32(svm_sum4(_mm_mul_ps(d, d))));
+#else
+    return vec4_distance(svm_load_vec4(a), svm_load_vec4(b));
+#endif
+}
+
+static inline Vec4 svm_vec4_normalize(const void *v)
+{
+#if SVM_SIMD
+    __m128 x = _mm_loadu_ps(v);
+    __m128 len = _mm_sqrt_ss(svm_sum4(_mm_mul_ps(x, x)));
+    return svm_store_vec4(_mm_div_ps(x, _mm_shuffle_ps(len, len, 0)));
+#else
+    return vec4_normalize(svm_load_vec4(v));
+#endif
+}
+
+static inline Mat2 svm_mat2_add(const void *a, const void *b)
+{
+    Mat2 r;
+#if SVM_SIMD
+    _mm_storeu_ps(r.f, _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+#else
+    Mat2 lhs, rhs;
+    memcpy(&lhs, a, sizeof(Mat2));
+    memcpy(&rhs, b, sizeof(Mat2));
+    r = mat2_add(lhs, rhs);
+#endif
+    return r;
+}
+
+static inline Mat2 svm_mat2_sub(const void *a, const void *b)
+{
+    Mat2 r;
+#if SVM_SIMD
+    _mm_storeu_ps(r.f, _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+#else
+    Mat2 lhs, rhs;
+    memcpy(&lhs, a, sizeof(Mat2));
+    memcpy(&rhs, b, sizeof(Mat2));
+    r = mat2_sub(lhs, rhs);
+#endif
+    return r;
+}
+
+static inline Mat4 svm_mat4_add(const void *a, const void *b)
+{
+#if defined(__AVX__)
+    Mat4 r;
+    const f32 *fa = a, *fb = b;
+    _mm256_storeu_ps(&r.f[0], _mm256_add_ps(_mm256_loadu_ps(&fa[0]), _mm256_loadu_ps(&fb[0])));
+    _mm256_storeu_ps(&r.f[8], _mm256_add_ps(_mm256_loadu_ps(&fa[8]), _mm256_loadu_ps(&fb[8])));
+    return r;
+#elif SVM_SIMD
+    Mat4 r;
+    const f32 *fa = a, *fb = b;
+    for (u32 i = 0; i < 16; i += 4) {
+        _mm_storeu_ps(&r.f[i], _mm_add_ps(_mm_loadu_ps(&fa[i]), _mm_loadu_ps(&fb[i])));
+    }
+    return r;
+#else
+    return mat4_add(svm_load_mat4(a), svm_load_mat4(b));
+#endif
+}
+
+static inline Mat4 svm_mat4_sub(const void *a, const void *b)
+{
+#if defined(__AVX__)
+    Mat4 r;
+    const f32 *fa = a, *fb = b;
+    _mm256_storeu_ps(&r.f[0], _mm256_sub_ps(_mm256_loadu_ps(&fa[0]), _mm256_loadu_ps(&fb[0])));
+    _mm256_storeu_ps(&r.f[8], _mm256_sub_ps(_mm256_loadu_ps(&fa[8]), _mm256_loadu_ps(&fb[8])));
+    return r;
+#elif SVM_SIMD
+    Mat4 r;
+    const f32 *fa = a, *fb = b;
+    for (u32 i = 0; i < 16; i += 4) {
+        _mm_storeu_ps(&r.f[i], _mm_sub_ps(_mm_loadu_ps(&fa[i]), _mm_loadu_ps(&fb[i])));
+    }
+    return r;
+#else
+    return mat4_sub(svm_load_mat4(a), svm_load_mat4(b));
+#endif
+}
+
+static inline Mat4 svm_mat4_mul_scalar(const void *m, f32 s)
+{
+#if defined(__AVX__)
+    Mat4 r;
+    const f32 *fm = m;
+    __m256 vs = _mm256_set1_ps(s);
+    _mm256_storeu_ps(&r.f[0], _mm256_mul_ps(vs, _mm256_loadu_ps(&fm[0])));
+    _mm256_storeu_ps(&r.f[8], _mm256_mul_ps(vs, _mm256_loadu_ps(&fm[8])));
+    return r;
+#elif SVM_SIMD
+    Mat4 r;
+    const f32 *fm = m;
+    __m128 vs = _mm_set1_ps(s);
+    for (u32 i = 0; i < 16; i += 4) {
+        _mm_storeu_ps(&r.f[i], _mm_mul_ps(vs, _mm_loadu_ps(&fm[i])));
+    }
+    return r;
+#else
+    return mat4_mul_scalar(svm_load_mat4(m), s);
+#endif
+}
+
+#if SVM_SIMD
+/* The columns of `m` weighted by the components of `x`, and summed in order */
+static inline __m128 svm_combine_columns(const f32 *m, __m128 x)
+{
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(&m[0]), _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 0, 0, 0)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[4]), _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1))));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[8]), _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 2, 2))));
+    return _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[12]), _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3))));
+}
+
+/* 
+ * `a` times the matrix with the columns `b0` to `b3`, which are passed in registers so 
+ * that matrices made on the spot are not stored first. With AVX, two columns at a time.
+ */
+static inline Mat4 svm_mat4_mul_columns(const void *a, __m128 b0, __m128 b1, __m128 b2, __m128 b3)
+{
+    Mat4 r;
+    const f32 *fa = a;
+#ifdef __AVX__
+    __m256 c0 = _mm256_broadcast_ps((const __m128 *)&fa[0]);
+    __m256 c1 = _mm256_broadcast_ps((const __m128 *)&fa[4]);
+    __m256 c2 = _mm256_broadcast_ps((const __m128 *)&fa[8]);
+    __m256 c3 = _mm256_broadcast_ps((const __m128 *)&fa[12]);
+    __m256 pairs[2] = {_mm256_set_m128(b1, b0), _mm256_set_m128(b3, b2)};
+    for (u32 i = 0; i < 2; i++) {
+        __m256 x = pairs[i];
+        __m256 s = _mm256_mul_ps(c0, _mm256_permute_ps(x, _MM_SHUFFLE(0, 0, 0, 0)));
+        s = _mm256_add_ps(s, _mm256_mul_ps(c1, _mm256_permute_ps(x, _MM_SHUFFLE(1, 1, 1, 1))));
+        s = _mm256_add_ps(s, _mm256_mul_ps(c2, _mm256_permute_ps(x, _MM_SHUFFLE(2, 2, 2, 2))));
+        s = _mm256_add_ps(s, _mm256_mul_ps(c3, _mm256_permute_ps(x, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm256_storeu_ps(&r.f[8*i], s);
+    }
+#else
+    _mm_storeu_ps(&r.f[0], svm_combine_columns(fa, b0));
+    _mm_storeu_ps(&r.f[4], svm_combine_columns(fa, b1));
+    _mm_storeu_ps(&r.f[8], svm_combine_columns(fa, b2));
+    _mm_storeu_ps(&r.f[12], svm_combine_columns(fa, b3));
+#endif
+    return r;
+}
+#endif
+
+static inline Vec4 svm_mat4_mul_vec4(const void *m, const void *v)
+{
+#if SVM_SIMD
+    return svm_store_vec4(svm_combine_columns(m, _mm_loadu_ps(v)));
+#else
+    return mat4_mul_vec4(svm_load_mat4(m), svm_load_vec4(v));
+#endif
+}
+
+static inline Mat4 svm_mat4_mul_mat4(const void *a, const void *b)
+{
+#if SVM_SIMD
+    const f32 *fb = b;
+    return svm_mat4_mul_columns(a, _mm_loadu_ps(&fb[0]), _mm_loadu_ps(&fb[4]), 
+                                   _mm_loadu_ps(&fb[8]), _mm_loadu_ps(&fb[12]));
+#else
+    return mat4_mul_mat4(svm_load_mat4(a), svm_load_mat4(b));
+#endif
+}
+
+/* `m` times the scaling matrix of `v`, products with its zeros included */
+static inline Mat4 svm_mat4_scale(const void *m, const void *v)
+{
+#if SVM_SIMD
+    const f32 *fv = v;
+    return svm_mat4_mul_columns(m, _mm_set_ps(0.0f, 0.0f, 0.0f, fv[0]), _mm_set_ps(0.0f, 0.0f, fv[1], 0.0f), 
+                                   _mm_set_ps(0.0f, fv[2], 0.0f, 0.0f), _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+#else
+    Vec3 s;
+    memcpy(&s, v, sizeof(Vec3));
+    return mat4_scale(svm_load_mat4(m), s);
+#endif
+}
+
+/* Adding -0 leaves the last row alone, even where it holds 0 */
+static inline Mat4 svm_mat4_translate(const void *m, const void *v)
+{
+#if SVM_SIMD
+    Mat4 r = svm_load_mat4(m);
+    const f32 *fv = v;
+    __m128 t = _mm_set_ps(-0.0f, fv[2], fv[1], fv[0]);
+    _mm_storeu_ps(r.c3.f, _mm_add_ps(_mm_loadu_ps(r.c3.f), t));
+    return r;
+#else
+    Vec3 t;
+    memcpy(&t, v, sizeof(Vec3));
+    return mat4_translate(svm_load_mat4(m), t);
+#endif
+}
 
 /* --------------------- TEXTURE functions ------------------ */
 
 static SelValue fn_load_image_(void *args)
 {
     StringView filepath = *(StringView *)args;
-    i32 id = shaq_find_texture_id_by_name(filepath, true);
-    if (id == -1) {
-        return (SelValue) { .val_tex = {.error = 1}};
-    }
-    return (SelValue) {
-        .val_tex = {
-            .kind    = LOADED_TEXTURE,
-            .id      = (u32) id,
-            .filter  = GL_LINEAR,
-            .wrap    = GL_REPEAT,
-        }
-    };
+    return loaded_texture_(shaq_find_texture_id_by_name(filepath, true), GL_LINEAR, GL_REPEAT);
 }
 
 static SelValue fn_load_image_ex_(void *args)
@@ -765,42 +2484,14 @@ static SelValue fn_load_image_ex_(void *args)
     StringView filepath = *(StringView *)args;
     i32 filter = *(i32 *)(args8 + sizeof(StringView));
     i32 wrap = *(i32 *)(args8 + sizeof(StringView) + sizeof(i32));
-    i32 id = shaq_find_texture_id_by_name(filepath, true);
-
-    if (id == -1) {
-        return (SelValue) { .val_tex = {.error = 1}};
-    }
-    return (SelValue) {
-        .val_tex = {
-            .kind   = LOADED_TEXTURE,
-            .id     = (u32) id,
-            .filter = filter,
-            .wrap   = wrap,
-        }
-    };
+    return loaded_texture_(shaq_find_texture_id_by_name(filepath, true), filter, wrap);
 }
 
 static SelValue fn_output_of_(void *args)
 {
     StringView name = *(StringView *)args;
     i32 sid = shaq_find_shader_id_by_name(name);
-    if (sid == -1) {
-        return (SelValue) { .val_tex = {.error = 1}};
-    }
-    Shader *s = shaq_get_shader_by_id(sid);
-    if (s == svm.ctx.shader) {
-        log_error("SEL: In call to output_of(\"" SV_FMT "\") - "
-                  "Shader name refers to the current shader", 
-                  SV_ARG(name));
-    }
-    return (SelValue) {
-        .val_tex = {
-            .kind   = SHADER_CURRENT_RENDER_TEXTURE,
-            .id     = (u32) sid,
-            .filter = GL_LINEAR,
-            .wrap   = GL_REPEAT,
-        }
-    };
+    return shader_output_(sid, SHADER_CURRENT_RENDER_TEXTURE, GL_LINEAR, GL_REPEAT, 0);
 }
 
 static SelValue fn_output_of_ex_(void *args)
@@ -810,40 +2501,32 @@ static SelValue fn_output_of_ex_(void *args)
     i32 filter      = *(i32 *)(args8 + sizeof(StringView));
     i32 wrap        = *(i32 *)(args8 + sizeof(StringView) + sizeof(i32));
     i32 sid = shaq_find_shader_id_by_name(name);
-    if (sid == -1) {
-        return (SelValue) { .val_tex = {.error = 1}};
-    }
-    Shader *s = shaq_get_shader_by_id(sid);
-    if (s == svm.ctx.shader) {
-        log_error("SEL: In call to output_of_ex(\"" SV_FMT "\") - "
-                  "Shader name refers to the current shader", 
-                  SV_ARG(name));
-    }
-    return (SelValue) {
-        .val_tex = {
-            .kind   = SHADER_CURRENT_RENDER_TEXTURE,
-            .id     = (u32) sid,
-            .filter = filter,
-            .wrap   = wrap,
-        }
-    };
+    return shader_output_(sid, SHADER_CURRENT_RENDER_TEXTURE, filter, wrap, 0);
+}
+
+static SelValue fn_output_of_n_(void *args)
+{
+    u8 *args8 = (u8 *) args;
+    StringView name = *(StringView *)args;
+    i32 output      = *(i32 *)(args8 + sizeof(StringView));
+    i32 sid = shaq_find_shader_id_by_name(name);
+    return shader_output_(sid, SHADER_CURRENT_RENDER_TEXTURE, GL_LINEAR, GL_REPEAT, output);
 }
 
 static SelValue fn_last_output_of_(void *args)
 {
     StringView name = *(StringView *)args;
     i32 id = shaq_find_shader_id_by_name(name);
-    if (id == -1) {
-        return (SelValue) { .val_tex = {.error = 1}};
-    }
-    return (SelValue) {
-        .val_tex = {
-            .kind   = SHADER_LAST_RENDER_TEXTURE,
-            .id     = (u32) id,
-            .filter = GL_LINEAR,
-            .wrap   = GL_REPEAT,
-        }
-    };
+    return shader_output_(id, SHADER_LAST_RENDER_TEXTURE, GL_LINEAR, GL_REPEAT, 0);
+}
+
+static SelValue fn_last_output_of_n_(void *args)
+{
+    u8 *args8 = (u8 *) args;
+    StringView name = *(StringView *)args;
+    i32 output      = *(i32 *)(args8 + sizeof(StringView));
+    i32 id = shaq_find_shader_id_by_name(name);
+    return shader_output_(id, SHADER_LAST_RENDER_TEXTURE, GL_LINEAR, GL_REPEAT, output);
 }
 
 static SelValue fn_last_output_of_ex_(void *args)
@@ -853,20 +2536,103 @@ static SelValue fn_last_output_of_ex_(void *args)
     i32 filter      = *(i32 *)(args8 + sizeof(StringView));
     i32 wrap        = *(i32 *)(args8 + sizeof(StringView) + sizeof(i32));
     i32 id = shaq_find_shader_id_by_name(name);
-    if (id == -1) {
+    return shader_output_(id, SHADER_LAST_RENDER_TEXTURE, filter, wrap, 0);
+}
+
+/* The same, with the texture id or shader id resolved by `link_texture_()` or `link_shader_()` */
+static SelValue fn_load_image_linked_(void *args)
+{
+    i32 *a = (i32 *) args;
+    return loaded_texture_(a[0], GL_LINEAR, GL_REPEAT);
+}
+
+static SelValue fn_load_image_ex_linked_(void *args)
+{
+    i32 *a = (i32 *) args;
+    return loaded_texture_(a[0], a[1], a[2]);
+}
+
+static SelValue fn_output_of_linked_(void *args)
+{
+    i32 *a = (i32 *) args;
+    return shader_output_(a[0], SHADER_CURRENT_RENDER_TEXTURE, GL_LINEAR, GL_REPEAT, 0);
+}
+
+static SelValue fn_output_of_ex_linked_(void *args)
+{
+    i32 *a = (i32 *) args;
+    return shader_output_(a[0], SHADER_CURRENT_RENDER_TEXTURE, a[1], a[2], 0);
+}
+
+static SelValue fn_output_of_n_linked_(void *args)
+{
+    i32 *a = (i32 *) args;
+    return shader_output_(a[0], SHADER_CURRENT_RENDER_TEXTURE, GL_LINEAR, GL_REPEAT, a[1]);
+}
+
+static SelValue fn_last_output_of_linked_(void *args)
+{
+    i32 *a = (i32 *) args;
+    return shader_output_(a[0], SHADER_LAST_RENDER_TEXTURE, GL_LINEAR, GL_REPEAT, 0);
+}
+
+static SelValue fn_last_output_of_ex_linked_(void *args)
+{
+    i32 *a = (i32 *) args;
+    return shader_output_(a[0], SHADER_LAST_RENDER_TEXTURE, a[1], a[2], 0);
+}
+
+static SelValue fn_last_output_of_n_linked_(void *args)
+{
+    i32 *a = (i32 *) args;
+    return shader_output_(a[0], SHADER_LAST_RENDER_TEXTURE, GL_LINEAR, GL_REPEAT, a[1]);
+}
+
+/* Reference to render target `output` of the shader with id `sid`, or an error if there is none */
+static SelValue shader_output_(i32 sid, TextureKind kind, i32 filter, i32 wrap, i32 output)
+{
+    const char *fn = (kind == SHADER_CURRENT_RENDER_TEXTURE) ? "output_of" : "last_output_of";
+    Shader *s = shaq_get_shader_by_id(sid);
+    if (s == NULL) {
+        return (SelValue) { .val_tex = {.error = 1}};
+    }
+    if (kind == SHADER_CURRENT_RENDER_TEXTURE && s == svm_thread.state.ctx.shader) {
+        log_error("SEL: In call to %s(\"" SV_FMT "\") - "
+                  "Shader name refers to the current shader", 
+                  fn, SV_ARG(s->name));
+    }
+    if (output < 0 || output >= s->attributes.outputs) {
+        log_error("SEL: In call to %s(\"" SV_FMT "\", %d) - "
+                  "Shader has only %d output(s)", 
+                  fn, SV_ARG(s->name), output, s->attributes.outputs);
         return (SelValue) { .val_tex = {.error = 1}};
     }
     return (SelValue) {
         .val_tex = {
-            .kind   = SHADER_LAST_RENDER_TEXTURE,
-            .id     = (u32) id,
+            .kind   = kind,
+            .id     = sid,
             .filter = filter,
             .wrap   = wrap,
+            .output = output,
         }
     };
 }
 
-
+/* Reference to the loaded texture with id `id`, or an error if the texture could not be loaded */
+static SelValue loaded_texture_(i32 id, i32 filter, i32 wrap)
+{
+    if (id == -1) {
+        return (SelValue) { .val_tex = {.error = 1}};
+    }
+    return (SelValue) {
+        .val_tex = {
+            .kind   = LOADED_TEXTURE,
+            .id     = id,
+            .filter = filter,
+            .wrap   = wrap,
+        }
+    };
+}
 
 /* ---------------------- BOOL functions -------------------- */
 
@@ -964,7 +2730,7 @@ static SelValue fn_randi_(void *args)
     i32 *args_i32 = (i32 *) args;
     i32 min = args_i32[0];
     i32 max = args_i32[1];
-    return (SelValue) {.val_i32 = rand() % (max + 1 - min) + min}; 
+    return (SelValue) {.val_i32 = svm_rand() % (max + 1 - min) + min}; 
 }
 
 static SelValue fn_iota_(void *args)
@@ -980,6 +2746,13 @@ static SelValue fn_frame_count_(void *args)
     return (SelValue) {.val_i32 = shaq_frame_count()};
 }
 
+/* Overridden by `sel_eval_array()` */
+static SelValue fn_index_(void *args)
+{
+    (void) args;
+    return (SelValue) {.val_i32 = 0};
+}
+
 /* ----------------------- UINT functions --------------------- */
 
 static SelValue fn_signed_(void *args)
@@ -1074,7 +2847,7 @@ static SelValue fn_rand_(void *args)
     f32 min = args_f32[0];
     f32 max = args_f32[1];
     f32 range = max - min;
-    return (SelValue) {.val_f32 = ((f32)rand()/(f32)RAND_MAX)*range + min}; 
+    return (SelValue) {.val_f32 = ((f32)svm_rand()/(f32)RAND_MAX)*range + min}; 
 }
 
 static SelValue fn_sqrt_(void *args)
@@ -1375,7 +3148,7 @@ static SelValue fn_vec3_lerp_(void *args)
 static SelValue fn_vec3_slerp_(void *args)
 {
     Vec3 *args_v3 = (Vec3 *) args;
-    return (SelValue) {.val_vec3 = hglm_vec3_lerp(args_v3[0], args_v3[1], *(f32*)&args_v3[2])};
+    return (SelValue) {.val_vec3 = hglm_vec3_slerp(args_v3[0], args_v3[1], *(f32*)&args_v3[2])};
 } 
   
 static SelValue fn_vec3_cross_(void *args)
@@ -1393,40 +3166,39 @@ static SelValue fn_vec4_(void *args)
     return (SelValue) {.val_vec4 = hglm_vec4_make(args_f32[0], args_f32[1], args_f32[2], args_f32[3])};
 }
 
+/* the arguments are packed, so vectors are not dereferenced, but loaded by the kernels */
 static SelValue fn_vec4_distance_(void *args)
 {
-    Vec4 *args_v4 = (Vec4 *) args;
-    return (SelValue) {.val_f32 = hglm_vec4_distance(args_v4[0], args_v4[1])};
+    f32 *args_f32 = (f32 *) args;
+    return (SelValue) {.val_f32 = svm_vec4_distance(&args_f32[0], &args_f32[4])};
 } 
   
 static SelValue fn_vec4_length_(void *args)
 {
-    Vec4 *args_v4 = (Vec4 *) args;
-    return (SelValue) {.val_f32 = hglm_vec4_len(args_v4[0])};
+    return (SelValue) {.val_f32 = svm_vec4_len(args)};
 } 
   
 static SelValue fn_vec4_normalize_(void *args)
 {
-    Vec4 *args_v4 = (Vec4 *) args;
-    return (SelValue) {.val_vec4 = hglm_vec4_normalize(args_v4[0])};
+    return (SelValue) {.val_vec4 = svm_vec4_normalize(args)};
 } 
   
 static SelValue fn_vec4_dot_(void *args)
 {
-    Vec4 *args_v4 = (Vec4 *) args;
-    return (SelValue) {.val_f32 = hglm_vec4_dot(args_v4[0], args_v4[1])};
+    f32 *args_f32 = (f32 *) args;
+    return (SelValue) {.val_f32 = svm_vec4_dot(&args_f32[0], &args_f32[4])};
 } 
   
 static SelValue fn_vec4_mul_scalar_(void *args)
 {
-    Vec4 *args_v4 = (Vec4 *) args;
-    return (SelValue) {.val_vec4 = hglm_vec4_mul_scalar(args_v4[0], *(f32*)&args_v4[1])};
+    f32 *args_f32 = (f32 *) args;
+    return (SelValue) {.val_vec4 = svm_vec4_mul_scalar(&args_f32[0], args_f32[4])};
 } 
   
 static SelValue fn_vec4_lerp_(void *args)
 {
-    Vec4 *args_v4 = (Vec4 *) args;
-    return (SelValue) {.val_vec4 = hglm_vec4_lerp(args_v4[0], args_v4[1], *(f32*)&args_v4[2])};
+    f32 *args_f32 = (f32 *) args;
+    return (SelValue) {.val_vec4 = svm_vec4_lerp(&args_f32[0], &args_f32[4], args_f32[8])};
 } 
   
 static SelValue fn_rgba_(void *args)
@@ -1468,10 +3240,19 @@ static SelValue fn_resolution_of_(void *args)
     }
 }
 
+static SelValue fn_resolution_of_linked_(void *args)
+{
+    Shader *s = shaq_get_shader_by_id(*(i32 *)args);
+    if (s == NULL) {
+        return (SelValue) {.val_ivec2 = ivec2_make(0, 0)}; /* reported by `link_shader_()` */
+    }
+    return (SelValue) {.val_ivec2 = s->attributes.resolution};
+}
+
 static SelValue fn_resolution_(void *args)
 {
     (void) args;
-    Shader *s = svm.ctx.shader;
+    Shader *s = svm_thread.state.ctx.shader;
     if (s == NULL) {
         log_error("SEL: In call to resolution() - No shader bound in the current context");
         return (SelValue) {.val_ivec2 = ivec2_make(0, 0)};
@@ -1480,6 +3261,20 @@ static SelValue fn_resolution_(void *args)
     }
 }
 
+static SelValue fn_output_resolution_(void *args)
+{
+    if (shaq_is_rendering_tiled()) {
+        return (SelValue) {.val_ivec2 = shaq_tiled_output_resolution()};
+    }
+    return fn_resolution_(args);
+}
+
+static SelValue fn_tile_offset_(void *args)
+{
+    (void) args;
+    return (SelValue) {.val_ivec2 = shaq_tile_offset()};
+}
+
 /* ---------------------- IVEC4 functions -------------------- */
 
 static SelValue fn_ivec3_(void *args)
@@ -1530,10 +3325,10 @@ static SelValue fn_mat3_id_(void *args)
 
 /* ---------------------- MAT4 functions -------------------- */
 
+/* the arguments are packed, so matrices are not dereferenced, but loaded by the kernels */
 static SelValue fn_mat4_(void *args)
 {
-    Vec4 *args_v4 = (Vec4 *) args;
-    return (SelValue) {.val_mat4 = hglm_mat4_make(args_v4[0], args_v4[1], args_v4[2], args_v4[3])};
+    return (SelValue) {.val_mat4 = svm_load_mat4(args)};
 }
 
 static SelValue fn_mat4_id_(void *args)
@@ -1568,44 +3363,135 @@ static SelValue fn_mat4_look_at_(void *args)
 
 static SelValue fn_mat4_scale_(void *args)
 { 
-    Mat4 *args_m4 = (Mat4 *) args;
-    return (SelValue) {.val_mat4 = hglm_mat4_scale(args_m4[0], *(Vec3*)&args_m4[1])};
+    f32 *args_f32 = (f32 *) args;
+    return (SelValue) {.val_mat4 = svm_mat4_scale(&args_f32[0], &args_f32[16])};
 }  
 
 static SelValue fn_mat4_rotate_(void *args)
 { 
-    u8 *args8 = (u8 *) args;
-    Mat4 *args_m4 = (Mat4 *) args;
-    return (SelValue) {.val_mat4 = hglm_mat4_rotate(args_m4[0], 
-                                                   *(f32*)(args8 + sizeof(Mat4)), 
-                                                   *(Vec3*)(args8 + sizeof(Mat4) + sizeof(Vec3)))};
+    /* left to the scalar code, as the sines and cosines dominate */
+    f32 *args_f32 = (f32 *) args;
+    return (SelValue) {.val_mat4 = hglm_mat4_rotate(svm_load_mat4(&args_f32[0]), args_f32[16], *(Vec3*)&args_f32[17])};
 }  
 
 static SelValue fn_mat4_translate_(void *args)
 { 
-    Mat4 *args_m4 = (Mat4 *) args;
-    return (SelValue) {.val_mat4 = hglm_mat4_translate(args_m4[0], *(Vec3*)&args_m4[1])};
+    f32 *args_f32 = (f32 *) args;
+    return (SelValue) {.val_mat4 = svm_mat4_translate(&args_f32[0], &args_f32[16])};
 }  
 
 static SelValue fn_mat4_mul_mat4_(void *args)
 { 
-    Mat4 *args_m4 = (Mat4 *) args;
-    return (SelValue) {.val_mat4 = hglm_mat4_mul_mat4(args_m4[0], args_m4[1])};
+    f32 *args_f32 = (f32 *) args;
+    return (SelValue) {.val_mat4 = svm_mat4_mul_mat4(&args_f32[0], &args_f32[16])};
 }  
 
 static SelValue fn_mat4_mul_vec4_(void *args)
 { 
-    Mat4 *args_m4 = (Mat4 *) args;
-    return (SelValue) {.val_vec4 = hglm_mat4_mul_vec4(args_m4[0], *(Vec4*)&args_m4[1])};
+    f32 *args_f32 = (f32 *) args;
+    return (SelValue) {.val_vec4 = svm_mat4_mul_vec4(&args_f32[0], &args_f32[16])};
 }  
 
 static SelValue fn_mat4_mul_scalar_(void *args)
 { 
-    Mat4 *args_m4 = (Mat4 *) args;
-    return (SelValue) {.val_mat4 = hglm_mat4_mul_scalar(args_m4[0], *(f32*)&args_m4[1])};
+    f32 *args_f32 = (f32 *) args;
+    return (SelValue) {.val_mat4 = svm_mat4_mul_scalar(&args_f32[0], args_f32[16])};
 }  
 
 
+/* ---------------------- STATE functions ------------------- */
+
+static SelValue fn_smooth_(void *args)         { return state_smooth_((f32 *) args, 1); }
+static SelValue fn_smooth_vec2_(void *args)    { return state_smooth_((f32 *) args, 2); }
+static SelValue fn_smooth_vec3_(void *args)    { return state_smooth_((f32 *) args, 3); }
+static SelValue fn_smooth_vec4_(void *args)    { return state_smooth_((f32 *) args, 4); }
+static SelValue fn_integrate_(void *args)      { return state_integrate_((f32 *) args, 1); }
+static SelValue fn_integrate_vec2_(void *args) { return state_integrate_((f32 *) args, 2); }
+static SelValue fn_integrate_vec3_(void *args) { return state_integrate_((f32 *) args, 3); }
+static SelValue fn_integrate_vec4_(void *args) { return state_integrate_((f32 *) args, 4); }
+static SelValue fn_prev_(void *args)           { return state_prev_(args, 1); }
+static SelValue fn_prev_vec2_(void *args)      { return state_prev_(args, 2); }
+static SelValue fn_prev_vec3_(void *args)      { return state_prev_(args, 3); }
+static SelValue fn_prev_vec4_(void *args)      { return state_prev_(args, 4); }
+static SelValue fn_spring_(void *args)         { return state_spring_((f32 *) args, 1); }
+static SelValue fn_spring_vec2_(void *args)    { return state_spring_((f32 *) args, 2); }
+static SelValue fn_spring_vec3_(void *args)    { return state_spring_((f32 *) args, 3); }
+
+static SelValue fn_counter_(void *args)
+{
+    (void) args;
+    SelState *state = svm_call_state();
+    i32 n = 0;
+    if (state->frame != 0) {
+        memcpy(&n, &state->values[0], sizeof(i32));
+        n++;
+    }
+    memcpy(&state->values[0], &n, sizeof(i32));
+    return (SelValue) {.val_i32 = n};
+}
+
+/* Exponential smoothing of the `n` components of `x`, followed by the rate */
+static SelValue state_smooth_(const f32 *args, u32 n)
+{
+    SelState *state = svm_call_state();
+    f32 t = 1.0f - expf(-args[n] * shaq_deltatime());
+    for (u32 i = 0; i < n; i++) {
+        f32 s = state->values[i];
+        state->values[i] = (state->frame == 0) ? args[i] : s + (args[i] - s)*t;
+    }
+    SelValue v = {0};
+    memcpy(&v, state->values, n*sizeof(f32));
+    return v;
+}
+
+static SelValue state_integrate_(const f32 *args, u32 n)
+{
+    SelState *state = svm_call_state();
+    f32 dt = (state->frame == 0) ? 0.0f : shaq_deltatime();
+    for (u32 i = 0; i < n; i++) {
+        state->values[i] += args[i]*dt;
+    }
+    SelValue v = {0};
+    memcpy(&v, state->values, n*sizeof(f32));
+    return v;
+}
+
+/* `n` words of any type */
+static SelValue state_prev_(const void *args, u32 n)
+{
+    SelState *state = svm_call_state();
+    SelValue v = {0};
+    memcpy(&v, (state->frame == 0) ? args : (const void *) state->values, n*sizeof(u32));
+    memcpy(state->values, args, n*sizeof(u32));
+    return v;
+}
+
+/* 
+ * Damped spring, by semi-implicit Euler steps: the velocity first, then the position. 
+ * The `n` components of the target are followed by the stiffness and the damping. 
+ */
+static SelValue state_spring_(const f32 *args, u32 n)
+{
+    SelState *state = svm_call_state();
+    f32 *p = &state->values[0];
+    f32 *v = &state->values[4];
+    f32 k = args[n];
+    f32 d = args[n + 1];
+    f32 dt = shaq_deltatime();
+    for (u32 i = 0; i < n; i++) {
+        if (state->frame == 0) {
+            p[i] = args[i];
+            v[i] = 0.0f;
+            continue;
+        }
+        v[i] += (k*(args[i] - p[i]) - d*v[i])*dt;
+        p[i] += v[i]*dt;
+    }
+    SelValue r = {0};
+    memcpy(&r, p, n*sizeof(f32));
+    return r;
+}
+
 /* ---------------------- GUI functions --------------------- */
 
 static SelValue fn_input_float_(void *args)
@@ -1688,6 +3574,12 @@ static SelValue fn_color_picker_(void *args)
     return gui_get_widget_value(label, COLOR_PICKER, secondary_args, sizeof(Vec4));
 }
 
+/* Any of the above, bound to its widget by `link_widget_()` */
+static SelValue fn_widget_linked_(void *args)
+{
+    return gui_get_widget_value_by_handle(*(u32 *)args);
+}
+
 /* ---------------------- Copy functions -------------------- */
 
 static SelValue fn_copy_helper_(void *args, Type t)
@@ -1715,7 +3607,7 @@ static SelValue fn_copy_helper_(void *args, Type t)
         }
         goto out_err;
     }
-    if (u->type != t) {
+    if (u->type != t || u->count > 0) {
         if (shaq_reloaded_this_frame()) {
             log_error("SEL: In call to copy_*(\"" SV_FMT "\", \"" SV_FMT "\") - "
                       "Variable \"" SV_FMT "\" has incorrect type ", SV_ARG(shader_name), 
@@ -1723,7 +3615,7 @@ static SelValue fn_copy_helper_(void *args, Type t)
         }
         goto out_err;
     }
-    return u->exe->cached_computed_value;
+    return uniform_get_value(u);
 
 out_err:
     return (SelValue) {.val_i32 = 0};
@@ -1743,4 +3635,113 @@ static SelValue fn_copy_mat2_(void *args)  { return fn_copy_helper_(args, TYPE_M
 static SelValue fn_copy_mat3_(void *args)  { return fn_copy_helper_(args, TYPE_MAT3); }
 static SelValue fn_copy_mat4_(void *args)  { return fn_copy_helper_(args, TYPE_MAT4); }
 
+/* The same, with the shader id and uniform index resolved by `link_uniform_()` */
+static SelValue fn_copy_linked_(void *args)
+{
+    i32 *a = (i32 *) args;
+    Shader *s = shaq_get_shader_by_id(a[0]);
+    if (s == NULL || a[1] == -1) {
+        return (SelValue) {.val_i32 = 0};
+    }
+    return uniform_get_value(&s->uniforms.arr[a[1]]);
+}
+
+/* ---------------------- Link functions -------------------- */
+
+/* 
+ * Resolve the arguments passed as literals to the builtins that take them (`args[i]` 
+ * is NULL for any other) into the handles taken in place of the string arguments by 
+ * their `FUNC_FLAG_LINKED` overloads. Names that don't resolve give the handle -1. 
+ * Called once per call site, by `sel_end_session()`, so any error is reported once 
+ * instead of on every evaluation. Return false to leave the call as it is.
+ */
+static b8 link_texture_(const Func *f, const SelValue *const *args, i32 *handles)
+{
+    (void) f;
+    if (args[0] == NULL) {
+        return false;
+    }
+    handles[0] = shaq_find_texture_id_by_name(args[0]->val_str, true);
+    return true;
+}
+
+static b8 link_shader_(const Func *f, const SelValue *const *args, i32 *handles)
+{
+    if (args[0] == NULL) {
+        return false;
+    }
+    StringView name = args[0]->val_str;
+    handles[0] = shaq_find_shader_id_by_name(name);
+    if (handles[0] == -1) {
+        log_error("SEL: In call to " SV_FMT "(\"" SV_FMT "\") - "
+                  "No shader with such a name found", SV_ARG(f->id), SV_ARG(name));
+    }
+    return true;
+}
+
+static b8 link_uniform_(const Func *f, const SelValue *const *args, i32 *handles)
+{
+    if (args[0] == NULL || args[1] == NULL) {
+        return false;
+    }
+    StringView shader_name = args[0]->val_str;
+    StringView var_name = args[1]->val_str;
+    handles[0] = shaq_find_shader_id_by_name(shader_name);
+    handles[1] = -1;
+    Shader *s = shaq_get_shader_by_id(handles[0]);
+    if (s == NULL) {
+        log_error("SEL: In call to " SV_FMT "(\"" SV_FMT "\", \"" SV_FMT "\") - "
+                  "No such shader:\"" SV_FMT "\" ", SV_ARG(f->id), SV_ARG(shader_name), 
+                  SV_ARG(var_name), SV_ARG(shader_name));
+        return true;
+    }
+    Uniform *u = shader_find_uniform_by_name(s, var_name);
+    if (u == NULL) {
+        log_error("SEL: In call to " SV_FMT "(\"" SV_FMT "\", \"" SV_FMT "\") - "
+                  "No such uniform variable in shader :\"" SV_FMT "\" ", SV_ARG(f->id), SV_ARG(shader_name), 
+                  SV_ARG(var_name), SV_ARG(var_name));
+        return true;
+    }
+    if (u->type != f->type || u->count > 0) {
+        log_error("SEL: In call to " SV_FMT "(\"" SV_FMT "\", \"" SV_FMT "\") - "
+                  "Variable \"" SV_FMT "\" has incorrect type ", SV_ARG(f->id), SV_ARG(shader_name), 
+                  SV_ARG(var_name), SV_ARG(var_name));
+        return true;
+    }
+    handles[1] = (i32)(u - s->uniforms.arr);
+    return true;
+}
+
+/* 
+ * Widgets are registered here, and the call bound to the widget, when the label and 
+ * the secondary arguments are all literals. Packs the secondary arguments like the VM.
+ */
+static b8 link_widget_(const Func *f, const SelValue *const *args, i32 *handles, WidgetKind kind, u32 secondary_args_size)
+{
+    u8 secondary_args[64] = {0};
+    u32 offset = 0;
+    for (u32 i = 0; i < SEL_FUNC_MAX_N_ARGS && f->argtypes[i] != TYPE_NIL; i++) {
+        if (args[i] == NULL) {
+            return false;
+        }
+        if (i > 0) {
+            memcpy(&secondary_args[offset], args[i], TYPE_TO_SIZE[f->argtypes[i]]);
+            offset += TYPE_TO_SIZE[f->argtypes[i]];
+        }
+    }
+    handles[0] = (i32) gui_register_widget(args[0]->val_str, kind, secondary_args, secondary_args_size);
+    return true;
+}
+
+static b8 link_input_float_(const Func *f, const SelValue *const *args, i32 *handles)      { return link_widget_(f, args, handles, INPUT_FLOAT, 1*sizeof(f32)); }
+static b8 link_checkbox_(const Func *f, const SelValue *const *args, i32 *handles)         { return link_widget_(f, args, handles, CHECKBOX, 1*sizeof(f32)); }
+static b8 link_drag_int_(const Func *f, const SelValue *const *args, i32 *handles)         { return link_widget_(f, args, handles, DRAG_INT, 3*sizeof(i32) + 1*sizeof(f32)); }
+static b8 link_slider_float_(const Func *f, const SelValue *const *args, i32 *handles)     { return link_widget_(f, args, handles, SLIDER_FLOAT, 3*sizeof(f32)); }
+static b8 link_slider_float_log_(const Func *f, const SelValue *const *args, i32 *handles) { return link_widget_(f, args, handles, SLIDER_FLOAT_LOG, 3*sizeof(f32)); }
+static b8 link_input_int_(const Func *f, const SelValue *const *args, i32 *handles)        { return link_widget_(f, args, handles, INPUT_INT, sizeof(i32)); }
+static b8 link_input_vec2_(const Func *f, const SelValue *const *args, i32 *handles)       { return link_widget_(f, args, handles, INPUT_VEC2, sizeof(Vec2)); }
+static b8 link_input_vec3_(const Func *f, const SelValue *const *args, i32 *handles)       { return link_widget_(f, args, handles, INPUT_VEC3, sizeof(Vec3)); }
+static b8 link_input_vec4_(const Func *f, const SelValue *const *args, i32 *handles)       { return link_widget_(f, args, handles, INPUT_VEC4, sizeof(Vec4)); }
+static b8 link_color_picker_(const Func *f, const SelValue *const *args, i32 *handles)     { return link_widget_(f, args, handles, COLOR_PICKER, sizeof(Vec4)); }
+
 
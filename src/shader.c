@@ -6,9 +6,11 @@
 #include "shaq_core.h"
 #include "renderer.h"
 #include "gui.h"
+#include "fusion.h"
 #include "log.h"
 
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
 
 /*--- Private macros --------------------------------------------------------------------*/
@@ -17,8 +19,10 @@
 
 /*--- Private function prototypes -------------------------------------------------------*/
 
-u32 make_shader_program(u8 *frag_shader_src); // TODO remove?
+static u32 make_shader_program(StringView name, const char *frag_shader_src, i32 frag_shader_src_size);
 static void parse_attribute_from_kv_pair(Shader *s, HglIniKVPair *kv);
+static void update_uniforms(Shader *s, u32 *texture_unit);
+static void update_array_uniform(Shader *s, Uniform *u);
 static size_t whitespace_lexeme(StringView sv);
 
 /*--- Public variables ------------------------------------------------------------------*/
@@ -51,6 +55,27 @@ const char *const LAST_PASS_FRAGMENT_SHADER_SOURCE =
     "}\n                                                    "
 ;
 
+/* 
+ * Used to write the stencil pattern of interleaved shaders. Each pixel is assigned
+ * to one of `interleave` phases: a checkerboard for `interleave = 2`, and a 2x2 
+ * ordered pattern for `interleave = 4`.
+ */
+const char *const INTERLEAVE_PATTERN_FRAGMENT_SHADER_SOURCE =
+    "#version 330 core\n                                              "
+    "\n                                                               "
+    "uniform int interleave;\n                                        "
+    "uniform int phase;\n                                             "
+    "\n                                                               "
+    "void main(void)\n                                                "
+    "{\n                                                              "
+    "    ivec2 p = ivec2(gl_FragCoord.xy) & 1;\n                      "
+    "    int idx = (interleave == 2) ? (p.x ^ p.y) : (p.x + 2*p.y);\n "
+    "    if (idx != phase) {\n                                        "
+    "        discard;\n                                               "
+    "    }\n                                                          "
+    "}\n                                                              "
+;
+
 /*--- Public functions ------------------------------------------------------------------*/
 
 i32 shader_parse_from_ini_section(Shader *sh, HglIniSection *s)
@@ -59,6 +84,7 @@ i32 shader_parse_from_ini_section(Shader *sh, HglIniSection *s)
     memset(sh, 0, sizeof(*sh));
     array_clear(&sh->uniforms); // not necessary
     array_clear(&sh->shader_depends); // not necessary
+    sh->fused_into = -1;
 
     /* get name */ 
     sh->name = sv_from_cstr(s->name);
@@ -115,6 +141,12 @@ i32 shader_parse_from_ini_section(Shader *sh, HglIniSection *s)
         sh->attributes.resolution.y == 0) {
         sh->attributes.resolution = gui_shader_window_size();
     } 
+    if (sh->attributes.interleave == 0) {
+        sh->attributes.interleave = 1;
+    }
+    if (sh->attributes.outputs == 0) {
+        sh->attributes.outputs = 1;
+    }
 
     return 0;
 }
@@ -128,7 +160,7 @@ void shader_determine_dependencies(Shader *s)
             continue;
         }
         SelValue r = sel_eval(u->exe, (SVMContext){s}, true);
-        if (r.val_tex.kind == SHADER_CURRENT_RENDER_TEXTURE) {
+        if (!r.val_tex.error && r.val_tex.kind == SHADER_CURRENT_RENDER_TEXTURE) {
             array_push(&s->shader_depends, r.val_tex.id);
         }
     } 
@@ -177,92 +209,90 @@ void shader_reload(Shader *s)
         glDeleteProgram(s->gl_shader_program_id);
         s->gl_shader_program_id = 0;
     }
-    texture_free(&s->render_texture[0]);
-    texture_free(&s->render_texture[1]);
-
-    u32 vert_shader = glCreateShader(GL_VERTEX_SHADER);
-    u32 frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    u32 shader_program = glCreateProgram();
-
-    i32 size = (i32) s->frag_shader_src_size;
-    glShaderSource(vert_shader, 1, &PASS_THROUGH_VERT_SHADER_SOURCE, NULL);
-    glShaderSource(frag_shader, 1, (const char * const *)&s->frag_shader_src, &size);
-    glCompileShader(vert_shader);
-    glCompileShader(frag_shader);
-    glAttachShader(shader_program, vert_shader);
-    glAttachShader(shader_program, frag_shader);
-    glLinkProgram(shader_program);
-    
-    i32 vert_success, frag_success, link_success;
-    glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &vert_success);
-    glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &frag_success);
-    glGetProgramiv(shader_program, GL_LINK_STATUS, &link_success);
-
-    glDeleteShader(vert_shader);
-    glDeleteShader(frag_shader);
+    for (i32 i = 0; i < SHAQ_MAX_N_OUTPUTS; i++) {
+        texture_free(&s->render_texture[0][i]);
+        texture_free(&s->render_texture[1][i]);
+    }
 
-    // TODO better error handling
-    if (!(vert_success & frag_success & link_success))
-    {
-        char log[4096];
-        log_error("Failed to compile shader `" SV_FMT "`.", SV_ARG(s->name));
-        glGetShaderInfoLog(vert_shader, 4096, NULL, log);
-        log_error("Vertex shader error(s):\n%s", log);
-        glGetShaderInfoLog(frag_shader, 4096, NULL, log);
-        log_error("Fragment shader error(s):\n%s", log);
-        glGetProgramInfoLog(shader_program, 4096, NULL, log);
-        log_error("Linking error(s):\n%s", log);
+    u32 shader_program = make_shader_program(s->name, (const char *) s->frag_shader_src, 
+                                             (i32) s->frag_shader_src_size);
+    if (shader_program == 0) {
         return;
     }
 
     s->gl_shader_program_id = shader_program;
-    s->render_texture[0] = texture_make_empty(s->attributes.resolution, 
-                                              s->attributes.format);
-    s->render_texture[1] = texture_make_empty(s->attributes.resolution, 
-                                              s->attributes.format);
-    s->render_texture_current = &s->render_texture[0];
-    s->render_texture_last = &s->render_texture[1];
+    for (i32 i = 0; i < s->attributes.outputs; i++) {
+        s->render_texture[0][i] = texture_make_empty(s->attributes.resolution, 
+                                                     s->attributes.format);
+        s->render_texture[1][i] = texture_make_empty(s->attributes.resolution, 
+                                                     s->attributes.format);
+    }
+    s->render_texture_current = s->render_texture[0];
+    s->render_texture_last = s->render_texture[1];
+    if (s->attributes.interleave > 1) {
+        renderer_make_interleave_stencil(s);
+    }
 
     glUseProgram(s->gl_shader_program_id); // necessary?
     for (u32 i = 0; i < s->uniforms.count; i++) {
         Uniform *u = &s->uniforms.arr[i];
-        uniform_map_shader_uniform(u, s->gl_shader_program_id);
+        uniform_map_shader_uniform(u, s->gl_shader_program_id, SV_LIT(""));
     }
 }
 
-void shader_make_last_pass_shader(Shader *s)
+/*
+ * Replaces the program of the last shader in `chain` with a single program that 
+ * renders the whole chain of point-wise passes. `inputs[i]` is the sampler uniform 
+ * of `chain[i]` that is fed by `chain[i - 1]`. The uniforms of every pass in the 
+ * chain are mapped to their namespaced counterparts in the fused program. On 
+ * failure, the shaders are left untouched.
+ */
+i32 shader_fuse(Shader **chain, Uniform **inputs, u32 n)
 {
-    u32 vert_shader = glCreateShader(GL_VERTEX_SHADER);
-    u32 frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    u32 shader_program = glCreateProgram();
+    FusionPass passes[SHAQ_MAX_N_SHADERS];
+    char prefixes[SHAQ_MAX_N_SHADERS][32];
+    Shader *last = chain[n - 1];
+
+    for (u32 i = 0; i < n; i++) {
+        snprintf(prefixes[i], sizeof(prefixes[i]), "shaq_p%u_", i);
+        passes[i] = (FusionPass){
+            .source = sv_from((const char *) chain[i]->frag_shader_src, chain[i]->frag_shader_src_size),
+            .prefix = sv_from_cstr(prefixes[i]),
+            .input  = (inputs[i] != NULL) ? inputs[i]->name : (StringView){0},
+        };
+    }
 
-    glShaderSource(vert_shader, 1, &PASS_THROUGH_VERT_SHADER_SOURCE, NULL);
-    glShaderSource(frag_shader, 1, &LAST_PASS_FRAGMENT_SHADER_SOURCE, NULL);
-    glCompileShader(vert_shader);
-    glCompileShader(frag_shader);
-    glAttachShader(shader_program, vert_shader);
-    glAttachShader(shader_program, frag_shader);
-    glLinkProgram(shader_program);
-    
-    i32 vert_success, frag_success, link_success;
-    glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &vert_success);
-    glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &frag_success);
-    glGetProgramiv(shader_program, GL_LINK_STATUS, &link_success);
+    char *src = fusion_make_source(passes, n);
+    if (src == NULL) {
+        return -1;
+    }
+    u32 shader_program = make_shader_program(last->name, src, -1);
+    r2r_fs_free(src);
+    if (shader_program == 0) {
+        return -1;
+    }
 
-    glDeleteShader(vert_shader);
-    glDeleteShader(frag_shader);
+    glDeleteProgram(last->gl_shader_program_id);
+    last->gl_shader_program_id = shader_program;
+    glUseProgram(shader_program);
+    for (u32 i = 0; i < n; i++) {
+        for (u32 j = 0; j < chain[i]->uniforms.count; j++) {
+            Uniform *u = &chain[i]->uniforms.arr[j];
+            if (u == inputs[i]) {
+                u->gl_uniform_location = -1;
+                continue;
+            }
+            uniform_map_shader_uniform(u, shader_program, passes[i].prefix);
+        }
+    }
 
-    // TODO better error handling
-    if (!(vert_success & frag_success & link_success))
-    {
-        char log[4096];
-        log_error("Failed to compile shader `" SV_FMT "`.", SV_ARG(s->name));
-        glGetShaderInfoLog(vert_shader, 4096, NULL, log);
-        log_error("Vertex shader error(s):\n%s", log);
-        glGetShaderInfoLog(frag_shader, 4096, NULL, log);
-        log_error("Fragment shader error(s):\n%s", log);
-        glGetProgramInfoLog(shader_program, 4096, NULL, log);
-        log_error("Linking error(s):\n%s", log);
+    return 0;
+}
+
+void shader_make_last_pass_shader(Shader *s)
+{
+    u32 shader_program = make_shader_program(SV_LIT("LAST-PASS"), LAST_PASS_FRAGMENT_SHADER_SOURCE, -1);
+    if (shader_program == 0) {
         return;
     }
 
@@ -272,13 +302,32 @@ void shader_make_last_pass_shader(Shader *s)
     s->shader_depends.count = 0;
 }
 
+void shader_make_interleave_pattern_shader(Shader *s)
+{
+    u32 shader_program = make_shader_program(SV_LIT("INTERLEAVE-PATTERN"), 
+                                             INTERLEAVE_PATTERN_FRAGMENT_SHADER_SOURCE, -1);
+    if (shader_program == 0) {
+        return;
+    }
+
+    s->name = SV_LIT("INTERLEAVE-PATTERN");
+    s->gl_shader_program_id = shader_program;
+    s->uniforms.count = 0;
+    s->shader_depends.count = 0;
+}
+
 void shader_free_opengl_resources(Shader *s)
 {
     if (s->gl_shader_program_id != 0) {
         glDeleteProgram(s->gl_shader_program_id);
     }
-    glDeleteTextures(1, &s->render_texture[0].gl_texture_id);
-    glDeleteTextures(1, &s->render_texture[1].gl_texture_id);
+    for (i32 i = 0; i < SHAQ_MAX_N_OUTPUTS; i++) {
+        glDeleteTextures(1, &s->render_texture[0][i].gl_texture_id);
+        glDeleteTextures(1, &s->render_texture[1][i].gl_texture_id);
+    }
+    if (s->gl_interleave_stencil_rb != 0) {
+        glDeleteRenderbuffers(1, &s->gl_interleave_stencil_rb);
+    }
 }
 
 void shader_swap_render_textures(Shader *s)
@@ -295,8 +344,128 @@ void shader_update_uniforms(Shader *s)
     }
     glUseProgram(s->gl_shader_program_id);
 
+    /* passes fused into this shader share its program and texture units */
     u32 texture_unit = 0;
+    for (u32 i = 0; i < s->fused_passes.count; i++) {
+        Shader *pass = shaq_get_shader_by_id(s->fused_passes.arr[i]);
+        if (pass != NULL) {
+            update_uniforms(pass, &texture_unit);
+        }
+    }
+    update_uniforms(s, &texture_unit);
+}
 
+Uniform *shader_find_uniform_by_name(Shader *s, StringView name)
+{
+    for (u32 i = 0; i < s->uniforms.count; i++) {
+        Uniform *u  = &s->uniforms.arr[i];
+        if (sv_equals(u->name, name)) {
+            return u;
+        }
+    }
+
+    return NULL;
+}
+
+/*--- Private functions -----------------------------------------------------------------*/
+
+
+static void parse_attribute_from_kv_pair(Shader *s, HglIniKVPair *kv)
+{
+    StringView k = sv_trim(sv_from_cstr(kv->key));
+
+    if (!sv_starts_with_lchop(&k, "attribute")) {
+        log_error("Expected keyword `attribute` in left-hand-side expression: `%s`.", kv->key);
+        return;
+    }
+
+    /* expect whitespace */
+    if (!sv_starts_with_lexeme(&k, whitespace_lexeme)) {
+        log_error("Malformed left-hand-side expression: `%s`.", kv->key);
+        return;
+    }
+
+    k = sv_ltrim(k);
+    ExeExpr *exe = sel_compile(kv->val);
+    if (exe == NULL) {
+        log_error("Could not compile shader attribute expression: `%s`.", kv->val);
+        return;
+    }
+
+    /* `region` is the only attribute that is re-evaluated every frame */
+    if ((exe->qualifier & QUALIFIER_CONST) == 0 && !sv_equals(sv_trim(k), SV_LIT("region"))) {
+        log_error("Shader attribute `%s` has a non-constant expression `%s`\n", kv->key, kv->val);
+        return;
+    }
+
+    /* Parse `source` attribute */
+    SVMContext svm_ctx = (SVMContext){ .shader = s};
+    if (sv_starts_with_lchop(&k, "source") && sv_trim(k).length == 0) {
+        if (exe->type != TYPE_STR) {
+            log_error("Shader `" SV_FMT "`: Attribute `source` attribute must have type `str`.", SV_ARG(s->name));
+            return;
+        }
+        s->attributes.source = sv_make_copy(sel_eval(exe, svm_ctx, true).val_str, r2r_fs_alloc);
+    } else if (sv_starts_with_lchop(&k, "format") && sv_trim(k).length == 0) {
+        if (exe->type != TYPE_INT) {
+            log_error("Shader `" SV_FMT "`: Attribute `format` attribute must have type `int`.", SV_ARG(s->name));
+            return;
+        }
+        s->attributes.format = sel_eval(exe, svm_ctx, true).val_i32;
+    } else if (sv_starts_with_lchop(&k, "resolution") && sv_trim(k).length == 0) {
+        if (exe->type != TYPE_IVEC2) {
+            log_error("Shader `" SV_FMT "`: Attribute `resolution` attribute must have type `ivec2`.", SV_ARG(s->name));
+            return;
+        }
+        s->attributes.resolution = sel_eval(exe, svm_ctx, true).val_ivec2;
+    } else if (sv_starts_with_lchop(&k, "render_after") && sv_trim(k).length == 0) {
+        if (exe->type != TYPE_STR) {
+            log_error("Shader `" SV_FMT "`: Attribute `render_after` attribute must have type `str`.", SV_ARG(s->name));
+            return;
+        }
+        array_push(&s->attributes.render_after, sv_make_copy(sel_eval(exe, svm_ctx, true).val_str, r2r_fs_alloc));
+    } else if (sv_starts_with_lchop(&k, "interleave") && sv_trim(k).length == 0) {
+        if (exe->type != TYPE_INT) {
+            log_error("Shader `" SV_FMT "`: Attribute `interleave` attribute must have type `int`.", SV_ARG(s->name));
+            return;
+        }
+        i32 interleave = sel_eval(exe, svm_ctx, true).val_i32;
+        if (interleave != 1 && interleave != 2 && interleave != 4) {
+            log_error("Shader `" SV_FMT "`: Attribute `interleave` must be one of 1, 2, or 4.", SV_ARG(s->name));
+            return;
+        }
+        s->attributes.interleave = interleave;
+    } else if (sv_starts_with_lchop(&k, "outputs") && sv_trim(k).length == 0) {
+        if (exe->type != TYPE_INT) {
+            log_error("Shader `" SV_FMT "`: Attribute `outputs` attribute must have type `int`.", SV_ARG(s->name));
+            return;
+        }
+        i32 outputs = sel_eval(exe, svm_ctx, true).val_i32;
+        if (outputs < 1 || outputs > SHAQ_MAX_N_OUTPUTS) {
+            log_error("Shader `" SV_FMT "`: Attribute `outputs` must be in the range [1, %d].", 
+                      SV_ARG(s->name), SHAQ_MAX_N_OUTPUTS);
+            return;
+        }
+        s->attributes.outputs = outputs;
+    } else if (sv_starts_with_lchop(&k, "pointwise") && sv_trim(k).length == 0) {
+        if (exe->type != TYPE_BOOL) {
+            log_error("Shader `" SV_FMT "`: Attribute `pointwise` attribute must have type `bool`.", SV_ARG(s->name));
+            return;
+        }
+        s->attributes.pointwise = sel_eval(exe, svm_ctx, true).val_bool;
+    } else if (sv_starts_with_lchop(&k, "region") && sv_trim(k).length == 0) {
+        if (exe->type != TYPE_IVEC4) {
+            log_error("Shader `" SV_FMT "`: Attribute `region` attribute must have type `ivec4`.", SV_ARG(s->name));
+            return;
+        }
+        s->attributes.region = exe;
+    } else {
+        log_error("Shader `" SV_FMT "`: Unrecognized attribute `" SV_FMT "`", SV_ARG(s->name), SV_ARG(k));
+    }
+}
+
+static void update_uniforms(Shader *s, u32 *texture_unit)
+{
     for (u32 i = 0; i < s->uniforms.count; i++) {
         Uniform *u = &s->uniforms.arr[i];
         if (u->exe == NULL) {
@@ -306,7 +475,25 @@ void shader_update_uniforms(Shader *s)
             continue;
         }
 
-        SelValue r = sel_eval(u->exe, (SVMContext){s}, false);
+        if (u->count > 0) {
+            update_array_uniform(s, u);
+            continue;
+        }
+
+        /* evaluated by the frame program, unless it could not be linked */
+        if (u->value == NULL) {
+            (void) sel_eval(u->exe, (SVMContext){s}, false);
+        }
+        SelValue r = uniform_get_value(u);
+
+        /* the program keeps its uniforms, so only upload what changed */
+        if (u->type != TYPE_TEXTURE) {
+            if (u->is_uploaded && memcmp(&u->uploaded, &r, TYPE_TO_SIZE[u->type]) == 0) {
+                continue;
+            }
+            u->uploaded = r;
+            u->is_uploaded = true;
+        }
 
         switch (u->type) {
             case TYPE_BOOL:  glUniform1i(u->gl_uniform_location,  r.val_bool); break;
@@ -325,21 +512,21 @@ void shader_update_uniforms(Shader *s)
             case TYPE_TEXTURE: {
                 TextureDescriptor desc = r.val_tex;
                 Texture *t = NULL;
-                glActiveTexture(GL_TEXTURE0 + texture_unit);
-                glUniform1i(u->gl_uniform_location, texture_unit);
-                texture_unit++;
+                glActiveTexture(GL_TEXTURE0 + *texture_unit);
+                glUniform1i(u->gl_uniform_location, *texture_unit);
+                (*texture_unit)++;
 
                 u32 gl_tex_id = 0;
                 switch(desc.kind) {
                     case SHADER_CURRENT_RENDER_TEXTURE:
                     case SHADER_LAST_RENDER_TEXTURE: {
                         Shader *sh = shaq_get_shader_by_id(desc.id);
-                        if (sh == NULL || !shader_is_ok(sh)) {
+                        if (sh == NULL || !shader_is_ok(sh) || desc.output >= sh->attributes.outputs) {
                             break;
                         } else if (desc.kind == SHADER_CURRENT_RENDER_TEXTURE) {
-                            t = sh->render_texture_current;
+                            t = &sh->render_texture_current[desc.output];
                         } else {
-                            t = sh->render_texture_last;
+                            t = &sh->render_texture_last[desc.output];
                         }
                     } break;
 
@@ -369,77 +556,81 @@ void shader_update_uniforms(Shader *s)
     }
 }
 
-Uniform *shader_find_uniform_by_name(Shader *s, StringView name)
+/* 
+ * Array uniforms are computed as a whole, in a batch, and uploaded with a single call 
+ * whenever they were recomputed, or the program lost them. 
+ */
+static void update_array_uniform(Shader *s, Uniform *u)
 {
-    for (u32 i = 0; i < s->uniforms.count; i++) {
-        Uniform *u  = &s->uniforms.arr[i];
-        if (sv_equals(u->name, name)) {
-            return u;
-        }
+    i32 recomputed = sel_eval_array(u->exe, (SVMContext){s}, u->values, u->count, false);
+    if (recomputed == -1 || (recomputed == 0 && u->is_uploaded)) {
+        return;
+    }
+    u->is_uploaded = true;
+
+    i32 loc = u->gl_uniform_location;
+    i32 n = (i32) u->count;
+    switch (u->type) {
+        case TYPE_BOOL:  glUniform1iv(loc, n, (i32 *)u->values); break;
+        case TYPE_INT:   glUniform1iv(loc, n, (i32 *)u->values); break;
+        case TYPE_UINT:  glUniform1uiv(loc, n, (u32 *)u->values); break;
+        case TYPE_FLOAT: glUniform1fv(loc, n, (f32 *)u->values); break;
+        case TYPE_VEC2:  glUniform2fv(loc, n, (f32 *)u->values); break;
+        case TYPE_VEC3:  glUniform3fv(loc, n, (f32 *)u->values); break;
+        case TYPE_VEC4:  glUniform4fv(loc, n, (f32 *)u->values); break;
+        case TYPE_IVEC2: glUniform2iv(loc, n, (i32 *)u->values); break;
+        case TYPE_IVEC3: glUniform3iv(loc, n, (i32 *)u->values); break;
+        case TYPE_IVEC4: glUniform4iv(loc, n, (i32 *)u->values); break;
+        case TYPE_MAT2:  glUniformMatrix2fv(loc, n, false, (f32 *)u->values); break;
+        case TYPE_MAT3:  glUniformMatrix3fv(loc, n, false, (f32 *)u->values); break;
+        case TYPE_MAT4:  glUniformMatrix4fv(loc, n, false, (f32 *)u->values); break;
+        case TYPE_TEXTURE:
+        case TYPE_STR:
+        case TYPE_NIL:
+        case TYPE_AND_NAMECHECKER_ERROR_:
+        case N_TYPES:
+            log_error("Strange logic error that shouldn't happen<%s:%d>", __FILE__, __LINE__);
     }
-
-    return NULL;
 }
 
-/*--- Private functions -----------------------------------------------------------------*/
-
-
-static void parse_attribute_from_kv_pair(Shader *s, HglIniKVPair *kv)
+static u32 make_shader_program(StringView name, const char *frag_shader_src, i32 frag_shader_src_size)
 {
-    StringView k = sv_trim(sv_from_cstr(kv->key));
-
-    if (!sv_starts_with_lchop(&k, "attribute")) {
-        log_error("Expected keyword `attribute` in left-hand-side expression: `%s`.", kv->key);
-        return;
-    }
+    u32 vert_shader = glCreateShader(GL_VERTEX_SHADER);
+    u32 frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    u32 shader_program = glCreateProgram();
 
-    /* expect whitespace */
-    if (!sv_starts_with_lexeme(&k, whitespace_lexeme)) {
-        log_error("Malformed left-hand-side expression: `%s`.", kv->key);
-        return;
-    }
+    glShaderSource(vert_shader, 1, &PASS_THROUGH_VERT_SHADER_SOURCE, NULL);
+    glShaderSource(frag_shader, 1, &frag_shader_src, 
+                   (frag_shader_src_size < 0) ? NULL : &frag_shader_src_size);
+    glCompileShader(vert_shader);
+    glCompileShader(frag_shader);
+    glAttachShader(shader_program, vert_shader);
+    glAttachShader(shader_program, frag_shader);
+    glLinkProgram(shader_program);
+    
+    i32 vert_success, frag_success, link_success;
+    glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &vert_success);
+    glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &frag_success);
+    glGetProgramiv(shader_program, GL_LINK_STATUS, &link_success);
 
-    k = sv_ltrim(k);
-    ExeExpr *exe = sel_compile(kv->val);
-    if (exe == NULL) {
-        log_error("Could not compile shader attribute expression: `%s`.", kv->val);
-        return;
-    }
+    glDeleteShader(vert_shader);
+    glDeleteShader(frag_shader);
 
-    if ((exe->qualifier & QUALIFIER_CONST) == 0) {
-        log_error("Shader attribute `%s` has a non-constant expression `%s`\n", kv->key, kv->val);
-        return;
+    // TODO better error handling
+    if (!(vert_success & frag_success & link_success))
+    {
+        char log[4096];
+        log_error("Failed to compile shader `" SV_FMT "`.", SV_ARG(name));
+        glGetShaderInfoLog(vert_shader, 4096, NULL, log);
+        log_error("Vertex shader error(s):\n%s", log);
+        glGetShaderInfoLog(frag_shader, 4096, NULL, log);
+        log_error("Fragment shader error(s):\n%s", log);
+        glGetProgramInfoLog(shader_program, 4096, NULL, log);
+        log_error("Linking error(s):\n%s", log);
+        return 0;
     }
 
-    /* Parse `source` attribute */
-    SVMContext svm_ctx = (SVMContext){ .shader = s};
-    if (sv_starts_with_lchop(&k, "source") && sv_trim(k).length == 0) {
-        if (exe->type != TYPE_STR) {
-            log_error("Shader `" SV_FMT "`: Attribute `source` attribute must have type `str`.", SV_ARG(s->name));
-            return;
-        }
-        s->attributes.source = sv_make_copy(sel_eval(exe, svm_ctx, true).val_str, r2r_fs_alloc);
-    } else if (sv_starts_with_lchop(&k, "format") && sv_trim(k).length == 0) {
-        if (exe->type != TYPE_INT) {
-            log_error("Shader `" SV_FMT "`: Attribute `format` attribute must have type `int`.", SV_ARG(s->name));
-            return;
-        }
-        s->attributes.format = sel_eval(exe, svm_ctx, true).val_i32;
-    } else if (sv_starts_with_lchop(&k, "resolution") && sv_trim(k).length == 0) {
-        if (exe->type != TYPE_IVEC2) {
-            log_error("Shader `" SV_FMT "`: Attribute `resolution` attribute must have type `ivec2`.", SV_ARG(s->name));
-            return;
-        }
-        s->attributes.resolution = sel_eval(exe, svm_ctx, true).val_ivec2;
-    } else if (sv_starts_with_lchop(&k, "render_after") && sv_trim(k).length == 0) {
-        if (exe->type != TYPE_STR) {
-            log_error("Shader `" SV_FMT "`: Attribute `render_after` attribute must have type `str`.", SV_ARG(s->name));
-            return;
-        }
-        array_push(&s->attributes.render_after, sv_make_copy(sel_eval(exe, svm_ctx, true).val_str, r2r_fs_alloc));
-    } else {
-        log_error("Shader `" SV_FMT "`: Unrecognized attribute `" SV_FMT "`", SV_ARG(s->name), SV_ARG(k));
-    }
+    return shader_program;
 }
 
 static size_t whitespace_lexeme(StringView sv)
@@ -21,14 +21,23 @@ typedef struct Shader {
         StringView source;
         IVec2 resolution;
         i32 format;
+        i32 interleave;
+        i32 outputs;
+        b8 pointwise;
+        ExeExpr *region;
         Array(StringView, SHAQ_MAX_N_SHADERS) render_after;
     } attributes;
 
-    Array(Uniform, SHAQ_MAX_N_SHADERS) uniforms;
+    Array(Uniform, SHAQ_MAX_N_UNIFORMS) uniforms;
     Array(u32, SHAQ_MAX_N_SHADERS) shader_depends;
-    Texture render_texture[2];
-    Texture *render_texture_current;
-    Texture *render_texture_last;
+    Texture render_texture[2][SHAQ_MAX_N_OUTPUTS];
+    Texture *render_texture_current; /* array of `attributes.outputs` textures */
+    Texture *render_texture_last;    /* array of `attributes.outputs` textures */
+    IVec4 last_drawn_region;
+
+    /* Point-wise pass fusion */
+    i32 fused_into;                                 /* id of the shader that renders this pass, or -1 */
+    Array(u32, SHAQ_MAX_N_SHADERS) fused_passes;    /* ids of the passes rendered by this shader, in order */
 
     u8 *frag_shader_src;
     size_t frag_shader_src_size;
@@ -36,6 +45,7 @@ typedef struct Shader {
 
     /* OpenGL */
     u32 gl_shader_program_id;
+    u32 gl_interleave_stencil_rb;
 } Shader;
 
 /*--- Public variables ------------------------------------------------------------------*/
@@ -47,7 +57,9 @@ void shader_determine_dependencies(Shader *s);
 b8 shader_was_modified(Shader *s);
 b8 shader_is_ok(const Shader *s);
 void shader_reload(Shader *s);
+i32 shader_fuse(Shader **chain, Uniform **inputs, u32 n);
 void shader_make_last_pass_shader(Shader *s);
+void shader_make_interleave_pattern_shader(Shader *s);
 void shader_free_opengl_resources(Shader *s);
 void shader_swap_render_textures(Shader *s);
 void shader_update_uniforms(Shader *s);
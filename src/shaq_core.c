@@ -30,20 +30,59 @@
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 
 #include <GLFW/glfw3.h>
 
 /*--- Private macros --------------------------------------------------------------------*/
 
+/* 
+ * Estimated cost (see `codegen_measure()`) of the uniforms of a frame program worth 
+ * evaluating on a thread of its own. Waking a worker costs about as much.
+ */
+#define FRAME_PROGRAM_MIN_COST 4096
+
 /*--- Private type definitions ----------------------------------------------------------*/
 
+/* The uniforms of a pass, as gathered by `link_frame_program()` */
+typedef struct
+{
+    u32 first; // index of the first of them
+    u32 n;
+    u32 cost;
+    b8 main_thread; // any of them must be evaluated on the main thread
+} FramePass;
+
+/* Frame programs that are run side by side, one per thread. See `link_frame_program()` */
+typedef struct
+{
+    u32 first; // index in `shaq.frame_programs`
+    u32 n;
+} FrameStage;
+
+/* A uniform expression, as listed by `shaq_dump_sel()` */
+typedef struct
+{
+    const Shader *shader;
+    const Uniform *uniform;
+} SelDumpEntry;
+
 /*--- Private function prototypes -------------------------------------------------------*/
 
 static b8 session_reload_needed(void);
 static i32 reload_session(void);
 static i32 satisfy_dependencies_for_shader(u32 index, u32 depth);
 static void determine_render_order(void);
+static void fuse_pointwise_passes(void);
+static void link_frame_program(void);
+static void link_frame_stage(const FramePass *passes, u32 n, ExeExpr *const *exes, const SVMContext *contexts, 
+                             Uniform *const *uniforms);
+static b8 is_fusable(const Shader *s);
+static void render_all_passes(void);
 static i32 load_state_from_project_ini(HglIni *project_ini); // TODO better name
+static i32 load_globals_from_ini_section(HglIniSection *s);
+static i32 sel_dump_entry_compare(const void *a, const void *b);
 static void shaq_atexit_(void);
 
 /*--- Public variables ------------------------------------------------------------------*/
@@ -65,12 +104,23 @@ static struct
     Array(Shader, SHAQ_MAX_N_SHADERS) shaders;
     Array(u32, SHAQ_MAX_N_SHADERS) render_order;
     Array(Texture, SHAQ_MAX_N_LOADED_TEXTURES) textures;
+    Array(ExeExpr *, SHAQ_MAX_N_SHADERS) frame_programs; /* evaluate the uniforms of all passes */
+    Array(FrameStage, SHAQ_MAX_N_SHADERS) frame_stages;  /* of `frame_programs`, run one after the other */
+    u32 n_sel_threads; /* the main thread, and the workers running frame programs beside it */
     i32 visible_shader_idx;
     b8 quiet;
     b8 should_reload;
     b8 reloaded_this_frame;
     b8 reloaded_last_frame;
 
+    struct {
+        b8 enabled;
+        IVec2 output_resolution;
+        IVec2 tile_resolution;
+        IVec2 offset;
+    } tiling;
+
+    IVec2 viewport_size;
     i32 frame_count;
     b8 time_paused;
     u64 timestamp_ns;
@@ -98,6 +148,7 @@ void shaq_begin(const char *project_ini_filepath, bool quiet)
     shaq.timestamp_ns = util_get_time_nanos();
     shaq.visible_shader_idx = (u32) -1;
     shaq.quiet = quiet;
+    shaq.n_sel_threads = 1 + sel_start_workers(SHAQ_SEL_N_WORKERS);
 
     reload_session();
 }
@@ -110,6 +161,7 @@ b8 shaq_should_close()
 void shaq_new_frame()
 {
     /* Reload if necessary */
+    b8 reloaded_recently = shaq.reloaded_this_frame || shaq.reloaded_last_frame;
     shaq.reloaded_last_frame = shaq.reloaded_this_frame;
     shaq.reloaded_this_frame = false;
     if (session_reload_needed()) {
@@ -118,6 +170,9 @@ void shaq_new_frame()
             shaq.reloaded_this_frame = true;
         }
     }
+    if (reloaded_recently || shaq.reloaded_this_frame) {
+        sel_signal(SEL_DEP_RELOAD);
+    }
 
     /* compute time */
     u64 now_ns = util_get_time_nanos();
@@ -128,6 +183,7 @@ void shaq_new_frame()
     if (!shaq.time_paused) {
         shaq.time_ns += dt_ns;
         shaq.time_s = (f32)((f64)shaq.time_ns / 1000000000.0);
+        sel_signal(SEL_DEP_TIME);
     }
 
     /* for all shaders: swap current and last frame render textures */
@@ -139,14 +195,14 @@ void shaq_new_frame()
 
     /* poll inputs */
     user_input_poll();
+    IVec2 viewport_size = gui_shader_window_size();
+    if (viewport_size.x != shaq.viewport_size.x || viewport_size.y != shaq.viewport_size.y) {
+        shaq.viewport_size = viewport_size;
+        sel_signal(SEL_DEP_VIEWPORT);
+    }
 
     /* Draw individual shaders onto individual offscreen framebuffer textures */
-    for (u32 i = 0; i < shaq.render_order.count; i++) {
-        u32 index = shaq.render_order.arr[i];
-        Shader *s  = &shaq.shaders.arr[index];
-        shader_update_uniforms(s);
-        renderer_do_shader_pass(s);
-    }
+    render_all_passes();
 
     /* begin imgui frame */
     gui_begin_frame();
@@ -177,15 +233,23 @@ void shaq_new_frame()
 
         /* Draw main window */
         if (gui_begin_main_window()) {
-            shaq.visible_shader_idx = gui_draw_shader_display_selector(shaq.visible_shader_idx, 
-                                                                       shaq.shaders.arr, 
-                                                                       shaq.shaders.count);
+            i32 visible_shader_idx = gui_draw_shader_display_selector(shaq.visible_shader_idx, 
+                                                                      shaq.shaders.arr, 
+                                                                      shaq.shaders.count);
+
+            /* a pass that was fused into another has no output of its own to display */
+            if (visible_shader_idx != shaq.visible_shader_idx && visible_shader_idx != -1 &&
+                shaq.shaders.arr[visible_shader_idx].fused_into != -1) {
+                shaq.should_reload = true;
+            }
+            shaq.visible_shader_idx = visible_shader_idx;
             gui_draw_widgets();
             for (u32 i = 0; i < shaq.render_order.count; i++) {
                 Shader *s  = &shaq.shaders.arr[i];
                 assert(s != NULL);
                 gui_draw_shader_info(s);
             }
+            gui_draw_memo_stats(shaq.frame_programs.arr, shaq.frame_programs.count);
         }
         gui_end_main_window();
 
@@ -219,6 +283,145 @@ void shaq_end()
     return; // TODO
 }
 
+i32 shaq_render_tiled(const char *output_filepath, IVec2 resolution, i32 tile_size, i32 overlap)
+{
+    i32 ret = -1;
+    FILE *fp = NULL;
+    u8 *strip = NULL;
+    u8 *tile = NULL;
+
+    if (resolution.x <= 0 || resolution.y <= 0 || tile_size <= 0 || overlap < 0) {
+        log_error("Tiled render: invalid output resolution, tile size, or tile overlap.");
+        return -1;
+    }
+
+    /* 
+     * Reload the session with every render texture sized to a single tile plus 
+     * `overlap` pixels on each side. The overlap lets intermediate passes sample 
+     * their inputs beyond the edges of the tile.
+     */
+    i32 tex_size = tile_size + 2*overlap;
+    shaq.tiling.enabled = true;
+    shaq.tiling.output_resolution = resolution;
+    shaq.tiling.tile_resolution = ivec2_make(tex_size, tex_size);
+    shaq.tiling.offset = ivec2_make(-overlap, -overlap);
+    if (reload_session() != 0 || shaq.visible_shader_idx == -1) {
+        log_error("Tiled render: failed to load project.");
+        goto out;
+    }
+    Shader *final = &shaq.shaders.arr[shaq.visible_shader_idx];
+
+    /* only a single row of tiles is kept in memory at any time */
+    strip = image_alloc((size_t)resolution.x * (size_t)tile_size * 3);
+    tile = image_alloc((size_t)tile_size * (size_t)tile_size * 3);
+    if (strip == NULL || tile == NULL) {
+        log_error("Tiled render: unable to allocate tile buffers.");
+        goto out;
+    }
+
+    fp = fopen(output_filepath, "wb");
+    if (fp == NULL) {
+        log_error("Tiled render: unable to open `%s`. Errno = %s.", output_filepath, strerror(errno));
+        goto out;
+    }
+    fprintf(fp, "P6\n%d %d\n255\n", resolution.x, resolution.y);
+
+    /* PPM is stored top to bottom, so render the rows of tiles from the top down */
+    for (i32 y1 = resolution.y; y1 > 0; y1 -= tile_size) {
+        i32 y0 = (y1 - tile_size > 0) ? y1 - tile_size : 0;
+        i32 h = y1 - y0;
+        for (i32 x0 = 0; x0 < resolution.x; x0 += tile_size) {
+            i32 w = (x0 + tile_size < resolution.x) ? tile_size : resolution.x - x0;
+
+            /* render all passes for this tile */
+            shaq.tiling.offset = ivec2_make(x0 - overlap, y0 - overlap);
+            render_all_passes();
+
+            /* read back the interior of the tile and flip it into the strip */
+            renderer_read_pixels(final, ivec4_make(overlap, overlap, w, h), tile);
+            for (i32 row = 0; row < h; row++) {
+                memcpy(&strip[((size_t)(h - 1 - row) * (size_t)resolution.x + (size_t)x0) * 3],
+                       &tile[(size_t)row * (size_t)w * 3], (size_t)w * 3);
+            }
+        }
+
+        size_t strip_size = (size_t)resolution.x * (size_t)h * 3;
+        if (fwrite(strip, 1, strip_size, fp) != strip_size) {
+            log_error("Tiled render: failed writing to `%s`.", output_filepath);
+            goto out;
+        }
+        log_info("Tiled render: %d/%d rows done.", resolution.y - y0, resolution.y);
+    }
+
+    log_info("Tiled render: wrote %dx%d image to `%s`.", resolution.x, resolution.y, output_filepath);
+    ret = 0;
+
+out:
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    if (strip != NULL) {
+        image_free(strip);
+    }
+    if (tile != NULL) {
+        image_free(tile);
+    }
+    shaq.tiling.enabled = false;
+    if (!shaq.quiet) {
+        log_print_info_log();
+        log_print_error_log();
+    }
+    return ret;
+}
+
+/*
+ * Prints the uniform expressions of every pass, costliest first, with their estimated 
+ * cost, the stack they need in the stack VM, and the number of instructions of their 
+ * register programs. Constant expressions are evaluated once. They are listed last, with
+ * their cost in parentheses.
+ */
+i32 shaq_dump_sel()
+{
+    if (shaq.shaders.count == 0) {
+        log_error("Dump SEL: no project loaded.");
+        return -1;
+    }
+
+    u32 n = 0;
+    SelDumpEntry *entries = hgl_alloc(g_frame_arena, shaq.shaders.count * SHAQ_MAX_N_UNIFORMS * sizeof(SelDumpEntry));
+    if (entries == NULL) {
+        log_error("Dump SEL: out of memory.");
+        return -1;
+    }
+    for (u32 i = 0; i < shaq.shaders.count; i++) {
+        const Shader *s = &shaq.shaders.arr[i];
+        for (u32 j = 0; j < s->uniforms.count; j++) {
+            if (s->uniforms.arr[j].exe != NULL) {
+                entries[n++] = (SelDumpEntry) {.shader = s, .uniform = &s->uniforms.arr[j]};
+            }
+        }
+    }
+    qsort(entries, n, sizeof(SelDumpEntry), sel_dump_entry_compare);
+
+    printf("%8s %6s %5s  %s\n", "cost", "stack", "ops", "uniform = expression");
+    for (u32 i = 0; i < n; i++) {
+        const ExeExpr *exe = entries[i].uniform->exe;
+        char cost[16];
+        snprintf(cost, sizeof(cost), (exe->qualifier & QUALIFIER_CONST) ? "(%u)" : "%u", exe->cost);
+        printf("%8s %6u %5u  " SV_FMT "." SV_FMT " = %s\n", cost, exe->stack_size, exe->n_ops,
+               SV_ARG(entries[i].shader->name), SV_ARG(entries[i].uniform->name), exe->source_code);
+    }
+    for (u32 i = 0; i < shaq.frame_stages.count; i++) {
+        const FrameStage *stage = &shaq.frame_stages.arr[i];
+        for (u32 j = 0; j < stage->n; j++) {
+            const ExeExpr *program = shaq.frame_programs.arr[stage->first + j];
+            printf("%8u %6s %5u  (frame program %u of %u in stage %u, on thread %u)\n", 
+                   program->cost, "", program->n_ops, j + 1, stage->n, i + 1, j);
+        }
+    }
+    return 0;
+}
+
 f32 shaq_time()
 {
     return shaq.time_s;
@@ -239,6 +442,7 @@ void shaq_reset_time()
     shaq.time_s      = 0.0f;
     shaq.time_ns     = 0;
     shaq.frame_count = 0;
+    sel_signal(SEL_DEP_TIME);
 }
 
 void shaq_toggle_time_pause()
@@ -256,6 +460,21 @@ b8 shaq_reloaded_last_frame()
     return shaq.reloaded_last_frame;
 }
 
+b8 shaq_is_rendering_tiled()
+{
+    return shaq.tiling.enabled;
+}
+
+IVec2 shaq_tile_offset()
+{
+    return shaq.tiling.enabled ? shaq.tiling.offset : ivec2_make(0, 0);
+}
+
+IVec2 shaq_tiled_output_resolution()
+{
+    return shaq.tiling.output_resolution;
+}
+
 b8 shaq_has_loaded_project()
 {
     return shaq.project_ini_loaded;
@@ -396,6 +615,10 @@ static i32 reload_session()
     /* collect garbage */
     hgl_free_all(g_r2r_arena);
     hgl_free_all(g_r2r_fs_allocator);
+    array_clear(&shaq.frame_programs);
+    array_clear(&shaq.frame_stages);
+    sel_jit_reset();
+    sel_begin_session();
 
     /* Return early if no filepath is set */
     if (!shaq.project_ini_loaded) {
@@ -405,6 +628,13 @@ static i32 reload_session()
         return -1;
     }
 
+#if SHAQ_SEL_CACHE
+    /* Skip the compilation of expressions unchanged since an earlier run */
+    char cache_filepath[SHAQ_FILEPATH_MAX_LEN + 16];
+    snprintf(cache_filepath, sizeof(cache_filepath), "%s.selcache", shaq.project_ini_filepath);
+    sel_cache_open(cache_filepath);
+#endif
+
     /* Reload project ini file */
     shaq.project_ini_modifytime = io_get_file_modify_time(shaq.project_ini_filepath, false);
     shaq.project_ini = hgl_ini_open(shaq.project_ini_filepath);
@@ -420,6 +650,16 @@ static i32 reload_session()
         goto out_error;
     }
 
+    /* Tiled rendering: every pass is rendered at tile resolution, in full */
+    if (shaq.tiling.enabled) {
+        for (u32 i = 0; i < shaq.shaders.count; i++) {
+            Shader *s = &shaq.shaders.arr[i];
+            s->attributes.resolution = shaq.tiling.tile_resolution;
+            s->attributes.interleave = 1;
+            s->attributes.region = NULL;
+        }
+    }
+
     /* Determine render order */
     determine_render_order(); // TODO return err?
 
@@ -429,11 +669,24 @@ static i32 reload_session()
         shader_reload(s);
     }
 
+    /* Share common subexpressions between all compiled expressions */
+    sel_end_session();
+#if SHAQ_SEL_CACHE
+    sel_cache_close();
+#endif
+
     /* Reset visible shader idx if necessary */
     if ((shaq.visible_shader_idx >= (i32)shaq.shaders.count) ||
         (shaq.visible_shader_idx == -1)) {
         shaq.visible_shader_idx = shaq.render_order.arr[shaq.shaders.count - 1];
     }
+
+    /* Fuse chains of point-wise passes into single programs */
+    fuse_pointwise_passes();
+
+    /* Evaluate all uniforms, of all passes, in a few runs of the SVM each frame */
+    link_frame_program();
+
     if (!shaq.quiet) {
         log_print_info_log();
         log_print_error_log();
@@ -441,6 +694,7 @@ static i32 reload_session()
 
 #if 0
     printf("frame arena      -- "); hgl_alloc_print_usage(g_frame_arena);
+    printf("sel arena        -- "); hgl_alloc_print_usage(g_sel_arena);
     printf("r2r arena        -- "); hgl_alloc_print_usage(g_r2r_arena);
     printf("r2r fs allocator -- "); hgl_alloc_print_usage(g_r2r_fs_allocator);
     printf("image allocator  -- "); hgl_alloc_print_usage(g_image_allocator);
@@ -519,8 +773,271 @@ static void determine_render_order()
     }
 }
 
+/*
+ * A point-wise pass P is fused into the pass C that consumes it if both are marked 
+ * `pointwise`, C is the only reader of P's output, and P is not displayed. Chains 
+ * P0 -> P1 -> ... -> C are rendered by C in a single program, which saves a render 
+ * texture write and read for every fused pass.
+ */
+static void fuse_pointwise_passes()
+{
+    u32 n_readers[SHAQ_MAX_N_SHADERS] = {0};
+    i32 producer[SHAQ_MAX_N_SHADERS];
+    i32 consumer[SHAQ_MAX_N_SHADERS];
+    Uniform *input[SHAQ_MAX_N_SHADERS];
+
+    /* count the readers of the output of each shader */
+    for (u32 i = 0; i < shaq.shaders.count; i++) {
+        Shader *s = &shaq.shaders.arr[i];
+        producer[i] = -1;
+        consumer[i] = -1;
+        input[i] = NULL;
+        for (u32 j = 0; j < s->uniforms.count; j++) {
+            Uniform *u = &s->uniforms.arr[j];
+            if (u->type != TYPE_TEXTURE || u->exe == NULL) {
+                continue;
+            }
+            TextureDescriptor desc = sel_eval(u->exe, (SVMContext){s}, true).val_tex;
+            if (!desc.error && desc.kind != LOADED_TEXTURE && 
+                desc.id >= 0 && desc.id < (i32)shaq.shaders.count) {
+                n_readers[desc.id]++;
+            }
+        }
+    }
+
+    /* pair each fusable shader with the fusable shader it reads from (if any) */
+    for (u32 i = 0; i < shaq.shaders.count; i++) {
+        Shader *s = &shaq.shaders.arr[i];
+        if (!is_fusable(s)) {
+            continue;
+        }
+        for (u32 j = 0; j < s->uniforms.count; j++) {
+            Uniform *u = &s->uniforms.arr[j];
+            if (u->type != TYPE_TEXTURE || u->exe == NULL) {
+                continue;
+            }
+            TextureDescriptor desc = sel_eval(u->exe, (SVMContext){s}, true).val_tex;
+            if (desc.error || desc.kind != SHADER_CURRENT_RENDER_TEXTURE || 
+                desc.id < 0 || desc.id >= (i32)shaq.shaders.count || desc.id == (i32)i) {
+                continue;
+            }
+            Shader *p = &shaq.shaders.arr[desc.id];
+            if (is_fusable(p) && n_readers[desc.id] == 1 && desc.id != shaq.visible_shader_idx &&
+                p->attributes.resolution.x == s->attributes.resolution.x &&
+                p->attributes.resolution.y == s->attributes.resolution.y) {
+                producer[i] = desc.id;
+                consumer[desc.id] = i;
+                input[i] = u;
+                break;
+            }
+        }
+    }
+
+    /* fuse every chain into its last shader */
+    for (u32 i = 0; i < shaq.shaders.count; i++) {
+        if (producer[i] == -1 || consumer[i] != -1) {
+            continue;
+        }
+
+        Shader *chain[SHAQ_MAX_N_SHADERS];
+        Uniform *inputs[SHAQ_MAX_N_SHADERS];
+        u32 ids[SHAQ_MAX_N_SHADERS];
+        u32 n = 0;
+        for (i32 id = i; id != -1; id = producer[id]) {
+            ids[n] = id;
+            chain[n] = &shaq.shaders.arr[id];
+            inputs[n] = input[id];
+            n++;
+        }
+
+        /* reverse into render order */
+        for (u32 j = 0; j < n/2; j++) {
+            u32 tmp_id = ids[j];        ids[j] = ids[n - 1 - j];       ids[n - 1 - j] = tmp_id;
+            Shader *tmp_s = chain[j];   chain[j] = chain[n - 1 - j];   chain[n - 1 - j] = tmp_s;
+            Uniform *tmp_u = inputs[j]; inputs[j] = inputs[n - 1 - j]; inputs[n - 1 - j] = tmp_u;
+        }
+
+        Shader *last = chain[n - 1];
+        if (shader_fuse(chain, inputs, n) != 0) {
+            log_error("Could not fuse the point-wise passes into shader \"" SV_FMT "\".", SV_ARG(last->name));
+            continue;
+        }
+        for (u32 j = 0; j < n - 1; j++) {
+            chain[j]->fused_into = ids[n - 1];
+            array_push(&last->fused_passes, ids[j]);
+        }
+        log_info("Fused %u point-wise passes into shader \"" SV_FMT "\".", n, SV_ARG(last->name));
+    }
+}
+
+static b8 is_fusable(const Shader *s)
+{
+    return s->attributes.pointwise && 
+           s->gl_shader_program_id != 0 &&
+           s->attributes.outputs == 1 &&
+           s->attributes.interleave == 1 &&
+           s->attributes.region == NULL;
+}
+
+/*
+ * Links the uniform expressions of every pass into frame programs, in the order in 
+ * which `render_all_passes()` uploads them. Uniforms that are never uploaded are left 
+ * out, like `shader_update_uniforms()` never evaluates them, and so are arrays, which 
+ * it evaluates in batches. Runs of consecutive passes that evaluate nothing on the main 
+ * thread form stages, whose passes are spread over as many frame programs as their 
+ * cost warrants, up to one per thread. Any other pass is a stage of its own. The 
+ * stages are run in order.
+ */
+static void link_frame_program()
+{
+    u32 max_n_exes = shaq.shaders.count * SHAQ_MAX_N_UNIFORMS;
+    ExeExpr **exes = hgl_alloc(g_frame_arena, max_n_exes * sizeof(ExeExpr *));
+    SVMContext *contexts = hgl_alloc(g_frame_arena, max_n_exes * sizeof(SVMContext));
+    Uniform **uniforms = hgl_alloc(g_frame_arena, max_n_exes * sizeof(Uniform *));
+    FramePass *passes = hgl_alloc(g_frame_arena, shaq.shaders.count * sizeof(FramePass));
+    u32 n = 0;
+    u32 n_passes = 0;
+
+    for (u32 i = 0; i < shaq.render_order.count; i++) {
+        Shader *s = &shaq.shaders.arr[shaq.render_order.arr[i]];
+        if (s->fused_into != -1 || s->gl_shader_program_id == 0) {
+            continue;
+        }
+        for (u32 j = 0; j <= s->fused_passes.count; j++) {
+            Shader *pass = (j < s->fused_passes.count) ? shaq_get_shader_by_id(s->fused_passes.arr[j]) : s;
+            if (pass == NULL) {
+                continue;
+            }
+            FramePass *p = &passes[n_passes];
+            *p = (FramePass) {.first = n};
+            for (u32 k = 0; k < pass->uniforms.count; k++) {
+                Uniform *u = &pass->uniforms.arr[k];
+                if (u->exe == NULL || u->gl_uniform_location == -1 || u->count > 0) {
+                    continue;
+                }
+                exes[n] = u->exe;
+                contexts[n] = (SVMContext){pass};
+                uniforms[n] = u;
+                n++;
+                p->cost += (u->exe->qualifier & QUALIFIER_CONST) ? 0 : u->exe->cost;
+                p->main_thread |= u->exe->main_thread;
+            }
+            p->n = n - p->first;
+            if (p->n > 0) {
+                n_passes++;
+            }
+        }
+    }
+
+    for (u32 i = 0; i < n_passes;) {
+        u32 end = i + 1;
+        while (!passes[i].main_thread && (end < n_passes) && !passes[end].main_thread) {
+            end++;
+        }
+        link_frame_stage(&passes[i], end - i, exes, contexts, uniforms);
+        i = end;
+    }
+}
+
+/* 
+ * Links the uniforms of the `n` passes `passes` of a stage (see `link_frame_program()`) 
+ * into frame programs. Each pass goes to the program with the lowest cost so far.
+ */
+static void link_frame_stage(const FramePass *passes, u32 n, ExeExpr *const *exes, const SVMContext *contexts, 
+                             Uniform *const *uniforms)
+{
+    u32 cost = 0;
+    u32 n_exes = 0;
+    for (u32 i = 0; i < n; i++) {
+        cost += passes[i].cost;
+        n_exes += passes[i].n;
+    }
+    u32 n_programs = cost / FRAME_PROGRAM_MIN_COST;
+    n_programs = (n_programs < n) ? n_programs : n;
+    n_programs = (n_programs < shaq.n_sel_threads) ? n_programs : shaq.n_sel_threads;
+    n_programs = (n_programs > 0) ? n_programs : 1;
+
+    u32 program_cost[SEL_MAX_N_WORKERS + 1] = {0};
+    u32 *program_of = hgl_alloc(g_frame_arena, n * sizeof(u32));
+    for (u32 i = 0; i < n; i++) {
+        u32 cheapest = 0;
+        for (u32 j = 1; j < n_programs; j++) {
+            cheapest = (program_cost[j] < program_cost[cheapest]) ? j : cheapest;
+        }
+        program_of[i] = cheapest;
+        program_cost[cheapest] += passes[i].cost;
+    }
+
+    ExeExpr **program_exes = hgl_alloc(g_frame_arena, n_exes * sizeof(ExeExpr *));
+    SVMContext *program_contexts = hgl_alloc(g_frame_arena, n_exes * sizeof(SVMContext));
+    Uniform **program_uniforms = hgl_alloc(g_frame_arena, n_exes * sizeof(Uniform *));
+    u8 **values = hgl_alloc(g_frame_arena, n_exes * sizeof(u8 *));
+    FrameStage stage = {.first = shaq.frame_programs.count};
+    for (u32 p = 0; p < n_programs; p++) {
+        u32 m = 0;
+        for (u32 i = 0; i < n; i++) {
+            for (u32 k = passes[i].first; (program_of[i] == p) && (k < passes[i].first + passes[i].n); k++) {
+                program_exes[m] = exes[k];
+                program_contexts[m] = contexts[k];
+                program_uniforms[m] = uniforms[k];
+                m++;
+            }
+        }
+        if (m == 0) {
+            continue;
+        }
+
+        ExeExpr *program = sel_link_frame_program(program_exes, program_contexts, m, values);
+        if (program == NULL) {
+            log_info("Too many uniforms for a single frame program. Evaluating them one by one.");
+            continue;
+        }
+        for (u32 i = 0; i < m; i++) {
+            program_uniforms[i]->value = values[i];
+        }
+        array_push(&shaq.frame_programs, program);
+        stage.n++;
+    }
+    if (stage.n > 0) {
+        array_push(&shaq.frame_stages, stage);
+    }
+}
+
+static void render_all_passes()
+{
+    sel_begin_frame();
+    sel_update_globals();
+    for (u32 i = 0; i < shaq.frame_stages.count; i++) {
+        const FrameStage *stage = &shaq.frame_stages.arr[i];
+        sel_run_frame_programs(&shaq.frame_programs.arr[stage->first], stage->n);
+    }
+    for (u32 i = 0; i < shaq.render_order.count; i++) {
+        Shader *s = &shaq.shaders.arr[shaq.render_order.arr[i]];
+        if (s->fused_into != -1) {
+            continue; /* rendered as part of another shader */
+        }
+        shader_update_uniforms(s);
+        renderer_do_shader_pass(s);
+    }
+}
+
 static i32 load_state_from_project_ini(HglIni *project_ini)
 {
+    /* Handle globals section first. The expressions of every shader may refer to them */
+    hgl_ini_reset_section_iterator(project_ini);
+    while (true) {
+        HglIniSection *s = hgl_ini_next_section(project_ini);
+        if (s == NULL) {
+            break;
+        }
+        if (0 == strcasecmp(s->name, "Globals")) {
+            if (load_globals_from_ini_section(s) != 0) {
+                log_error("Failed to load globals.");
+            }
+            break;
+        }
+    }
+
     hgl_ini_reset_section_iterator(project_ini);
     u32 shader_count = 0; 
     while (true) {
@@ -536,6 +1053,11 @@ static i32 load_state_from_project_ini(HglIni *project_ini)
             continue;
         }
 
+        /* Already handled */
+        if (0 == strcasecmp(s->name, "Globals")) {
+            continue;
+        }
+
         /* Handle shader sections */
         int err = shader_parse_from_ini_section(&shaq.shaders.arr[shader_count], s);
         if (err == 0) {
@@ -546,8 +1068,50 @@ static i32 load_state_from_project_ini(HglIni *project_ini)
     return (shaq.shaders.count != 0) ? 0 : -1;
 }
 
+/* 
+ * Defines the globals declared as `<type> <name> = <expression>` in `s`, and evaluates 
+ * them, since shaders may evaluate their expressions as they are loaded.
+ */
+static i32 load_globals_from_ini_section(HglIniSection *s)
+{
+    u32 n = (u32) s->kv_pairs.count;
+    StringView *names = hgl_alloc(g_frame_arena, n * sizeof(StringView) + 1);
+    Type *types = hgl_alloc(g_frame_arena, n * sizeof(Type) + 1);
+    const char **srcs = hgl_alloc(g_frame_arena, n * sizeof(const char *) + 1);
+
+    hgl_ini_reset_kv_pair_iterator(s);
+    for (u32 i = 0; i < n; i++) {
+        HglIniKVPair *kv = hgl_ini_next_kv_pair(s);
+        if (uniform_parse_global_declaration(kv, &types[i], &names[i]) != 0) {
+            return -1;
+        }
+        srcs[i] = kv->val;
+    }
+
+    if (sel_define_globals(names, types, srcs, n) != 0) {
+        return -1;
+    }
+    sel_update_globals();
+    return 0;
+}
+
+/* Costliest first, constant expressions last */
+static i32 sel_dump_entry_compare(const void *a, const void *b)
+{
+    const ExeExpr *ea = ((const SelDumpEntry *)a)->uniform->exe;
+    const ExeExpr *eb = ((const SelDumpEntry *)b)->uniform->exe;
+    b8 a_const = (ea->qualifier & QUALIFIER_CONST) != 0;
+    b8 b_const = (eb->qualifier & QUALIFIER_CONST) != 0;
+    if (a_const != b_const) {
+        return a_const - b_const;
+    }
+    return (ea->cost < eb->cost) - (ea->cost > eb->cost);
+}
+
 static void shaq_atexit_()
 {
+    sel_stop_workers();
+
     log_print_info_log();
     log_print_error_log();
 
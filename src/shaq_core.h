@@ -21,6 +21,8 @@ void shaq_begin(const char *ini_filepath, bool quiet);
 b8 shaq_should_close(void);
 void shaq_new_frame(void);
 void shaq_end(void);
+i32 shaq_render_tiled(const char *output_filepath, IVec2 resolution, i32 tile_size, i32 overlap);
+i32 shaq_dump_sel(void);
 
 void shaq_reset_time(void);
 f32 shaq_time(void);
@@ -29,6 +31,9 @@ i32 shaq_frame_count(void);
 void shaq_toggle_time_pause(void);
 b8 shaq_reloaded_this_frame(void);
 b8 shaq_reloaded_last_frame(void);
+b8 shaq_is_rendering_tiled(void);
+IVec2 shaq_tile_offset(void);
+IVec2 shaq_tiled_output_resolution(void);
 
 b8 shaq_has_loaded_project(void);
 Shader *shaq_find_shader_by_name(StringView name);
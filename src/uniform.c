@@ -6,12 +6,16 @@
 
 #include "glad/glad.h"
 
+#include <string.h>
+
 /*--- Private macros --------------------------------------------------------------------*/
 
 /*--- Private type definitions ----------------------------------------------------------*/
 
 /*--- Private function prototypes -------------------------------------------------------*/
 
+static i32 parse_declaration(StringView decl, const char *key, Type *type, StringView *name);
+static i32 parse_array_size(StringView *decl, const char *key, u32 *count);
 static size_t whitespace_lexeme(StringView sv);
 static size_t identifier_lexeme(StringView sv);
 
@@ -36,42 +40,22 @@ i32 uniform_parse_from_ini_kv_pair(Uniform *u, HglIniKVPair *kv)
         return -1;
     }
 
-    /* expect type identifier */
-    k = sv_ltrim(k);
-    if      (sv_starts_with_lchop(&k, "bool"))      { u->type = TYPE_BOOL;    }
-    else if (sv_starts_with_lchop(&k, "int"))       { u->type = TYPE_INT;     }
-    else if (sv_starts_with_lchop(&k, "uint"))      { u->type = TYPE_UINT;    }
-    else if (sv_starts_with_lchop(&k, "float"))     { u->type = TYPE_FLOAT;   }
-    else if (sv_starts_with_lchop(&k, "vec2"))      { u->type = TYPE_VEC2;    }
-    else if (sv_starts_with_lchop(&k, "vec3"))      { u->type = TYPE_VEC3;    }
-    else if (sv_starts_with_lchop(&k, "vec4"))      { u->type = TYPE_VEC4;    }
-    else if (sv_starts_with_lchop(&k, "ivec2"))     { u->type = TYPE_IVEC2;   }
-    else if (sv_starts_with_lchop(&k, "ivec3"))     { u->type = TYPE_IVEC3;   }
-    else if (sv_starts_with_lchop(&k, "ivec4"))     { u->type = TYPE_IVEC4;   }
-    else if (sv_starts_with_lchop(&k, "mat2"))      { u->type = TYPE_MAT2;    }
-    else if (sv_starts_with_lchop(&k, "mat3"))      { u->type = TYPE_MAT3;    }
-    else if (sv_starts_with_lchop(&k, "mat4"))      { u->type = TYPE_MAT4;    }
-    else if (sv_starts_with_lchop(&k, "sampler2D")) { u->type = TYPE_TEXTURE; }
-    else {
-        log_error("Unknown or unsupported type in left-hand-side expression: `%s`.", kv->key);
+    if (parse_array_size(&k, kv->key, &u->count) != 0) {
         return -1;
     }
 
-    /* expect whitespace */
-    if (!sv_starts_with_lexeme(&k, whitespace_lexeme)) {
-        log_error("Malformed left-hand-side expression: `%s`.", kv->key);
+    if (parse_declaration(k, kv->key, &u->type, &u->name) != 0) {
         return -1;
     }
 
-    /* expect type identifier */
-    k = sv_ltrim(k);
-    u->name = sv_lchop_lexeme(&k, identifier_lexeme);
-    if (u->name.length == 0) {
-        log_error("Malformed left-hand-side expression: `%s`.", kv->key);
+    if (u->count > 0 && u->type == TYPE_TEXTURE) {
+        log_error("Arrays of samplers are not supported: `%s`.", kv->key);
         return -1;
     }
 
     u->exe = sel_compile(kv->val);
+    u->value = NULL;
+    u->values = NULL;
 
     if (u->exe == NULL) {
         log_error("Could not compile expression: `%s`.", kv->val);
@@ -84,10 +68,44 @@ i32 uniform_parse_from_ini_kv_pair(Uniform *u, HglIniKVPair *kv)
         return -1;
     }
 
+    if (u->count == 0 && (u->exe->n_elements > 0 || u->exe->calls_index)) {
+        log_error("`array()` and `index()` are only allowed in the expressions of array uniforms: `%s`.", kv->val);
+        return -1;
+    }
+
+    if (u->exe->n_elements > 0 && u->exe->n_elements != u->count) {
+        log_error("`%s` declares %u elements, but `array()` has %u arguments.", 
+                  kv->key, u->count, u->exe->n_elements);
+        return -1;
+    }
+
+    if (u->count > 0 && u->exe->n_states > 0) {
+        log_error("Stateful builtins keep a single state, not one per element, and are not allowed in "
+                  "the expressions of array uniforms: `%s`.", kv->val);
+        return -1;
+    }
+
+    if (u->count > 0) {
+        u->values = r2r_arena_alloc(u->count * TYPE_TO_SIZE[u->type]);
+        if (u->values == NULL) {
+            log_error("Out of memory for the elements of `%s`.", kv->key);
+            return -1;
+        }
+    }
+
     return 0;
 }
 
-void uniform_map_shader_uniform(Uniform *u, u32 shader_program)
+/* 
+ * Parses the left-hand side `<type> <name>` of the declaration of a global (see 
+ * `sel_define_globals()`). The types are those of uniforms.
+ */
+i32 uniform_parse_global_declaration(HglIniKVPair *kv, Type *type, StringView *name)
+{
+    return parse_declaration(sv_trim(sv_from_cstr(kv->key)), kv->key, type, name);
+}
+
+void uniform_map_shader_uniform(Uniform *u, u32 shader_program, StringView prefix)
 {
     static const i32 sel_to_gl_type[N_TYPES] = {
         [TYPE_BOOL]    = GL_BOOL,
@@ -107,9 +125,16 @@ void uniform_map_shader_uniform(Uniform *u, u32 shader_program)
     };
 
     u->gl_uniform_location = -1;
+    u->is_uploaded = false;
     u32 index = GL_INVALID_INDEX;
     i32 type = -1;
-    const char *name_cstr = hgl_sv_make_cstr_copy(u->name, tmp_alloc);
+    /* arrays are queried by their first element, which is how GL names active arrays */
+    const char *suffix = (u->count > 0) ? "[0]" : "";
+    char *name = tmp_alloc(prefix.length + u->name.length + strlen(suffix) + 1);
+    memcpy(name, prefix.start, prefix.length);
+    memcpy(&name[prefix.length], u->name.start, u->name.length);
+    strcpy(&name[prefix.length + u->name.length], suffix);
+    const char *name_cstr = name;
     u->gl_uniform_location = glGetUniformLocation(shader_program, name_cstr);
     if (u->gl_uniform_location == -1) {
         log_error("Could not locate uniform variable: `%s`.", name_cstr);
@@ -129,8 +154,104 @@ void uniform_map_shader_uniform(Uniform *u, u32 shader_program)
     }
 }
 
+/* 
+ * The value last computed for `u`, by the frame program or by evaluating `u->exe`. 
+ * The first element, for arrays.
+ */
+SelValue uniform_get_value(const Uniform *u)
+{
+    if (u->count > 0) {
+        SelValue v = {0};
+        memcpy(&v, u->values, TYPE_TO_SIZE[u->type]);
+        return v;
+    }
+    if (u->value == NULL) {
+        return u->exe->cached_computed_value;
+    }
+    SelValue v = {0};
+    memcpy(&v, u->value, TYPE_TO_SIZE[u->type]);
+    return v;
+}
+
 /*--- Private functions -----------------------------------------------------------------*/
 
+/* Parses `<type> <name>`, the rest of the left-hand-side expression `key` */
+static i32 parse_declaration(StringView decl, const char *key, Type *type, StringView *name)
+{
+    /* expect type identifier */
+    decl = sv_ltrim(decl);
+    if      (sv_starts_with_lchop(&decl, "bool"))      { *type = TYPE_BOOL;    }
+    else if (sv_starts_with_lchop(&decl, "int"))       { *type = TYPE_INT;     }
+    else if (sv_starts_with_lchop(&decl, "uint"))      { *type = TYPE_UINT;    }
+    else if (sv_starts_with_lchop(&decl, "float"))     { *type = TYPE_FLOAT;   }
+    else if (sv_starts_with_lchop(&decl, "vec2"))      { *type = TYPE_VEC2;    }
+    else if (sv_starts_with_lchop(&decl, "vec3"))      { *type = TYPE_VEC3;    }
+    else if (sv_starts_with_lchop(&decl, "vec4"))      { *type = TYPE_VEC4;    }
+    else if (sv_starts_with_lchop(&decl, "ivec2"))     { *type = TYPE_IVEC2;   }
+    else if (sv_starts_with_lchop(&decl, "ivec3"))     { *type = TYPE_IVEC3;   }
+    else if (sv_starts_with_lchop(&decl, "ivec4"))     { *type = TYPE_IVEC4;   }
+    else if (sv_starts_with_lchop(&decl, "mat2"))      { *type = TYPE_MAT2;    }
+    else if (sv_starts_with_lchop(&decl, "mat3"))      { *type = TYPE_MAT3;    }
+    else if (sv_starts_with_lchop(&decl, "mat4"))      { *type = TYPE_MAT4;    }
+    else if (sv_starts_with_lchop(&decl, "sampler2D")) { *type = TYPE_TEXTURE; }
+    else {
+        log_error("Unknown or unsupported type in left-hand-side expression: `%s`.", key);
+        return -1;
+    }
+
+    /* expect whitespace */
+    if (!sv_starts_with_lexeme(&decl, whitespace_lexeme)) {
+        log_error("Malformed left-hand-side expression: `%s`.", key);
+        return -1;
+    }
+
+    /* expect identifier */
+    decl = sv_ltrim(decl);
+    *name = sv_lchop_lexeme(&decl, identifier_lexeme);
+    if (name->length == 0) {
+        log_error("Malformed left-hand-side expression: `%s`.", key);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* 
+ * Chops the array size `[N]` off the end of the left-hand-side expression `key`, if it 
+ * declares an array. `count` is 0 otherwise.
+ */
+static i32 parse_array_size(StringView *decl, const char *key, u32 *count)
+{
+    *count = 0;
+    *decl = sv_rtrim(*decl);
+    if (!sv_ends_with(decl, "]")) {
+        return 0;
+    }
+
+    size_t open = decl->length - 1;
+    while (open > 0 && decl->start[open] != '[') {
+        open--;
+    }
+    StringView size = sv_trim(sv_substr(*decl, open + 1, decl->length - open - 2));
+    b8 is_number = (decl->start[open] == '[') && (size.length > 0) && (size.length < 6);
+    for (size_t i = 0; i < size.length; i++) {
+        is_number &= (isdigit(size.start[i]) != 0);
+    }
+    if (!is_number) {
+        log_error("Malformed array size in left-hand-side expression: `%s`.", key);
+        return -1;
+    }
+
+    *count = (u32) sv_to_u64(size);
+    if (*count == 0 || *count > SEL_MAX_ARRAY_SIZE) {
+        log_error("The size of an array must be between 1 and %d: `%s`.", SEL_MAX_ARRAY_SIZE, key);
+        return -1;
+    }
+    decl->length = open;
+
+    return 0;
+}
+
 static size_t whitespace_lexeme(StringView sv)
 {
     if (sv.length < 1) return 0;
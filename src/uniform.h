@@ -16,9 +16,14 @@ typedef struct {
     StringView name;
     Type type;
     ExeExpr *exe;
+    u8 *value; /* where the frame program leaves the value of `exe`, or NULL */
+    u32 count; /* the number of elements of an array uniform, or 0 */
+    u8 *values; /* the `count` elements of an array uniform, packed */
 
     /* OpenGL */
     i32 gl_uniform_location;
+    b8 is_uploaded;    /* whether the program holds `uploaded` */
+    SelValue uploaded; /* the value last passed to glUniform*() */
 } Uniform;
 
 /*--- Public variables ------------------------------------------------------------------*/
@@ -26,7 +31,9 @@ typedef struct {
 /*--- Public function prototypes --------------------------------------------------------*/
 
 i32 uniform_parse_from_ini_kv_pair(Uniform *u, HglIniKVPair *kv);
-void uniform_map_shader_uniform(Uniform *u, u32 shader_program);
+i32 uniform_parse_global_declaration(HglIniKVPair *kv, Type *type, StringView *name);
+void uniform_map_shader_uniform(Uniform *u, u32 shader_program, StringView prefix);
+SelValue uniform_get_value(const Uniform *u);
 
 #endif /* UNIFORM_H */
 
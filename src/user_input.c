@@ -6,6 +6,9 @@
 #include "shaq_core.h"
 #include "gui.h"
 #include "imguic.h"
+#include "sel.h"
+
+#include <string.h>
 
 /*--- Private macros --------------------------------------------------------------------*/
 
@@ -17,7 +20,7 @@
 
 /*--- Private variables -----------------------------------------------------------------*/
 
-static struct {
+static struct UserInput {
     b8 should_reload;
 
     Vec2 mouse_position;
@@ -35,6 +38,7 @@ static struct {
 
 void user_input_poll()
 {
+    struct UserInput last = user_input;
     user_input.should_reload = false;
     user_input.key_pressed_bitfield = 0u;
     user_input.mouse_position_last = user_input.mouse_position;
@@ -82,6 +86,21 @@ void user_input_poll()
             }
         }
     }
+
+    /* Let the SVM know which inputs changed */
+    if (memcmp(&last.mouse_position, &user_input.mouse_position, sizeof(Vec2)) != 0 ||
+        memcmp(&last.mouse_position_last, &user_input.mouse_position_last, sizeof(Vec2)) != 0 ||
+        memcmp(&last.mouse_drag_position, &user_input.mouse_drag_position, sizeof(Vec2)) != 0 ||
+        last.lmb_is_down != user_input.lmb_is_down ||
+        last.rmb_is_down != user_input.rmb_is_down ||
+        last.lmb_was_down_last_frame != user_input.lmb_was_down_last_frame ||
+        last.rmb_was_down_last_frame != user_input.rmb_was_down_last_frame) {
+        sel_signal(SEL_DEP_MOUSE);
+    }
+    if (last.key_down_bitfield != user_input.key_down_bitfield ||
+        last.key_pressed_bitfield != user_input.key_pressed_bitfield) {
+        sel_signal(SEL_DEP_KEYBOARD);
+    }
 }
 
 b8 user_input_should_reload()
@@ -1,7 +1,256 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "sel.h"
 #include "alloc.h"
+#include "util.h"
+
+/* Builtins of vectors and matrices, most of them computed by the vector kernels of the SVM */
+static const char *const KERNEL_BUILTINS[] = {
+    "vec4_distance", "vec4_length", "vec4_normalize", "vec4_dot", "vec4_mul_scalar", "vec4_lerp", 
+    "vec3_slerp", "mat4_scale", "mat4_rotate", "mat4_translate", "mat4_mul_mat4", "mat4_mul_vec4", 
+    "mat4_mul_scalar",
+};
+#define N_KERNEL_BUILTINS (sizeof(KERNEL_BUILTINS) / sizeof(KERNEL_BUILTINS[0]))
+
+/* 
+ * The scalar hglm function of `KERNEL_BUILTINS[k]`, called with the arguments `a`. Not 
+ * inlined, as the builtins are not either.
+ */
+__attribute__((noinline)) static SelValue kernel_reference(u32 k, const f32 *a)
+{
+    Vec3 u3, v3;
+    Vec4 u4, v4;
+    Mat4 m, n;
+    memcpy(&u3, &a[0], sizeof(Vec3));
+    memcpy(&v3, &a[3], sizeof(Vec3));
+    memcpy(&u4, &a[0], sizeof(Vec4));
+    memcpy(&v4, &a[4], sizeof(Vec4));
+    memcpy(&m, &a[0], sizeof(Mat4));
+    memcpy(&n, &a[16], sizeof(Mat4));
+    switch (k) {
+        case 0:  return (SelValue) {.val_f32 = vec4_distance(u4, v4)};
+        case 1:  return (SelValue) {.val_f32 = vec4_len(u4)};
+        case 2:  return (SelValue) {.val_vec4 = vec4_normalize(u4)};
+        case 3:  return (SelValue) {.val_f32 = vec4_dot(u4, v4)};
+        case 4:  return (SelValue) {.val_vec4 = vec4_mul_scalar(u4, a[4])};
+        case 5:  return (SelValue) {.val_vec4 = vec4_lerp(u4, v4, a[8])};
+        case 6:  return (SelValue) {.val_vec3 = vec3_slerp(u3, v3, a[6])};
+        case 7:  return (SelValue) {.val_mat4 = mat4_scale(m, n.c0.xyz)};
+        case 8:  return (SelValue) {.val_mat4 = mat4_rotate(m, a[16], vec3_make(a[17], a[18], a[19]))};
+        case 9:  return (SelValue) {.val_mat4 = mat4_translate(m, n.c0.xyz)};
+        case 10: return (SelValue) {.val_mat4 = mat4_mul_mat4(m, n)};
+        case 11: return (SelValue) {.val_vec4 = mat4_mul_vec4(m, n.c0)};
+        case 12: return (SelValue) {.val_mat4 = mat4_mul_scalar(m, a[16])};
+        default: return (SelValue) {0};
+    }
+}
+
+/* All of a result is used, so that no part of the scalar code is optimized away */
+static f32 sum_floats(const SelValue *v, u32 size)
+{
+    f32 sum = 0.0f;
+    for (u32 i = 0; i < size / sizeof(f32); i++) {
+        f32 x;
+        memcpy(&x, (const u8 *)v + i*sizeof(f32), sizeof(f32));
+        sum += x;
+    }
+    return sum;
+}
+
+/* 
+ * Calls the builtins of `KERNEL_BUILTINS` with 256 random arguments each, and 
+ * returns the number of results that differ from those of the scalar functions by as 
+ * much as a bit. The arguments are packed, so they are misaligned on purpose. With 
+ * `print_times`, also prints the time per call of both, over `n` calls.
+ */
+static u32 compare_kernels(u32 n, b8 print_times)
+{
+    static f32 args[256][33];
+    for (u32 i = 0; i < 256; i++) {
+        for (u32 j = 0; j < 33; j++) {
+            u32 r = (u32) rand();
+            args[i][j] = (r % 13 == 0) ? ((r & 256) ? -0.0f : 0.0f) : (f32) r / (f32) RAND_MAX * 2.0f - 1.0f;
+        }
+    }
+
+    u32 n_mismatches = 0;
+    for (u32 k = 0; k < N_KERNEL_BUILTINS; k++) {
+        const Func *func = NULL;
+        for (u32 i = 0; i < N_BUILTIN_FUNCTIONS; i++) {
+            if (sv_equals(BUILTIN_FUNCTIONS[i].id, sv_from_cstr(KERNEL_BUILTINS[k]))) {
+                func = &BUILTIN_FUNCTIONS[i];
+            }
+        }
+        if (func == NULL) {
+            printf("%s is not a builtin\n", KERNEL_BUILTINS[k]);
+            n_mismatches++;
+            continue;
+        }
+
+        u32 size = TYPE_TO_SIZE[func->type];
+        f32 packed[34];
+        f32 sink = 0.0f;
+        for (u32 i = 0; i < 256; i++) {
+            memcpy(&packed[1], args[i], sizeof(args[i]));
+            SelValue r = func->impl(&packed[1]);
+            SelValue r_scalar = kernel_reference(k, args[i]);
+            if (memcmp(&r, &r_scalar, size) != 0) {
+                printf("mismatch: %s differs from the scalar code for argument set %u\n", KERNEL_BUILTINS[k], i);
+                n_mismatches++;
+                break;
+            }
+        }
+        if (!print_times) {
+            continue;
+        }
+
+        u64 t0 = util_get_time_nanos();
+        for (u32 i = 0; i < n; i++) {
+            memcpy(&packed[1], args[i % 256], sizeof(args[0]));
+            SelValue r = func->impl(&packed[1]);
+            sink += sum_floats(&r, size);
+        }
+        u64 t1 = util_get_time_nanos();
+        for (u32 i = 0; i < n; i++) {
+            memcpy(&packed[1], args[i % 256], sizeof(args[0]));
+            SelValue r = kernel_reference(k, &packed[1]);
+            sink += sum_floats(&r, size);
+        }
+        u64 t2 = util_get_time_nanos();
+        printf("%-16s builtin %6.1f ns/call, scalar hglm %6.1f ns/call (%s)\n", KERNEL_BUILTINS[k], 
+               (f64)(t1 - t0) / n, (f64)(t2 - t1) / n, (sink > 0.0f) ? "+" : "-");
+    }
+    return n_mismatches;
+}
+
+/* 
+ * Expressions sharing subexpressions (see `sel_end_session()`), one of them only in a 
+ * branch, which is taken once the global `g` exceeds 3
+ */
+static const char *const SHARING_EXPRS[] = {
+    "sin(g * 0.5) * 2.0 + (g * g + 1.0)",
+    "g > 3.0 ? sin(g * 0.5) - 1.0 : sqrt(g * g + 1.0)",
+    "vec2(sin(g * 0.5), g * g + 1.0)",
+};
+#define N_SHARING_EXPRS (sizeof(SHARING_EXPRS) / sizeof(SHARING_EXPRS[0]))
+
+/* 
+ * Compiles `SHARING_EXPRS` in one session, through the cache file `cache_path` unless 
+ * it is NULL, and returns the number of results of `sel_eval()` and of a frame program 
+ * that differ from those of unshared copies run by the stack VM, over enough frames 
+ * for both to be JIT compiled. `g` changes every frame.
+ */
+static u32 compare_shared(const char *cache_path)
+{
+    StringView name = SV_LIT("g");
+    Type type = TYPE_FLOAT;
+    const char *src = "deltatime()"; /* so that `g` is recomputed every frame */
+    ExeExpr *exes[N_SHARING_EXPRS];
+    ExeExpr *copies[N_SHARING_EXPRS];
+    SVMContext contexts[N_SHARING_EXPRS];
+    u8 *staged[N_SHARING_EXPRS];
+
+    if (cache_path != NULL) {
+        sel_cache_open(cache_path);
+    }
+    sel_begin_session();
+    if (sel_define_globals(&name, &type, &src, 1) != 0) return 1;
+    for (u32 i = 0; i < N_SHARING_EXPRS; i++) {
+        exes[i] = sel_compile(SHARING_EXPRS[i]);
+        if (exes[i] == NULL) return 1;
+        contexts[i] = SEL_EMPTY_SVM_CONTEXT;
+    }
+    sel_end_session();
+    sel_cache_close();
+
+    /* outside of a session, nothing is shared */
+    u32 n_mismatches = 0;
+    u32 n_shared = 0;
+    for (u32 i = 0; i < N_SHARING_EXPRS; i++) {
+        copies[i] = sel_compile(SHARING_EXPRS[i]);
+        if (copies[i] == NULL) return 1;
+        for (u32 j = 0; j < exes[i]->n_ops; j++) {
+            n_shared += (exes[i]->ops[j].code == REG_OP_SHARED);
+        }
+    }
+    if (n_shared == 0) {
+        printf("mismatch: the expressions of the session share nothing\n");
+        n_mismatches++;
+    }
+
+    ExeExpr *program = sel_link_frame_program(exes, contexts, N_SHARING_EXPRS, staged);
+    if (program == NULL) return 1;
+    for (i32 f = 0; f <= 2*SEL_JIT_THRESHOLD; f++) {
+        sel_begin_frame();
+        sel_set_global(0, (SelValue) {.val_f32 = 0.75f*(f32)f});
+        sel_run_frame_program(program);
+        for (u32 i = 0; i < N_SHARING_EXPRS; i++) {
+            u32 size = TYPE_TO_SIZE[exes[i]->type];
+            SelValue r_stack = sel_eval_stack(copies[i], contexts[i]);
+            SelValue r = sel_eval(exes[i], contexts[i], true);
+            if (memcmp(&r, &r_stack, size) != 0 || memcmp(staged[i], &r_stack, size) != 0) {
+                printf("mismatch: `%s` computed something else when shared, in frame %d%s\n", 
+                       SHARING_EXPRS[i], f, (cache_path != NULL) ? ", with the cache" : "");
+                n_mismatches++;
+            }
+        }
+    }
+
+    /* leave no globals behind */
+    sel_begin_session();
+    sel_end_session();
+    return n_mismatches;
+}
+
+/* 
+ * The same, compiled through a new cache file, and then loaded from it. Loading all 
+ * expressions from the file leaves it as it is.
+ */
+static u32 compare_cached(void)
+{
+    char path[] = "/tmp/seldbg_cache_XXXXXX";
+    i32 fd = mkstemp(path);
+    if (fd < 0) return 1;
+    close(fd);
+    unlink(path);
+
+    u32 n_mismatches = compare_shared(path);
+    struct stat before, after;
+    if (stat(path, &before) != 0) {
+        printf("mismatch: the cache file was not written\n");
+        return n_mismatches + 1;
+    }
+    n_mismatches += compare_shared(path);
+    if (stat(path, &after) != 0 || 
+        before.st_mtim.tv_sec != after.st_mtim.tv_sec || before.st_mtim.tv_nsec != after.st_mtim.tv_nsec) {
+        printf("mismatch: the expressions were not all loaded from the cache\n");
+        n_mismatches++;
+    }
+    unlink(path);
+    return n_mismatches;
+}
+
+/* 
+ * True if `e` calls a `FUNC_FLAG_VOLATILE` builtin. `index()` does not count, as it is 
+ * always 0 outside of array uniforms.
+ */
+static b8 calls_volatile(const ExeExpr *e)
+{
+    for (u32 i = 0; i < e->n_ops; i++) {
+        if (e->ops[i].kind != OP_FUNC) {
+            continue;
+        }
+        const Func *f = &BUILTIN_FUNCTIONS[e->ops[i].imm];
+        if ((f->flags & FUNC_FLAG_VOLATILE) && !sv_equals(f->id, SV_LIT("index"))) {
+            return true;
+        }
+    }
+    return false;
+}
 
 int main(int argc, char *argv[])
 {
@@ -9,6 +258,13 @@ int main(int argc, char *argv[])
 
     if (argc < 2) return 1;
 
+    /* the vector kernels must compute the bits of the scalar code they replace */
+    if (compare_kernels(0, false) != 0) return 3;
+
+    /* sharing subexpressions, and caching the code, must not change what expressions compute */
+    if (compare_shared(NULL) != 0) return 3;
+    if (compare_cached() != 0) return 3;
+
     ExeExpr *e = sel_compile(argv[1]);
     if (e == NULL) return 2;
     printf("type = %d\n", e->type);
@@ -16,4 +272,158 @@ int main(int argc, char *argv[])
     SelValue r = sel_eval(e, SEL_EMPTY_SVM_CONTEXT, false);
     sel_print_value(e->type, r);
     printf("\n");
+
+    /* 
+     * The register VM, and the native code it switches to once the expression is 
+     * hot, must agree with the reference stack VM. Widgets only report their 
+     * default value after the first evaluation has inserted them. Calls to volatile 
+     * builtins (e.g. `rand()`) differ between evaluations, so their results are only 
+     * printed.
+     */
+    b8 reproducible = !calls_volatile(e);
+    SelValue r_stack = sel_eval_stack(e, SEL_EMPTY_SVM_CONTEXT);
+    for (i32 i = 0; i <= SEL_JIT_THRESHOLD; i++) {
+        r = sel_eval(e, SEL_EMPTY_SVM_CONTEXT, true);
+        if (reproducible && memcmp(&r, &r_stack, TYPE_TO_SIZE[e->type]) != 0) {
+            printf("mismatch: the stack VM computed ");
+            sel_print_value(e->type, r_stack);
+            printf("\n");
+            return 3;
+        }
+    }
+
+    /* 
+     * The same, for the expression linked into a frame program. Every other run 
+     * finds the expression up to date and must leave the staged value alone.
+     */
+    SVMContext ctx = SEL_EMPTY_SVM_CONTEXT;
+    u8 *value = NULL;
+    ExeExpr *program = sel_link_frame_program(&e, &ctx, 1, &value);
+    if (program == NULL) return 2;
+    for (i32 i = 0; i <= 2*SEL_JIT_THRESHOLD; i++) {
+        if (i % 2 == 0) e->computed_at = 0;
+        sel_run_frame_program(program);
+        if (reproducible && memcmp(value, &r_stack, TYPE_TO_SIZE[e->type]) != 0) {
+            printf("mismatch: the frame program computed something else\n");
+            return 3;
+        }
+    }
+
+    /*
+     * ... and for copies of it, linked into frame programs of their own and run side by
+     * side, by the calling thread and the workers.
+     */
+    u32 n_programs = e->main_thread ? 1 : 1 + sel_start_workers(3);
+    ExeExpr *programs[SEL_MAX_N_WORKERS + 1];
+    u8 *staged[SEL_MAX_N_WORKERS + 1];
+    ExeExpr *copies[SEL_MAX_N_WORKERS + 1];
+    for (u32 i = 0; i < n_programs; i++) {
+        copies[i] = sel_compile(argv[1]);
+        if (copies[i] == NULL) return 2;
+        programs[i] = sel_link_frame_program(&copies[i], &ctx, 1, &staged[i]);
+        if (programs[i] == NULL) return 2;
+    }
+    for (i32 i = 0; i <= 2*SEL_JIT_THRESHOLD; i++) {
+        for (u32 j = 0; j < n_programs; j++) {
+            if (i % 2 == 0) copies[j]->computed_at = 0;
+        }
+        sel_run_frame_programs(programs, n_programs);
+        for (u32 j = 0; j < n_programs; j++) {
+            if (reproducible && memcmp(staged[j], &r_stack, TYPE_TO_SIZE[e->type]) != 0) {
+                printf("mismatch: frame program %u of %u computed something else\n", j, n_programs);
+                return 3;
+            }
+        }
+    }
+    sel_stop_workers();
+
+    /* ... and for the expression evaluated in a batch, lanes and leftovers alike */
+    SelValue batch[19];
+    if (sel_eval_batch(e, SEL_EMPTY_SVM_CONTEXT, NULL, 0, batch, 19) != 0) return 2;
+    for (i32 i = 0; i < 19; i++) {
+        if (reproducible && memcmp((u8 *)batch + i*TYPE_TO_SIZE[e->type], &r_stack, TYPE_TO_SIZE[e->type]) != 0) {
+            printf("mismatch: evaluation %d of the batch computed something else\n", i);
+            return 3;
+        }
+    }
+
+    /* 
+     * ... and for the expression computed as the elements of an array uniform, unless 
+     * the elements differ by their `index()`, which the stack VM can't be given
+     */
+    if (sel_eval_array(e, SEL_EMPTY_SVM_CONTEXT, batch, 19, true) != 1) return 2;
+    for (i32 i = 0; i < 19; i++) {
+        if (reproducible && !e->calls_index && 
+            memcmp((u8 *)batch + i*TYPE_TO_SIZE[e->type], &r_stack, TYPE_TO_SIZE[e->type]) != 0) {
+            printf("mismatch: element %d of the array computed something else\n", i);
+            return 3;
+        }
+    }
+
+    /* 
+     * Optionally time both VMs and the compiler: `seldbg <expr> <n_iterations>`, and 
+     * batch evaluation with the builtin `func` swept over 0, 1, ..., n - 1: 
+     * `seldbg <expr> <n> <func>`
+     */
+    if (argc > 2) {
+        i32 n = atoi(argv[2]);
+        if (n <= 0) return 1;
+
+        u64 t0 = util_get_time_nanos();
+        for (i32 i = 0; i < n; i++) {
+            (void) sel_eval(e, SEL_EMPTY_SVM_CONTEXT, true);
+        }
+        u64 t1 = util_get_time_nanos();
+        for (i32 i = 0; i < n; i++) {
+            (void) sel_eval_stack(e, SEL_EMPTY_SVM_CONTEXT);
+        }
+        u64 t2 = util_get_time_nanos();
+
+        f64 ns_registers = (f64)(t1 - t0) / n;
+        f64 ns_stack = (f64)(t2 - t1) / n;
+        printf("register VM: %8.1f ns/eval\n", ns_registers);
+        printf("stack VM:    %8.1f ns/eval (%.2fx)\n", ns_stack, ns_stack / ns_registers);
+
+        /* every compilation stays in the r2r arena, so at most 1000 of them */
+        i32 n_compiles = (n < 1000) ? n : 1000;
+        u64 t5 = util_get_time_nanos();
+        for (i32 i = 0; i < n_compiles; i++) {
+            if (sel_compile(argv[1]) == NULL) return 2;
+        }
+        u64 t6 = util_get_time_nanos();
+        printf("compile:     %8.1f us/expr\n", (f64)(t6 - t5) / n_compiles / 1e3);
+        (void) compare_kernels((u32) n, true);
+
+        if (argc > 3) {
+            Type t = TYPE_FLOAT;
+            for (u32 i = 0; i < N_BUILTIN_FUNCTIONS; i++) {
+                if (sv_equals(BUILTIN_FUNCTIONS[i].id, sv_from_cstr(argv[3]))) {
+                    t = BUILTIN_FUNCTIONS[i].type;
+                }
+            }
+            u32 *values = calloc(n, TYPE_TO_SIZE[t]);
+            u8 *results = calloc(n, TYPE_TO_SIZE[e->type]);
+            if (values == NULL || results == NULL) return 1;
+            for (i32 i = 0; i < n; i++) {
+                u32 *v = &values[i * TYPE_TO_SIZE[t] / sizeof(u32)];
+                if (t >= TYPE_FLOAT && t <= TYPE_VEC4) {
+                    f32 x = (f32) i;
+                    memcpy(v, &x, sizeof(f32));
+                } else {
+                    *v = (u32) i; /* int, uint and bool */
+                }
+            }
+            SelOverride sweep = {.func = sv_from_cstr(argv[3]), .values = values};
+
+            u64 t3 = util_get_time_nanos();
+            if (sel_eval_batch(e, SEL_EMPTY_SVM_CONTEXT, &sweep, 1, results, n) != 0) return 2;
+            u64 t4 = util_get_time_nanos();
+
+            f64 ns_batch = (f64)(t4 - t3) / n;
+            printf("batch:       %8.1f ns/eval (%.2fx), %.1f Mevals/s\n", 
+                   ns_batch, ns_registers / ns_batch, 1e3 / ns_batch);
+            free(values);
+            free(results);
+        }
+    }
 }